@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT = core gui printsupport qml serialbus serialport widgets help network
+QT = core gui printsupport qml serialbus serialport widgets help network concurrent
 
 CONFIG(release, debug|release):DEFINES += QT_NO_DEBUG_OUTPUT
 
@@ -13,10 +13,14 @@ CONFIG += NO_UNIT_TESTS
 
 DEFINES += QCUSTOMPLOT_USE_OPENGL
 
+#qmake CONFIG+=tracing builds in the TRACE_SCOPE timers, see utils/tracer.h
+tracing:DEFINES += CANOA_TRACING
+
 TARGET = CANOpenAnalyzer
 TEMPLATE = app
 
 SOURCES += main.cpp\
+    utils/tracer.cpp \
     connections/mqtt_bus.cpp \
     mqtt/qmqtt_client.cpp \
     mqtt/qmqtt_client_p.cpp \
@@ -40,6 +44,10 @@ SOURCES += main.cpp\
     candatagrid.cpp \
     framesenderwindow.cpp \
     framefileio.cpp \
+    capturearchive.cpp \
+    capturefile.cpp \
+    textlogparser.cpp \
+    framefileloader.cpp \
     mainsettingsdialog.cpp \
     firmwareuploaderwindow.cpp \
     scriptingwindow.cpp \
@@ -48,6 +56,7 @@ SOURCES += main.cpp\
     can_structs.cpp \
     motorcontrollerconfigwindow.cpp \
     connections/canconnection.cpp \
+    connections/cantimebase.cpp \
     connections/serialbusconnection.cpp \
     connections/canconfactory.cpp \
     connections/gvretserial.cpp \
@@ -92,6 +101,11 @@ SOURCES += main.cpp\
 HEADERS  += mainwindow.h \
     can_structs.h \
     canframemodel.h \     \
+    canframebatch.h \
+    canframestore.h \
+    canframeidindex.h \
+    compiledframefilter.h \
+    canframeview.h \
     connections/mqtt_bus.h \
     mqtt/qmqtt.h \
     mqtt/qmqtt_client.h \
@@ -121,6 +135,11 @@ HEADERS  += mainwindow.h \
     framesenderwindow.h \
     can_trigger_structs.h \
     framefileio.h \
+    capturearchive.h \
+    capturefile.h \
+    textlogparser.h \
+    framefileloader.h \
+    framestream.h \
     config.h \
     mainsettingsdialog.h \
     firmwareuploaderwindow.h \
@@ -128,8 +147,12 @@ HEADERS  += mainwindow.h \
     scriptcontainer.h \
     canfilter.h \
     utils/lfqueue.h \
+    utils/tracer.h \
     motorcontrollerconfigwindow.h \
     connections/canconnection.h \
+    connections/canconstats.h \
+    connections/cantargetfilters.h \
+    connections/cantimebase.h \
     connections/serialbusconnection.h \
     connections/canconconst.h \
     connections/canconfactory.h \
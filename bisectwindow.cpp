@@ -8,7 +8,7 @@
 #include <QDebug>
 #include <algorithm>
 
-BisectWindow::BisectWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+BisectWindow::BisectWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::BisectWindow)
 {
@@ -67,7 +67,12 @@ void BisectWindow::refreshIDList()
     foundID.clear();
     ui->cbIDLower->clear();
     ui->cbIDUpper->clear();
-    for (int i = 0; i < modelFrames->count(); i++)
+    const CANFrameIDIndex *idIndex = modelFrames->idIndex();
+    if (idIndex)
+    {
+        foreach (uint32_t indexedID, idIndex->ids()) foundID.append(static_cast<int>(indexedID));
+    }
+    else for (int i = 0; i < modelFrames->count(); i++)
     {
         id = modelFrames->at(i).frameId();
         if (!foundID.contains(id))
@@ -130,7 +135,20 @@ void BisectWindow::handleCalculateButton()
     {
         uint32_t lowerID = Utility::ParseStringToNum2(ui->cbIDLower->currentText());
         uint32_t upperID = Utility::ParseStringToNum2(ui->cbIDUpper->currentText());
-        for (int i = 0; i < modelFrames->count(); i++)
+        const CANFrameIDIndex *idIndex = modelFrames->idIndex();
+        if (idIndex)
+        {
+            //gather the rows of just the IDs in range then put them back in capture order
+            QVector<uint32_t> rows;
+            foreach (uint32_t id, idIndex->ids())
+            {
+                if (id >= lowerID && id <= upperID) rows += idIndex->rowsForID(id);
+            }
+            std::sort(rows.begin(), rows.end());
+            splitFrames.reserve(rows.count());
+            for (int i = 0; i < rows.count(); i++) splitFrames.append(modelFrames->at(static_cast<int>(rows[i])));
+        }
+        else for (int i = 0; i < modelFrames->count(); i++)
         {
             if (modelFrames->at(i).frameId() >= lowerID && modelFrames->at(i).frameId() <= upperID) splitFrames.append(modelFrames->at(i));
         }
@@ -152,7 +170,8 @@ void BisectWindow::handleSaveButton()
 {
     QMessageBox msg;
     QString filename;
-    if (FrameFileIO::saveFrameFile(filename, &splitFrames))
+    CANFrameView splitView(&splitFrames);
+    if (FrameFileIO::saveFrameFile(filename, &splitView))
     {
         msg.setText(tr("Successfully saved file"));
     }
@@ -3,6 +3,7 @@
 
 #include <QDialog>
 #include "can_structs.h"
+#include "canframeview.h"
 
 namespace Ui {
 class BisectWindow;
@@ -13,7 +14,7 @@ class BisectWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit BisectWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit BisectWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~BisectWindow();
     void showEvent(QShowEvent*);
 
@@ -33,7 +34,7 @@ private slots:
 
 private:
     Ui::BisectWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QVector<CANFrame> splitFrames;
     QList<int> foundID;
 
@@ -3,6 +3,7 @@
 #include <QFile>
 #include <QString>
 #include <QtEndian>
+#include <string.h>
 
 #define BLF_REMOTE_FLAG 0x80
 
@@ -19,152 +20,153 @@ https://bitbucket.org/tobylorenz/vector_blf/
 All the code actually below is freshly written but heavily based upon things seen in those
 two source repos.
 */
-bool BLFHandler::loadBLF(QString filename, QVector<CANFrame>* frames)
+bool BLFReader::open(const QString &filename)
 {
-    BLF_OBJ_HEADER objHeader;
-    QByteArray fileData;
-    QByteArray uncompressedData;
-    QByteArray junk;
-    BLF_OBJECT obj;
-    uint32_t pos;
-    BLF_CAN_OBJ canObject;
-    BLF_CAN_OBJ2 canObject2;
+    BLF_FILE_HEADER header;
 
-    QFile *inFile = new QFile(filename);
+    mOk = false;
+    mFile.setFileName(filename);
+    if (!mFile.open(QIODevice::ReadOnly)) return false;
+    if (mFile.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)) return false;
+    if (qFromLittleEndian(header.sig) != 0x47474F4C) return false; //"LOGG"
+    mOk = true;
+    return true;
+}
 
-    if (!inFile->open(QIODevice::ReadOnly))
+int BLFReader::read(CANFrame *frames, int max)
+{
+    int done = 0;
+    while (done < max)
     {
-        delete inFile;
-        return false;
+        if (nextFrame(frames[done])) done++;
+        else if (!nextContainer()) break;
     }
-    inFile->read((char *)&header, sizeof(header));
-    if (qFromLittleEndian(header.sig) == 0x47474F4C)
+    return done;
+}
+
+//the rest of the file can't be trusted once an object doesn't make sense
+void BLFReader::fail()
+{
+    mOk = false;
+    mData.clear();
+    mPos = 0;
+}
+
+//reads on to the next container and unpacks it behind what is left of the one before. False at the end of the file
+bool BLFReader::nextContainer()
+{
+    BLF_OBJ_HEADER_BASE base;
+    BLF_OBJ_HEADER_CONTAINER container;
+
+    mData.remove(0, mPos);
+    mPos = 0;
+    while (mOk && !mFile.atEnd())
     {
-        qDebug() << "Proper BLF file header token";
+        if (mFile.read(reinterpret_cast<char *>(&base), sizeof(base)) != sizeof(base)
+                || qFromLittleEndian(base.sig) != 0x4A424F4C || base.objSize < sizeof(base)) //"LOBJ"
+        {
+            fail();
+            break;
+        }
+        int readSize = static_cast<int>(base.objSize - sizeof(BLF_OBJ_HEADER_BASE));
+        QByteArray fileData = mFile.read(readSize);
+        mFile.read(readSize % 4); //file is padded so sizes must always end up on even multiple of 4
+        if (base.objType != BLF_CONTAINER) continue;
+        if (fileData.count() < static_cast<int>(sizeof(container)))
+        {
+            fail();
+            break;
+        }
+
+        memcpy(&container, fileData.constData(), sizeof(container));
+        fileData.remove(0, sizeof(container));
+        if (container.compressionMethod == BLF_CONT_NO_COMPRESSION)
+        {
+            mData += fileData;
+        }
+        else if (container.compressionMethod == BLF_CONT_ZLIB_COMPRESSION)
+        {
+            //qUncompress wants the unpacked size in front, big endian
+            fileData.prepend(container.uncompressedSize & 0xFF);
+            fileData.prepend((container.uncompressedSize >> 8) & 0xFF);
+            fileData.prepend((container.uncompressedSize >> 16) & 0xFF);
+            fileData.prepend((container.uncompressedSize >> 24) & 0xFF);
+            mData += qUncompress(fileData);
+        }
+        else
+        {
+            qDebug() << "Dunno what this is... " << container.compressionMethod;
+            continue;
+        }
+
+        //skip forward to an object header signature - usually not necessary
+        while (mPos + static_cast<int>(sizeof(BLF_OBJ_HEADER)) < mData.count())
+        {
+            uint32_t sig;
+            memcpy(&sig, mData.constData() + mPos, sizeof(sig));
+            if (sig == 0x4A424F4C) break;
+            mPos += 4;
+        }
+        return true;
     }
-    else return false;
+    return false;
+}
 
-    while (!inFile->atEnd())
+//the next CAN frame of the objects unpacked so far. False once they are used up
+bool BLFReader::nextFrame(CANFrame &frame)
+{
+    const int objHeaderSize = sizeof(BLF_OBJ_HEADER_BASE) + sizeof(BLF_OBJ_HEADER_V1);
+    BLF_OBJ_HEADER obj;
+    BLF_CAN_OBJ canObject;
+
+    while (mPos + static_cast<int>(sizeof(BLF_OBJ_HEADER)) < mData.count())
     {
-        qDebug() << "Position within file: " << inFile->pos();
-        inFile->read((char *)&objHeader.base, sizeof(BLF_OBJ_HEADER_BASE));
-        if (qFromLittleEndian(objHeader.base.sig) == 0x4A424F4C)
+        const char *objData = mData.constData() + mPos;
+        memcpy(&obj.base, objData, sizeof(BLF_OBJ_HEADER_BASE));
+        memcpy(&obj.v1Obj, objData + sizeof(BLF_OBJ_HEADER_BASE), sizeof(BLF_OBJ_HEADER_V1));
+        if (obj.base.objSize < static_cast<uint32_t>(objHeaderSize))
         {
-            int readSize = objHeader.base.objSize - sizeof(BLF_OBJ_HEADER_BASE);
-            qDebug() << "Proper object header token. Read Size: " << readSize;
-            fileData = inFile->read(readSize);
-            junk = inFile->read(readSize % 4); //file is padded so sizes must always end up on even multiple of 4
-            //qDebug() << "Fudge bytes in readSize: " << (readSize % 4);
+            fail();
+            return false;
+        }
+        //objects can be split over two containers, the rest of this one comes with the next
+        if (mPos + static_cast<qint64>(obj.base.objSize) > mData.count()) return false;
+        mPos += obj.base.objSize + (obj.base.objSize % 4);
 
-            switch (objHeader.base.objType)
+        if (obj.base.objType == BLF_CAN_MSG || obj.base.objType == BLF_CAN_MSG2)
+        {
+            //BLF_CAN_OBJ2 starts out the same as BLF_CAN_OBJ, the extra fields aren't needed
+            memset(&canObject, 0, sizeof(canObject));
+            memcpy(&canObject, objData + objHeaderSize, qMin(sizeof(canObject), static_cast<size_t>(obj.base.objSize - objHeaderSize)));
+            frame = CANFrame();
+            frame.bus = canObject.channel;
+            frame.setExtendedFrameFormat((canObject.id & 0x80000000ull)?true:false);
+            frame.setFrameId(canObject.id & 0x1FFFFFFFull);
+            frame.isReceived = true;
+            int dlc = qMin(static_cast<int>(canObject.dlc), 8);
+            if (canObject.flags & BLF_REMOTE_FLAG)
+            {
+                unsigned char bytes[8] = {0};
+                frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+                frame.setPayload(bytes, dlc);
+            }
+            else
             {
-                case BLF_CONTAINER:
-                qDebug() << "Object is a container.";
-                memcpy(&objHeader.containerObj, fileData.constData(), sizeof(BLF_OBJ_HEADER_CONTAINER));
-                fileData.remove(0, sizeof(BLF_OBJ_HEADER_CONTAINER));
-                if (objHeader.containerObj.compressionMethod == BLF_CONT_NO_COMPRESSION)
-                {
-                    qDebug() << "Container is not compressed";
-                    uncompressedData = fileData;
-                }
-                else if (objHeader.containerObj.compressionMethod == BLF_CONT_ZLIB_COMPRESSION)
-                {
-                    qDebug() << "Compressed container. Unpacking it.";
-                    fileData.prepend(objHeader.containerObj.uncompressedSize & 0xFF);
-                    fileData.prepend((objHeader.containerObj.uncompressedSize >> 8) & 0xFF);
-                    fileData.prepend((objHeader.containerObj.uncompressedSize >> 16) & 0xFF);
-                    fileData.prepend((objHeader.containerObj.uncompressedSize >> 24) & 0xFF);
-                    uncompressedData += qUncompress(fileData);
-                }
-                else
-                {
-                    qDebug() << "Dunno what this is... " << objHeader.containerObj.compressionMethod;
-                }
-                qDebug() << "Uncompressed size: " << uncompressedData.count();
-                qDebug() << "Currently loaded frames at this point: " << frames->count();
-                pos = 0;
-                //bool foundHeader = false;
-                //first skip forward to find a header signature - usually not necessary
-                while ( (int)(pos + sizeof(BLF_OBJ_HEADER)) < uncompressedData.count())
-                {
-                    int32_t *headerSig = (int32_t *)(uncompressedData.constData() + pos);
-                    if (*headerSig == 0x4A424F4C) break;
-                    pos += 4;
-                }
-                //then process all the objects
-                while ( (int)(pos + sizeof(BLF_OBJ_HEADER)) < uncompressedData.count())
-                {
-                    memcpy(&obj.header.base, (uncompressedData.constData() + pos), sizeof(BLF_OBJ_HEADER_BASE));
-                    memcpy(&obj.header.v1Obj, (uncompressedData.constData() + pos) + sizeof(BLF_OBJ_HEADER_BASE), sizeof(BLF_OBJ_HEADER_V1));
-                    //if (obj.header.base.objType != 1)
-                        //qDebug() << "Pos: " << pos << " Type: " << obj.header.base.objType << "Obj Size: " << obj.header.base.objSize;
-                    if (qFromLittleEndian(objHeader.base.sig) == 0x4A424F4C)
-                    {
-                        fileData = uncompressedData.mid(pos + sizeof(BLF_OBJ_HEADER_BASE) + sizeof(BLF_OBJ_HEADER_V1), obj.header.base.objSize - sizeof(BLF_OBJ_HEADER_BASE) - sizeof(BLF_OBJ_HEADER_V1));
-                        if (obj.header.base.objType == BLF_CAN_MSG)
-                        {
-                            memcpy(&canObject, fileData.constData(), sizeof(BLF_CAN_OBJ));
-                            CANFrame frame;
-                            frame.bus = canObject.channel;
-                            frame.setExtendedFrameFormat((canObject.id & 0x80000000ull)?true:false);
-                            frame.setFrameId(canObject.id & 0x1FFFFFFFull);
-                            frame.isReceived = true;
-                            QByteArray bytes(canObject.dlc, 0);
-
-                            if (canObject.flags & BLF_REMOTE_FLAG) {
-                                frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                            } else {
-                                frame.setFrameType(QCanBusFrame::DataFrame);
-                                for (int i = 0; i < canObject.dlc; i++) bytes[i] = canObject.data[i];
-                            }
-                            frame.setPayload(bytes);
-                            //Should we divide by a thousand or a million? Unsure here. It appears some logs are stamped in microseconds and some in milliseconds?
-                            frame.setTimeStamp(QCanBusFrame::TimeStamp(0, obj.header.v1Obj.uncompSize / 1000.0)); //uncompsize field also used for timestamp oddly enough
-                            frames->append(frame);
-                        }
-                        else if (obj.header.base.objType == BLF_CAN_MSG2)
-                        {
-                            memcpy(&canObject2, fileData.constData(), sizeof(BLF_CAN_OBJ2));
-                            CANFrame frame;
-                            frame.bus = canObject2.channel;
-                            frame.setExtendedFrameFormat((canObject2.id & 0x80000000ull)?true:false);
-                            frame.setFrameId(canObject2.id & 0x1FFFFFFFull);
-                            frame.isReceived = true;
-                            QByteArray bytes(canObject2.dlc, 0);
-
-                            if (canObject2.flags & BLF_REMOTE_FLAG) {
-                                frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                            } else {
-                                frame.setFrameType(QCanBusFrame::DataFrame);
-                                for (int i = 0; i < canObject2.dlc; i++) bytes[i] = canObject2.data[i];
-                            }
-                            //Should we divide by a thousand or a million? Unsure here. It appears some logs are stamped in microseconds and some in milliseconds?
-                            frame.setTimeStamp(QCanBusFrame::TimeStamp(0, obj.header.v1Obj.uncompSize / 1000.0)); //uncompsize field also used for timestamp oddly enough
-                            frames->append(frame);
-                        }
-                        else
-                        {
-                            qDebug() << "Not a can frame! ObjType: " << obj.header.base.objType;
-                            if (obj.header.base.objType > 0xFFFF)
-                                return false;
-                        }
-                        pos += obj.header.base.objSize + (obj.header.base.objSize % 4);
-                    }
-                    else
-                    {
-                        qDebug() << "Unexpected object header signature, aborting";
-                        return false;
-                    }
-                }
-                uncompressedData.remove(0, pos);
-                qDebug() << "After removing used data uncompressedData is now this big: " << uncompressedData.count();
-
-                break;
+                frame.setFrameType(QCanBusFrame::DataFrame);
+                frame.setPayload(canObject.data, dlc);
             }
+            //Should we divide by a thousand or a million? Unsure here. It appears some logs are stamped in microseconds and some in milliseconds?
+            frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(obj.v1Obj.uncompSize / 1000))); //uncompsize field also used for timestamp oddly enough
+            return true;
+        }
+        if (obj.base.objType > 0xFFFF)
+        {
+            qDebug() << "Unexpected BLF object type, aborting: " << obj.base.objType;
+            fail();
+            return false;
         }
-        else return false;
     }
-    return true;
+    return false;
 }
 
 bool BLFHandler::saveBLF(QString filename, QVector<CANFrame> *frames)
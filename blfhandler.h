@@ -3,8 +3,10 @@
 
 #include <Qt>
 #include <QByteArray>
+#include <QFile>
 #include <QList>
 #include "can_structs.h"
+#include "framestream.h"
 
 enum
 {
@@ -179,12 +181,33 @@ class BLFHandler
 {
 public:
     BLFHandler();
-    bool loadBLF(QString filename, QVector<CANFrame>* frames);
     bool saveBLF(QString filename, QVector<CANFrame>* frames);
+};
+
+//reads the CAN frames of a BLF file a container at a time, so only one container of objects is ever held
+class BLFReader : public FrameReader
+{
+public:
+    BLFReader() : mPos(0), mOk(false) {}
+
+    bool open(const QString &filename);
+
+    int read(CANFrame *frames, int max) override;
+    bool isOk() const override { return mOk; }
+    qint64 position() const override { return mFile.isOpen() ? mFile.pos() : 0; }
+    qint64 size() const override { return mFile.size(); }
 
 private:
-    BLF_FILE_HEADER header;
-    QList<BLF_OBJECT> objects;
+    Q_DISABLE_COPY(BLFReader)
+
+    bool nextContainer();
+    bool nextFrame(CANFrame &frame);
+    void fail();
+
+    QFile mFile;
+    QByteArray mData;   //unpacked objects of the containers read so far that haven't been gone through
+    int mPos;           //next object in mData
+    bool mOk;
 };
 
 #endif // BLFHANDLER_H
@@ -123,13 +123,11 @@ void ISOTP_HANDLER::updatedFrames(int numFrames)
     }
 }
 
-void ISOTP_HANDLER::rapidFrames(const CANConnection* conn, const QVector<CANFrame>& pFrames)
+void ISOTP_HANDLER::rapidFrames(const CANConnection* conn, const CANFrameBatch& pFrames)
 {
     Q_UNUSED(conn)
     if (pFrames.length() <= 0) return;
 
-    qDebug() << "received " << QString::number(pFrames.count()) << " messages in ISOTP handler";
-
     foreach(const CANFrame& thisFrame, pFrames)
     {
         //only process frames that we've marked are ISOTP frames
@@ -160,9 +158,9 @@ void ISOTP_HANDLER::processFrame(const CANFrame &frame)
     ISOTP_MESSAGE msg;
     ISOTP_MESSAGE *pMsg;
     QByteArray dataBytes;
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(frame.payload().constData());
-    //qDebug() << frame.payload().count();
-    //int dataLen = frame.payload().count();
+    const unsigned char *data = frame.payloadData();
+    //qDebug() << frame.payloadLength();
+    //int dataLen = frame.payloadLength();
 
     frameType = 0;
     frameLen = 0;
@@ -202,7 +200,7 @@ void ISOTP_HANDLER::processFrame(const CANFrame &frame)
         {       
             for (int j = 0; j < frameLen; j++)
             {
-                if (frame.payload().count() > (j+2))
+                if (frame.payloadLength() > (j+2))
                     dataBytes.append(data[j+2]);
             }
         }
@@ -210,7 +208,7 @@ void ISOTP_HANDLER::processFrame(const CANFrame &frame)
         {
             for (int j = 0; j < frameLen; j++)
             {
-                if (frame.payload().count() > (j+1))
+                if (frame.payloadLength() > (j+1))
                     dataBytes.append(data[j+1]);
             }
         }
@@ -221,7 +219,7 @@ void ISOTP_HANDLER::processFrame(const CANFrame &frame)
     case 1: //first frame of a multi-frame message
         checkNeedFlush(ID);
         msg.bus = frame.bus;
-        if (frame.payload().count() < 8) return; //MUST have all 8 data bytes in this first frame.
+        if (frame.payloadLength() < 8) return; //MUST have all 8 data bytes in this first frame.
         msg.setExtendedFrameFormat( frame.hasExtendedFrameFormat() );
         msg.setFrameId(ID);
         msg.setTimeStamp(frame.timeStamp());
@@ -273,7 +271,7 @@ void ISOTP_HANDLER::processFrame(const CANFrame &frame)
         if (!pMsg->isMultiframe) return; //if we didn't get a frame type 1 (start of multiframe) first then ignore this frame.
         dataBytes.clear();
         dataBytes.append(pMsg->payload());
-        ln = pMsg->reportedLength - pMsg->payload().count();
+        ln = pMsg->reportedLength - pMsg->payloadLength();
         //offset = pMsg->data.count();
         if (useExtendedAddressing)
         {
@@ -286,7 +284,7 @@ void ISOTP_HANDLER::processFrame(const CANFrame &frame)
             for (int j = 0; j < ln; j++) dataBytes.append(frame.payload()[j+1]);
         }
         pMsg->setPayload(dataBytes);
-        if (pMsg->reportedLength <= pMsg->payload().count())
+        if (pMsg->reportedLength <= pMsg->payloadLength())
         {
             qDebug() << "Emitting multiframe ISOTP message";
             checkNeedFlush(pMsg->frameId());
@@ -326,16 +324,16 @@ void ISOTP_HANDLER::checkNeedFlush(uint64_t ID)
     if (messageBuffer.contains(ID))
     {
         msg = &messageBuffer[ID];
-        if (msg->reportedLength <= msg->payload().count())
+        if (msg->reportedLength <= msg->payloadLength())
         {
-            qDebug() << "Flushing full frame" << QString::number(msg->frameId(), 16) << "  " << msg->reportedLength << "  " << msg->payload().count();
+            qDebug() << "Flushing full frame" << QString::number(msg->frameId(), 16) << "  " << msg->reportedLength << "  " << msg->payloadLength();
             if (msg->reportedLength > 0) emit newISOMessage(*msg);
         }
         else
         {
             if (sendPartialMessages)
             {
-                qDebug() << "Flushing a partial frame " << QString::number(msg->frameId(), 16) << "  " << msg->reportedLength << "  " << msg->payload().count();
+                qDebug() << "Flushing a partial frame " << QString::number(msg->frameId(), 16) << "  " << msg->reportedLength << "  " << msg->payloadLength();
                 if (msg->reportedLength > 0) emit newISOMessage(*msg);
             }
             else qDebug() << "Have a partial message but sending of such is disabled. Throwing it away";
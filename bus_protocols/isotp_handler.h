@@ -5,6 +5,8 @@
 #include <QDebug>
 #include <QTimer>
 #include "can_structs.h"
+#include "canframeview.h"
+#include "canframebatch.h"
 #include "mainwindow.h"
 #include "canframemodel.h"
 #include "isotp_message.h"
@@ -29,7 +31,7 @@ public:
 
 public slots:
     void updatedFrames(int);
-    void rapidFrames(const CANConnection* conn, const QVector<CANFrame>& pFrames);
+    void rapidFrames(const CANConnection* conn, const CANFrameBatch& pFrames);
     void frameTimerTick();
 
 signals:
@@ -39,7 +41,7 @@ private:
     QHash<uint32_t, ISOTP_MESSAGE> messageBuffer;
     QList<CANFrame> sendingFrames;
     QList<CANFilter> filters;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     bool useExtendedAddressing;
     bool isReceiving;
     bool waitingForFlow;
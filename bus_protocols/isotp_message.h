@@ -3,16 +3,27 @@
 
 #include <Qt>
 #include <QVector>
+#include <QByteArray>
 #include <can_structs.h>
 
 //Now a child class of CANFrame. We just add the ability to track how long it was supposed to be and other
 //ISOTP related details. But, mostly just CANFrame.
+//ISOTP payloads can be up to 4095 bytes which won't fit in the inline CANFrame buffer so the payload
+//accessors are replaced with ones backed by a QByteArray.
 class ISOTP_MESSAGE : public CANFrame
 {
 public:
     int reportedLength;
     int lastSequence;
     bool isMultiframe;
+
+    QByteArray payload() const { return isoData; }
+    const unsigned char *payloadData() const { return reinterpret_cast<const unsigned char *>(isoData.constData()); }
+    int payloadLength() const { return isoData.length(); }
+    void setPayload(const QByteArray &bytes) { isoData = bytes; }
+
+private:
+    QByteArray isoData;
 };
 
 #endif // ISOTP_MESSAGE_H
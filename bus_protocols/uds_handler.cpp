@@ -185,8 +185,8 @@ UDS_HANDLER::~UDS_HANDLER()
 void UDS_HANDLER::gotISOTPFrame(ISOTP_MESSAGE msg)
 {
     qDebug() << "UDS handler got ISOTP frame";
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(msg.payload().constData());
-    int dataLen = msg.payload().count();
+    const unsigned char *data = msg.payloadData();
+    int dataLen = msg.payloadLength();
     UDS_MESSAGE udsMsg;
     udsMsg.bus = msg.bus;
     udsMsg.setExtendedFrameFormat(msg.hasExtendedFrameFormat());
@@ -337,8 +337,8 @@ QString UDS_HANDLER::getDetailedMessageAnalysis(const UDS_MESSAGE &msg)
     int dataSize;
     int addrSize;
     int compType, encType;
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(msg.payload().constData());
-    int dataLen = msg.payload().length();
+    const unsigned char *data = msg.payloadData();
+    int dataLen = msg.payloadLength();
 
     if (msg.isErrorReply)
     {
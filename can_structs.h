@@ -3,38 +3,204 @@
 
 #include <QObject>
 #include <QVector>
+#include <QByteArray>
 #include <stdint.h>
+#include <string.h>
+#include <type_traits>
 #include <QCanBusFrame>
 
-//Now inherits from the built-in CAN frame class from Qt. This should be more future proof and easier to integrate with other code
+//Maximum payload a single frame can carry (CAN-FD). Classic CAN frames just use the first 8 bytes.
+#define CANFRAME_MAX_PAYLOAD    64
 
-struct CANFrame : public QCanBusFrame
+/*
+ * Compact, fixed size capture record. This used to inherit from QCanBusFrame but that meant every captured
+ * frame dragged along a heap allocated QByteArray payload plus a Qt timestamp object. Now the payload is stored
+ * inline and the timestamp is a single 64 bit microsecond count so frames can be block copied around
+ * (queues, model storage, file buffers) without ever touching the allocator.
+ *
+ * The accessors intentionally mirror the QCanBusFrame API so that code all over the program reads the same
+ * as it always did. Conversion to a real QCanBusFrame only happens at the edges (QCanBusDevice read/write)
+ * through fromQCanBusFrame() / toQCanBusFrame().
+ */
+struct CANFrame
 {
 public:
-    int bus;
-    bool isReceived; //did we receive this or send it?
+    enum Flags : uint8_t
+    {
+        FLAG_EXTENDED       = 0x01,
+        FLAG_FD             = 0x02,
+        FLAG_BRS            = 0x04,
+        FLAG_ESI            = 0x08,
+        FLAG_LOCAL_ECHO     = 0x10,
+        FLAG_INVALID_ID     = 0x80
+    };
+
+    uint64_t timestamp; //microseconds. Same value timeStamp().microSeconds() returns
     uint64_t timedelta;
+    uint32_t id;
     uint32_t frameCount; //used in overwrite mode
+    int bus;
+    uint8_t len;
+    uint8_t type; //QCanBusFrame::FrameType
+    uint8_t flags;
+    bool isReceived; //did we receive this or send it?
+    uint8_t data[CANFRAME_MAX_PAYLOAD];
 
     friend bool operator<(const CANFrame& l, const CANFrame& r)
     {
-        qint64 lStamp = l.timeStamp().seconds() * 1000000 + l.timeStamp().microSeconds();
-        qint64 rStamp = r.timeStamp().seconds() * 1000000 + r.timeStamp().microSeconds();
-        return lStamp < rStamp;
+        return l.timestamp < r.timestamp;
     }
 
     CANFrame()
     {
-        setFrameId(0);
-        bus = 0;
-        setExtendedFrameFormat(false);
-        setFrameType(QCanBusFrame::DataFrame);
-        isReceived = true;
+        timestamp = 0;
         timedelta = 0;
+        id = 0;
         frameCount = 1;
+        bus = 0;
+        len = 0;
+        type = QCanBusFrame::DataFrame;
+        flags = 0;
+        isReceived = true;
+        memset(data, 0, sizeof(data)); //frames are written to capture files as whole records, no stray bytes in them
+    }
+
+    uint32_t frameId() const { return id; }
+
+    //same rules as QCanBusFrame. Anything that doesn't fit in 11 bits forces extended format
+    //and IDs that don't fit in 29 bits are rejected.
+    void setFrameId(uint32_t newId)
+    {
+        if (newId < 0x20000000U)
+        {
+            id = newId;
+            flags &= ~FLAG_INVALID_ID;
+            if (newId & 0x1FFFF800U) flags |= FLAG_EXTENDED;
+        }
+        else
+        {
+            id = 0;
+            flags |= FLAG_INVALID_ID;
+        }
+    }
+
+    bool hasExtendedFrameFormat() const { return flags & FLAG_EXTENDED; }
+    void setExtendedFrameFormat(bool isExtended) { setFlag(FLAG_EXTENDED, isExtended); }
+
+    QCanBusFrame::FrameType frameType() const { return static_cast<QCanBusFrame::FrameType>(type); }
+    void setFrameType(QCanBusFrame::FrameType newType) { type = static_cast<uint8_t>(newType); }
+
+    bool hasFlexibleDataRateFormat() const { return flags & FLAG_FD; }
+    void setFlexibleDataRateFormat(bool isFD) { setFlag(FLAG_FD, isFD); }
+    bool hasBitrateSwitch() const { return flags & FLAG_BRS; }
+    void setBitrateSwitch(bool brs) { setFlag(FLAG_BRS, brs); }
+    bool hasErrorStateIndicator() const { return flags & FLAG_ESI; }
+    void setErrorStateIndicator(bool esi) { setFlag(FLAG_ESI, esi); }
+    bool hasLocalEcho() const { return flags & FLAG_LOCAL_ECHO; }
+    void setLocalEcho(bool echo) { setFlag(FLAG_LOCAL_ECHO, echo); }
+
+    //Like QCanBusFrame the error bits of an error frame live in the frame ID
+    QCanBusFrame::FrameErrors error() const
+    {
+        if (frameType() != QCanBusFrame::ErrorFrame) return QCanBusFrame::NoError;
+        return QCanBusFrame::FrameErrors(static_cast<int>(id & 0x1FFFFFFFU));
+    }
+
+    void setError(QCanBusFrame::FrameErrors e)
+    {
+        if (frameType() != QCanBusFrame::ErrorFrame) return;
+        id = static_cast<uint32_t>(e) & 0x1FFFFFFFU;
+    }
+
+    QCanBusFrame::TimeStamp timeStamp() const { return QCanBusFrame::TimeStamp(0, static_cast<qint64>(timestamp)); }
+    void setTimeStamp(QCanBusFrame::TimeStamp ts)
+    {
+        timestamp = static_cast<uint64_t>(ts.seconds() * 1000000 + ts.microSeconds());
+    }
+
+    /*
+     * payload() returns a copy, exactly like QCanBusFrame did. Code that just needs to look at the bytes
+     * should use payloadData() and payloadLength() instead which don't allocate anything.
+     */
+    QByteArray payload() const { return QByteArray(reinterpret_cast<const char *>(data), len); }
+    const unsigned char *payloadData() const { return data; }
+    unsigned char *payloadData() { return data; }
+    int payloadLength() const { return len; }
+
+    void setPayload(const QByteArray &bytes)
+    {
+        setPayload(reinterpret_cast<const unsigned char *>(bytes.constData()), bytes.length());
+    }
+
+    void setPayload(const unsigned char *bytes, int length)
+    {
+        if (length < 0) length = 0;
+        if (length > CANFRAME_MAX_PAYLOAD) length = CANFRAME_MAX_PAYLOAD;
+        if (length > 0) memcpy(data, bytes, static_cast<size_t>(length));
+        memset(data + length, 0, static_cast<size_t>(CANFRAME_MAX_PAYLOAD - length));
+        len = static_cast<uint8_t>(length);
+    }
+
+    bool isValid() const
+    {
+        if (flags & FLAG_INVALID_ID) return false;
+        switch (frameType())
+        {
+        case QCanBusFrame::InvalidFrame:
+            return false;
+        case QCanBusFrame::RemoteRequestFrame:
+            return !hasFlexibleDataRateFormat();
+        case QCanBusFrame::ErrorFrame:
+            return len == 8;
+        default:
+            break;
+        }
+        if (hasFlexibleDataRateFormat()) return len <= CANFRAME_MAX_PAYLOAD;
+        return len <= 8;
+    }
+
+    static CANFrame fromQCanBusFrame(const QCanBusFrame &frame)
+    {
+        CANFrame out;
+        out.setFrameType(frame.frameType());
+        out.setFrameId(frame.frameId());
+        out.setExtendedFrameFormat(frame.hasExtendedFrameFormat());
+        out.setFlexibleDataRateFormat(frame.hasFlexibleDataRateFormat());
+        out.setBitrateSwitch(frame.hasBitrateSwitch());
+        out.setErrorStateIndicator(frame.hasErrorStateIndicator());
+        out.setLocalEcho(frame.hasLocalEcho());
+        out.setTimeStamp(frame.timeStamp());
+        out.setPayload(frame.payload());
+        return out;
+    }
+
+    QCanBusFrame toQCanBusFrame() const
+    {
+        QCanBusFrame out(frameType());
+        out.setFrameId(id);
+        out.setExtendedFrameFormat(hasExtendedFrameFormat());
+        out.setFlexibleDataRateFormat(hasFlexibleDataRateFormat());
+        out.setBitrateSwitch(hasBitrateSwitch());
+        out.setErrorStateIndicator(hasErrorStateIndicator());
+        out.setLocalEcho(hasLocalEcho());
+        out.setTimeStamp(timeStamp());
+        out.setPayload(payload());
+        return out;
+    }
+
+    QString toString() const { return toQCanBusFrame().toString(); }
+
+private:
+    void setFlag(uint8_t flag, bool state)
+    {
+        if (state) flags |= flag;
+        else flags &= ~flag;
     }
 };
 
+static_assert(std::is_trivially_copyable<CANFrame>::value, "CANFrame must stay a flat record that can be block copied");
+Q_DECLARE_TYPEINFO(CANFrame, Q_MOVABLE_TYPE);
+
 class CANFltObserver
 {
 public:
@@ -51,4 +217,3 @@ public:
 };
 
 #endif // CAN_STRUCTS_H
-
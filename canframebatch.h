@@ -0,0 +1,49 @@
+#ifndef CANFRAMEBATCH_H
+#define CANFRAMEBATCH_H
+
+#include <QVector>
+#include <QMetaType>
+#include "can_structs.h"
+
+/*
+ * A batch of frames as handed out by CANConManager::framesReceived. The frames are stored once and every
+ * subscriber (main model, sniffer, ISO-TP handler, scripting, ...) reads the same block of memory no matter
+ * how many of them there are or which thread they live in. Copying a batch only bumps a reference count, and
+ * as there is no way to modify the frames through a batch nobody can trigger a hidden deep copy either.
+ * A subscriber that wants to hang on to the frames for later should keep the batch rather than copy the
+ * frames out of it.
+ */
+class CANFrameBatch
+{
+public:
+    typedef const CANFrame *const_iterator;
+
+    CANFrameBatch() : mQueuedAt(0) {}
+    explicit CANFrameBatch(const QVector<CANFrame> &frames, qint64 queuedAt = 0) : mFrames(frames), mQueuedAt(queuedAt) {}
+
+    int count() const { return mFrames.count(); }
+    int size() const { return mFrames.count(); }
+    int length() const { return mFrames.count(); }
+    bool isEmpty() const { return mFrames.isEmpty(); }
+
+    const CANFrame &at(int i) const { return mFrames.at(i); }
+    const CANFrame &operator[](int i) const { return mFrames.at(i); }
+    const CANFrame *constData() const { return mFrames.constData(); }
+
+    const_iterator begin() const { return mFrames.constData(); }
+    const_iterator end() const { return mFrames.constData() + mFrames.count(); }
+
+    //when the oldest frame of the batch was queued by its connection (CANConStats::now()), 0 if unknown
+    qint64 queuedAt() const { return mQueuedAt; }
+
+    //shares the frames with whoever else holds this batch. Still no copy unless the caller modifies it.
+    QVector<CANFrame> toVector() const { return mFrames; }
+
+private:
+    QVector<CANFrame> mFrames; //never modified after construction so it is never detached
+    qint64 mQueuedAt;
+};
+
+Q_DECLARE_METATYPE(CANFrameBatch)
+
+#endif // CANFRAMEBATCH_H
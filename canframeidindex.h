@@ -0,0 +1,368 @@
+#ifndef CANFRAMEIDINDEX_H
+#define CANFRAMEIDINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <stdint.h>
+#include <algorithm>
+#include "can_structs.h"
+#include "canframestore.h"
+
+/*
+ * Index from (bus, id) to the rows of a CANFrameStore holding frames with that bus and id. Each list of rows
+ * is in ascending row order and, as frames are captured in time order, in ascending timestamp order too, so
+ * "which frame of this ID was current at time T" is a binary search instead of a walk over the capture.
+ *
+ * The owner (CANFrameModel) adds every row as it is stored, shifts the index when the oldest rows are evicted
+ * and rebuilds it whenever rows are moved around. Unlike the stores themselves this is not safe to read from
+ * other threads, it is meant for the windows that live in the GUI thread alongside the model. Row numbers are rows of the full capture, which
+ * is why only the unfiltered view of the model hands the index out (see CANFrameView::idIndex()).
+ *
+ * A list of every row costs 4 bytes a frame, which is too much for captures mapped in from disk that can be
+ * far bigger than RAM (and building it would mean reading the whole file up front). Those get a sparse index
+ * instead (setChunkKeys()): for each chunk of the store just the sorted list of distinct (bus, id) keys in
+ * it and its earliest timestamp. The answers are the same, the rows are found by scanning only the chunks that
+ * have the key in them. The scan goes by timestamp, not row, so files that aren't in time order as a whole
+ * (several buses recorded separately, clock resyncs, frames captured on top of a file) still answer right.
+ */
+class CANFrameIDIndex
+{
+public:
+    explicit CANFrameIDIndex(const CANFrameStore *frames) : mFrames(frames), mSparse(false) {}
+
+    //bus number above the 29 bit ID so every (bus, id) pair gets its own key
+    static uint64_t key(int bus, uint32_t id)
+    {
+        return static_cast<uint64_t>(id) | (static_cast<uint64_t>(static_cast<uint32_t>(bus)) << 29);
+    }
+
+    /* writer side */
+
+    //rows have to be added in ascending order
+    void add(const CANFrame &frame, int row)
+    {
+        uint64_t k = key(frame.bus, frame.frameId());
+        if (mSparse)
+        {
+            int chunk = row >> CANFrameStore::CHUNK_BITS;
+            if (chunk >= mChunkKeys.count())
+            {
+                mChunkKeys.resize(chunk + 1);
+                mChunkEarliest.resize(chunk + 1);
+                mChunkEarliest[chunk] = frame.timestamp;
+            }
+            if (frame.timestamp < mChunkEarliest[chunk]) mChunkEarliest[chunk] = frame.timestamp;
+            QVector<uint64_t> &keys = mChunkKeys[chunk];
+            QVector<uint64_t>::iterator pos = std::lower_bound(keys.begin(), keys.end(), k);
+            if (pos != keys.end() && *pos == k) return;
+            keys.insert(pos, k);
+            if (!mBuses.value(frame.frameId()).contains(frame.bus)) mBuses[frame.frameId()].append(frame.bus);
+            return;
+        }
+        QHash<uint64_t, QVector<uint32_t> >::iterator it = mRows.find(k);
+        if (it == mRows.end())
+        {
+            it = mRows.insert(k, QVector<uint32_t>());
+            mBuses[frame.frameId()].append(frame.bus);
+        }
+        it.value().append(static_cast<uint32_t>(row));
+    }
+
+    //also goes back to keeping every row
+    void clear()
+    {
+        mRows.clear();
+        mBuses.clear();
+        mChunkKeys.clear();
+        mChunkEarliest.clear();
+        mSparse = false;
+    }
+
+    //distinct (bus, id) keys in a block of frames, sorted. What the sparse index keeps per chunk
+    static QVector<uint64_t> keysOf(const CANFrame *frames, int num)
+    {
+        QVector<uint64_t> keys;
+        uint64_t last = ~0ull;
+        for (int i = 0; i < num; i++)
+        {
+            uint64_t k = key(frames[i].bus, frames[i].frameId());
+            if (k != last) keys.append(k); //runs of the same ID are common, no need to sort them all
+            last = k;
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    //switch to the sparse index, one keysOf() list and earliest timestamp per chunk of the store
+    void setChunkKeys(const QVector<QVector<uint64_t> > &chunkKeys, const QVector<uint64_t> &chunkEarliest)
+    {
+        clear();
+        mSparse = true;
+        mChunkKeys = chunkKeys;
+        mChunkEarliest = chunkEarliest;
+        rebuildBuses();
+    }
+
+    bool isSparse() const { return mSparse; }
+
+    //the store dropped its first num rows and moved the rest down. Do the same to every row list
+    void dropFront(int num)
+    {
+        if (mSparse)
+        {
+            int chunks = qMin(num >> CANFrameStore::CHUNK_BITS, mChunkKeys.count());
+            mChunkKeys.remove(0, chunks);
+            mChunkEarliest.remove(0, qMin(chunks, mChunkEarliest.count()));
+            rebuildBuses();
+            return;
+        }
+        QHash<uint64_t, QVector<uint32_t> >::iterator it = mRows.begin();
+        while (it != mRows.end())
+        {
+            QVector<uint32_t> &list = it.value();
+            QVector<uint32_t>::iterator keep = std::lower_bound(list.begin(), list.end(), static_cast<uint32_t>(num));
+            int gone = static_cast<int>(keep - list.begin());
+            if (gone == list.count())
+            {
+                uint32_t id = static_cast<uint32_t>(it.key() & 0x1FFFFFFF);
+                int bus = static_cast<int>(it.key() >> 29);
+                QVector<int> &buses = mBuses[id];
+                buses.removeAll(bus);
+                if (buses.isEmpty()) mBuses.remove(id);
+                it = mRows.erase(it);
+                continue;
+            }
+            if (gone > 0) list.remove(0, gone);
+            for (int i = 0; i < list.count(); i++) list[i] -= static_cast<uint32_t>(num);
+            ++it;
+        }
+    }
+
+    //from scratch, keeping whichever kind of index this is
+    void rebuild()
+    {
+        bool sparse = mSparse;
+        clear();
+        if (sparse)
+        {
+            QVector<QVector<uint64_t> > chunkKeys;
+            QVector<uint64_t> chunkEarliest;
+            int chunks = mFrames->chunkCount();
+            for (int c = 0; c < chunks; c++)
+            {
+                const CANFrame *data = mFrames->chunkData(c);
+                int len = mFrames->chunkLength(c);
+                uint64_t earliest = UINT64_MAX;
+                for (int i = 0; i < len; i++) if (data[i].timestamp < earliest) earliest = data[i].timestamp;
+                chunkKeys.append(keysOf(data, len));
+                chunkEarliest.append(earliest);
+            }
+            setChunkKeys(chunkKeys, chunkEarliest);
+            return;
+        }
+        int num = mFrames->count();
+        for (int i = 0; i < num; i++) add(mFrames->at(i), i);
+    }
+
+    /* reader side */
+
+    bool isEmpty() const { return mBuses.isEmpty(); }
+
+    //every frame ID in the capture, in ascending order
+    QList<uint32_t> ids() const
+    {
+        QList<uint32_t> out = mBuses.keys();
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    QVector<int> busesForID(uint32_t id) const { return mBuses.value(id); }
+
+    //rows of one (bus, id), ascending. Empty if that pair was never seen
+    QVector<uint32_t> rows(int bus, uint32_t id) const
+    {
+        if (mSparse)
+        {
+            uint64_t k = key(bus, id);
+            return scanRows([this, k](int chunk) { return chunkHas(chunk, k); },
+                            [k](const CANFrame &frame) { return key(frame.bus, frame.frameId()) == k; });
+        }
+        return mRows.value(key(bus, id));
+    }
+
+    //rows of this id on any bus, ascending
+    QVector<uint32_t> rowsForID(uint32_t id) const
+    {
+        QVector<int> buses = mBuses.value(id);
+        if (mSparse)
+        {
+            if (buses.isEmpty()) return QVector<uint32_t>();
+            return scanRows([this, id, buses](int chunk) { return chunkHasID(chunk, id, buses); },
+                            [id](const CANFrame &frame) { return frame.frameId() == id; });
+        }
+        if (buses.count() == 1) return mRows.value(key(buses[0], id));
+        QVector<uint32_t> out;
+        foreach (int bus, buses)
+        {
+            const QVector<uint32_t> busRows = mRows.value(key(bus, id));
+            int mid = out.count();
+            out += busRows;
+            std::inplace_merge(out.begin(), out.begin() + mid, out.end());
+        }
+        return out;
+    }
+
+    int countForID(uint32_t id) const
+    {
+        if (mSparse) return rowsForID(id).count();
+        int num = 0;
+        foreach (int bus, mBuses.value(id)) num += mRows.value(key(bus, id)).count();
+        return num;
+    }
+
+    //most recent row of this id on any bus, -1 if there isn't one
+    int lastRowForID(uint32_t id) const
+    {
+        if (mSparse)
+        {
+            QVector<int> buses = mBuses.value(id);
+            if (buses.isEmpty()) return -1;
+            return scanBack(mFrames->count() - 1, [this, id, buses](int chunk) { return chunkHasID(chunk, id, buses); },
+                            [id](const CANFrame &frame) { return frame.frameId() == id; });
+        }
+        int best = -1;
+        foreach (int bus, mBuses.value(id))
+        {
+            QHash<uint64_t, QVector<uint32_t> >::const_iterator it = mRows.constFind(key(bus, id));
+            if (it != mRows.constEnd() && !it.value().isEmpty()) best = qMax(best, static_cast<int>(it.value().last()));
+        }
+        return best;
+    }
+
+    //last row of (bus, id) with a timestamp at or before the given one (microseconds), -1 if there isn't one
+    int rowAtOrBefore(int bus, uint32_t id, uint64_t timestamp) const
+    {
+        if (mSparse)
+        {
+            uint64_t k = key(bus, id);
+            return scanBack(mFrames->count() - 1, [this, k, timestamp](int chunk) { return chunkHas(chunk, k) && chunkReaches(chunk, timestamp); },
+                            [k, timestamp](const CANFrame &frame) { return key(frame.bus, frame.frameId()) == k && frame.timestamp <= timestamp; });
+        }
+        QHash<uint64_t, QVector<uint32_t> >::const_iterator it = mRows.constFind(key(bus, id));
+        if (it == mRows.constEnd()) return -1;
+        return searchRows(it.value(), timestamp);
+    }
+
+    //same thing over every bus the id was seen on
+    int rowAtOrBeforeForID(uint32_t id, uint64_t timestamp) const
+    {
+        if (mSparse)
+        {
+            QVector<int> buses = mBuses.value(id);
+            if (buses.isEmpty()) return -1;
+            return scanBack(mFrames->count() - 1, [this, id, buses, timestamp](int chunk) { return chunkHasID(chunk, id, buses) && chunkReaches(chunk, timestamp); },
+                            [id, timestamp](const CANFrame &frame) { return frame.frameId() == id && frame.timestamp <= timestamp; });
+        }
+        int best = -1;
+        foreach (int bus, mBuses.value(id)) best = qMax(best, rowAtOrBefore(bus, id, timestamp));
+        return best;
+    }
+
+private:
+    /* sparse index helpers */
+
+    bool chunkHas(int chunk, uint64_t k) const
+    {
+        if (chunk >= mChunkKeys.count()) return false;
+        const QVector<uint64_t> &keys = mChunkKeys[chunk];
+        return std::binary_search(keys.constBegin(), keys.constEnd(), k);
+    }
+
+    bool chunkHasID(int chunk, uint32_t id, const QVector<int> &buses) const
+    {
+        foreach (int bus, buses) if (chunkHas(chunk, key(bus, id))) return true;
+        return false;
+    }
+
+    //every row passing frameTest, only looking inside chunks that pass chunkTest
+    template<typename ChunkTest, typename FrameTest>
+    QVector<uint32_t> scanRows(ChunkTest chunkTest, FrameTest frameTest) const
+    {
+        QVector<uint32_t> out;
+        int chunks = mFrames->chunkCount();
+        for (int c = 0; c < chunks; c++)
+        {
+            if (!chunkTest(c)) continue;
+            const CANFrame *data = mFrames->chunkData(c);
+            int len = mFrames->chunkLength(c);
+            uint32_t base = static_cast<uint32_t>(c) << CANFrameStore::CHUNK_BITS;
+            for (int i = 0; i < len; i++)
+            {
+                if (frameTest(data[i])) out.append(base + static_cast<uint32_t>(i));
+            }
+        }
+        return out;
+    }
+
+    //last row at or before fromRow passing frameTest, -1 if there isn't one
+    template<typename ChunkTest, typename FrameTest>
+    int scanBack(int fromRow, ChunkTest chunkTest, FrameTest frameTest) const
+    {
+        for (int c = fromRow >> CANFrameStore::CHUNK_BITS; c >= 0 && fromRow >= 0; c--)
+        {
+            int base = c << CANFrameStore::CHUNK_BITS;
+            if (chunkTest(c))
+            {
+                const CANFrame *data = mFrames->chunkData(c);
+                for (int i = fromRow - base; i >= 0; i--)
+                {
+                    if (frameTest(data[i])) return base + i;
+                }
+            }
+            fromRow = base - 1;
+        }
+        return -1;
+    }
+
+    //false if every frame of the chunk is later than the timestamp, so it can be skipped without reading it
+    bool chunkReaches(int chunk, uint64_t timestamp) const
+    {
+        if (chunk >= mChunkEarliest.count()) return true;
+        return mChunkEarliest[chunk] <= timestamp;
+    }
+
+    void rebuildBuses()
+    {
+        mBuses.clear();
+        foreach (const QVector<uint64_t> &keys, mChunkKeys)
+        {
+            foreach (uint64_t k, keys)
+            {
+                uint32_t id = static_cast<uint32_t>(k & 0x1FFFFFFF);
+                int bus = static_cast<int>(k >> 29);
+                QVector<int> &buses = mBuses[id];
+                if (!buses.contains(bus)) buses.append(bus);
+            }
+        }
+    }
+
+    int searchRows(const QVector<uint32_t> &list, uint64_t timestamp) const
+    {
+        const CANFrameStore *frames = mFrames;
+        QVector<uint32_t>::const_iterator pos = std::upper_bound(list.constBegin(), list.constEnd(), timestamp,
+            [frames](uint64_t ts, uint32_t row) { return ts < frames->at(static_cast<int>(row)).timestamp; });
+        if (pos == list.constBegin()) return -1;
+        return static_cast<int>(*(pos - 1));
+    }
+
+    const CANFrameStore *mFrames;
+    QHash<uint64_t, QVector<uint32_t> > mRows; //(bus, id) -> rows
+    QHash<uint32_t, QVector<int> > mBuses; //id -> buses it was seen on
+    bool mSparse; //true = mChunkKeys instead of mRows
+    QVector<QVector<uint64_t> > mChunkKeys; //sparse only. Chunk of the store -> sorted distinct keys in it
+    QVector<uint64_t> mChunkEarliest; //sparse only. Chunk of the store -> earliest timestamp in it
+};
+
+#endif // CANFRAMEIDINDEX_H
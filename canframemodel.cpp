@@ -4,10 +4,14 @@
 #include <QApplication>
 #include <QPalette>
 #include <QDateTime>
+#include <QtConcurrent>
+#include <functional>
 #include "utility.h"
+#include "utils/tracer.h"
 
 CANFrameModel::~CANFrameModel()
 {
+    flushOverflow();
     frames.clear();
     filteredFrames.clear();
     filters.clear();
@@ -16,16 +20,8 @@ CANFrameModel::~CANFrameModel()
 int CANFrameModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    if (filteredFrames.data())
-    {
-        int rows = filteredFrames.count();
-        return rows;
-    }
-
-     //just in case somehow data is invalid which I have seen before.
-    //But, this should not happen so issue a debugging message too
-    qDebug() << "Invalid data for filteredFrames. Returning 0.";
-    return 0;
+    //not filteredFrames.count(), the view must not see rows it hasn't been told about with beginInsertRows
+    return shownRows;
 }
 
 int CANFrameModel::totalFrameCount()
@@ -42,22 +38,26 @@ int CANFrameModel::columnCount(const QModelIndex &index) const
 }
 
 CANFrameModel::CANFrameModel(QObject *parent)
-    : QAbstractTableModel(parent)
+    : QAbstractTableModel(parent), idIndex(&frames)
 {
-
-    if (QSysInfo::WordSize > 32)
-    {
-        qDebug() << "64 bit OS detected. Requesting a large preallocation";
-        preallocSize = 10000000;
-    }
-    else //if compiling for 32 bit you can't ask for gigabytes of preallocation so tone it down.
-    {
-        qDebug() << "32 bit OS detected. Requesting a much restricted prealloc";
-        preallocSize = 2000000;
-    }
-
-    frames.reserve(preallocSize);
-    filteredFrames.reserve(preallocSize); //the goal is to prevent a reallocation from ever happening
+    //frames grows a chunk at a time so there is no need to preallocate anything here.
+    //the filtered view doesn't own any frames, it is just a list of indices into frames
+    framesView = CANFrameView(&frames);
+    framesView.setIDIndex(&idIndex);
+    filteredFramesView = CANFrameView(&frames, &filteredFrames);
+    shownRows = 0;
+    dirtyFirstRow = -1;
+    dirtyLastRow = -1;
+    //a few screens worth of cells so scrolling back and forth doesn't format anything twice
+    displayCache.setMaxCost(8192);
+    displayGeneration = 0;
+    displayDBCGeneration = DBCHandler::getLookupGeneration();
+    filterNMTon = false;
+    filterSYNCon = false;
+    filterEMCYon = false;
+    filterHBEATon = false;
+    filterTIMEon = false;
+    compileFilters();
 
     dbcHandler = DBCHandler::getReference();
     interpretFrames = false;
@@ -65,10 +65,16 @@ CANFrameModel::CANFrameModel(QObject *parent)
     useHexMode = true;
     timeSeconds = false;
     timeOffset = 0;
+    minTimestamp = UINT64_MAX;
     needFilterRefresh = false;
     lastUpdateNumFrames = 0;
     timeFormat =  "MMM-dd HH:mm:ss.zzz";
+    sortColumn = -1;
     sortDirAsc = false;
+    captureLimitChunks = 0;
+    evictedFrames = 0;
+    overflowChunk = nullptr;
+    overflowCount = 0;
 }
 
 void CANFrameModel::setHexMode(bool mode)
@@ -76,6 +82,7 @@ void CANFrameModel::setHexMode(bool mode)
     if (useHexMode != mode)
     {
         this->beginResetModel();
+        invalidateDisplayCache();
         useHexMode = mode;
         Utility::decimalMode = !useHexMode;
         this->endResetModel();
@@ -87,6 +94,7 @@ void CANFrameModel::setSecondsMode(bool mode)
     if (Utility::secondsMode != mode)
     {
         this->beginResetModel();
+        invalidateDisplayCache();
         Utility::secondsMode = mode;
         this->endResetModel();
     }
@@ -97,6 +105,7 @@ void CANFrameModel::setSysTimeMode(bool mode)
     if (Utility::sysTimeMode != mode)
     {
         this->beginResetModel();
+        invalidateDisplayCache();
         Utility::sysTimeMode = mode;
         this->endResetModel();
     }
@@ -109,6 +118,7 @@ void CANFrameModel::setInterpretMode(bool mode)
     if (interpretFrames != mode)
     {
         this->beginResetModel();
+        invalidateDisplayCache();
         interpretFrames = mode;
         this->endResetModel();
     }
@@ -122,53 +132,227 @@ bool CANFrameModel::getInterpretMode()
 void CANFrameModel::setTimeFormat(QString format)
 {
     Utility::timeFormat = format;
+    invalidateDisplayCache();
     beginResetModel(); //reset model to show new time format
     endResetModel();
 }
 
 /*
- * Scan all frames for the smallest timestamp and offset all timestamps so that smallest one is at 0
+ * Show timestamps relative to the earliest frame. The frames themselves are left alone and the offset is
+ * applied as timestamps are shown. The earliest timestamp is kept up to date as frames come in, so this costs
+ * the same however big the capture is. The view only has to redraw the timestamp column.
 */
 void CANFrameModel::normalizeTiming()
 {
-    mutex.lock();
     if (frames.count() == 0) return;
-    timeOffset = frames[0].timeStamp().microSeconds();
+    timeOffset = static_cast<int64_t>(minTimestamp);
+    invalidateDisplayCache();
+    int rows = rowCount();
+    if (rows > 0) emit dataChanged(index(0, static_cast<int>(Column::TimeStamp)), index(rows - 1, static_cast<int>(Column::TimeStamp)));
+}
 
-    //find the absolute lowest timestamp in the whole time. Needed because maybe timestamp was reset in the middle.
-    for (int j = 0; j < frames.count(); j++)
+void CANFrameModel::setOverwriteMode(bool mode)
+{
+    overwriteDups = mode;
+    invalidateDisplayCache(); //time and count columns mean something else now
+    if (overwriteDups) recalcOverwrite();
+    else
     {
-        if (frames[j].timeStamp().microSeconds() < timeOffset) timeOffset = frames[j].timeStamp().microSeconds();
+        overwriteRows.clear();
+        overwriteFilteredRows.clear();
     }
+}
 
-    for (int i = 0; i < frames.count(); i++)
+static inline uint64_t overwriteKey(const CANFrame &frame)
+{
+    return CANFrameIDIndex::key(frame.bus, frame.frameId());
+}
+
+/*
+ * In overwrite mode each (bus, id) has exactly one row. These hashes find that row in frames and
+ * in filteredFrames without scanning either list. The filtered one has to be rebuilt whenever the
+ * filtered list is.
+ */
+void CANFrameModel::rebuildOverwriteFilteredRows()
+{
+    overwriteFilteredRows.clear();
+    if (!overwriteDups) return;
+    int num = filteredFrames.count();
+    overwriteFilteredRows.reserve(num);
+    for (int row = 0; row < num; row++)
     {
-        frames[i].setTimeStamp(QCanBusFrame::TimeStamp(0, frames[i].timeStamp().microSeconds() - timeOffset));
+        overwriteFilteredRows.insert(overwriteKey(frames[static_cast<int>(filteredFrames[row])]), row);
     }
+}
 
-    this->beginResetModel();
-    for (int i = 0; i < filteredFrames.count(); i++)
+void CANFrameModel::rebuildOverwriteRows()
+{
+    overwriteRows.clear();
+    if (!overwriteDups) return;
+    int num = frames.count();
+    overwriteRows.reserve(num);
+    for (int i = 0; i < num; i++) overwriteRows.insert(overwriteKey(frames[i]), i);
+}
+
+//Must be called whenever filters or any of the filterXXXon flags change
+void CANFrameModel::compileFilters()
+{
+    uint16_t functionMask = 0xFFFF;
+    if (filterNMTon) functionMask &= ~(1 << CompiledFrameFilter::FUNC_NMT);
+    if (filterEMCYon) functionMask &= ~(1 << CompiledFrameFilter::FUNC_EMCY);
+    if (filterTIMEon) functionMask &= ~(1 << CompiledFrameFilter::FUNC_TIME);
+    if (filterHBEATon) functionMask &= ~(1 << CompiledFrameFilter::FUNC_HEARTBEAT);
+    compiledFilter.compile(filters, functionMask, !filterSYNCon);
+}
+
+/*
+ * Rows of frames that pass pred, in ascending order. Captures bigger than one chunk of the store are
+ * scanned a chunk at a time spread over every core (pred must be safe to call from several threads at once,
+ * so hand it copies rather than references to model state) and the per chunk results are joined in order.
+ * The writer is this thread so nothing is added to frames while the scan runs.
+ */
+template<typename Pred>
+QVector<uint32_t> CANFrameModel::collectRows(Pred pred) const
+{
+    QVector<uint32_t> rows;
+    int chunks = frames.chunkCount();
+    if (chunks <= 1)
     {
-        filteredFrames[i].setTimeStamp(QCanBusFrame::TimeStamp(0, filteredFrames[i].timeStamp().microSeconds() - timeOffset));
+        int num = frames.count();
+        for (int i = 0; i < num; i++)
+        {
+            if (pred(frames.at(i))) rows.append(static_cast<uint32_t>(i));
+        }
+        return rows;
     }
-    this->endResetModel();
 
-    mutex.unlock();
+    const CANFrameStore *store = &frames;
+    std::function<QVector<uint32_t>(int)> scanChunk = [store, pred](int chunk)
+    {
+        QVector<uint32_t> out;
+        const CANFrame *data = store->chunkData(chunk);
+        int len = store->chunkLength(chunk);
+        uint32_t base = static_cast<uint32_t>(chunk) << CANFrameStore::CHUNK_BITS;
+        for (int i = 0; i < len; i++)
+        {
+            if (pred(data[i])) out.append(base + static_cast<uint32_t>(i));
+        }
+        return out;
+    };
+
+    QVector<int> chunkList(chunks);
+    for (int i = 0; i < chunks; i++) chunkList[i] = i;
+    QList<QVector<uint32_t> > parts = QtConcurrent::blockingMapped<QList<QVector<uint32_t> > >(chunkList, scanChunk);
+
+    int total = 0;
+    for (int i = 0; i < parts.count(); i++) total += parts[i].count();
+    rows.reserve(total);
+    for (int i = 0; i < parts.count(); i++) rows += parts[i];
+    return rows;
 }
 
-void CANFrameModel::setOverwriteMode(bool mode)
+void CANFrameModel::setFilterState(unsigned int ID, bool state)
 {
-    beginResetModel();
-    overwriteDups = mode;
-    recalcOverwrite();
-    endResetModel();
+    int node = ID & 0x7F;
+    if (!filters.contains(node)) return;
+    if (filters[node] == state) return;
+    filters[node] = state;
+    compileFilters();
+    //only the rows for this one node come or go. Everything else in the filtered list stays put.
+    updateFilteredRows([node](const CANFrame &frame) { return static_cast<int>(frame.frameId() & 0x7F) == node; }, state);
 }
 
-void CANFrameModel::setFilterState(unsigned int ID, bool state)
+void CANFrameModel::set_filterNMTon(bool state)
 {
-    if (!filters.contains(ID & 0x7F)) return;
-    filters[ID] = state;
-    sendRefresh();
+    if (filterNMTon == state) return;
+    filterNMTon = state;
+    compileFilters();
+    updateFilteredRows([](const CANFrame &frame) { return ((frame.frameId() & 0x7FF) >> 7) == 0; }, !state);
+}
+
+void CANFrameModel::set_filterSYNCon(bool state)
+{
+    if (filterSYNCon == state) return;
+    filterSYNCon = state;
+    compileFilters();
+    updateFilteredRows([](const CANFrame &frame) { return ((frame.frameId() & 0x7FF) >> 7) == 1 && (frame.frameId() & 0x7F) == 0; }, !state);
+}
+
+void CANFrameModel::set_filterEMCYon(bool state)
+{
+    if (filterEMCYon == state) return;
+    filterEMCYon = state;
+    compileFilters();
+    updateFilteredRows([](const CANFrame &frame) { return ((frame.frameId() & 0x7FF) >> 7) == 1 && (frame.frameId() & 0x7F) != 0; }, !state);
+}
+
+void CANFrameModel::set_filterHBEATon(bool state)
+{
+    if (filterHBEATon == state) return;
+    filterHBEATon = state;
+    compileFilters();
+    updateFilteredRows([](const CANFrame &frame) { return ((frame.frameId() & 0x7FF) >> 7) == 14; }, !state);
+}
+
+void CANFrameModel::set_filterTIMEon(bool state)
+{
+    if (filterTIMEon == state) return;
+    filterTIMEon = state;
+    compileFilters();
+    updateFilteredRows([](const CANFrame &frame) { return ((frame.frameId() & 0x7FF) >> 7) == 2; }, !state);
+}
+
+/*
+ * Incremental refilter. Rather than rebuilding the whole filtered index list when a single filter flips,
+ * only the frames the changed filter applies to are touched. When hiding, indices of matching frames are
+ * dropped from the filtered list. When showing, the indices of matching frames that now pass every filter
+ * are merged in. Both lists are in ascending frame order so a single merge pass keeps the order intact.
+ */
+template<typename Matcher>
+void CANFrameModel::updateFilteredRows(Matcher matches, bool show)
+{
+    TRACE_SCOPE("refilter");
+    beginResetModel();
+    if (!show)
+    {
+        int out = 0;
+        int num = filteredFrames.count();
+        for (int i = 0; i < num; i++)
+        {
+            uint32_t idx = filteredFrames[i];
+            if (!matches(frames[static_cast<int>(idx)])) filteredFrames[out++] = idx;
+        }
+        filteredFrames.truncate(out);
+    }
+    else
+    {
+        CompiledFrameFilter filter = compiledFilter;
+        QVector<uint32_t> added = collectRows([matches, filter](const CANFrame &frame) { return matches(frame) && filter.matches(frame); });
+        if (!added.isEmpty() && sortColumn >= 0)
+        {
+            //the list isn't in frame order when sorted so there's nothing to merge against. Just sort again.
+            for (int i = 0; i < added.count(); i++) filteredFrames.append(added[i]);
+            applySort();
+        }
+        else if (!added.isEmpty())
+        {
+            //merge from the back so it can be done in place. The new entries go on the end first which
+            //makes room, then everything is walked backwards putting the largest remaining index last.
+            int oldCount = filteredFrames.count();
+            for (int i = 0; i < added.count(); i++) filteredFrames.append(0);
+            int src = oldCount - 1;
+            int add = added.count() - 1;
+            for (int dst = filteredFrames.count() - 1; add >= 0; dst--)
+            {
+                if (src >= 0 && filteredFrames[src] > added[add]) filteredFrames[dst] = filteredFrames[src--];
+                else filteredFrames[dst] = added[add--];
+            }
+        }
+    }
+    rebuildOverwriteFilteredRows();
+    lastUpdateNumFrames = 0;
+    shownRows = filteredFrames.count();
+    endResetModel();
 }
 
 void CANFrameModel::setAllFilters(bool state)
@@ -178,130 +362,144 @@ void CANFrameModel::setAllFilters(bool state)
     {
         it.value() = state;
     }
+    compileFilters();
     sendRefresh();
 }
 
 /*
- * There is probably a more correct way to have done this but below are several functions that collectively implement
- * quicksort on the columns and interpret the columns numerically. But, correct or not, this implementation is quite fast
- * and sorts the columns properly.
-*/
-uint64_t CANFrameModel::getCANFrameVal(int row, Column col)
+ * Column sorting. The capture itself is never reordered (other windows read it through getListReference and
+ * expect it in capture order), instead the filtered row list is permuted. Each shown row's column value is
+ * turned into a 64 bit key once up front and then the rows are put in order with an LSD radix sort on those
+ * keys, so the frames are only looked at once and there's no recursion no matter how big the capture is.
+ */
+static uint64_t sortKey(const CANFrame &frame, Column col, bool overwrite)
 {
     uint64_t temp = 0;
-    if (row >= frames.count()) return 0;
-    CANFrame frame = frames[row];
     switch (col)
     {
     case Column::TimeStamp:
-        if (overwriteDups) return frame.timedelta;
-        return frame.timeStamp().microSeconds();
+        if (overwrite) return frame.timedelta;
+        return frame.timestamp;
     case Column::FrameId:
         return frame.frameId();
     case Column::Extended:
         if (frame.hasExtendedFrameFormat()) return 1;
         return 0;
     case Column::Remote:
-        if (overwriteDups) return frame.frameCount;
+        if (overwrite) return frame.frameCount;
         if (frame.frameType() == QCanBusFrame::RemoteRequestFrame) return 1;
         return 0;
     case Column::Direction:
         if (frame.isReceived) return 1;
         return 0;
     case Column::Bus:
-        return static_cast<uint64_t>(frame.bus);
+        return static_cast<uint64_t>(static_cast<uint32_t>(frame.bus));
     case Column::Length:
-        return static_cast<uint64_t>(frame.payload().length());
+        return static_cast<uint64_t>(frame.payloadLength());
     case Column::ASCII: //sort both the same for now
     case Column::Data:
-        for (int i = 0; i < frame.payload().length(); i++) temp += (static_cast<uint64_t>(frame.payload()[i]) << (56 - (8 * i)));
-        //qDebug() << temp;
+        //first 8 bytes, first byte most significant
+        for (int i = 0; i < frame.payloadLength() && i < 8; i++)
+            temp |= static_cast<uint64_t>(frame.payloadData()[i]) << (56 - (8 * i));
         return temp;
-
     case Column::CANOpenFunction:
         return frame.frameId() >> 7;
     case Column::CANOpenNode:
         return frame.frameId() & 0x7f;
-
     case Column::NUM_COLUMN:
         return 0;
     }
     return 0;
 }
 
-void CANFrameModel::qSortCANFrameAsc(QVector<CANFrame> *frames, Column column, int lowerBound, int upperBound)
+//Stable LSD radix sort of rows by keys, a byte at a time. Bytes that are the same in every key are skipped
+//so sorting on something like the bus number or the length is a single pass.
+static void radixSortByKey(QVector<uint64_t> &keys, QVector<uint32_t> &rows)
 {
-    int p, i, j;
-    qDebug() << "Lower " << lowerBound << " Upper" << upperBound;
-    if (lowerBound < upperBound)
+    int num = keys.count();
+    if (num < 2) return;
+
+    uint64_t orAll = 0;
+    uint64_t andAll = ~0ull;
+    for (int i = 0; i < num; i++)
     {
-        uint64_t piv = getCANFrameVal(lowerBound + (upperBound - lowerBound) / 2, column);
-        i = lowerBound - 1;
-        j = upperBound + 1;
-        for (;;){
-            do {
-                i++;
-            } while ((i < upperBound) && getCANFrameVal(i, column) < piv);
-
-            do
-            {
-                j--;
-            } while ((j > lowerBound) && getCANFrameVal(j, column) > piv);
-            if (i < j) {
-                CANFrame temp = frames->at(i);
-                frames->replace(i, frames->at(j));
-                frames->replace(j, temp);
-            }
-            else {p = j; break;}
+        orAll |= keys[i];
+        andAll &= keys[i];
+    }
+    uint64_t varies = orAll ^ andAll;
+
+    QVector<uint64_t> tempKeys(num);
+    QVector<uint32_t> tempRows(num);
+    uint64_t *srcKeys = keys.data();
+    uint32_t *srcRows = rows.data();
+    uint64_t *dstKeys = tempKeys.data();
+    uint32_t *dstRows = tempRows.data();
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        if (((varies >> shift) & 0xFF) == 0) continue;
+
+        int counts[256] = {0};
+        for (int i = 0; i < num; i++) counts[(srcKeys[i] >> shift) & 0xFF]++;
+        int pos = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            int c = counts[b];
+            counts[b] = pos;
+            pos += c;
         }
+        for (int i = 0; i < num; i++)
+        {
+            int dst = counts[(srcKeys[i] >> shift) & 0xFF]++;
+            dstKeys[dst] = srcKeys[i];
+            dstRows[dst] = srcRows[i];
+        }
+        qSwap(srcKeys, dstKeys);
+        qSwap(srcRows, dstRows);
+    }
 
-        qSortCANFrameAsc(frames, column, lowerBound, p);
-        qSortCANFrameAsc(frames, column, p+1, upperBound);
+    //an odd number of passes leaves the result in the temp buffers
+    if (srcRows != rows.data())
+    {
+        keys.swap(tempKeys);
+        rows.swap(tempRows);
     }
 }
 
-void CANFrameModel::qSortCANFrameDesc(QVector<CANFrame> *frames, Column column, int lowerBound, int upperBound)
+//Puts filteredFrames in the order of the current sort column. Callers take care of telling the view.
+void CANFrameModel::applySort()
 {
-    int p, i, j;
-    qDebug() << "Lower " << lowerBound << " Upper" << upperBound;
-    if (lowerBound < upperBound)
-    {
-        uint64_t piv = getCANFrameVal(lowerBound + (upperBound - lowerBound) / 2, column);
-        i = lowerBound - 1;
-        j = upperBound + 1;
-        for (;;){
-            do {
-                i++;
-            } while ((i < upperBound) && getCANFrameVal(i, column) > piv);
-
-            do
-            {
-                j--;
-            } while ((j > lowerBound) && getCANFrameVal(j, column) < piv);
-            if (i < j) {
-                CANFrame temp = frames->at(i);
-                frames->replace(i, frames->at(j));
-                frames->replace(j, temp);
-            }
-            else {p = j; break;}
-        }
+    if (sortColumn < 0) return;
 
-        qSortCANFrameDesc(frames, column, lowerBound, p);
-        qSortCANFrameDesc(frames, column, p+1, upperBound);
+    int num = filteredFrames.count();
+    QVector<uint64_t> keys(num);
+    QVector<uint32_t> rows(num);
+    for (int i = 0; i < num; i++)
+    {
+        rows[i] = filteredFrames[i];
+        uint64_t key = sortKey(frames[static_cast<int>(rows[i])], Column(sortColumn), overwriteDups);
+        //inverting the key sorts descending while keeping equal rows in capture order
+        keys[i] = sortDirAsc ? key : ~key;
     }
+
+    radixSortByKey(keys, rows);
+
+    for (int i = 0; i < num; i++) filteredFrames[i] = rows[i];
+    rebuildOverwriteFilteredRows();
 }
 
 void CANFrameModel::sortByColumn(int column)
 {
+    if (column < 0 || column >= static_cast<int>(Column::NUM_COLUMN)) return;
     sortDirAsc = !sortDirAsc;
-    //beginResetModel();
-    if (sortDirAsc) qSortCANFrameAsc(&frames, Column(column), 0, frames.count()-1);
-    else qSortCANFrameDesc(&frames, Column(column), 0, frames.count()-1);
-    //endResetModel();
-    sendRefresh();
+    sortColumn = column;
+    beginResetModel();
+    applySort();
+    shownRows = filteredFrames.count();
+    endResetModel();
 }
 
-bool CANFrameModel::filterFrameConsideringFunction(int frame_id)
+bool CANFrameModel::filterFrameConsideringFunction(int frame_id) const
 {
     // Returns false if it is to filter
     int func = (frame_id & 0x7FF) >> 7;
@@ -389,48 +587,55 @@ void CANFrameModel::recalcOverwrite()
 {
     if (!overwriteDups) return; //no need to do a thing if mode is disabled
 
+    TRACE_SCOPE("overwrite recalc");
     qDebug() << "recalcOverwrite called in model";
 
-    mutex.lock();
     beginResetModel();
-
-    //Look at the current list of frames and turn it into just a list of unique IDs
-    QHash<uint64_t, CANFrame> overWriteFrames;
-    uint64_t idAugmented; //id in lower 29 bits, bus number shifted up 29 bits
-    foreach(CANFrame frame, frames)
+    invalidateDisplayCache(); //rows are about to be moved around
+
+    //Single pass over the frames collapsing them down to one per (bus, id). Each ID keeps the row it was first
+    //seen at and that row is updated with every later frame of that ID. The rows are built up on their own and
+    //the frames are only read, a mapped capture must not be written to or every page of it gets copied.
+    overwriteRows.clear();
+    QVector<CANFrame> rows;
+    int num = frames.count();
+    for (int i = 0; i < num; i++)
     {
-        idAugmented = frame.frameId();
-        idAugmented = idAugmented + (frame.bus << 29ull);
-        if (!overWriteFrames.contains(idAugmented))
+        CANFrame frame = frames.at(i);
+        uint64_t key = overwriteKey(frame);
+        int row = overwriteRows.value(key, -1);
+        if (row == -1)
         {
             frame.timedelta = 0;
             frame.frameCount = 1;
-            overWriteFrames.insert(idAugmented, frame);
+            overwriteRows.insert(key, rows.count());
+            rows.append(frame);
         }
         else
         {
-            frame.timedelta = frame.timeStamp().microSeconds() - overWriteFrames[idAugmented].timeStamp().microSeconds();
-            frame.frameCount = overWriteFrames[idAugmented].frameCount + 1;
-            overWriteFrames[idAugmented] = frame;
+            frame.timedelta = frame.timeStamp().microSeconds() - rows[row].timeStamp().microSeconds();
+            frame.frameCount = rows[row].frameCount + 1;
+            rows[row] = frame;
         }
     }
-    //Then replace the old list of frames with just the unique list
-    frames.clear();
-    frames.append(overWriteFrames.values().toVector());
-
-    filteredFrames.clear();
-    filteredFrames.reserve(preallocSize);
-
-    for (int i = 0; i < frames.count(); i++)
+    if (frames.externalChunks() > 0)
     {
-        if (filters[frames[i].frameId() & 0x7F] && filterFrameConsideringFunction(frames[i].frameId()))
-        {
-            filteredFrames.append(frames[i]);
-        }
+        //nothing of the file is shown anymore, only the rows built from it
+        frames.clear();
+        captureFile.close();
     }
+    else frames.reset();
+    frames.append(rows);
+    idIndex.rebuild();
 
+    filteredFrames.reset();
+    CompiledFrameFilter filter = compiledFilter;
+    filteredFrames.append(collectRows([filter](const CANFrame &frame) { return filter.matches(frame); }));
+    rebuildOverwriteFilteredRows();
+    applySort();
+
+    shownRows = filteredFrames.count();
     endResetModel();
-    mutex.unlock();
 }
 
 QString CANFrameModel::printIndexSubIndex(const unsigned char *data) const
@@ -574,10 +779,7 @@ QString CANFrameModel::printSDO(int sdo, const unsigned char *data) const
 
 QVariant CANFrameModel::data(const QModelIndex &index, int role) const
 {
-    QString tempString;
-    CANFrame thisFrame;
     static bool rowFlip = false;
-    QVariant ts;
 
     if (!index.isValid())
         return QVariant();
@@ -585,10 +787,7 @@ QVariant CANFrameModel::data(const QModelIndex &index, int role) const
     if (index.row() >= (filteredFrames.count()))
         return QVariant();
 
-    thisFrame = filteredFrames.at(index.row());
-
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(thisFrame.payload().constData());
-    int dataLen = thisFrame.payload().count();
+    const CANFrame &thisFrame = frames.at(static_cast<int>(filteredFrames.at(index.row())));
 
     if (role == Qt::BackgroundColorRole)
     {
@@ -639,101 +838,175 @@ QVariant CANFrameModel::data(const QModelIndex &index, int role) const
     }
 
     if (role == Qt::DisplayRole) {
-        switch (Column(index.column()))
+        //the view asks for the same handful of cells over and over (every repaint, hover, scroll step) so the
+        //formatted text is cached by capture row and column. See invalidateDisplayCache() for when it goes stale
+        int column = index.column();
+        if (interpretFrames && displayDBCGeneration != DBCHandler::getLookupGeneration())
         {
-        case Column::TimeStamp:            
-            //Reformatting the output a bit with custom code
-            if (overwriteDups)
-            {
-                if (timeSeconds) return QString::number(thisFrame.timedelta / 1000000.0, 'f', 5);
-                return QString::number(thisFrame.timedelta);
-            }
-            else ts = Utility::formatTimestamp(thisFrame.timeStamp().microSeconds());
-            if (ts.type() == QVariant::Double) return QString::number(ts.toDouble(), 'f', 5); //never scientific notation, 5 decimal places
-            if (ts.type() == QVariant::LongLong) return QString::number(ts.toLongLong()); //never scientific notion, all digits shown
-            if (ts.type() == QVariant::DateTime) return ts.toDateTime().toString(timeFormat); //custom set format for dates and times
-            return Utility::formatTimestamp(thisFrame.timeStamp().microSeconds());
-        case Column::FrameId:
-            return Utility::formatCANID(thisFrame.frameId(), thisFrame.hasExtendedFrameFormat());
-        case Column::Extended:
-            return QString::number(thisFrame.hasExtendedFrameFormat());
-        case Column::Remote:
-            if (!overwriteDups) return QString::number(thisFrame.frameType() == QCanBusFrame::RemoteRequestFrame);
-            return QString::number(thisFrame.frameCount);
-        case Column::Direction:
-            if (thisFrame.isReceived) return QString(tr("Rx"));
-            return QString(tr("Tx"));
-        case Column::Bus:
-            return QString::number(thisFrame.bus);
-        case Column::Length:
-            return QString::number(dataLen);
-        case Column::ASCII:
-            if (thisFrame.frameId() >= 0x7FFFFFF0ull)
-            {
-                tempString.append("MARK ");
-                tempString.append(QString::number(thisFrame.frameId() & 0x7));
-                return tempString;
-            }
-            if (thisFrame.frameType() == QCanBusFrame::RemoteRequestFrame)
-            {
-                tempString = "Remote request frame";
-            }
-            else
-            {
-                int sdo = Utility::isSDO(thisFrame.frameId());
-                tempString = printSDO(sdo, data);
-            }
+            //DBC files or messages changed so decoded cells may be wrong now
+            displayDBCGeneration = DBCHandler::getLookupGeneration();
+            displayGeneration++;
+        }
+        quint64 cacheKey = displayCacheKey(static_cast<int>(filteredFrames.at(index.row())), column);
+        const QString *cached = displayCache.object(cacheKey);
+        if (cached) return *cached;
+        QString text = formatCell(thisFrame, Column(column));
+        displayCache.insert(cacheKey, new QString(text));
+        return text;
+    }
+
+    return QVariant();
+}
+
+/*
+ * Cells are cached by the row in frames rather than the row in the view so sorting and filtering don't
+ * invalidate anything. A generation number is part of the key so everything can be made stale at once by
+ * bumping it (mode changes, clearing, anything that moves frames around); old entries just age out.
+ */
+quint64 CANFrameModel::displayCacheKey(int row, int column) const
+{
+    return (displayGeneration << 36) | (static_cast<quint64>(static_cast<uint32_t>(row)) << 4) | static_cast<quint64>(column & 0xF);
+}
+
+void CANFrameModel::invalidateDisplayCache()
+{
+    displayGeneration++;
+}
+
+//overwrite mode rewrites rows in place
+void CANFrameModel::invalidateDisplayRow(int row)
+{
+    for (int col = 0; col < static_cast<int>(Column::NUM_COLUMN); col++) displayCache.remove(displayCacheKey(row, col));
+}
+
+/*
+ * Payload bytes as "01 02 AB " (hex) or "1 2 171 " (decimal), built in a stack buffer from lookup tables so
+ * there is exactly one allocation for the whole string instead of a few temporary strings per byte.
+ */
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static QString formatPayloadBytes(const unsigned char *data, int dataLen, bool hex)
+{
+    QChar buffer[CANFRAME_MAX_PAYLOAD * 4]; //"255 " is the longest a byte gets
+    int pos = 0;
+    if (dataLen > CANFRAME_MAX_PAYLOAD) dataLen = CANFRAME_MAX_PAYLOAD;
+    for (int i = 0; i < dataLen; i++)
+    {
+        unsigned char val = data[i];
+        if (hex)
+        {
+            buffer[pos++] = QLatin1Char(hexDigits[val >> 4]);
+            buffer[pos++] = QLatin1Char(hexDigits[val & 0xF]);
+        }
+        else
+        {
+            if (val >= 100) buffer[pos++] = QLatin1Char(static_cast<char>('0' + val / 100));
+            if (val >= 10) buffer[pos++] = QLatin1Char(static_cast<char>('0' + (val / 10) % 10));
+            buffer[pos++] = QLatin1Char(static_cast<char>('0' + val % 10));
+        }
+        buffer[pos++] = QLatin1Char(' ');
+    }
+    return QString(buffer, pos);
+}
+
+//Text for one cell of the main view. Only called when the display cache doesn't have it already
+QString CANFrameModel::formatCell(const CANFrame &thisFrame, Column column) const
+{
+    QString tempString;
+    QVariant ts;
+    const unsigned char *data = thisFrame.payloadData();
+    int dataLen = thisFrame.payloadLength();
+
+    switch (column)
+    {
+    case Column::TimeStamp:
+        //Reformatting the output a bit with custom code
+        if (overwriteDups)
+        {
+            if (timeSeconds) return QString::number(thisFrame.timedelta / 1000000.0, 'f', 5);
+            return QString::number(thisFrame.timedelta);
+        }
+        else ts = Utility::formatTimestamp(thisFrame.timeStamp().microSeconds() - timeOffset);
+        if (ts.type() == QVariant::Double) return QString::number(ts.toDouble(), 'f', 5); //never scientific notation, 5 decimal places
+        if (ts.type() == QVariant::LongLong) return QString::number(ts.toLongLong()); //never scientific notion, all digits shown
+        if (ts.type() == QVariant::DateTime) return ts.toDateTime().toString(timeFormat); //custom set format for dates and times
+        return Utility::formatTimestamp(thisFrame.timeStamp().microSeconds() - timeOffset).toString();
+    case Column::FrameId:
+        return Utility::formatCANID(thisFrame.frameId(), thisFrame.hasExtendedFrameFormat());
+    case Column::Extended:
+        return QString::number(thisFrame.hasExtendedFrameFormat());
+    case Column::Remote:
+        if (!overwriteDups) return QString::number(thisFrame.frameType() == QCanBusFrame::RemoteRequestFrame);
+        return QString::number(thisFrame.frameCount);
+    case Column::Direction:
+        if (thisFrame.isReceived) return QString(tr("Rx"));
+        return QString(tr("Tx"));
+    case Column::Bus:
+        return QString::number(thisFrame.bus);
+    case Column::Length:
+        return QString::number(dataLen);
+    case Column::ASCII:
+        if (thisFrame.frameId() >= 0x7FFFFFF0ull)
+        {
+            tempString.append("MARK ");
+            tempString.append(QString::number(thisFrame.frameId() & 0x7));
             return tempString;
-        case Column::Data:
-            if (dataLen < 0) dataLen = 0;
-            //if (useHexMode) tempString.append("0x ");
-            if (thisFrame.frameType() == QCanBusFrame::RemoteRequestFrame) {
-                return tempString;
-            }
-            for (int i = 0; i < dataLen; i++)
-            {
-                if (useHexMode) tempString.append( QString::number(data[i], 16).toUpper().rightJustified(2, '0'));
-                else tempString.append(QString::number(data[i], 10));
-                tempString.append(" ");
-            }
-            //now, if we're supposed to interpret the data and the DBC handler is loaded then use it
-            if (dbcHandler != nullptr && interpretFrames)
+        }
+        if (thisFrame.frameType() == QCanBusFrame::RemoteRequestFrame)
+        {
+            tempString = "Remote request frame";
+        }
+        else
+        {
+            int sdo = Utility::isSDO(thisFrame.frameId());
+            tempString = printSDO(sdo, data);
+        }
+        return tempString;
+    case Column::Data:
+        if (dataLen < 0) dataLen = 0;
+        //if (useHexMode) tempString.append("0x ");
+        if (thisFrame.frameType() == QCanBusFrame::RemoteRequestFrame) {
+            return tempString;
+        }
+        tempString = formatPayloadBytes(data, dataLen, useHexMode);
+        //now, if we're supposed to interpret the data and the DBC handler is loaded then use it
+        if (dbcHandler != nullptr && interpretFrames)
+        {
+            TRACE_SCOPE("DBC decode");
+            DBC_MESSAGE *msg = dbcHandler->findMessage(thisFrame);
+            if (msg != nullptr)
             {
-                DBC_MESSAGE *msg = dbcHandler->findMessage(thisFrame);
-                if (msg != nullptr)
+                tempString.append("   <" + msg->name + ">\n");
+                if (msg->comment.length() > 1) tempString.append(msg->comment + "\n");
+                for (int j = 0; j < msg->sigHandler->getCount(); j++)
                 {
-                    tempString.append("   <" + msg->name + ">\n");
-                    if (msg->comment.length() > 1) tempString.append(msg->comment + "\n");
-                    for (int j = 0; j < msg->sigHandler->getCount(); j++)
+                    QString sigString;
+                    DBC_SIGNAL* sig = msg->sigHandler->findSignalByIdx(j);
+                    if (sig->processAsText(thisFrame, sigString))
                     {
-                        QString sigString;
-                        DBC_SIGNAL* sig = msg->sigHandler->findSignalByIdx(j);
-                        if (sig->processAsText(thisFrame, sigString))
-                        {
-                            tempString.append(sigString);
-                            tempString.append("\n");
-                        }
-                        else if (sig->isMultiplexed && overwriteDups) //wasn't in this exact frame but is in the message. Use cached value
-                        {
-                            tempString.append(sig->makePrettyOutput(sig->cachedValue.toDouble(), sig->cachedValue.toLongLong()));
-                            tempString.append("\n");
-                        }
+                        tempString.append(sigString);
+                        tempString.append("\n");
+                    }
+                    else if (sig->isMultiplexed && overwriteDups) //wasn't in this exact frame but is in the message. Use cached value
+                    {
+                        tempString.append(sig->makePrettyOutput(sig->cachedValue.toDouble(), sig->cachedValue.toLongLong()));
+                        tempString.append("\n");
                     }
                 }
             }
+        }
 //            tempString = "<html><body><p><i>This text is italic</i></p></body></html>";
 //            tempString = tempString.toHtmlEscaped();
-            return tempString;
-        case Column::CANOpenFunction:
-            return Utility::formatCANOpenFunction(thisFrame.frameId(), thisFrame.hasExtendedFrameFormat());
-        case Column::CANOpenNode:
-            return Utility::formatCANOpenNode(thisFrame.frameId(), thisFrame.hasExtendedFrameFormat());
-        default:
-            return tempString;
-        }
+        return tempString;
+    case Column::CANOpenFunction:
+        return Utility::formatCANOpenFunction(thisFrame.frameId(), thisFrame.hasExtendedFrameFormat());
+    case Column::CANOpenNode:
+        return Utility::formatCANOpenNode(thisFrame.frameId(), thisFrame.hasExtendedFrameFormat());
+    default:
+        return tempString;
     }
 
-    return QVariant();
+    return tempString;
 }
 
 QVariant CANFrameModel::headerData(int section, Qt::Orientation orientation,
@@ -792,123 +1065,153 @@ bool CANFrameModel::any_filters_are_configured(void)
     return false;
 }
 
+bool CANFrameModel::frameIsShown(const CANFrame &frame) const
+{
+    return compiledFilter.matches(frame);
+}
 
 void CANFrameModel::addFrame(const CANFrame& frame, bool autoRefresh = false)
 {
-    /*TODO: remove mutex */
-    mutex.lock();
-    CANFrame tempFrame;
-    tempFrame = frame;
-
-    tempFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, tempFrame.timeStamp().microSeconds() - timeOffset));
+    storeFrame(frame, autoRefresh);
+}
 
+/*
+ * Copies the frame straight into its slot in the capture store and fixes up the model specific fields there.
+ * This is the one and only copy a captured frame gets on its way into the model.
+ *
+ * There is no lock here. The model has a single writer (the thread it lives in) and the stores publish each
+ * new entry only once it is completely written, so readers of getListReference() and friends just see
+ * the capture grow.
+ */
+void CANFrameModel::storeFrame(const CANFrame &frame, bool autoRefresh)
+{
+    if (mappedCaptureFull())
+    {
+        divertFrame(frame);
+        return;
+    }
     lastUpdateNumFrames++;
 
     //if this ID isn't found in the filters list then add it and show it by default
-    if (!filters.contains(tempFrame.frameId() & 0x7F))
+    if (!filters.contains(frame.frameId() & 0x7F))
     {
         // if there are any filters already configured, leave the new filter disabled
         if (any_filters_are_configured())
-            filters.insert(tempFrame.frameId() & 0x7F, false);
+            filters.insert(frame.frameId() & 0x7F, false);
         else
-            filters.insert(tempFrame.frameId() & 0x7F, true);
+            filters.insert(frame.frameId() & 0x7F, true);
+        compileFilters();
         needFilterRefresh = true;
     }
 
-    if (!overwriteDups)
+    uint64_t key = 0;
+    int found = -1;
+    if (overwriteDups)
     {
-        frames.append(tempFrame);
-        if (filters[tempFrame.frameId() & 0x7F] && filterFrameConsideringFunction(tempFrame.frameId()))
-        {
-            if (autoRefresh) beginInsertRows(QModelIndex(), filteredFrames.count(), filteredFrames.count());
-            tempFrame.frameCount = 1;
-            filteredFrames.append(tempFrame);
-            if (autoRefresh) endInsertRows();
-        }
+        key = overwriteKey(frame);
+        found = overwriteRows.value(key, -1);
     }
-    else //yes, overwrite dups
+
+    if (found == -1)
     {
-        bool found = false;
-        for (int i = 0; i < frames.count(); i++)
+        //filled in before it is appended, append() publishes the entry to readers on other threads
+        CANFrame stored = frame;
+        stored.frameCount = 1;
+        if (overwriteDups) stored.timedelta = 0;
+        frames.append(stored);
+        if (stored.timestamp < minTimestamp) minTimestamp = stored.timestamp;
+        if (overwriteDups) overwriteRows.insert(key, frames.count() - 1);
+        idIndex.add(stored, frames.count() - 1);
+        if (frameIsShown(stored))
         {
-            if ( (frames[i].frameId() == tempFrame.frameId()) && (frames[i].bus == tempFrame.bus) )
-            {
-                tempFrame.frameCount = frames[i].frameCount + 1;
-                tempFrame.timedelta = tempFrame.timeStamp().microSeconds() - frames[i].timeStamp().microSeconds();
-                frames.replace(i, tempFrame);
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-        {
-            frames.append(tempFrame);
-            if (filters[tempFrame.frameId() & 0x7F] && filterFrameConsideringFunction(tempFrame.frameId()))
-            {
-                if (autoRefresh) beginInsertRows(QModelIndex(), filteredFrames.count(), filteredFrames.count());
-                tempFrame.frameCount = 1;
-                tempFrame.timedelta = 0;
-                filteredFrames.append(tempFrame);
-                if (autoRefresh) endInsertRows();
-            }
+            int row = filteredFrames.count();
+            filteredFrames.append(static_cast<uint32_t>(frames.count() - 1));
+            if (overwriteDups) overwriteFilteredRows.insert(key, row);
+            //new IDs are rare in overwrite mode so they are announced right away. Otherwise the new row waits
+            //for the next sendBulkRefresh() which announces everything appended since the last one in one go
+            if (autoRefresh || overwriteDups) announceNewRows();
         }
-        else
+    }
+    else //overwriting an existing frame
+    {
+        //rewritten in place, which is why frames may only be read from the GUI thread in overwrite mode
+        CANFrame &stored = frames[found];
+        uint32_t count = stored.frameCount;
+        int64_t lastTime = stored.timeStamp().microSeconds();
+        stored = frame;
+        stored.frameCount = count + 1;
+        stored.timedelta = stored.timeStamp().microSeconds() - lastTime;
+        invalidateDisplayRow(found);
+
+        //the filtered list just points at frames so it already sees the new data. Only the view needs telling.
+        int row = overwriteFilteredRows.value(key, -1);
+        if (row > -1)
         {
-            for (int j = 0; j < filteredFrames.count(); j++)
+            if (autoRefresh) emit dataChanged(index(row, 0), index(row, columnCount(QModelIndex()) - 1));
+            else
             {
-                if ( (filteredFrames[j].frameId() == tempFrame.frameId()) && (filteredFrames[j].bus == tempFrame.bus) )
-                {
-                    if (autoRefresh) beginResetModel();
-                    filteredFrames.replace(j, tempFrame);
-                    if (autoRefresh) endResetModel();
-                }
+                if (dirtyFirstRow == -1 || row < dirtyFirstRow) dirtyFirstRow = row;
+                if (row > dirtyLastRow) dirtyLastRow = row;
             }
         }
     }
-
-    mutex.unlock();
 }
 
 
-void CANFrameModel::addFrames(const CANConnection*, const QVector<CANFrame>& pFrames)
+void CANFrameModel::addFrames(const CANConnection* pConn, const CANFrameBatch& pFrames)
 {
-    foreach(const CANFrame& frame, pFrames)
+    TRACE_SCOPE("model insert");
+    for (int i = 0; i < pFrames.count(); i++)
     {
-        addFrame(frame);
+        storeFrame(pFrames[i], false);
     }
-    if (overwriteDups) //if in overwrite mode we'll update every time frames come in
+    //how long the frames took from the connection's queue to here
+    if (pConn && pFrames.queuedAt()) pConn->getStats().recordLatency(CANConStats::now() - pFrames.queuedAt(), pFrames.count());
+    announceDirtyRows();
+}
+
+//in overwrite mode only tell the view about the span of rows that actually changed
+void CANFrameModel::announceDirtyRows()
+{
+    if (dirtyFirstRow > -1)
     {
-        beginResetModel();
-        endResetModel();
+        emit dataChanged(index(dirtyFirstRow, 0), index(dirtyLastRow, columnCount(QModelIndex()) - 1));
+        dirtyFirstRow = -1;
+        dirtyLastRow = -1;
     }
 }
 
 void CANFrameModel::sendRefresh()
 {
+    TRACE_SCOPE("refilter");
     qDebug() << "Sending mass refresh";
-    QVector<CANFrame> tempContainer;
-    int count = frames.count();
-    for (int i = 0; i < count; i++)
-    {
-        if (filters[frames[i].frameId() & 0x7F] && filterFrameConsideringFunction(frames[i].frameId()))
-        {
-            tempContainer.append(frames[i]);
-        }
-    }
-    mutex.lock();
     beginResetModel();
-    filteredFrames.clear();
-    filteredFrames.reserve(preallocSize);
-    filteredFrames.append(tempContainer);
+    invalidateDisplayCache(); //also how DBC changes get shown
+    filteredFrames.reset();
+    CompiledFrameFilter filter = compiledFilter;
+    filteredFrames.append(collectRows([filter](const CANFrame &frame) { return filter.matches(frame); }));
+    rebuildOverwriteFilteredRows();
+    applySort();
 
     lastUpdateNumFrames = 0;
+    shownRows = filteredFrames.count();
     endResetModel();
-    mutex.unlock();
 }
 
 void CANFrameModel::sendRefresh(int pos)
 {
-    beginInsertRows(QModelIndex(), pos, pos);
+    Q_UNUSED(pos);
+    announceNewRows();
+}
+
+//Tell the view about the filtered rows appended since it was last told. These are always at the end
+//so it is a plain row insert, the view keeps its selection, scroll position and everything it has cached.
+void CANFrameModel::announceNewRows()
+{
+    int num = filteredFrames.count();
+    if (num <= shownRows) return;
+    beginInsertRows(QModelIndex(), shownRows, num - 1);
+    shownRows = num;
     endInsertRows();
 }
 
@@ -917,16 +1220,13 @@ void CANFrameModel::sendRefresh(int pos)
 //have to send thousands of messages per second
 int CANFrameModel::sendBulkRefresh()
 {
-    //int num = filteredFrames.count() - lastUpdateNumFrames;
-    if (lastUpdateNumFrames <= 0) return 0;
+    TRACE_SCOPE("view refresh");
+    enforceCaptureLimit();
 
-    if (lastUpdateNumFrames == 0 && !overwriteDups) return 0;
-    if (filteredFrames.count() == 0) return 0;
+    if (lastUpdateNumFrames <= 0 && shownRows == filteredFrames.count()) return 0;
 
-    qDebug() << "Bulk refresh of " << lastUpdateNumFrames;
-
-    beginResetModel();
-    endResetModel();
+    //overwrite mode tells the view about every changed row as it goes so there's normally nothing pending
+    announceNewRows();
 
     int num = lastUpdateNumFrames;
     lastUpdateNumFrames = 0;
@@ -934,18 +1234,158 @@ int CANFrameModel::sendBulkRefresh()
     return num;
 }
 
+/*
+ * Keep the capture within its memory limit by dropping the oldest chunk of frames until it fits. Dropping
+ * a chunk doesn't copy anything, the store hands the chunk over (to the archive, which writes it out in the
+ * background if archiving is on) and every later row moves down a chunk. In capture order the filtered rows
+ * that pointed into the dropped chunk are all at the top so the view just gets a row removal and keeps the
+ * rest of its state. Sorted views get a reset as those rows could be anywhere.
+ * Overwrite mode is left alone, it only keeps one row per ID anyway.
+ */
+void CANFrameModel::enforceCaptureLimit()
+{
+    //a capture mapped from disk doesn't take up memory to begin with
+    //the chunks of a capture mapped from disk are the file's and can't be given up, see mappedCaptureFull()
+    if (captureLimitChunks <= 0 || overwriteDups || frames.externalChunks() > 0) return;
+    const int chunkSize = CANFrameStore::CHUNK_SIZE;
+    bool evicted = false;
+
+    while (frames.chunkCount() > captureLimitChunks && frames.count() >= chunkSize)
+    {
+        int numFiltered = filteredFrames.count();
+        int gone = 0;
+        if (sortColumn == -1)
+        {
+            while (gone < numFiltered && filteredFrames.at(gone) < static_cast<uint32_t>(chunkSize)) gone++;
+        }
+        //rows the view hasn't been told about yet can't be removed from it
+        bool asRemove = (sortColumn == -1) && (gone <= shownRows);
+        if (!asRemove) beginResetModel();
+        else if (gone > 0) beginRemoveRows(QModelIndex(), 0, gone - 1);
+
+        int kept = 0;
+        for (int i = 0; i < numFiltered; i++)
+        {
+            uint32_t row = filteredFrames.at(i);
+            if (row >= static_cast<uint32_t>(chunkSize)) filteredFrames[kept++] = row - chunkSize;
+        }
+        filteredFrames.truncate(kept);
+        archive.archiveChunk(frames.takeFrontChunk(), chunkSize);
+        idIndex.dropFront(chunkSize);
+        invalidateDisplayCache(); //cached cells are keyed by row in frames
+        evictedFrames += chunkSize;
+
+        if (!asRemove)
+        {
+            shownRows = filteredFrames.count();
+            endResetModel();
+        }
+        else if (gone > 0)
+        {
+            shownRows -= gone;
+            endRemoveRows();
+        }
+        evicted = true;
+    }
+
+    //the earliest frame most likely went with the dropped chunks. Frames are captured in time order so the
+    //first chunk left has the new earliest one
+    if (evicted)
+    {
+        minTimestamp = UINT64_MAX;
+        const CANFrame *chunk = frames.chunkData(0);
+        int num = frames.chunkLength(0);
+        for (int i = 0; i < num; i++)
+        {
+            if (chunk[i].timestamp < minTimestamp) minTimestamp = chunk[i].timestamp;
+        }
+    }
+}
+
+/*
+ * A capture mapped from disk can't drop frames off its front to stay within the limit, those frames are the
+ * file's and cost no memory anyway. What does cost memory is the live frames captured behind it, so once they
+ * fill the limit any further frames bypass the model and go straight to the archive (or are dropped if there
+ * is none), and are counted as evicted.
+ */
+bool CANFrameModel::mappedCaptureFull() const
+{
+    if (captureLimitChunks <= 0 || overwriteDups || frames.externalChunks() == 0) return false;
+    qint64 limit = static_cast<qint64>(frames.externalChunks() + captureLimitChunks) * CANFrameStore::CHUNK_SIZE;
+    return frames.count() >= limit;
+}
+
+void CANFrameModel::divertFrame(const CANFrame &frame)
+{
+    if (!overflowChunk) overflowChunk = new CANFrame[CANFrameStore::CHUNK_SIZE];
+    overflowChunk[overflowCount++] = frame;
+    evictedFrames++;
+    if (overflowCount == CANFrameStore::CHUNK_SIZE) flushOverflow();
+}
+
+void CANFrameModel::flushOverflow()
+{
+    if (!overflowChunk) return;
+    archive.archiveChunk(overflowChunk, overflowCount);
+    overflowChunk = nullptr;
+    overflowCount = 0;
+}
+
+void CANFrameModel::setCaptureLimit(int megabytes)
+{
+    if (megabytes <= 0)
+    {
+        captureLimitChunks = 0;
+        return;
+    }
+    //each frame also costs a filtered row and an ID index entry
+    qint64 chunkBytes = static_cast<qint64>(CANFrameStore::CHUNK_SIZE) * (sizeof(CANFrame) + 2 * sizeof(uint32_t));
+    //never less than two chunks, one full and the one being filled
+    captureLimitChunks = qMax(2, static_cast<int>(static_cast<qint64>(megabytes) * 1024 * 1024 / chunkBytes));
+}
+
+void CANFrameModel::setArchiveDirectory(QString directory)
+{
+    archive.setDirectory(directory);
+}
+
+quint64 CANFrameModel::getEvictedFrameCount() const
+{
+    return evictedFrames;
+}
+
+quint64 CANFrameModel::getArchivedFrameCount() const
+{
+    return archive.archivedFrames();
+}
+
+qint64 CANFrameModel::getCaptureBytes() const
+{
+    //chunks of a mapped capture are the file's pages, not ours
+    return static_cast<qint64>(frames.chunkCount() - frames.externalChunks()) * CANFrameStore::CHUNK_SIZE * sizeof(CANFrame);
+}
+
 void CANFrameModel::clearFrames()
 {
-    mutex.lock();
     this->beginResetModel();
+    invalidateDisplayCache();
+    flushOverflow();
     frames.clear();
+    captureFile.close(); //only after frames has let go of it
     filteredFrames.clear();
+    idIndex.clear();
+    overwriteRows.clear();
+    overwriteFilteredRows.clear();
+    shownRows = 0;
+    dirtyFirstRow = -1;
+    dirtyLastRow = -1;
+    sortColumn = -1;
+    evictedFrames = 0;
+    timeOffset = 0;
+    minTimestamp = UINT64_MAX;
 //    filters.clear();
-    frames.reserve(preallocSize);
-    filteredFrames.reserve(preallocSize);
     this->endResetModel();
     lastUpdateNumFrames = 0;
-    mutex.unlock();
 
     emit updatedFiltersList();
 }
@@ -955,49 +1395,133 @@ void CANFrameModel::clearFrames()
  * you can't insert frames with it. Instead this function
  * allows for a mass import of frames into the model
  */
-void CANFrameModel::insertFrames(const QVector<CANFrame> &newFrames)
+void CANFrameModel::insertFrames(const CANFrame *newFrames, int count)
 {
-    //not resetting the model here because the serial worker automatically does a bulk refresh every 1/4 second
-    //and that refresh will cause the view to update. If you do both it usually ends up thinking you have
-    //double the number of frames.
+    //not telling the view anything here. The new rows are picked up by the next sendBulkRefresh() which
+    //the main window does on a timer, and announcing them twice would make the view think there are
+    //twice as many frames.
     //beginResetModel();
-    mutex.lock();
+    TRACE_SCOPE("model insert");
+    if (overwriteDups)
+    {
+        //collapsed into the per ID rows a frame at a time like live frames are, not by redoing the whole list
+        for (int i = 0; i < count; i++) storeFrame(newFrames[i], false);
+        announceDirtyRows();
+        if (needFilterRefresh) emit updatedFiltersList();
+        return;
+    }
     int insertedFiltered = 0;
-    for (int i = 0; i < newFrames.count(); i++)
+    for (int i = 0; i < count; i++)
     {
         frames.append(newFrames[i]);
+        idIndex.add(newFrames[i], frames.count() - 1);
+        if (newFrames[i].timestamp < minTimestamp) minTimestamp = newFrames[i].timestamp;
         if (!filters.contains(newFrames[i].frameId() & 0x7F))
         {
             filters.insert(newFrames[i].frameId() & 0x7F, true);
+            compileFilters();
             needFilterRefresh = true;
         }
-        if (filters[newFrames[i].frameId() & 0x7F] && filterFrameConsideringFunction(newFrames[i].frameId()))
+        if (frameIsShown(newFrames[i]))
         {
             insertedFiltered++;
-            filteredFrames.append(newFrames[i]);
+            filteredFrames.append(static_cast<uint32_t>(frames.count() - 1));
         }
     }
-    lastUpdateNumFrames = newFrames.count();
-    mutex.unlock();
+    lastUpdateNumFrames += count; //several batches and live frames may come in between two GUI updates
     //endResetModel();
     //beginInsertRows(QModelIndex(), filteredFrames.count() + 1, filteredFrames.count() + insertedFiltered);
     //endInsertRows();
     if (needFilterRefresh) emit updatedFiltersList();
 }
 
-int CANFrameModel::getIndexFromTimeID(unsigned int ID, double timestamp)
+/*
+ * Show a capture file (see CaptureFile) straight from disk instead of loading it. frames is pointed at the
+ * mapped file and the per ID index is the sparse kind so what is kept in memory is the filtered row list and
+ * a few bytes per ID per chunk, not the frames. Files with an index already list the IDs of every chunk,
+ * older ones take a read through the file spread over every core. Anything captured afterwards is appended
+ * behind the file's frames as usual.
+ */
+bool CANFrameModel::openCaptureFile(const QString &filename)
 {
-    int bestIndex = -1;
-    int64_t intTimeStamp = static_cast<int64_t> (timestamp * 1000000l);
-    for (int i = 0; i < frames.count(); i++)
+    clearFrames();
+    if (!captureFile.open(filename)) return false;
+
+    beginResetModel();
+    frames.attach(captureFile.frames(), captureFile.count());
+
+    if (captureFile.hasIndex())
+    {
+        //the file's index already says which IDs each chunk has
+        idIndex.setChunkKeys(captureFile.chunkKeys(), captureFile.chunkFirstTimestamps());
+        minTimestamp = captureFile.firstTimestamp();
+    }
+    else
     {
-        if ((frames[i].frameId() == ID))
+        //one pass over each chunk for the IDs in it and its earliest timestamp
+        typedef QPair<QVector<uint64_t>, uint64_t> ChunkScan;
+        const CANFrameStore *store = &frames;
+        std::function<ChunkScan(int)> scanChunk = [store](int chunk)
         {
-            if (frames[i].timeStamp().microSeconds() <= intTimeStamp) bestIndex = i;
-            else break; //drop out of loop as soon as we pass the proper timestamp
+            const CANFrame *data = store->chunkData(chunk);
+            int num = store->chunkLength(chunk);
+            uint64_t earliest = UINT64_MAX;
+            for (int i = 0; i < num; i++) if (data[i].timestamp < earliest) earliest = data[i].timestamp;
+            return ChunkScan(CANFrameIDIndex::keysOf(data, num), earliest);
+        };
+        QVector<int> chunkList(frames.chunkCount());
+        for (int i = 0; i < chunkList.count(); i++) chunkList[i] = i;
+        QList<ChunkScan> scans = QtConcurrent::blockingMapped<QList<ChunkScan> >(chunkList, scanChunk);
+        QVector<QVector<uint64_t> > keys;
+        QVector<uint64_t> earliest;
+        keys.reserve(scans.count());
+        earliest.reserve(scans.count());
+        foreach (const ChunkScan &scan, scans)
+        {
+            keys.append(scan.first);
+            earliest.append(scan.second);
+            if (scan.second < minTimestamp) minTimestamp = scan.second;
         }
+        idIndex.setChunkKeys(keys, earliest);
     }
-    return bestIndex;
+
+    //nodes showing up for the first time are shown, same as insertFrames
+    foreach (uint32_t id, idIndex.ids())
+    {
+        if (!filters.contains(id & 0x7F))
+        {
+            filters.insert(id & 0x7F, true);
+            needFilterRefresh = true;
+        }
+    }
+    compileFilters();
+
+    CompiledFrameFilter filter = compiledFilter;
+    filteredFrames.append(collectRows([filter](const CANFrame &frame) { return filter.matches(frame); }));
+    shownRows = filteredFrames.count();
+    endResetModel();
+
+    if (overwriteDups) recalcOverwrite();
+    if (needFilterRefresh) emit updatedFiltersList();
+    return true;
+}
+
+bool CANFrameModel::isMappedCapture() const
+{
+    return captureFile.isOpen();
+}
+
+//row in frames of the last frame with this ID at or before the timestamp (in seconds). -1 if there isn't one
+int CANFrameModel::getIndexFromTimeID(unsigned int ID, double timestamp)
+{
+    if (timestamp < 0) return -1;
+    uint64_t intTimeStamp = static_cast<uint64_t>(timestamp * 1000000l);
+    return idIndex.rowAtOrBeforeForID(ID, intTimeStamp);
+}
+
+const CANFrameIDIndex* CANFrameModel::getIDIndex() const
+{
+    return &idIndex;
 }
 
 void CANFrameModel::loadFilterFile(QString filename)
@@ -1023,6 +1547,7 @@ void CANFrameModel::loadFilterFile(QString filename)
     }
     inFile->close();
 
+    compileFilters();
     sendRefresh();
 
     emit updatedFiltersList();
@@ -1061,14 +1586,14 @@ bool CANFrameModel::needsFilterRefresh()
  * external code that needs to access frames directly and doesn't care about
  * this model's normal output mechanism.
  */
-const QVector<CANFrame>* CANFrameModel::getListReference() const
+const CANFrameView* CANFrameModel::getListReference() const
 {
-    return &frames;
+    return &framesView;
 }
 
-const QVector<CANFrame>* CANFrameModel::getFilteredListReference() const
+const CANFrameView* CANFrameModel::getFilteredListReference() const
 {
-    return &filteredFrames;
+    return &filteredFramesView;
 }
 
 const QMap<int, bool>* CANFrameModel::getFiltersReference() const
@@ -5,8 +5,16 @@
 #include <QList>
 #include <QVector>
 #include <QDebug>
-#include <QMutex>
+#include <QHash>
+#include <QCache>
 #include "can_structs.h"
+#include "canframestore.h"
+#include "canframeidindex.h"
+#include "canframeview.h"
+#include "canframebatch.h"
+#include "compiledframefilter.h"
+#include "capturearchive.h"
+#include "capturefile.h"
 #include "dbc/dbchandler.h"
 #include "connections/canconnection.h"
 
@@ -58,44 +66,81 @@ public:
     void normalizeTiming();
     void recalcOverwrite();
     bool needsFilterRefresh();
-    void insertFrames(const QVector<CANFrame> &newFrames);
+    void insertFrames(const QVector<CANFrame> &newFrames) { insertFrames(newFrames.constData(), newFrames.count()); }
+    void insertFrames(const CANFrame *newFrames, int count); //straight from a CANFrameBatch etc, nothing copied first
+    bool openCaptureFile(const QString &filename);
+    bool isMappedCapture() const;
     void sortByColumn(int column);
     int getIndexFromTimeID(unsigned int ID, double timestamp);
-    const QVector<CANFrame> *getListReference() const; //thou shalt not modify these frames externally!
-    const QVector<CANFrame> *getFilteredListReference() const; //Thus saith the Lord, NO.
+    const CANFrameIDIndex *getIDIndex() const; //rows of getListReference() by (bus, id)
+    //thou shalt not modify these frames externally! Entries below count() may be read from any thread, except
+    //in overwrite mode where the rows are rewritten in place as frames come in and only the GUI thread may look
+    const CANFrameView *getListReference() const;
+    const CANFrameView *getFilteredListReference() const; //Thus saith the Lord, NO.
     const QMap<int, bool> *getFiltersReference() const; //this neither
-    void set_filterNMTon(bool state) {filterNMTon = state; sendRefresh();};
-    void set_filterSYNCon(bool state) {filterSYNCon = state; sendRefresh();};
-    void set_filterEMCYon(bool state) {filterEMCYon = state; sendRefresh();};
-    void set_filterHBEATon(bool state) {filterHBEATon = state; sendRefresh();};
-    void set_filterTIMEon(bool state) {filterTIMEon = state; sendRefresh();};
-    bool filterFrameConsideringFunction(int frame_id);
+    void set_filterNMTon(bool state);
+    void set_filterSYNCon(bool state);
+    void set_filterEMCYon(bool state);
+    void set_filterHBEATon(bool state);
+    void set_filterTIMEon(bool state);
+    bool filterFrameConsideringFunction(int frame_id) const;
+    void setCaptureLimit(int megabytes); //0 = keep everything
+    void setArchiveDirectory(QString directory); //where evicted frames go. Empty = drop them
+    quint64 getEvictedFrameCount() const;
+    quint64 getArchivedFrameCount() const;
+    qint64 getCaptureBytes() const;
 
     QString printSDO(int sdo, const unsigned char *data) const;
 
 public slots:
     void addFrame(const CANFrame&, bool);
-    void addFrames(const CANConnection*, const QVector<CANFrame>&);
+    void addFrames(const CANConnection*, const CANFrameBatch&);
 
 signals:
     void updatedFiltersList();
 
 private:
-    void qSortCANFrameAsc(QVector<CANFrame>* frames, Column column, int lowerBound, int upperBound);
-    void qSortCANFrameDesc(QVector<CANFrame>* frames, Column column, int lowerBound, int upperBound);
-    uint64_t getCANFrameVal(int row, Column col);
+    void applySort();
+    QString formatCell(const CANFrame &thisFrame, Column column) const;
+    quint64 displayCacheKey(int row, int column) const;
+    void invalidateDisplayCache();
+    void invalidateDisplayRow(int row);
+    void announceNewRows();
+    void announceDirtyRows();
+    void enforceCaptureLimit();
+    bool mappedCaptureFull() const;
+    void divertFrame(const CANFrame &frame);
+    void flushOverflow();
     bool any_filters_are_configured(void);
+    bool frameIsShown(const CANFrame &frame) const;
+    void compileFilters();
+    template<typename Pred> QVector<uint32_t> collectRows(Pred pred) const;
+    void storeFrame(const CANFrame &frame, bool autoRefresh);
+    void rebuildOverwriteRows();
+    void rebuildOverwriteFilteredRows();
+    template<typename Matcher> void updateFilteredRows(Matcher matches, bool show);
 
-    QVector<CANFrame> frames;
-    QVector<CANFrame> filteredFrames;
+    CANFrameStore frames;
+    CANFrameIndexStore filteredFrames; //indices into frames of the rows that pass the filters
+    CANFrameIDIndex idIndex; //(bus, id) -> rows in frames
+    QHash<uint64_t, int> overwriteRows; //overwrite mode only. (bus, id) -> row in frames
+    QHash<uint64_t, int> overwriteFilteredRows; //overwrite mode only. (bus, id) -> row in filteredFrames
+    int shownRows; //rows of filteredFrames the view has been told about. Anything past this is pending
+    int dirtyFirstRow; //span of filtered rows updated since the view was last told
+    int dirtyLastRow;
+    mutable QCache<quint64, QString> displayCache; //formatted cells by (generation, row in frames, column)
+    mutable quint64 displayGeneration; //bumped whenever every cached cell goes stale
+    mutable uint32_t displayDBCGeneration; //DBC lookup generation the cached cells were made with
+    CANFrameView framesView;
+    CANFrameView filteredFramesView;
     QMap<int, bool> filters;
+    CompiledFrameFilter compiledFilter; //filters and the filterXXXon flags as a lookup table. See compileFilters()
     bool filterNMTon;
     bool filterSYNCon;
     bool filterEMCYon;
     bool filterHBEATon;
     bool filterTIMEon;
     DBCHandler *dbcHandler;
-    QMutex mutex;
     bool interpretFrames; //should we use the dbcHandler?
     bool overwriteDups; //should we display all frames or only the newest for each ID?
     QString timeFormat;
@@ -103,10 +148,17 @@ private:
     bool timeSeconds;
     bool useSystemTime;
     bool needFilterRefresh;
-    int64_t timeOffset;
+    int64_t timeOffset; //subtracted from every timestamp shown, see normalizeTiming()
+    uint64_t minTimestamp; //earliest timestamp in frames, kept up to date as frames come in. UINT64_MAX when empty
     int lastUpdateNumFrames;
-    uint32_t preallocSize;
+    int sortColumn; //column the filtered rows are sorted on, -1 for capture order
     bool sortDirAsc;
+    int captureLimitChunks; //most chunks of frames to keep, 0 for no limit
+    quint64 evictedFrames; //frames dropped off the front of this capture to stay within the limit
+    CANFrame *overflowChunk; //frames diverted past a full mapped capture, waiting to be archived a chunk at a time
+    int overflowCount;
+    CaptureArchive archive;
+    CaptureFile captureFile; //capture shown straight from disk, see openCaptureFile()
     QString printIndexSubIndex(const unsigned char *data) const;
 };
 
@@ -0,0 +1,195 @@
+#ifndef CANFRAMESTORE_H
+#define CANFRAMESTORE_H
+
+#include <QVector>
+#include <QAtomicInt>
+#include <QDebug>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include "can_structs.h"
+
+/*
+ * Append-only storage for captured frames (and the filtered row index list that goes with them). Entries live
+ * in fixed size chunks of CHUNK_SIZE entries that are allocated one at a time as the capture grows. A chunk is
+ * never moved or resized once allocated so growing the store never copies anything and an entry stays at the
+ * same address (and row index) until the store is cleared or its front chunk is evicted (takeFrontChunk()).
+ * The chunk pointers are kept in a directory that is sized once up front to cover every row index an int can
+ * address so the directory itself is never reallocated.
+ *
+ * There is one writer and any number of readers. The writer fills in the new entry (allocating its chunk if
+ * need be) and only then publishes the new count with a release store. Readers take a snapshot of count()
+ * (acquire) and can read every entry below it without any locking, from any thread. Changes that rewrite
+ * existing entries (resetting, truncating, overwriting) are the writer's business too and must be done
+ * while readers are told to look away, which for the model means inside beginResetModel/endResetModel.
+ * The model's overwrite mode is the exception: it rewrites its one row per ID as frames arrive, so while it is
+ * on the entries may only be read from the writer's (GUI) thread.
+ */
+template<typename T>
+class ChunkStore
+{
+public:
+    static const int CHUNK_BITS = 16;
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS; //64K entries, a bit over 6MB per chunk of frames
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+    static const int MAX_CHUNKS = 32768; //CHUNK_SIZE * MAX_CHUNKS = every non-negative int row
+
+    ChunkStore() : mAllocatedChunks(0), mExternalChunks(0), mCount(0)
+    {
+        mChunks = new T*[MAX_CHUNKS]();
+    }
+
+    ~ChunkStore()
+    {
+        clear();
+        delete[] mChunks;
+    }
+
+    //committed entries. Everything below this is safe to read
+    int count() const { return mCount.loadAcquire(); }
+    int length() const { return count(); }
+    int size() const { return count(); }
+    bool isEmpty() const { return count() == 0; }
+
+    const T &at(int i) const { return mChunks[i >> CHUNK_BITS][i & CHUNK_MASK]; }
+    const T &operator[](int i) const { return at(i); }
+    T &operator[](int i) { return mChunks[i >> CHUNK_BITS][i & CHUNK_MASK]; }
+
+    /* writer side */
+
+    void append(const T &entry)
+    {
+        int num = mCount.load();
+        int chunk = num >> CHUNK_BITS;
+        if (chunk >= mAllocatedChunks)
+        {
+            if (chunk >= MAX_CHUNKS)
+            {
+                qDebug() << "Frame store is full. Dropping entry.";
+                return;
+            }
+            mChunks[chunk] = new T[CHUNK_SIZE];
+            mAllocatedChunks++;
+        }
+        mChunks[chunk][num & CHUNK_MASK] = entry;
+        mCount.storeRelease(num + 1);
+    }
+
+    void append(const QVector<T> &entries)
+    {
+        for (int i = 0; i < entries.count(); i++) append(entries[i]);
+    }
+
+    void replace(int i, const T &entry) { (*this)[i] = entry; }
+
+    void swapEntries(int i, int j)
+    {
+        T temp = at(i);
+        (*this)[i] = at(j);
+        (*this)[j] = temp;
+    }
+
+    //drop everything from row num on but keep the chunks around for reuse
+    void truncate(int num)
+    {
+        if (num < count()) mCount.storeRelease(num);
+    }
+
+    //forget every entry but keep the chunks around for reuse
+    void reset() { mCount.storeRelease(0); }
+
+    /*
+     * Drop the oldest CHUNK_SIZE entries by handing their chunk to the caller, who owns it from then on
+     * (delete[] it when done). Every later entry moves down CHUNK_SIZE rows. Only the directory is shuffled,
+     * nothing is copied. Returns nullptr if there isn't a full chunk to give up or the front chunk isn't ours.
+     * This renumbers every row and frees the memory behind the old front rows, so like the other changes to
+     * existing entries it may only run on the thread the readers are on (the model's GUI thread), between
+     * beginRemoveRows/endRemoveRows or a model reset. Lock-free readers on other threads must not hold rows
+     * across an eviction.
+     */
+    T *takeFrontChunk()
+    {
+        int num = count();
+        if (num < CHUNK_SIZE || mAllocatedChunks == 0 || mExternalChunks > 0) return nullptr;
+        T *chunk = mChunks[0];
+        memmove(mChunks, mChunks + 1, static_cast<size_t>(mAllocatedChunks - 1) * sizeof(T *));
+        mAllocatedChunks--;
+        mChunks[mAllocatedChunks] = nullptr;
+        mCount.storeRelease(num - CHUNK_SIZE);
+        return chunk;
+    }
+
+    //forget every entry and give the memory back (detaching from attached memory)
+    void clear()
+    {
+        mCount.storeRelease(0);
+        for (int i = 0; i < mAllocatedChunks; i++)
+        {
+            if (i >= mExternalChunks) delete[] mChunks[i];
+            mChunks[i] = nullptr;
+        }
+        mAllocatedChunks = 0;
+        mExternalChunks = 0;
+    }
+
+    /*
+     * Turn the store into a window onto num entries that live somewhere else, a memory mapped capture file
+     * for instance. The directory points straight into that memory so nothing is read (or paged in) until
+     * somebody looks at it. Those chunks aren't ours: clear() leaves them alone and takeFrontChunk() won't
+     * hand them out. A trailing partial chunk is copied into a chunk of our own so append() carries on after
+     * the attached entries as usual. Anything that was in the store before is dropped. The memory has to stay
+     * where it is until the store is cleared.
+     */
+    void attach(T *entries, int num)
+    {
+        clear();
+        int whole = num >> CHUNK_BITS;
+        for (int i = 0; i < whole; i++) mChunks[i] = entries + (static_cast<size_t>(i) << CHUNK_BITS);
+        mAllocatedChunks = whole;
+        mExternalChunks = whole;
+        int rest = num & CHUNK_MASK;
+        if (rest)
+        {
+            mChunks[whole] = new T[CHUNK_SIZE];
+            std::copy(entries + (static_cast<size_t>(whole) << CHUNK_BITS), entries + num, mChunks[whole]);
+            mAllocatedChunks++;
+        }
+        mCount.storeRelease(num);
+    }
+
+    //chunks at the front of the directory that belong to attached memory
+    int externalChunks() const { return mExternalChunks; }
+
+    int indexOf(const T &entry) const
+    {
+        int num = count();
+        for (int i = 0; i < num; i++)
+        {
+            if (at(i) == entry) return i;
+        }
+        return -1;
+    }
+
+    //Chunk local access. Each chunk is a plain contiguous array so readers that want to walk the whole
+    //capture quickly can do so a chunk at a time instead of going through at() for every entry.
+    int chunkCount() const { return (count() + CHUNK_MASK) >> CHUNK_BITS; }
+    const T *chunkData(int chunk) const { return mChunks[chunk]; }
+    int chunkLength(int chunk) const
+    {
+        int remaining = count() - (chunk << CHUNK_BITS);
+        return (remaining > CHUNK_SIZE) ? CHUNK_SIZE : remaining;
+    }
+
+private:
+    Q_DISABLE_COPY(ChunkStore)
+
+    T **mChunks; //directory, MAX_CHUNKS entries. Unallocated chunks are null
+    int mAllocatedChunks; //writer only
+    int mExternalChunks; //writer only. The first this many chunks are attached memory, see attach()
+    QAtomicInt mCount;
+};
+
+typedef ChunkStore<CANFrame> CANFrameStore;
+typedef ChunkStore<uint32_t> CANFrameIndexStore; //rows of a CANFrameStore
+
+#endif // CANFRAMESTORE_H
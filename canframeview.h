@@ -0,0 +1,93 @@
+#ifndef CANFRAMEVIEW_H
+#define CANFRAMEVIEW_H
+
+#include <QVector>
+#include <stdint.h>
+#include "can_structs.h"
+#include "canframestore.h"
+#include "canframeidindex.h"
+
+/*
+ * Read-only window onto a list of captured frames. The backing list is either the chunked capture store of
+ * CANFrameModel or a plain QVector for code that builds its own list of frames. The view either covers every
+ * frame in the backing list or, when an index list is supplied, just the rows that index list points at (this
+ * is how the filtered view of CANFrameModel is handed out without keeping a second copy of every frame around).
+ * The API is the read-only subset of QVector that the analysis windows have always used (at, count, etc)
+ * so code that used to take a const QVector<CANFrame> * reads exactly the same.
+ * Reading through a view needs no locking, see CANFrameStore. Loops should take count() once up front.
+ * A view over the whole capture of the model also carries the model's per ID index (idIndex()) so code looking
+ * for the frames of one ID can go straight to them. Other views return null there and have to be scanned.
+ */
+class CANFrameView
+{
+public:
+    class const_iterator
+    {
+    public:
+        const_iterator(const CANFrameView *view, int pos) : mView(view), mPos(pos) {}
+        const CANFrame &operator*() const { return mView->at(mPos); }
+        const CANFrame *operator->() const { return &mView->at(mPos); }
+        const_iterator &operator++() { mPos++; return *this; }
+        bool operator==(const const_iterator &other) const { return mPos == other.mPos; }
+        bool operator!=(const const_iterator &other) const { return mPos != other.mPos; }
+    private:
+        const CANFrameView *mView;
+        int mPos;
+    };
+
+    CANFrameView() : mStore(nullptr), mFrames(nullptr), mIndices(nullptr), mIDIndex(nullptr) {}
+    explicit CANFrameView(const CANFrameStore *store, const CANFrameIndexStore *indices = nullptr)
+        : mStore(store), mFrames(nullptr), mIndices(indices), mIDIndex(nullptr) {}
+    explicit CANFrameView(const QVector<CANFrame> *frames)
+        : mStore(nullptr), mFrames(frames), mIndices(nullptr), mIDIndex(nullptr) {}
+
+    int count() const
+    {
+        if (mIndices) return mIndices->count();
+        if (mStore) return mStore->count();
+        if (mFrames) return mFrames->count();
+        return 0;
+    }
+    int length() const { return count(); }
+    int size() const { return count(); }
+    bool isEmpty() const { return count() == 0; }
+
+    const CANFrame &at(int i) const
+    {
+        if (mIndices) i = static_cast<int>(mIndices->at(i));
+        if (mStore) return mStore->at(i);
+        return mFrames->at(i);
+    }
+    const CANFrame &operator[](int i) const { return at(i); }
+    const CANFrame &first() const { return at(0); }
+    const CANFrame &last() const { return at(count() - 1); }
+
+    //row in the backing list that the given row of this view refers to
+    int sourceIndex(int i) const { return mIndices ? static_cast<int>(mIndices->at(i)) : i; }
+
+    //rows of the index are rows of this view. Null if this view doesn't have an index
+    const CANFrameIDIndex *idIndex() const { return mIDIndex; }
+    void setIDIndex(const CANFrameIDIndex *index) { mIDIndex = index; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count()); }
+
+    //deep copy of the frames this view covers. Only for code that really needs its own private list
+    QVector<CANFrame> toVector() const
+    {
+        if (mFrames && !mIndices) return *mFrames;
+        QVector<CANFrame> out;
+        int num = count();
+        out.reserve(num);
+        for (int i = 0; i < num; i++) out.append(at(i));
+        return out;
+    }
+
+private:
+    const CANFrameStore *mStore;
+    const QVector<CANFrame> *mFrames;
+    const CANFrameIndexStore *mIndices;
+    const CANFrameIDIndex *mIDIndex;
+};
+
+#endif // CANFRAMEVIEW_H
@@ -0,0 +1,66 @@
+#include "capturearchive.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <QtConcurrent>
+#include "framefileio.h"
+
+CaptureArchive::CaptureArchive()
+{
+    mPool.setMaxThreadCount(1);
+    mPool.setExpiryTimeout(-1);
+    mSession = QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss");
+    mChunksQueued = 0;
+    mArchived.storeRelease(0);
+    mFailed.storeRelease(0);
+}
+
+CaptureArchive::~CaptureArchive()
+{
+    //whatever is still queued was evicted from the capture, don't throw it away on the way out
+    mPool.waitForDone();
+}
+
+void CaptureArchive::setDirectory(const QString &directory)
+{
+    if (directory == mDirectory) return;
+    mDirectory = directory;
+    mChunksQueued = 0; //start a fresh file in the new place
+}
+
+void CaptureArchive::archiveChunk(CANFrame *chunk, int count)
+{
+    if (!chunk) return;
+    if (!isEnabled())
+    {
+        delete[] chunk;
+        return;
+    }
+
+    int fileNum = mChunksQueued / FILE_CHUNKS;
+    mChunksQueued++;
+    QString filename = QDir(mDirectory).filePath(QString("capture-%1-%2.csv").arg(mSession).arg(fileNum, 4, 10, QChar('0')));
+
+    QtConcurrent::run(&mPool, [this, chunk, count, filename]()
+    {
+        bool ok = false;
+        QFile file(filename);
+        if (QDir().mkpath(QFileInfo(filename).absolutePath()) &&
+            file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        {
+            if (file.size() == 0) FrameFileIO::writeNativeCSVHeader(&file);
+            ok = FrameFileIO::writeNativeCSVFrames(&file, chunk, count);
+            file.close();
+        }
+        delete[] chunk;
+
+        if (ok) mArchived.fetchAndAddOrdered(static_cast<quint64>(count));
+        else
+        {
+            mFailed.fetchAndAddOrdered(static_cast<quint64>(count));
+            qDebug() << "Could not archive evicted frames to" << filename;
+        }
+    });
+}
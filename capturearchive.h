@@ -0,0 +1,50 @@
+#ifndef CAPTUREARCHIVE_H
+#define CAPTUREARCHIVE_H
+
+#include <QString>
+#include <QThreadPool>
+#include <QAtomicInteger>
+#include <QDateTime>
+#include "can_structs.h"
+
+/*
+ * Writes out the chunks of frames CANFrameModel evicts when the capture hits its memory limit so nothing is
+ * actually lost, it just isn't on screen anymore. Chunks are handed over with archiveChunk() and written to
+ * native CSV files in the background on a pool with a single thread, so they land on disk in the order they
+ * were evicted and the GUI thread never waits on the disk. A new file is started every FILE_CHUNKS chunks to
+ * keep each file a size that loads back in comfortably.
+ */
+class CaptureArchive
+{
+public:
+    static const int FILE_CHUNKS = 16; //a bit over a million frames per file
+
+    CaptureArchive();
+    ~CaptureArchive();
+
+    //empty directory = don't archive, evicted frames are just thrown away
+    void setDirectory(const QString &directory);
+    QString directory() const { return mDirectory; }
+    bool isEnabled() const { return !mDirectory.isEmpty(); }
+
+    //takes ownership of chunk (new[]'d, as handed out by ChunkStore::takeFrontChunk) and deletes it once written
+    void archiveChunk(CANFrame *chunk, int count);
+
+    //frames written out so far and frames that could not be written. Safe to read from any thread
+    quint64 archivedFrames() const { return mArchived.loadAcquire(); }
+    quint64 failedFrames() const { return mFailed.loadAcquire(); }
+
+    void waitForDone() { mPool.waitForDone(); }
+
+private:
+    Q_DISABLE_COPY(CaptureArchive)
+
+    QThreadPool mPool;
+    QString mDirectory;
+    QString mSession; //start of the file names, one per run of the program
+    int mChunksQueued; //GUI thread only. Decides which file a chunk goes into
+    QAtomicInteger<quint64> mArchived;
+    QAtomicInteger<quint64> mFailed;
+};
+
+#endif // CAPTUREARCHIVE_H
@@ -0,0 +1,426 @@
+#include "capturefile.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <string.h>
+
+static const char captureMagic[8] = {'C', 'A', 'N', 'O', 'C', 'A', 'P', 0};
+static const char indexMagic[8] = {'C', 'A', 'N', 'O', 'I', 'D', 'X', 0};
+
+//index block, at Header::indexOffset
+struct IndexHeader
+{
+    char magic[8];
+    uint32_t numChunks;
+    uint32_t reserved;
+};
+
+//one per chunk, each followed by numKeys IndexKey
+struct IndexChunk
+{
+    uint64_t fileOffset;
+    uint64_t firstTimestamp;
+    uint64_t lastTimestamp;
+    uint32_t frames;
+    uint32_t numKeys;
+};
+
+struct IndexKey
+{
+    uint64_t key;
+    uint64_t count;
+};
+
+//index entry of the chunk being written
+struct ChunkStats
+{
+    uint64_t fileOffset;
+    uint64_t firstTimestamp;
+    uint64_t lastTimestamp;
+    uint32_t frames;
+    QHash<uint64_t, uint64_t> counts;
+
+    void start(uint64_t offset)
+    {
+        fileOffset = offset;
+        firstTimestamp = UINT64_MAX;
+        lastTimestamp = 0;
+        frames = 0;
+        counts.clear();
+    }
+
+    void add(const CANFrame &frame)
+    {
+        if (frame.timestamp < firstTimestamp) firstTimestamp = frame.timestamp;
+        if (frame.timestamp > lastTimestamp) lastTimestamp = frame.timestamp;
+        counts[CANFrameIDIndex::key(frame.bus, frame.frameId())]++;
+        frames++;
+    }
+
+    void writeTo(QByteArray &out) const
+    {
+        IndexChunk chunk;
+        chunk.fileOffset = fileOffset;
+        chunk.firstTimestamp = firstTimestamp;
+        chunk.lastTimestamp = lastTimestamp;
+        chunk.frames = frames;
+        chunk.numKeys = static_cast<uint32_t>(counts.count());
+        out.append(reinterpret_cast<const char *>(&chunk), sizeof(chunk));
+
+        QList<uint64_t> keys = counts.keys();
+        std::sort(keys.begin(), keys.end());
+        foreach (uint64_t key, keys)
+        {
+            IndexKey entry;
+            entry.key = key;
+            entry.count = counts.value(key);
+            out.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        }
+    }
+};
+
+static QByteArray busesToJson(const QVector<CaptureFile::BusInfo> &buses)
+{
+    QJsonArray list;
+    foreach (const CaptureFile::BusInfo &info, buses)
+    {
+        QJsonObject bus;
+        bus["bus"] = info.bus;
+        bus["driver"] = info.driver;
+        bus["port"] = info.port;
+        bus["speed"] = info.speed;
+        bus["listenOnly"] = info.listenOnly;
+        list.append(bus);
+    }
+    QJsonObject meta;
+    meta["buses"] = list;
+    return QJsonDocument(meta).toJson(QJsonDocument::Compact);
+}
+
+static QVector<CaptureFile::BusInfo> busesFromJson(const QByteArray &json)
+{
+    QVector<CaptureFile::BusInfo> buses;
+    QJsonArray list = QJsonDocument::fromJson(json).object().value("buses").toArray();
+    for (int i = 0; i < list.count(); i++)
+    {
+        QJsonObject bus = list[i].toObject();
+        CaptureFile::BusInfo info;
+        info.bus = bus.value("bus").toInt();
+        info.driver = bus.value("driver").toString();
+        info.port = bus.value("port").toString();
+        info.speed = bus.value("speed").toInt();
+        info.listenOnly = bus.value("listenOnly").toBool();
+        buses.append(info);
+    }
+    return buses;
+}
+
+CaptureFile::CaptureFile() : mMap(nullptr), mFrames(nullptr), mCount(0)
+{
+}
+
+CaptureFile::~CaptureFile()
+{
+    close();
+}
+
+bool CaptureFile::readHeader(QIODevice &file, Header &header)
+{
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)) return false;
+    if (memcmp(header.magic, captureMagic, sizeof(captureMagic)) != 0) return false;
+    if (header.version < 1 || header.version > VERSION) return false;
+    if (header.recordSize != sizeof(CANFrame))
+    {
+        qDebug() << "Capture file has" << header.recordSize << "byte frames, this build uses" << sizeof(CANFrame);
+        return false;
+    }
+    if (header.dataOffset < HEADER_SIZE + header.metaSize || (header.dataOffset % alignof(CANFrame)) != 0) return false;
+    if (header.count > static_cast<uint64_t>(INT32_MAX)) return false;
+    return true;
+}
+
+bool CaptureFile::isCaptureFile(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    Header header;
+    return readHeader(file, header);
+}
+
+bool CaptureFile::isCaptureFile(const QByteArray &prefix)
+{
+    QBuffer buffer;
+    buffer.setData(prefix);
+    if (!buffer.open(QIODevice::ReadOnly)) return false;
+    Header header;
+    return readHeader(buffer, header);
+}
+
+//written a block of the view at a time so saving doesn't need a second copy of the capture in memory
+bool CaptureFile::save(const QString &filename, const CANFrameView *frames, const QVector<BusInfo> &buses)
+{
+    CaptureFileWriter writer;
+    if (!writer.open(filename, buses)) return false;
+
+    const int blockFrames = 4096;
+    QVector<CANFrame> block;
+    block.reserve(blockFrames);
+    int num = frames->count();
+    for (int i = 0; i < num; i++)
+    {
+        block.append(frames->at(i));
+        if (block.count() == blockFrames || i == num - 1)
+        {
+            if (!writer.write(block.constData(), block.count())) return false;
+            block.resize(0);
+        }
+    }
+    return writer.finish();
+}
+
+bool CaptureFile::open(const QString &filename)
+{
+    close();
+    mFile.setFileName(filename);
+    if (!mFile.open(QIODevice::ReadOnly)) return false;
+
+    Header header;
+    if (!readHeader(mFile, header))
+    {
+        mFile.close();
+        return false;
+    }
+    qint64 bytes = static_cast<qint64>(header.count) * static_cast<qint64>(sizeof(CANFrame));
+    if (static_cast<qint64>(header.dataOffset) + bytes > mFile.size())
+    {
+        qDebug() << "Capture file" << filename << "is truncated";
+        mFile.close();
+        return false;
+    }
+
+    if (header.count > 0)
+    {
+        //MapPrivateOption = copy on write. Pages the model changes get a private copy, the file stays as it is
+        mMap = mFile.map(static_cast<qint64>(header.dataOffset), bytes, QFileDevice::MapPrivateOption);
+        if (!mMap)
+        {
+            qDebug() << "Could not map capture file" << filename << mFile.errorString();
+            mFile.close();
+            return false;
+        }
+        mFrames = reinterpret_cast<CANFrame *>(mMap);
+    }
+    mCount = static_cast<int>(header.count);
+
+    if (header.metaSize > 0 && mFile.seek(HEADER_SIZE)) mBuses = busesFromJson(mFile.read(header.metaSize));
+    if (header.indexOffset > 0 && !readIndex(header))
+    {
+        qDebug() << "Ignoring the damaged index of capture file" << filename;
+        mChunks.clear();
+    }
+    return true;
+}
+
+//the index is only used if it is complete and agrees with the header, otherwise the file is treated as having none
+bool CaptureFile::readIndex(const Header &header)
+{
+    if (header.chunkFrames != static_cast<uint32_t>(CHUNK_FRAMES)) return false;
+    if (!mFile.seek(static_cast<qint64>(header.indexOffset))) return false;
+    QByteArray index = mFile.readAll();
+    const char *pos = index.constData();
+    const char *end = pos + index.size();
+
+    IndexHeader indexHeader;
+    if (end - pos < static_cast<qint64>(sizeof(indexHeader))) return false;
+    memcpy(&indexHeader, pos, sizeof(indexHeader));
+    pos += sizeof(indexHeader);
+    if (memcmp(indexHeader.magic, indexMagic, sizeof(indexMagic)) != 0) return false;
+    if (indexHeader.numChunks != (header.count + CHUNK_FRAMES - 1) / CHUNK_FRAMES) return false;
+
+    mChunks.resize(static_cast<int>(indexHeader.numChunks));
+    for (int c = 0; c < mChunks.count(); c++)
+    {
+        IndexChunk entry;
+        if (end - pos < static_cast<qint64>(sizeof(entry))) return false;
+        memcpy(&entry, pos, sizeof(entry));
+        pos += sizeof(entry);
+        if (end - pos < static_cast<qint64>(entry.numKeys) * static_cast<qint64>(sizeof(IndexKey))) return false;
+
+        ChunkInfo &info = mChunks[c];
+        info.fileOffset = entry.fileOffset;
+        info.firstTimestamp = entry.firstTimestamp;
+        info.lastTimestamp = entry.lastTimestamp;
+        info.keys.resize(static_cast<int>(entry.numKeys));
+        info.counts.resize(static_cast<int>(entry.numKeys));
+        for (uint32_t k = 0; k < entry.numKeys; k++)
+        {
+            IndexKey key;
+            memcpy(&key, pos, sizeof(key));
+            pos += sizeof(key);
+            info.keys[static_cast<int>(k)] = key.key;
+            info.counts[static_cast<int>(k)] = key.count;
+        }
+    }
+    return true;
+}
+
+//in the form CANFrameIDIndex::setChunkKeys() takes, along with chunkFirstTimestamps()
+QVector<QVector<uint64_t> > CaptureFile::chunkKeys() const
+{
+    QVector<QVector<uint64_t> > keys;
+    keys.reserve(mChunks.count());
+    foreach (const ChunkInfo &chunk, mChunks) keys.append(chunk.keys);
+    return keys;
+}
+
+QVector<uint64_t> CaptureFile::chunkFirstTimestamps() const
+{
+    QVector<uint64_t> firsts;
+    firsts.reserve(mChunks.count());
+    foreach (const ChunkInfo &chunk, mChunks) firsts.append(chunk.firstTimestamp);
+    return firsts;
+}
+
+uint64_t CaptureFile::firstTimestamp() const
+{
+    uint64_t first = UINT64_MAX;
+    foreach (const ChunkInfo &chunk, mChunks) first = qMin(first, chunk.firstTimestamp);
+    return first;
+}
+
+void CaptureFile::close()
+{
+    if (mMap) mFile.unmap(mMap);
+    mMap = nullptr;
+    mFrames = nullptr;
+    mCount = 0;
+    mBuses.clear();
+    mChunks.clear();
+    if (mFile.isOpen()) mFile.close();
+}
+
+
+bool CaptureFileReader::open(const QString &filename)
+{
+    mFile.setFileName(filename);
+    mOk = false;
+    mRemaining = 0;
+    if (!mFile.open(QIODevice::ReadOnly)) return false;
+
+    CaptureFile::Header header;
+    if (!CaptureFile::readHeader(mFile, header) || !mFile.seek(static_cast<qint64>(header.dataOffset)))
+    {
+        mFile.close();
+        return false;
+    }
+    mRemaining = header.count;
+    mOk = true;
+    return true;
+}
+
+int CaptureFileReader::read(CANFrame *frames, int max)
+{
+    int num = static_cast<int>(qMin(static_cast<uint64_t>(qMax(max, 0)), mRemaining));
+    if (num == 0) return 0;
+    qint64 bytes = static_cast<qint64>(num) * static_cast<qint64>(sizeof(CANFrame));
+    qint64 got = mFile.read(reinterpret_cast<char *>(frames), bytes);
+    if (got != bytes)
+    {
+        //truncated file. Whatever whole frames made it are still good
+        mOk = false;
+        mRemaining = 0;
+        return (got > 0) ? static_cast<int>(got / static_cast<qint64>(sizeof(CANFrame))) : 0;
+    }
+    mRemaining -= static_cast<uint64_t>(num);
+    return num;
+}
+
+
+CaptureFileWriter::CaptureFileWriter() : mChunk(new ChunkStats), mNumChunks(0), mOk(false)
+{
+    memset(&mHeader, 0, sizeof(mHeader));
+}
+
+CaptureFileWriter::~CaptureFileWriter()
+{
+}
+
+/*
+ * The frame count and the index are only known at the end. The header goes out with neither and finish()
+ * rewrites it, so a save that fails halfway leaves a file that opens as empty rather than one that is wrong.
+ */
+bool CaptureFileWriter::open(const QString &filename, const QVector<CaptureFile::BusInfo> &buses)
+{
+    mFile.setFileName(filename);
+    mOk = mFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!mOk) return false;
+
+    QByteArray meta = buses.isEmpty() ? QByteArray() : busesToJson(buses);
+    memset(&mHeader, 0, sizeof(mHeader));
+    memcpy(mHeader.magic, captureMagic, sizeof(captureMagic));
+    mHeader.version = CaptureFile::VERSION;
+    mHeader.recordSize = sizeof(CANFrame);
+    mHeader.metaSize = static_cast<uint32_t>(meta.size());
+    mHeader.dataOffset = (CaptureFile::HEADER_SIZE + meta.size() + 63) & ~static_cast<uint64_t>(63);
+    mHeader.chunkFrames = CaptureFile::CHUNK_FRAMES;
+    meta.append(QByteArray(static_cast<int>(mHeader.dataOffset) - CaptureFile::HEADER_SIZE - meta.size(), '\0'));
+    mOk = mFile.write(reinterpret_cast<const char *>(&mHeader), sizeof(mHeader)) == sizeof(mHeader)
+          && mFile.write(meta) == meta.size();
+
+    mIndex.resize(0);
+    mNumChunks = 0;
+    mChunk->start(mHeader.dataOffset);
+    return mOk;
+}
+
+bool CaptureFileWriter::write(const CANFrame *frames, int count)
+{
+    if (!mOk) return false;
+    qint64 bytes = static_cast<qint64>(count) * static_cast<qint64>(sizeof(CANFrame));
+    if (mHeader.count + static_cast<uint64_t>(count) > static_cast<uint64_t>(INT32_MAX)
+        || mFile.write(reinterpret_cast<const char *>(frames), bytes) != bytes)
+    {
+        mOk = false;
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        mChunk->add(frames[i]);
+        if (mChunk->frames == static_cast<uint32_t>(CaptureFile::CHUNK_FRAMES))
+        {
+            mChunk->writeTo(mIndex);
+            mNumChunks++;
+            mChunk->start(mHeader.dataOffset + (mHeader.count + static_cast<uint64_t>(i + 1)) * sizeof(CANFrame));
+        }
+    }
+    mHeader.count += static_cast<uint64_t>(count);
+    return true;
+}
+
+bool CaptureFileWriter::finish()
+{
+    if (!mOk || !mFile.isOpen()) return false;
+    if (mChunk->frames > 0)
+    {
+        mChunk->writeTo(mIndex);
+        mNumChunks++;
+    }
+
+    IndexHeader indexHeader;
+    memset(&indexHeader, 0, sizeof(indexHeader));
+    memcpy(indexHeader.magic, indexMagic, sizeof(indexMagic));
+    indexHeader.numChunks = mNumChunks;
+
+    mHeader.indexOffset = static_cast<uint64_t>(mFile.pos());
+    mOk = mFile.write(reinterpret_cast<const char *>(&indexHeader), sizeof(indexHeader)) == sizeof(indexHeader)
+          && mFile.write(mIndex) == mIndex.size()
+          && mFile.seek(0)
+          && mFile.write(reinterpret_cast<const char *>(&mHeader), sizeof(mHeader)) == sizeof(mHeader);
+    mFile.close();
+    return mOk;
+}
@@ -0,0 +1,159 @@
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+#include "can_structs.h"
+#include "canframeview.h"
+#include "framestream.h"
+
+struct ChunkStats;
+
+/*
+ * Fixed record capture file. A 64 byte header followed by the frames exactly as CANFrame lays them out in
+ * memory, so the file can be memory mapped and used in place by CANFrameModel no matter how big it is. Only
+ * the pages that are actually looked at get read in and, being backed by the file, the OS can drop them
+ * again whenever it likes so a capture many times the size of RAM stays usable.
+ *
+ * The records are in the byte order of the machine that wrote them. The header says how big a record is
+ * so a file from a build with a different CANFrame is refused instead of misread.
+ *
+ * Version 2 adds two optional blocks that version 1 left as zeroed reserved space:
+ * - Right after the header, a short UTF-8 JSON description of the buses the frames came from (connection
+ *   driver, port, speed). The frames start after it at dataOffset.
+ * - After the frames, an index with one entry per CHUNK_FRAMES frames. Each entry holds the chunk's file
+ *   offset, its earliest and latest timestamp, and how many frames of each (bus, id) it has. Chunks are the
+ *   same size as the chunks of CANFrameStore. A mapped file can therefore be shown and filtered without a
+ *   pass over the frames to find out what is in it.
+ * Version 1 files still open. They just have no bus list and no index.
+ */
+class CaptureFile
+{
+public:
+    static const int HEADER_SIZE = 64;
+    static const uint32_t VERSION = 2;
+    static const int CHUNK_FRAMES = CANFrameStore::CHUNK_SIZE;
+
+    struct Header
+    {
+        char magic[8]; //"CANOCAP" and a nul
+        uint32_t version;
+        uint32_t recordSize; //sizeof(CANFrame) of the writer
+        uint64_t count; //frames in the file
+        uint64_t dataOffset; //where the first frame starts, after the header and the bus list
+        uint64_t indexOffset; //where the index starts, 0 if there is none
+        uint32_t metaSize; //bytes of bus list right after the header, 0 if there is none
+        uint32_t chunkFrames; //frames per index entry
+        uint8_t reserved[16];
+    };
+
+    //one bus of the capture, as it was set up when the file was saved
+    struct BusInfo
+    {
+        int bus;
+        QString driver;
+        QString port;
+        int speed;
+        bool listenOnly;
+    };
+
+    //what the index says about one chunk of frames
+    struct ChunkInfo
+    {
+        uint64_t fileOffset;
+        uint64_t firstTimestamp; //earliest in the chunk
+        uint64_t lastTimestamp; //latest in the chunk
+        QVector<uint64_t> keys; //CANFrameIDIndex::key() of every (bus, id) in the chunk, ascending
+        QVector<uint64_t> counts; //frames of each of those keys
+    };
+
+    CaptureFile();
+    ~CaptureFile();
+
+    static bool isCaptureFile(const QString &filename);
+    static bool isCaptureFile(const QByteArray &prefix); //the start of the file, at least HEADER_SIZE bytes of it
+    static bool save(const QString &filename, const CANFrameView *frames, const QVector<BusInfo> &buses = QVector<BusInfo>());
+
+    //maps the file copy on write. The model may change frames (timing normalization etc) but the file never is
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const { return mFile.isOpen(); }
+    QString fileName() const { return mFile.fileName(); }
+
+    CANFrame *frames() const { return mFrames; }
+    int count() const { return mCount; }
+
+    const QVector<BusInfo> &buses() const { return mBuses; }
+
+    //empty for files without an index. Otherwise one entry per CHUNK_FRAMES frames
+    bool hasIndex() const { return !mChunks.isEmpty(); }
+    const QVector<ChunkInfo> &chunks() const { return mChunks; }
+    QVector<QVector<uint64_t> > chunkKeys() const;
+    QVector<uint64_t> chunkFirstTimestamps() const;
+    uint64_t firstTimestamp() const;
+
+private:
+    Q_DISABLE_COPY(CaptureFile)
+    friend class CaptureFileReader;
+
+    static bool readHeader(QIODevice &file, Header &header);
+    bool readIndex(const Header &header);
+
+    QFile mFile;
+    QVector<BusInfo> mBuses;
+    QVector<ChunkInfo> mChunks;
+    uchar *mMap;
+    CANFrame *mFrames;
+    int mCount;
+};
+
+//reads the frames of a capture file in order without mapping it, for going through files of any size
+class CaptureFileReader : public FrameReader
+{
+public:
+    CaptureFileReader() : mRemaining(0), mOk(false) {}
+
+    bool open(const QString &filename);
+
+    int read(CANFrame *frames, int max) override;
+    bool isOk() const override { return mOk; }
+    qint64 position() const override { return mFile.isOpen() ? mFile.pos() : 0; }
+    qint64 size() const override { return mFile.size(); }
+
+private:
+    Q_DISABLE_COPY(CaptureFileReader)
+
+    QFile mFile;
+    uint64_t mRemaining;
+    bool mOk;
+};
+
+//writes a capture file as the frames come. The index is built on the way and goes out with finish()
+class CaptureFileWriter : public FrameWriter
+{
+public:
+    CaptureFileWriter();
+    ~CaptureFileWriter() override;
+
+    bool open(const QString &filename, const QVector<CaptureFile::BusInfo> &buses = QVector<CaptureFile::BusInfo>());
+
+    bool write(const CANFrame *frames, int count) override;
+    bool finish() override;
+
+private:
+    Q_DISABLE_COPY(CaptureFileWriter)
+
+    QFile mFile;
+    CaptureFile::Header mHeader;
+    QScopedPointer<ChunkStats> mChunk;
+    QByteArray mIndex;
+    uint32_t mNumChunks;
+    bool mOk;
+};
+
+static_assert(sizeof(CaptureFile::Header) == CaptureFile::HEADER_SIZE, "capture file header has to stay 64 bytes");
+
+#endif // CAPTUREFILE_H
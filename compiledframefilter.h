@@ -0,0 +1,77 @@
+#ifndef COMPILEDFRAMEFILTER_H
+#define COMPILEDFRAMEFILTER_H
+
+#include <QMap>
+#include <stdint.h>
+#include <string.h>
+#include "can_structs.h"
+
+/*
+ * The main view's filter settings (per node on/off plus the NMT/SYNC/EMCY/TIME/heartbeat switches) boiled
+ * down to a flat lookup table. Which frames are shown only depends on the low 11 bits of the ID (node is
+ * bits 0-6, function code bits 7-10) so every one of the 2048 possible values is worked out once when the
+ * settings change and testing a frame is a single bit test.
+ *
+ * Compile it from the settings whenever they change and then test frames with matches(). matches() only
+ * reads the tables so one compiled filter can be shared by any number of threads at once.
+ */
+class CompiledFrameFilter
+{
+public:
+    //function codes (bits 7-10 of the ID) in the function mask. SYNC is function 1 on node 0 so it gets its own flag
+    enum Function
+    {
+        FUNC_NMT        = 0,
+        FUNC_EMCY       = 1,
+        FUNC_TIME       = 2,
+        FUNC_HEARTBEAT  = 14
+    };
+
+    CompiledFrameFilter()
+    {
+        memset(mNodeBits, 0, sizeof(mNodeBits));
+        memset(mIDBits, 0, sizeof(mIDBits));
+        mFunctionMask = 0xFFFF;
+        mSyncShown = true;
+    }
+
+    //nodes: node number -> shown. Nodes that aren't in there are hidden
+    void compile(const QMap<int, bool> &nodes, uint16_t functionMask, bool syncShown)
+    {
+        memset(mNodeBits, 0, sizeof(mNodeBits));
+        QMap<int, bool>::const_iterator it;
+        for (it = nodes.constBegin(); it != nodes.constEnd(); ++it)
+        {
+            if (it.value() && it.key() >= 0 && it.key() < 128) mNodeBits[it.key() >> 6] |= 1ull << (it.key() & 63);
+        }
+        mFunctionMask = functionMask;
+        mSyncShown = syncShown;
+
+        memset(mIDBits, 0, sizeof(mIDBits));
+        for (int id = 0; id < 2048; id++)
+        {
+            int node = id & 0x7F;
+            int func = id >> 7;
+            bool shown = (mNodeBits[node >> 6] >> (node & 63)) & 1;
+            if (func == FUNC_EMCY && node == 0) shown = shown && mSyncShown;
+            else shown = shown && ((mFunctionMask >> func) & 1);
+            if (shown) mIDBits[id >> 6] |= 1ull << (id & 63);
+        }
+    }
+
+    bool matchesID(uint32_t id) const
+    {
+        uint32_t low = id & 0x7FF;
+        return (mIDBits[low >> 6] >> (low & 63)) & 1;
+    }
+
+    bool matches(const CANFrame &frame) const { return matchesID(frame.frameId()); }
+
+private:
+    uint64_t mNodeBits[2]; //128 nodes
+    uint64_t mIDBits[32]; //2048 11 bit IDs, the combination of everything else
+    uint16_t mFunctionMask; //bit n set = function code n shown
+    bool mSyncShown;
+};
+
+#endif // COMPILEDFRAMEFILTER_H
@@ -3,6 +3,8 @@
 
 #include "canconmanager.h"
 #include "canconfactory.h"
+#include "cantimebase.h"
+#include "utils/tracer.h"
 
 CANConManager* CANConManager::mInstance = nullptr;
 
@@ -17,9 +19,7 @@ CANConManager* CANConManager::getInstance()
 CANConManager::CANConManager(QObject *parent): QObject(parent)
 {
     connect(&mTimer, SIGNAL(timeout()), this, SLOT(refreshCanList()));
-    mTimer.setInterval(20); /*Tick 50 times per second to allow for good resolution in reception where needed. GUI updates *MUCH* more slowly*/
     mTimer.setSingleShot(false);
-    mTimer.start();
 
     mNumActiveBuses = 0;
 
@@ -32,12 +32,20 @@ CANConManager::CANConManager(QObject *parent): QObject(parent)
         useSystemTime = true;
     }
     else useSystemTime = false;
+
+    //batches are delivered straight to subscribers in other threads too
+    qRegisterMetaType<CANFrameBatch>("CANFrameBatch");
+
+    //connections now ask to be drained when they have frames so the timer is just a backstop for
+    //anything that never crosses a watermark (and for frames sent with no connection at all)
+    mDrainPolicy = (DrainPolicy)settings.value("Main/DrainPolicy", LATENCY_FIRST).toInt();
+    mTimer.setInterval(50);
+    mTimer.start();
 }
 
 void CANConManager::resetTimeBasis()
 {
-    mTimestampBasis = QDateTime::currentMSecsSinceEpoch() * 1000;
-    mElapsedTimer.restart();
+    CANTimebase::reset();
 }
 
 CANConManager::~CANConManager()
@@ -57,18 +65,82 @@ void CANConManager::stopAllConnections()
 void CANConManager::add(CANConnection* pConn_p)
 {
     mConns.append(pConn_p);
+    applyDrainPolicy(pConn_p);
+    connect(pConn_p, SIGNAL(framesAvailable()), this, SLOT(drainConnection()));
+    updateBusBases();
 }
 
 
 void CANConManager::remove(CANConnection* pConn_p)
 {
-    //disconnect(pConn_p, 0, this, 0);
+    disconnect(pConn_p, SIGNAL(framesAvailable()), this, SLOT(drainConnection()));
     mConns.removeOne(pConn_p);
+    updateBusBases();
 }
 
 void CANConManager::replace(int idx, CANConnection* pConn_p)
 {
+    disconnect(mConns[idx], SIGNAL(framesAvailable()), this, SLOT(drainConnection()));
     mConns.replace(idx, pConn_p);
+    applyDrainPolicy(pConn_p);
+    connect(pConn_p, SIGNAL(framesAvailable()), this, SLOT(drainConnection()));
+    updateBusBases();
+}
+
+void CANConManager::setDrainPolicy(DrainPolicy pPolicy)
+{
+    if (mDrainPolicy == pPolicy) return;
+    mDrainPolicy = pPolicy;
+    foreach (CANConnection* conn_p, mConns) applyDrainPolicy(conn_p);
+}
+
+CANConManager::DrainPolicy CANConManager::getDrainPolicy() const
+{
+    return mDrainPolicy;
+}
+
+void CANConManager::applyDrainPolicy(CANConnection* pConn_p)
+{
+    switch (mDrainPolicy)
+    {
+    case THROUGHPUT_FIRST:
+        pConn_p->setDrainTrigger(pConn_p->getQueue().size() / 4, 50000);
+        break;
+    case LATENCY_FIRST:
+    default:
+        pConn_p->setDrainTrigger(1, 0);
+        break;
+    }
+}
+
+/*
+ * Each connection only knows about its own bus numbers so the frames it queues have to be shifted up by the
+ * number of buses on all the connections before it. That offset only changes when connections come and go
+ * (or a device reports a different bus count once it connects) so it is worked out here once instead of
+ * for every batch of frames.
+ */
+void CANConManager::updateBusBases()
+{
+    int busBase = 0;
+    mBusBases.clear();
+    mBusCounts.clear();
+    foreach (CANConnection* conn_p, mConns)
+    {
+        int buses = conn_p->getNumBuses();
+        mBusBases.insert(conn_p, busBase);
+        mBusCounts.insert(conn_p, buses);
+        busBase += buses;
+    }
+}
+
+bool CANConManager::busBasesValid()
+{
+    if (mBusCounts.count() != mConns.count()) return false;
+    foreach (CANConnection* conn_p, mConns)
+    {
+        if (mBusCounts.value(conn_p, -1) != conn_p->getNumBuses()) return false;
+    }
+    return true;
 }
 
 //Get total number of buses currently registered with the program
@@ -84,13 +156,8 @@ int CANConManager::getNumBuses()
 
 int CANConManager::getBusBase(CANConnection *which)
 {
-    int buses = 0;
-    foreach(CANConnection* conn_p, mConns)
-    {
-        if (conn_p != which) buses += conn_p->getNumBuses();
-        else return buses;
-    }
-    return -1;
+    if (!busBasesValid()) updateBusBases();
+    return mBusBases.value(which, -1);
 }
 
 void CANConManager::refreshCanList()
@@ -99,12 +166,11 @@ void CANConManager::refreshCanList()
 
     if (mConns.count() == 0)
     {
-        tempFrames.clear();
-        //TODO: Seems to crash under heavy load. Find out why.
-        if(buslessFrames.size()) {            
-            tempFrames = buslessFrames; //make a copy and pass that copy
-            buslessFrames.clear(); //delete all frames from the original
-            emit framesReceived(nullptr, tempFrames);
+        if(buslessFrames.size()) {
+            //the batch takes over the frames, buslessFrames starts over empty
+            CANFrameBatch batch(buslessFrames);
+            buslessFrames.clear();
+            emit framesReceived(nullptr, batch);
         }
         return;
     }
@@ -118,14 +184,53 @@ void CANConManager::refreshCanList()
     }
     else
     {
+        /* backstop tick. Also catches devices that changed their bus count after connecting */
+        if (!busBasesValid()) updateBusBases();
         foreach (CANConnection* conn_p, mConns)
             refreshConnection((CANConnection*)conn_p);
     }
 }
 
+/* a connection reached its drain watermark or deadline */
+void CANConManager::drainConnection()
+{
+    CANConnection* conn_p = qobject_cast<CANConnection*>(QObject::sender());
+    if (!conn_p || !mConns.contains(conn_p)) return;
+    if (mBusCounts.value(conn_p, -1) != conn_p->getNumBuses()) updateBusBases();
+    refreshConnection(conn_p);
+}
+
+CANConStatsSnapshot CANConManager::getStats(CANConnection* pConn_p) const
+{
+    CANConStatsSnapshot stats = pConn_p->getStats().snapshot();
+    stats.name = pConn_p->getPort();
+    stats.queueSize = pConn_p->getQueue().size();
+    return stats;
+}
+
+QList<CANConStatsSnapshot> CANConManager::getConnectionStats() const
+{
+    QList<CANConStatsSnapshot> out;
+    foreach (CANConnection* conn_p, mConns) out.append(getStats(conn_p));
+    return out;
+}
+
+CANConStatsSnapshot CANConManager::getTotalStats() const
+{
+    CANConStatsSnapshot total;
+    total.name = tr("All connections");
+    foreach (CANConnection* conn_p, mConns) total.add(getStats(conn_p));
+    return total;
+}
+
+void CANConManager::resetStats()
+{
+    foreach (CANConnection* conn_p, mConns) conn_p->getStats().reset();
+}
+
 uint64_t CANConManager::getTimeBasis()
 {
-    return mTimestampBasis;
+    return CANTimebase::startEpochUs();
 }
 
 QList<CANConnection*>& CANConManager::getConnections()
@@ -159,33 +264,41 @@ void CANConManager::refreshConnection(CANConnection* pConn_p)
         emit connectionStatusUpdated(buses);
     }
 
+    //clear before looking at the queue so anything queued from here on raises a new request
+    pConn_p->clearDrainRequest();
+    pConn_p->deliverTargettedFrames();
+
     if (pConn_p->getQueue().peek() == nullptr) return;
+    TRACE_SCOPE("queue drain");
+    qint64 queuedAt = pConn_p->getStats().takeQueuedSince();
 
     CANFrame* frame_p = nullptr;
     QVector<CANFrame> frames;
+    frames.reserve(pConn_p->getQueue().count());
 
     //Each connection only knows about its own bus numbers
     //so this variable is used to fix that up to turn local bus numbers
     //into system global bus numbers for display.
-    int busBase = 0;
-
-    foreach (CANConnection* conn, mConns)
-    {
-        if (conn != pConn_p) busBase += conn->getNumBuses();
-        else break;
-    }
+    int busBase = mBusBases.value(pConn_p, 0);
 
     //qDebug() << "Bus fixup number: " << busBase;
 
-    while( (frame_p = pConn_p->getQueue().peek() ) ) {
-        frame_p->bus += busBase;
-        //qDebug() << "Rx of frame from bus: " << frame_p->bus;
-        frames.append(*frame_p);
-        pConn_p->getQueue().dequeue();
+    //take everything that is waiting a contiguous run at a time. At most two runs if the data wraps
+    //around the end of the ring.
+    int count = 0;
+    while( (frame_p = pConn_p->getQueue().peekBulk(pConn_p->getQueue().size(), count) ) ) {
+        int start = frames.count();
+        frames.resize(start + count);
+        for (int i = 0; i < count; i++)
+        {
+            frames[start + i] = frame_p[i];
+            frames[start + i].bus += busBase;
+        }
+        pConn_p->getQueue().consume(count);
     }
 
     if(frames.size())
-        emit framesReceived(pConn_p, frames);
+        emit framesReceived(pConn_p, CANFrameBatch(frames, queuedAt));
 }
 
 /*
@@ -203,7 +316,6 @@ bool CANConManager::sendFrame(const CANFrame& pFrame)
 {
     int busBase = 0;
     CANFrame workingFrame = pFrame;
-    CANFrame *txFrame;
 
     if (mConns.count() == 0)
     {
@@ -224,12 +336,9 @@ bool CANConManager::sendFrame(const CANFrame& pFrame)
             }
             else
             {
-                workingFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, mElapsedTimer.nsecsElapsed() / 1000));
-                //workingFrame.timestamp -= mTimestampBasis;
+                workingFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, CANTimebase::captureUs()));
             }
-            txFrame = conn->getQueue().get();
-            *txFrame = workingFrame;
-            conn->getQueue().queue();
+            //the connection queues the echo of the frame itself, from its own thread
             return conn->sendFrame(workingFrame);
         }
         busBase += conn->getNumBuses();
@@ -3,15 +3,28 @@
 
 #include <QObject>
 #include <QTimer>
-#include <QElapsedTimer>
+#include <QHash>
 
 #include "canconnection.h"
+#include "canframebatch.h"
 
 class CANConManager : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief How queued frames get from the connections to the rest of the program
+     * LATENCY_FIRST: a connection asks for a drain as soon as it queues anything. Frames show up right away.
+     * THROUGHPUT_FIRST: a connection asks once a quarter of its queue is used or the oldest frame is 50ms old
+     * so frames are handed on in big batches with far fewer wakeups.
+     */
+    enum DrainPolicy
+    {
+        LATENCY_FIRST,
+        THROUGHPUT_FIRST
+    };
+
     static CANConManager* getInstance();
     virtual ~CANConManager();
 
@@ -23,7 +36,18 @@ public:
 
     CANConnection* getByName(const QString& pName) const;
 
+    /**
+     * @brief queue and latency counters of each connection and all of them together (see CANConStats)
+     * @note dropped frames are frames a connection had to throw away because the GUI fell behind
+     */
+    CANConStatsSnapshot getStats(CANConnection* pConn_p) const;
+    QList<CANConStatsSnapshot> getConnectionStats() const;
+    CANConStatsSnapshot getTotalStats() const;
+    void resetStats();
+
+    /* wall clock (microseconds since the epoch) when the capture started, see CANTimebase */
     uint64_t getTimeBasis();
+    /* the capture starts over now */
     void resetTimeBasis();
 
     int getNumBuses();
@@ -62,26 +86,36 @@ public:
 
     bool removeAllTargettedFrames(QObject *receiver);
 
+    void setDrainPolicy(DrainPolicy pPolicy);
+    DrainPolicy getDrainPolicy() const;
+
 signals:
-    void framesReceived(CANConnection* pConn_p, QVector<CANFrame>& pFrames);
+    /**
+     * @brief newly captured frames. The batch is shared by every subscriber, keep it instead of copying frames out of it
+     */
+    void framesReceived(CANConnection* pConn_p, const CANFrameBatch& pFrames);
     void connectionStatusUpdated(int conns);
 
 private slots:
     void refreshCanList();
+    void drainConnection();
 
 private:
     explicit CANConManager(QObject *parent = 0);
     void refreshConnection(CANConnection* pConn_p);
+    void applyDrainPolicy(CANConnection* pConn_p);
+    void updateBusBases();
+    bool busBasesValid();
 
     static CANConManager*  mInstance;
     QList<CANConnection*>  mConns;
     QTimer                 mTimer;
-    QElapsedTimer          mElapsedTimer;
-    uint64_t               mTimestampBasis;
     uint32_t               mNumActiveBuses;
     bool                   useSystemTime;
     QVector<CANFrame>      buslessFrames;
-    QVector<CANFrame>      tempFrames;
+    DrainPolicy            mDrainPolicy;
+    QHash<CANConnection*, int> mBusBases;  //first global bus number of each connection
+    QHash<CANConnection*, int> mBusCounts; //number of buses each connection had when mBusBases was built
 };
 
 #endif // CANCONNECTIONMODEL_H
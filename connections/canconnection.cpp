@@ -1,6 +1,8 @@
 #include <QSettings>
 #include <QThread>
+#include <QMetaObject>
 #include "canconnection.h"
+#include "canframebatch.h"
 
 CANConnection::CANConnection(QString pPort,
                              QString pDriver,
@@ -16,7 +18,13 @@ CANConnection::CANConnection(QString pPort,
     mIsCapSuspended(false),
     mStatus(CANCon::NOT_CONNECTED),
     mStarted(false),
-    mThread_p(nullptr)
+    mThread_p(nullptr),
+    mDrainWatermark(1),
+    mDrainDeadlineUs(0),
+    mDrainRequested(0),
+    mDrainSinceNs(0),
+    mTargetFilters(nullptr),
+    mTargetRetired(0)
 {
     /* register types */
     qRegisterMetaType<CANBus>("CANBus");
@@ -52,6 +60,9 @@ CANConnection::~CANConnection()
     }
 
     mBusData.clear();
+
+    delete mTargetFilters.load();
+    qDeleteAll(mRetiredTargetFilters);
 }
 
 
@@ -168,10 +179,28 @@ bool CANConnection::sendFrame(const CANFrame& pFrame)
         return ret;
     }
 
+    queueSentFrame(pFrame);
     return piSendFrame(pFrame);
 }
 
 
+void CANConnection::queueSentFrame(const CANFrame& pFrame)
+{
+    if (isCapSuspended())
+        return;
+
+    /* get frame from queue */
+    CANFrame* frame_p = mQueue.get();
+    if(frame_p) {
+        *frame_p = pFrame;
+        mQueue.queue();
+        framesQueued();
+    }
+    else
+        framesDropped(); /* queue is full */
+}
+
+
 bool CANConnection::sendFrames(const QList<CANFrame>& pFrames)
 {
     /* make sure we execute in mThread context */
@@ -239,6 +268,52 @@ LFQueue<CANFrame>& CANConnection::getQueue() {
 }
 
 
+void CANConnection::setDrainTrigger(int pWatermark, int pDeadlineUs) {
+    if(pWatermark < 1) pWatermark = 1;
+    if(pWatermark > mQueue.size()) pWatermark = mQueue.size();
+    mDrainWatermark.store(pWatermark);
+    mDrainDeadlineUs.store(pDeadlineUs);
+}
+
+
+void CANConnection::clearDrainRequest() {
+    /* whatever drained the queue (a request or the manager's backstop), the deadline counts from the next frame */
+    mDrainSinceNs.store(0);
+    mDrainRequested.storeRelease(0);
+}
+
+
+void CANConnection::framesQueued(int pCount) {
+    mStats.framesQueued(pCount, mQueue.count());
+
+    /* matches don't wait for the watermark, the consumer's backstop delivers them even when no drain is asked for */
+    publishTargettedFrames();
+
+    qint64 now = CANConStats::now();
+    mDrainSinceNs.testAndSetRelaxed(0, now);
+
+    if( (mQueue.count() < mDrainWatermark.load()) &&
+        ((now - mDrainSinceNs.load()) / 1000 < mDrainDeadlineUs.load()) )
+        return;
+
+    mDrainSinceNs.store(0);
+
+    /* only one request in flight. The consumer takes everything that is queued when it gets to it */
+    if(mDrainRequested.testAndSetOrdered(0, 1))
+        emit framesAvailable();
+}
+
+
+void CANConnection::framesDropped(int pCount) {
+    mStats.framesDropped(pCount);
+}
+
+
+CANConStats& CANConnection::getStats() const {
+    return mStats;
+}
+
+
 CANCon::type CANConnection::getType() {
     return mType;
 }
@@ -288,7 +363,9 @@ bool CANConnection::addTargettedFrame(int pBusId, uint32_t ID, uint32_t mask, QO
     target.id = ID;
     target.mask = mask;
     target.observer = receiver;
-    mBusData[pBusId].mTargettedFrames.append(target);
+    if (pBusId == -1) mAnyBusTargets.append(target);
+    else mBusData[pBusId].mTargettedFrames.append(target);
+    compileTargettedFrames();
 
     return true;
 }
@@ -316,7 +393,9 @@ bool CANConnection::removeTargettedFrame(int pBusId, uint32_t ID, uint32_t mask,
     target.id = ID;
     target.mask = mask;
     target.observer = receiver;
-    mBusData[pBusId].mTargettedFrames.removeAll(target);
+    if (pBusId == -1) mAnyBusTargets.removeAll(target);
+    else mBusData[pBusId].mTargettedFrames.removeAll(target);
+    compileTargettedFrames();
 
     return true;
 }
@@ -329,25 +408,133 @@ bool CANConnection::removeAllTargettedFrames(QObject *receiver)
             if (filt.observer == receiver) mBusData[i].mTargettedFrames.removeOne(filt);
         }
     }
+    foreach (const CANFltObserver filt, mAnyBusTargets)
+    {
+        if (filt.observer == receiver) mAnyBusTargets.removeOne(filt);
+    }
+    compileTargettedFrames();
+
+    /* frames that matched but weren't delivered yet have nowhere to go any more */
+    QMutexLocker lock(&mTargetLock);
+    for (int i = mTargetPending.count() - 1; i >= 0; i--)
+    {
+        if (mTargetPending[i].mReceiver == receiver) mTargetPending.remove(i);
+    }
 
     return true;
 }
 
+/*
+ * The filters are compiled into a fresh table every time they change and the device thread picks up the new
+ * one with the next frame it checks. The old table can't be deleted right away as the device thread might be
+ * halfway through it, so it is retired and the device thread deletes it the next time it queues frames,
+ * when it is certainly done with it (see publishTargettedFrames).
+ */
+void CANConnection::compileTargettedFrames()
+{
+    CANTargetFilters* filters_p = new CANTargetFilters();
+    foreach (const CANFltObserver& filt, mAnyBusTargets)
+        filters_p->add(-1, filt);
+    for (int i = 0; i < mBusData.count(); i++)
+    {
+        foreach (const CANFltObserver& filt, mBusData[i].mTargettedFrames)
+            filters_p->add(i, filt);
+    }
+    if (filters_p->isEmpty())
+    {
+        delete filters_p;
+        filters_p = nullptr;
+    }
+
+    CANTargetFilters* old_p = mTargetFilters.fetchAndStoreOrdered(filters_p);
+    if (old_p) {
+        QMutexLocker lock(&mTargetLock);
+        mRetiredTargetFilters.append(old_p);
+        mTargetRetired.storeRelease(1);
+    }
+}
+
 void CANConnection::checkTargettedFrame(CANFrame &frame)
 {
-    unsigned int maskedID;
-    //qDebug() << "Got frame with ID " << frame.ID << " on bus " << frame.bus;
-    if (mBusData.count() == 0) return;
+    const CANTargetFilters* filters_p = mTargetFilters.loadAcquire();
+    if (!filters_p) return;
+
+    filters_p->match(frame.bus, frame.frameId(), [this, &frame](QObject* receiver) {
+        queueTargettedFrame(receiver, frame);
+    });
+}
+
+/* device thread only, no lock. There are only ever a handful of receivers so a walk over them is as quick as any lookup */
+void CANConnection::queueTargettedFrame(QObject* pReceiver, const CANFrame& pFrame)
+{
+    for (int i = 0; i < mTargetMatched.count(); i++)
+    {
+        if (mTargetMatched[i].mReceiver.data() == pReceiver)
+        {
+            mTargetMatched[i].mFrames.append(pFrame);
+            return;
+        }
+    }
+    TargettedDelivery delivery;
+    delivery.mReceiver = pReceiver;
+    delivery.mFrames.append(pFrame);
+    mTargetMatched.append(delivery);
+}
+
+/*
+ * Device thread, every time it has queued frames: hands what matched in them over to the consumer in one go, so
+ * mTargetLock is taken once per committed batch that had a match rather than once per matched frame, and never
+ * when nothing matched. The device thread isn't inside any filter table here, which makes it the place to free
+ * the retired ones too.
+ */
+void CANConnection::publishTargettedFrames()
+{
+    if (mTargetMatched.isEmpty() && !mTargetRetired.loadAcquire())
+        return;
 
-    if (mBusData[frame.bus].mTargettedFrames.length() == 0) return;
-    foreach (const CANFltObserver filt, mBusData[frame.bus].mTargettedFrames)
+    QList<CANTargetFilters*> retired;
     {
-        //qDebug() << "Checking filter with id " << filt.id << " mask " << filt.mask;
-        maskedID = frame.frameId() & filt.mask;
-        if (maskedID == filt.id) {
-            qDebug() << "In connection object I got a targetted frame. Forwarding it.";
-            QMetaObject::invokeMethod(filt.observer, "gotTargettedFrame",Qt::QueuedConnection, Q_ARG(CANFrame, frame));
+        QMutexLocker lock(&mTargetLock);
+        foreach (const TargettedDelivery& matched, mTargetMatched)
+        {
+            int i = 0;
+            while (i < mTargetPending.count() && mTargetPending[i].mReceiver.data() != matched.mReceiver.data())
+                i++;
+            if (i == mTargetPending.count())
+                mTargetPending.append(matched);
+            else
+                mTargetPending[i].mFrames += matched.mFrames;
+        }
+        retired.swap(mRetiredTargetFilters);
+        mTargetRetired.storeRelease(0);
+    }
+    mTargetMatched.clear();
+    qDeleteAll(retired);
+}
+
+void CANConnection::deliverTargettedFrames()
+{
+    QVector<TargettedDelivery> ready;
+    {
+        QMutexLocker lock(&mTargetLock);
+        if (mTargetPending.isEmpty()) return;
+        ready.swap(mTargetPending);
+    }
+
+    foreach (const TargettedDelivery& delivery, ready)
+    {
+        /* the receiver may have been deleted since its frames matched */
+        QObject* receiver_p = delivery.mReceiver.data();
+        if (!receiver_p)
+            continue;
+        if (receiver_p->metaObject()->indexOfSlot("gotTargettedFrames(CANFrameBatch)") >= 0)
+        {
+            QMetaObject::invokeMethod(receiver_p, "gotTargettedFrames", Qt::QueuedConnection,
+                                      Q_ARG(CANFrameBatch, CANFrameBatch(delivery.mFrames)));
+            continue;
         }
+        foreach (const CANFrame& frame, delivery.mFrames)
+            QMetaObject::invokeMethod(receiver_p, "gotTargettedFrame", Qt::QueuedConnection, Q_ARG(CANFrame, frame));
     }
 }
 
@@ -3,10 +3,16 @@
 
 #include <Qt>
 #include <QObject>
+#include <QMutex>
+#include <QAtomicPointer>
+#include <QPointer>
 #include "utils/lfqueue.h"
 #include "can_structs.h"
 #include "canbus.h"
 #include "canconconst.h"
+#include "canconstats.h"
+#include "cantargetfilters.h"
+#include "cantimebase.h"
 
 struct BusData;
 
@@ -65,6 +71,12 @@ public:
      */
     LFQueue<CANFrame>& getQueue();
 
+    /**
+     * @brief getStats
+     * @return the queue and latency counters of the device. They are lock free and can be used from any thread
+     */
+    CANConStats& getStats() const;
+
     /**
      * @brief getType
      * @return the @ref CANCon::type of the device
@@ -83,6 +95,21 @@ public:
      */
     void setConsoleOutput(bool state);
 
+    /**
+     * @brief setDrainTrigger sets when the device asks for its queue to be drained (see @ref framesAvailable)
+     * @param pWatermark: number of queued frames that triggers a request
+     * @param pDeadlineUs: longest time in microseconds a queued frame may wait before a request is made anyway
+     * @note the deadline is only checked when more frames are queued so the consumer should still poll now and then
+     */
+    void setDrainTrigger(int pWatermark, int pDeadlineUs);
+
+    /**
+     * @brief clearDrainRequest must be called by the consumer right before it drains the queue
+     * @note frames queued after this call will raise a new @ref framesAvailable, and the deadline starts over with
+     *       the first of them
+     */
+    void clearDrainRequest();
+
 
 signals:
     /*not implemented yet */
@@ -112,6 +139,12 @@ signals:
       */
     void debugOutput(QString debugString);
 
+    /**
+     * @brief event sent when the queue has reached the drain watermark or deadline
+     * @note emitted at most once until the consumer calls @ref clearDrainRequest
+     */
+    void framesAvailable();
+
 public slots:
 
     /**
@@ -157,6 +190,8 @@ public slots:
      * @param pFrame: the frame to send
      * @return false if parameter is invalid (bus id for instance)
      * @note this calls piSendFrame (in the working thread context if one has been started)
+     * @note the frame is also queued as sent (isReceived false) from that same context, so the device thread stays
+     *       the only producer of the queue
      */
     bool sendFrame(const CANFrame& pFrame);
 
@@ -169,7 +204,7 @@ public slots:
     bool sendFrames(const QList<CANFrame>& pFrames);
 
     /**
-     * @brief Add a new filter for the targetted frames. If a frame matches it will immediately be sent via the targettedFrameReceived signal
+     * @brief Add a new filter for the targetted frames. Matching frames are handed to the receiver by @ref deliverTargettedFrames
      * @param pBusId - Which bus to bond to. -1 for any, otherwise a bitfield of buses (but 0 = first bus, etc)
      * @param ID - 11 or 29 bit ID to match against
      * @param mask - 11 or 29 bit mask used for filter
@@ -195,6 +230,14 @@ public slots:
      */
     bool removeAllTargettedFrames(QObject *receiver);
 
+    /**
+     * @brief hands the frames that matched a targetted frame filter since the last call over to their receivers
+     * @note called by the consumer every time it drains the queue. Each receiver gets one queued call per drain
+     *       with all of its frames: gotTargettedFrames(CANFrameBatch) if it has that slot, otherwise
+     *       gotTargettedFrame(CANFrame) once per frame
+     */
+    void deliverTargettedFrames();
+
     void debugInput(QByteArray bytes);
 
 protected:
@@ -202,9 +245,23 @@ protected:
     QVector<BusData> mBusData;
     bool mConsoleOutput; //send debugging info to the console?
 
-    //determine if the passed frame is part of a filter or not.
+    //determine if the passed frame is part of a filter or not. Matches are handed over when the frames are
+    //committed (see framesQueued) and held for deliverTargettedFrames()
     void checkTargettedFrame(CANFrame &frame);
 
+    /**
+     * @brief framesQueued must be called by the device after committing frames to the queue
+     * @param pCount: number of frames just committed
+     * @note emits @ref framesAvailable if the watermark or deadline has been reached
+     */
+    void framesQueued(int pCount = 1);
+
+    /**
+     * @brief framesDropped must be called by the device for frames it had to throw away because the queue was full
+     * @param pCount: number of frames lost
+     */
+    void framesDropped(int pCount = 1);
+
     /**
      * @brief setStatus
      * @param pStatus: the status to set
@@ -255,6 +312,7 @@ protected:
 
 protected:
     bool useSystemTime;
+    CANClockSync mClockSync; /* maps the device's own timestamps onto capture time, device thread only */
 
     /**************************************************************/
     /***********     protected interface to implement       *******/
@@ -308,7 +366,21 @@ protected:
     virtual bool piSendFrames(const QList<CANFrame>&);
 
 private:
+    /* frames that matched the filters of one receiver and haven't been delivered yet */
+    struct TargettedDelivery {
+        QPointer<QObject> mReceiver;
+        QVector<CANFrame> mFrames;
+    };
+
+    /* rebuilds the table checkTargettedFrame works from. Called whenever the filters change */
+    void compileTargettedFrames();
+    void queueTargettedFrame(QObject* pReceiver, const CANFrame& pFrame);
+    void publishTargettedFrames();
+    /* puts the echo of a frame being sent into the queue. Device thread only, like every other producer call */
+    void queueSentFrame(const CANFrame& pFrame);
+
     LFQueue<CANFrame>   mQueue;
+    mutable CANConStats mStats; /* counters only, so they can be updated through a const connection */
     const QString       mPort;
     const QString       mDriver;
     const CANCon::type  mType;
@@ -316,6 +388,17 @@ private:
     QAtomicInt          mStatus;
     bool                mStarted;
     QThread*            mThread_p;
+    QAtomicInt          mDrainWatermark;
+    QAtomicInt          mDrainDeadlineUs;
+    QAtomicInt          mDrainRequested;
+    QAtomicInteger<qint64> mDrainSinceNs; /* CANConStats::now() of the oldest frame not yet drained, 0 if none */
+    QVector<CANFltObserver>         mAnyBusTargets; /* filters added for bus -1 */
+    QAtomicPointer<CANTargetFilters> mTargetFilters; /* compiled filters, null if there are none */
+    QList<CANTargetFilters*>        mRetiredTargetFilters; /* the device thread may still be reading these, guarded by mTargetLock */
+    QAtomicInt                      mTargetRetired; /* set while mRetiredTargetFilters has anything in it */
+    QMutex                          mTargetLock;
+    QVector<TargettedDelivery>      mTargetMatched; /* matched since the last drain request, device thread only */
+    QVector<TargettedDelivery>      mTargetPending; /* guarded by mTargetLock */
 };
 
 #endif // CANCONNECTION_H
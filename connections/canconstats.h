@@ -0,0 +1,161 @@
+#ifndef CANCONSTATS_H
+#define CANCONSTATS_H
+
+#include <QAtomicInteger>
+#include <QString>
+#include <string.h>
+#include "cantimebase.h"
+
+/**
+ * @brief Point in time copy of the counters of one connection (or the sum of several), see CANConStats
+ */
+class CANConStatsSnapshot
+{
+public:
+    /* bucket n counts frames that took less than 2^n microseconds to reach the model, the last one takes the rest */
+    static const int LATENCY_BUCKETS = 24;
+
+    QString name;
+    quint64 received;       /* frames the device handed us, queued or not */
+    quint64 queued;         /* frames that made it into the queue */
+    quint64 dropped;        /* frames lost because the queue was full */
+    int     peakQueueDepth; /* most frames ever waiting in the queue at once */
+    int     queueSize;
+    quint64 latency[LATENCY_BUCKETS];
+
+    CANConStatsSnapshot() : received(0), queued(0), dropped(0), peakQueueDepth(0), queueSize(0)
+    {
+        memset(latency, 0, sizeof(latency));
+    }
+
+    void add(const CANConStatsSnapshot& pOther)
+    {
+        received += pOther.received;
+        queued += pOther.queued;
+        dropped += pOther.dropped;
+        peakQueueDepth = qMax(peakQueueDepth, pOther.peakQueueDepth);
+        queueSize += pOther.queueSize;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) latency[i] += pOther.latency[i];
+    }
+
+    quint64 latencySamples() const
+    {
+        quint64 total = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) total += latency[i];
+        return total;
+    }
+
+    /**
+     * @brief latencyPercentileUs
+     * @param pFraction: 0.5 for the median, 0.99 for the 99th percentile etc
+     * @return upper bound in microseconds of the bucket that holds that fraction of the frames, -1 if there are none yet
+     */
+    qint64 latencyPercentileUs(double pFraction) const
+    {
+        quint64 total = latencySamples();
+        if (total == 0) return -1;
+        quint64 wanted = static_cast<quint64>(pFraction * static_cast<double>(total));
+        quint64 seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            seen += latency[i];
+            if (seen > wanted) return 1ll << i;
+        }
+        return 1ll << (LATENCY_BUCKETS - 1);
+    }
+};
+
+
+/**
+ * @brief Lock free counters kept by every CANConnection
+ * The device thread counts frames in and out of the queue, the consumer records how long frames waited between
+ * being queued and landing in the model. Every counter is a plain atomic so nobody ever waits on anybody and
+ * any thread can take a snapshot() at any time.
+ * Latency is measured on the host's monotonic clock from the moment the connection queued the oldest frame of a
+ * batch. Device timestamps aren't used as not every device clock has anything to do with the host's.
+ */
+class CANConStats
+{
+public:
+    CANConStats() { reset(); }
+
+    /**
+     * @brief now
+     * @return nanoseconds on the capture clock (CANTimebase::nowNs()), the same for every thread. Never 0, see takeQueuedSince()
+     */
+    static qint64 now()
+    {
+        return CANTimebase::nowNs() + 1;
+    }
+
+    /* device thread */
+
+    void framesQueued(int pCount, int pQueueDepth)
+    {
+        mReceived.fetchAndAddRelaxed(static_cast<quint64>(pCount));
+        mQueued.fetchAndAddRelaxed(static_cast<quint64>(pCount));
+        int peak = mPeakQueueDepth.load();
+        while (pQueueDepth > peak && !mPeakQueueDepth.testAndSetRelaxed(peak, pQueueDepth, peak)) {}
+        /* stamp the first frame since the last drain, see takeQueuedSince() */
+        if (mQueuedSince.load() == 0) mQueuedSince.testAndSetRelaxed(0, now());
+    }
+
+    void framesDropped(int pCount)
+    {
+        mReceived.fetchAndAddRelaxed(static_cast<quint64>(pCount));
+        mDropped.fetchAndAddRelaxed(static_cast<quint64>(pCount));
+    }
+
+    /* consumer side */
+
+    /**
+     * @brief takeQueuedSince must be called right before the queue is drained
+     * @return when the oldest frame about to be drained was queued (see now()), 0 if nothing was
+     */
+    qint64 takeQueuedSince() { return mQueuedSince.fetchAndStoreRelaxed(0); }
+
+    /**
+     * @brief records pCount frames reaching their destination pLatencyNs after being queued
+     * @note a batch is all recorded with the wait of its oldest frame so the histogram errs on the slow side
+     */
+    void recordLatency(qint64 pLatencyNs, int pCount)
+    {
+        qint64 us = pLatencyNs / 1000;
+        int bucket = 0;
+        while (bucket < CANConStatsSnapshot::LATENCY_BUCKETS - 1 && us >= (1ll << bucket)) bucket++;
+        mLatency[bucket].fetchAndAddRelaxed(static_cast<quint64>(pCount));
+    }
+
+    CANConStatsSnapshot snapshot() const
+    {
+        CANConStatsSnapshot out;
+        out.received = mReceived.load();
+        out.queued = mQueued.load();
+        out.dropped = mDropped.load();
+        out.peakQueueDepth = mPeakQueueDepth.load();
+        for (int i = 0; i < CANConStatsSnapshot::LATENCY_BUCKETS; i++) out.latency[i] = mLatency[i].load();
+        return out;
+    }
+
+    void reset()
+    {
+        mReceived.store(0);
+        mQueued.store(0);
+        mDropped.store(0);
+        mPeakQueueDepth.store(0);
+        mQueuedSince.store(0);
+        for (int i = 0; i < CANConStatsSnapshot::LATENCY_BUCKETS; i++) mLatency[i].store(0);
+    }
+
+private:
+    Q_DISABLE_COPY(CANConStats)
+
+    QAtomicInteger<quint64> mReceived;
+    QAtomicInteger<quint64> mQueued;
+    QAtomicInteger<quint64> mDropped;
+    QAtomicInt              mPeakQueueDepth;
+    QAtomicInteger<qint64>  mQueuedSince;
+    QAtomicInteger<quint64> mLatency[CANConStatsSnapshot::LATENCY_BUCKETS];
+};
+
+#endif // CANCONSTATS_H
@@ -0,0 +1,85 @@
+#ifndef CANTARGETFILTERS_H
+#define CANTARGETFILTERS_H
+
+#include <QHash>
+#include <QVector>
+#include "can_structs.h"
+
+/**
+ * @brief The targetted frame filters of one connection compiled for the receive path
+ * @note Filters whose mask covers every ID bit can only ever match one ID so they are looked up by that ID in a
+ *       hash. Everything else (real masks) is kept in a short list that is tested one by one. Filters for any bus
+ *       are tested against every frame on top of the ones for the frame's own bus.
+ *       A compiled table is never changed once built. The connection builds a new one whenever the filters change
+ *       and the receive thread picks it up with the next frame, see CANConnection::checkTargettedFrame
+ */
+class CANTargetFilters
+{
+public:
+    static const quint32 ID_BITS = 0x1FFFFFFF;
+
+    /**
+     * @brief add a filter
+     * @param pBusId: local bus number, -1 for every bus
+     */
+    void add(int pBusId, const CANFltObserver& pFilter)
+    {
+        Filters& filters = (pBusId < 0) ? mAnyBus : busFilters(pBusId);
+        if ((pFilter.mask & ID_BITS) == ID_BITS)
+            filters.exact[pFilter.id & ID_BITS].append(pFilter.observer);
+        else
+            filters.masked.append(pFilter);
+    }
+
+    /**
+     * @brief calls pVisit(observer) for every filter that matches the given ID on the given bus
+     * @note an observer with several matching filters is visited once for each, as it always has been
+     */
+    template<typename Visitor>
+    void match(int pBus, quint32 pId, Visitor pVisit) const
+    {
+        if (pBus >= 0 && pBus < mBuses.count()) mBuses[pBus].match(pId, pVisit);
+        mAnyBus.match(pId, pVisit);
+    }
+
+    bool isEmpty() const
+    {
+        if (!mAnyBus.isEmpty()) return false;
+        for (int i = 0; i < mBuses.count(); i++)
+            if (!mBuses[i].isEmpty()) return false;
+        return true;
+    }
+
+private:
+    struct Filters
+    {
+        QHash<quint32, QVector<QObject *>> exact;
+        QVector<CANFltObserver> masked;
+
+        bool isEmpty() const { return exact.isEmpty() && masked.isEmpty(); }
+
+        template<typename Visitor>
+        void match(quint32 pId, Visitor pVisit) const
+        {
+            if (!exact.isEmpty())
+            {
+                QHash<quint32, QVector<QObject *>>::const_iterator it = exact.constFind(pId);
+                if (it != exact.constEnd())
+                    for (int i = 0; i < it.value().count(); i++) pVisit(it.value()[i]);
+            }
+            for (int i = 0; i < masked.count(); i++)
+                if ((pId & masked[i].mask) == masked[i].id) pVisit(masked[i].observer);
+        }
+    };
+
+    Filters& busFilters(int pBusId)
+    {
+        if (pBusId >= mBuses.count()) mBuses.resize(pBusId + 1);
+        return mBuses[pBusId];
+    }
+
+    QVector<Filters> mBuses;
+    Filters mAnyBus;
+};
+
+#endif // CANTARGETFILTERS_H
@@ -0,0 +1,129 @@
+#include <QAtomicInteger>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include "cantimebase.h"
+
+namespace {
+
+struct Timebase
+{
+    QElapsedTimer           timer;
+    QAtomicInteger<qint64>  startNs;
+    QAtomicInteger<quint64> startEpochUs;
+
+    Timebase() : startNs(0), startEpochUs(static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000)
+    {
+        timer.start();
+    }
+};
+
+Timebase& timebase()
+{
+    static Timebase instance;
+    return instance;
+}
+
+}
+
+qint64 CANTimebase::nowNs()
+{
+    return timebase().timer.nsecsElapsed();
+}
+
+void CANTimebase::reset()
+{
+    Timebase& base = timebase();
+    base.startEpochUs.store(static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000);
+    base.startNs.store(base.timer.nsecsElapsed());
+}
+
+qint64 CANTimebase::startNs()
+{
+    return timebase().startNs.load();
+}
+
+quint64 CANTimebase::startEpochUs()
+{
+    return timebase().startEpochUs.load();
+}
+
+quint64 CANTimebase::captureUs()
+{
+    return captureUs(nowNs());
+}
+
+quint64 CANTimebase::captureUs(qint64 pNowNs)
+{
+    qint64 ns = pNowNs - startNs();
+    return (ns > 0) ? static_cast<quint64>(ns / 1000) : 0;
+}
+
+
+void CANClockSync::reset()
+{
+    mSamples = 0;
+    mBaseDevice = 0;
+    mBaseOffset = 0;
+    mDrift = 0.0;
+    mHaveFirstWindow = false;
+    mFirstDevice = 0;
+    mFirstOffset = 0;
+    mWindowStart = 0;
+    mWindowDevice = 0;
+    mWindowOffset = 0;
+}
+
+void CANClockSync::addSample(qint64 pDeviceUs, qint64 pHostNs)
+{
+    qint64 offset = pHostNs / 1000 - pDeviceUs;
+
+    if (mSamples == 0 || qAbs(offset - offsetAt(pDeviceUs)) > RESYNC_US)
+    {
+        /* first sample, or the device clock jumped: start over from here */
+        reset();
+        mSamples = 1;
+        mBaseDevice = mWindowStart = mWindowDevice = pDeviceUs;
+        mBaseOffset = mWindowOffset = offset;
+        return;
+    }
+    mSamples++;
+
+    /* got here sooner than the estimate allows, so the estimate had some delay in it */
+    if (offset < offsetAt(pDeviceUs))
+    {
+        mBaseDevice = pDeviceUs;
+        mBaseOffset = offset;
+    }
+
+    if (offset - mWindowOffset < static_cast<qint64>(mDrift * static_cast<double>(pDeviceUs - mWindowDevice)))
+    {
+        mWindowDevice = pDeviceUs;
+        mWindowOffset = offset;
+    }
+
+    if (pDeviceUs - mWindowStart < WINDOW_US) return;
+
+    /* window complete. The drift is the slope from the first window's best sample to this one's */
+    if (!mHaveFirstWindow)
+    {
+        mHaveFirstWindow = true;
+        mFirstDevice = mWindowDevice;
+        mFirstOffset = mWindowOffset;
+    }
+    else if (mWindowDevice > mFirstDevice)
+    {
+        mDrift = static_cast<double>(mWindowOffset - mFirstOffset) / static_cast<double>(mWindowDevice - mFirstDevice);
+        mDrift = qBound(-0.001, mDrift, 0.001); /* no crystal is off by more than 1000ppm, anything else is noise */
+        mBaseDevice = mWindowDevice;
+        mBaseOffset = mWindowOffset;
+    }
+    mWindowStart = pDeviceUs;
+    mWindowDevice = pDeviceUs;
+    mWindowOffset = offset;
+}
+
+quint64 CANClockSync::toCaptureUs(qint64 pDeviceUs) const
+{
+    qint64 hostUs = pDeviceUs + offsetAt(pDeviceUs);
+    return CANTimebase::captureUs(hostUs * 1000);
+}
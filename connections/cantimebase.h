@@ -0,0 +1,111 @@
+#ifndef CANTIMEBASE_H
+#define CANTIMEBASE_H
+
+#include <QtGlobal>
+
+/**
+ * @brief The one clock every connection stamps its frames against
+ * @note Time is kept in nanoseconds on a monotonic clock so it never jumps when the wall clock is changed.
+ *       Capture time counts from the start of the capture (program start or the last @ref reset). Frames carry
+ *       capture time in microseconds, so frames from different connections can be compared directly.
+ *       Devices with a clock of their own map it onto this one with a @ref CANClockSync.
+ *       Everything here may be called from any thread.
+ */
+class CANTimebase
+{
+public:
+    /* monotonic clock, nanoseconds since some arbitrary point before the first call */
+    static qint64 nowNs();
+
+    /* the capture starts over now */
+    static void reset();
+
+    /* nowNs() when the capture started */
+    static qint64 startNs();
+
+    /* wall clock (microseconds since the epoch) when the capture started */
+    static quint64 startEpochUs();
+
+    /* capture time, now */
+    static quint64 captureUs();
+
+    /* capture time of a reading of the monotonic clock, in microseconds. 0 for anything before the capture started */
+    static quint64 captureUs(qint64 pNowNs);
+};
+
+/**
+ * @brief Maps the timestamps of a device's own clock onto capture time
+ * @note Every frame that arrives with a device timestamp is a sample of (device time, host time). The host
+ *       time also includes however long the frame took to get here, and that delay is never negative. The
+ *       sample with the smallest host - device offset is therefore the best guess at the real offset. The
+ *       smallest offset is tracked per window of device time. The drift is the slope between the first
+ *       window and the latest one, so a device clock that runs fast or slow stays aligned over long
+ *       captures. When the device clock jumps (the device was reset or its counter wrapped), the estimate
+ *       starts over. The timestamps stamp() hands out never go backwards though, a frame that would land before
+ *       the one stamped last gets that one's time instead, so a resync doesn't reorder the device's frames.
+ *       Mapping a timestamp is a multiply and an add. One instance belongs to one device thread.
+ */
+class CANClockSync
+{
+public:
+    static const qint64 WINDOW_US = 10000000;   /* drift is re-estimated every 10s of device time */
+    static const qint64 RESYNC_US = 1000000;    /* a sample this far off the estimate means the device clock jumped */
+
+    CANClockSync() : mLastStampUs(0), mLastStartNs(0) { reset(); }
+
+    void reset();
+
+    /**
+     * @brief addSample
+     * @param pDeviceUs: timestamp the device gave, in microseconds
+     * @param pHostNs: CANTimebase::nowNs() when it arrived
+     */
+    void addSample(qint64 pDeviceUs, qint64 pHostNs);
+
+    /* capture time of a device timestamp. Only meaningful once there has been a sample */
+    quint64 toCaptureUs(qint64 pDeviceUs) const;
+
+    /* adds the sample for a timestamp that just arrived and returns its capture time, never less than the last one */
+    quint64 stamp(qint64 pDeviceUs)
+    {
+        addSample(pDeviceUs, CANTimebase::nowNs());
+        quint64 us = toCaptureUs(pDeviceUs);
+        qint64 startNs = CANTimebase::startNs();
+        if (startNs != mLastStartNs)
+        {
+            /* the capture started over, so did its time */
+            mLastStartNs = startNs;
+            mLastStampUs = 0;
+        }
+        if (us < mLastStampUs) us = mLastStampUs;
+        mLastStampUs = us;
+        return us;
+    }
+
+    bool isSynced() const { return mSamples > 0; }
+
+    /* estimated drift of the device clock, in parts per million. Positive when it runs slow */
+    double driftPpm() const { return mDrift * 1000000.0; }
+
+private:
+    /* host - device in microseconds at a given device time */
+    qint64 offsetAt(qint64 pDeviceUs) const
+    {
+        return mBaseOffset + static_cast<qint64>(mDrift * static_cast<double>(pDeviceUs - mBaseDevice));
+    }
+
+    quint64 mSamples;
+    qint64  mBaseDevice;        /* the estimate is anchored at this device time ... */
+    qint64  mBaseOffset;        /* ... where the offset was this */
+    double  mDrift;             /* change of offset per microsecond of device time */
+    bool    mHaveFirstWindow;
+    qint64  mFirstDevice;       /* minimum offset sample of the first complete window */
+    qint64  mFirstOffset;
+    qint64  mWindowStart;       /* device time the current window started at */
+    qint64  mWindowDevice;      /* minimum offset sample of the current window */
+    qint64  mWindowOffset;
+    quint64 mLastStampUs;       /* what stamp() returned last, kept over resyncs */
+    qint64  mLastStartNs;       /* CANTimebase::startNs() of the capture mLastStampUs belongs to */
+};
+
+#endif // CANTIMEBASE_H
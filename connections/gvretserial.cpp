@@ -7,6 +7,7 @@
 #include <QtNetwork>
 
 #include "gvretserial.h"
+#include "utils/tracer.h"
 
 GVRetSerial::GVRetSerial(QString portName, bool useTcp) :
     CANConnection(portName, "gvret", CANCon::GVRET_SERIAL, 3, 4000, true),    
@@ -24,10 +25,6 @@ GVRetSerial::GVRetSerial(QString portName, bool useTcp) :
     isAutoRestart = false;
     espSerialMode = true;
 
-    timeBasis = 0;
-    lastSystemTimeBasis = 0;
-    timeAtGVRETSync = 0;
-
     readSettings();
 }
 
@@ -259,12 +256,12 @@ bool GVRetSerial::piSendFrame(const CANFrame& frame)
     buffer[4] = (char)(ID >> 16);
     buffer[5] = (char)(ID >> 24);
     buffer[6] = (char)((frame.bus) & 3);
-    buffer[7] = (char)frame.payload().length();
-    for (c = 0; c < frame.payload().length(); c++)
+    buffer[7] = (char)frame.payloadLength();
+    for (c = 0; c < frame.payloadLength(); c++)
     {
         buffer[8 + c] = frame.payload()[c];
     }
-    buffer[8 + frame.payload().length()] = 0;
+    buffer[8 + frame.payloadLength()] = 0;
 
     sendToSerial(buffer);
 
@@ -571,6 +568,7 @@ void GVRetSerial::connectionTimeout()
 
 void GVRetSerial::readSerialData()
 {
+    TRACE_SCOPE("driver read");
     QByteArray data;
     unsigned char c;
     QString debugBuild;
@@ -670,11 +668,11 @@ void GVRetSerial::procRXChar(unsigned char c)
         case 3:
             buildTimestamp |= (uint)c << 24;
 
-            buildTimestamp += timeBasis;
             if (useSystemTime)
             {
                 buildTimestamp = QDateTime::currentMSecsSinceEpoch() * 1000l;
             }
+            else buildTimestamp = mClockSync.stamp(buildTimestamp);
             buildFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, buildTimestamp));
             break;
         case 4:
@@ -723,9 +721,10 @@ void GVRetSerial::procRXChar(unsigned char c)
                         checkTargettedFrame(buildFrame);
                         /* enqueue frame */
                         getQueue().queue();
+                        framesQueued();
                     }
                     else
-                        qDebug() << "can't get a frame, ERROR";
+                        framesDropped(); /* queue is full */
 
                     //take the time the frame came in and try to resync the time base.
                     //if (continuousTimeSync) txTimestampBasis = QDateTime::currentMSecsSinceEpoch() - (buildFrame.timestamp / 1000);
@@ -750,9 +749,7 @@ void GVRetSerial::procRXChar(unsigned char c)
         case 3:
             buildTimeBasis += ((uint32_t)c << 24);
             qDebug() << "GVRET firmware reports timestamp of " << buildTimeBasis;
-            timeAtGVRETSync = QDateTime::currentMSecsSinceEpoch() * 1000;
-
-            rebuildLocalTimeBasis();
+            mClockSync.addSample(buildTimeBasis, CANTimebase::nowNs());
 
             continuousTimeSync = false;
             rx_state = IDLE;
@@ -981,26 +978,8 @@ void GVRetSerial::procRXChar(unsigned char c)
     }
 }
 
-void GVRetSerial::rebuildLocalTimeBasis()
-{
-    qDebug() << "Rebuilding GVRET time base. GVRET local base = " << buildTimeBasis;
-
-    /*
-      our time basis is the value we have to modulate the main system basis by in order
-      to sync the GVRET timestamps to the rest of the system.
-      The rest of the system uses CANConManager::getInstance()->getTimeBasis as the basis.
-      GVRET returns to us the current time since boot up in microseconds.
-      timeAtGVRETSync stores the "system" timestamp when the GVRET timestamp was retrieved.
-    */
-    lastSystemTimeBasis = CANConManager::getInstance()->getTimeBasis();
-    int64_t systemDelta = timeAtGVRETSync - lastSystemTimeBasis;
-    int32_t localDelta = buildTimeBasis - systemDelta;
-    timeBasis = -localDelta;
-}
-
 void GVRetSerial::handleTick()
 {
-    if (lastSystemTimeBasis != CANConManager::getInstance()->getTimeBasis()) rebuildLocalTimeBasis();
     //qDebug() << "Tick!";
 
     if( CANCon::CONNECTED == getStatus() )
@@ -72,7 +72,6 @@ private:
     void readSettings();
     void procRXChar(unsigned char);
     void sendCommValidation();
-    void rebuildLocalTimeBasis();
     void sendToSerial(const QByteArray &bytes);
     void sendDebug(const QString debugText);
 
@@ -102,9 +101,6 @@ protected:
     int deviceBuildNum;
     int deviceSingleWireMode;
     uint32_t buildTimeBasis;
-    int32_t timeBasis;
-    uint64_t lastSystemTimeBasis;
-    uint64_t timeAtGVRETSync;
 };
 
 #endif // GVRETSERIAL_H
@@ -7,6 +7,7 @@
 
 #include "utility.h"
 #include "mqtt_bus.h"
+#include "utils/tracer.h"
 
 MQTT_BUS::MQTT_BUS(QString topicName) :
     CANConnection(topicName, "mqtt_client", CANCon::MQTT, 1, 4000, true),
@@ -19,9 +20,6 @@ MQTT_BUS::MQTT_BUS(QString topicName) :
     isAutoRestart = false;
     this->topicName = topicName;
 
-    timeBasis = 0;
-    lastSystemTimeBasis = 0;
-
     readSettings();
 }
 
@@ -173,8 +171,7 @@ void MQTT_BUS::readSettings()
 
 void MQTT_BUS::clientMessageReceived(const QMQTT::Message& message)
 {
-//    uint64_t timeBasis = CANConManager::getInstance()->getTimeBasis();
-
+    TRACE_SCOPE("driver read");
 
     /* drop frame if capture is suspended */
     if(isCapSuspended())
@@ -198,13 +195,16 @@ void MQTT_BUS::clientMessageReceived(const QMQTT::Message& message)
         {
             frame_p->setTimeStamp(QCanBusFrame::TimeStamp(0, QDateTime::currentMSecsSinceEpoch() * 1000ul));
         }
-        else frame_p->setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp));
+        else frame_p->setTimeStamp(QCanBusFrame::TimeStamp(0, mClockSync.stamp(static_cast<qint64>(timeStamp))));
 
         checkTargettedFrame(*frame_p);
 
         /* enqueue frame */
         getQueue().queue();
+        framesQueued();
     }
+    else
+        framesDropped(); /* queue is full */
 }
 
 void MQTT_BUS::clientConnected()
@@ -229,23 +229,3 @@ void MQTT_BUS::disconnectDevice() {
     stats.numHardwareBuses = mNumBuses;
     emit status(stats);
 }
-
-void MQTT_BUS::rebuildLocalTimeBasis()
-{
-
-    //qDebug() << "Rebuilding GVRET time base. GVRET local base = " << buildTimeBasis;
-
-    /*
-      our time basis is the value we have to modulate the main system basis by in order
-      to sync the GVRET timestamps to the rest of the system.
-      The rest of the system uses CANConManager::getInstance()->getTimeBasis as the basis.
-      GVRET returns to us the current time since boot up in microseconds.
-      timeAtGVRETSync stores the "system" timestamp when the GVRET timestamp was retrieved.
-    */
-    /*
-    lastSystemTimeBasis = CANConManager::getInstance()->getTimeBasis();
-    int64_t systemDelta = timeAtGVRETSync - lastSystemTimeBasis;
-    int32_t localDelta = buildTimeBasis - systemDelta;
-    timeBasis = -localDelta;
-    */
-}
@@ -41,7 +41,6 @@ private slots:
 
 private:
     void readSettings();
-    void rebuildLocalTimeBasis();
     void sendDebug(const QString debugText);
     QString genRandomClientID();
     SimpleCrypt *crypto;
@@ -59,9 +58,6 @@ protected:
     qint64 buildTimestamp;
     quint32 buildId;
     QByteArray buildData;
-    uint32_t buildTimeBasis;
-    int32_t timeBasis;
-    uint64_t lastSystemTimeBasis;
 };
 
 #endif // MQTT_BUS_H
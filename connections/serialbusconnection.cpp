@@ -1,6 +1,7 @@
 #include "serialbusconnection.h"
 
 #include "canconmanager.h"
+#include "utils/tracer.h"
 
 #include <QCanBus>
 #include <QCanBusFrame>
@@ -119,7 +120,7 @@ bool SerialBusConnection::piSendFrame(const CANFrame& pFrame)
         return false;
     if (!mDev_p) return false;
 
-    return mDev_p->writeFrame(pFrame);
+    return mDev_p->writeFrame(pFrame.toQCanBusFrame());
 }
 
 
@@ -159,12 +160,16 @@ void SerialBusConnection::framesWritten(qint64 count)
 
 void SerialBusConnection::framesReceived()
 {
-    uint64_t timeBasis = CANConManager::getInstance()->getTimeBasis();
-
+    TRACE_SCOPE("driver read");
     /* sanity checks */
     if(!mDev_p)
         return;
 
+    /* frames are written straight into a block of reserved queue slots which is published in one go */
+    CANFrame* batch_p = nullptr;
+    int batchSize = 0;
+    int batchUsed = 0;
+
     /* read frame */
     while(true)
     {
@@ -178,11 +183,21 @@ void SerialBusConnection::framesReceived()
         if(isCapSuspended())
             continue;
 
+        if(batchUsed == batchSize) {
+            if(batchUsed) {
+                getQueue().commit(batchUsed);
+                framesQueued(batchUsed);
+            }
+            batchUsed = 0;
+            batch_p = getQueue().reserve(static_cast<int>(mDev_p->framesAvailable()) + 1, batchSize);
+        }
+
         /* check frame */
         //if (recFrame.payload().length() <= 8) {
-            CANFrame* frame_p = getQueue().get();
+            CANFrame* frame_p = batch_p ? &batch_p[batchUsed] : nullptr;
             if(frame_p) {
-                frame_p->setPayload(recFrame.payload());
+                //the only place a QCanBusFrame turns into one of our own capture records
+                *frame_p = CANFrame::fromQCanBusFrame(recFrame);
                 frame_p->bus = 0;
 
                 if (recFrame.frameType() == QCanBusFrame::ErrorFrame) {
@@ -222,31 +237,31 @@ void SerialBusConnection::framesReceived()
                     }
                     frame_p->extended = true;
                     */
-                } else {
-                    frame_p->setExtendedFrameFormat(recFrame.hasExtendedFrameFormat());
-                    frame_p->setFrameId(recFrame.frameId());
-                    frame_p->setTimeStamp(recFrame.timeStamp());
-                    frame_p->setFrameType(recFrame.frameType());
-                    frame_p->setError(recFrame.error());
-                    frame_p->isReceived = true;
                 }
               
                 frame_p->isReceived    = true;
                 if (useSystemTime) {
                     frame_p->setTimeStamp(QCanBusFrame::TimeStamp(0, QDateTime::currentMSecsSinceEpoch() * 1000ul));
                 }
-                else frame_p->setTimeStamp(QCanBusFrame::TimeStamp(0, (recFrame.timeStamp().seconds() * 1000000ul + recFrame.timeStamp().microSeconds()) - timeBasis));
+                else {
+                    /* drivers differ in what their timestamps count from (and some don't fill them in at all) */
+                    qint64 deviceUs = recFrame.timeStamp().seconds() * 1000000ll + recFrame.timeStamp().microSeconds();
+                    frame_p->setTimeStamp(QCanBusFrame::TimeStamp(0, deviceUs ? mClockSync.stamp(deviceUs) : CANTimebase::captureUs()));
+                }
 
                 checkTargettedFrame(*frame_p);
 
-                /* enqueue frame */
-                getQueue().queue();
+                batchUsed++;
             //}
-#if 0
+            }
             else
-                qDebug() << "can't get a frame, ERROR";
-#endif
-        }
+                framesDropped(); /* queue is full */
+    }
+
+    /* enqueue frames */
+    if(batchUsed) {
+        getQueue().commit(batchUsed);
+        framesQueued(batchUsed);
     }
 }
 
@@ -88,7 +88,7 @@ bool DBC_SIGNAL::processAsText(const CANFrame &frame, QString &outString, bool o
     }
     else //double precision float
     {
-        if ( frame.payload().length() < 8 )
+        if ( frame.payloadLength() < 8 )
         {
             result = 0;
             return false;
@@ -159,7 +159,7 @@ bool DBC_SIGNAL::processAsInt(const CANFrame &frame, int32_t &outValue)
     }
 
     if (valType == SIGNED_INT) isSigned = true;
-    if ( static_cast<int>(frame.payload().length() * 8) < (startBit + signalSize) )
+    if ( static_cast<int>(frame.payloadLength() * 8) < (startBit + signalSize) )
     {
         result = 0;
         return false;
@@ -204,7 +204,7 @@ bool DBC_SIGNAL::processAsDouble(const CANFrame &frame, double &outValue)
     if (valType == SIGNED_INT) isSigned = true;
     if (valType == SIGNED_INT || valType == UNSIGNED_INT)
     {
-        if ( frame.payload().length() * 8 < (startBit+signalSize) )
+        if ( frame.payloadLength() * 8 < (startBit+signalSize) )
         {
             result = 0;
             return false;
@@ -216,7 +216,7 @@ bool DBC_SIGNAL::processAsDouble(const CANFrame &frame, double &outValue)
     /*TODO: It should be noted that the below floating point has not even been tested. For shame! Test it!*/
     else if (valType == SP_FLOAT)
     {
-        if ( frame.payload().length() * 8 < (startBit + 32) )
+        if ( frame.payloadLength() * 8 < (startBit + 32) )
         {
             result = 0;
             return false;
@@ -231,7 +231,7 @@ bool DBC_SIGNAL::processAsDouble(const CANFrame &frame, double &outValue)
     }
     else //double precision float
     {
-        if ( frame.payload().length() < 8 )
+        if ( frame.payloadLength() < 8 )
         {
             result = 0;
             return false;
@@ -15,6 +15,7 @@
 #include "connections/canconmanager.h"
 
 DBCHandler* DBCHandler::instance = nullptr;
+uint32_t DBCHandler::lookupGeneration = 0;
 
 DBC_SIGNAL* DBCSignalHandler::findSignalByIdx(int idx)
 {
@@ -179,12 +180,14 @@ DBC_MESSAGE* DBCMessageHandler::findMsgByPartialName(QString name)
 
 bool DBCMessageHandler::addMessage(DBC_MESSAGE &msg)
 {
+    DBCHandler::invalidateLookups();
     messages.append(msg);
     return true;
 }
 
 bool DBCMessageHandler::removeMessage(DBC_MESSAGE *msg)
 {
+    DBCHandler::invalidateLookups();
     qDebug() << "Total # of messages: " << getCount();
     for (int i = 0; i < getCount(); i++)
     {
@@ -202,6 +205,7 @@ bool DBCMessageHandler::removeMessageByIndex(int idx)
     if (messages.count() == 0) return false;
     if (idx < 0) return false;
     if (idx >= messages.count()) return false;
+    DBCHandler::invalidateLookups();
     messages.removeAt(idx);
     return true;
 }
@@ -214,6 +218,7 @@ bool DBCMessageHandler::removeMessage(uint32_t ID)
     {
         if (messages[i].ID == ID)
         {
+            DBCHandler::invalidateLookups();
             messages.removeAt(i);
             foundSome = true;
         }
@@ -229,6 +234,7 @@ bool DBCMessageHandler::removeMessage(QString name)
     {
         if (messages[i].name.compare(name, Qt::CaseInsensitive) == 0)
         {
+            DBCHandler::invalidateLookups();
             messages.removeAt(i);
             foundSome = true;
         }
@@ -238,6 +244,7 @@ bool DBCMessageHandler::removeMessage(QString name)
 
 void DBCMessageHandler::removeAllMessages()
 {
+    DBCHandler::invalidateLookups();
     messages.clear();
 }
 
@@ -248,6 +255,7 @@ int DBCMessageHandler::getCount()
 
 void DBCMessageHandler::sort()
 {
+    DBCHandler::invalidateLookups(); //messages trade places so cached pointers now point at other messages
     std::sort(messages.begin(), messages.end());
     for (int i = 0; i < messages.count(); i++)
     {
@@ -272,6 +280,7 @@ MatchingCriteria_t DBCMessageHandler::getMatchingCriteria()
 
 void DBCMessageHandler::setMatchingCriteria(MatchingCriteria_t _matchingCriteria)
 {
+    if (matchingCriteria != _matchingCriteria) DBCHandler::invalidateLookups();
     matchingCriteria = _matchingCriteria;
 }
 
@@ -369,6 +378,7 @@ void DBCFile::setAssocBus(int bus)
     // To allow setting bus numbers even before connection is configured, do not enforce "valid" bus numbers
     //int numBuses = CANConManager::getInstance()->getNumBuses();
     //if (bus >= numBuses) return;
+    if (assocBuses != bus) DBCHandler::invalidateLookups();
     assocBuses = bus;
 }
 
@@ -1535,6 +1545,7 @@ int DBCHandler::createBlankFile()
     falseNode.comment = "Default node if none specified";
     newFile.dbc_nodes.append(falseNode);
 
+    invalidateLookups();
     loadedFiles.append(newFile);
     return loadedFiles.count();
 }
@@ -1543,6 +1554,7 @@ DBCFile* DBCHandler::loadDBCFile(QString filename)
 {
     DBCFile newFile;
     newFile.loadFile(filename);
+    invalidateLookups();
     loadedFiles.append(newFile);
     return &loadedFiles.last();
 }
@@ -1736,11 +1748,13 @@ void DBCHandler::removeDBCFile(int idx)
     if (loadedFiles.count() == 0) return;
     if (idx < 0) return;
     if (idx >= loadedFiles.count()) return;
+    invalidateLookups();
     loadedFiles.removeAt(idx);
 }
 
 void DBCHandler::removeAllFiles()
 {
+    invalidateLookups();
     loadedFiles.clear();
 }
 
@@ -1752,6 +1766,7 @@ void DBCHandler::swapFiles(int pos1, int pos2)
     if (pos2 < 0) return;
     if (pos2 >= loadedFiles.count()) return;
 
+    invalidateLookups(); //file order decides which file wins a match
 //    loadedFiles.swapItemsAt(pos1, pos2);
 }
 
@@ -1763,15 +1778,43 @@ void DBCHandler::swapFiles(int pos1, int pos2)
 */
 DBC_MESSAGE* DBCHandler::findMessage(const CANFrame &frame)
 {
+    //The answer only depends on the bus and ID so it is remembered, misses included, until something
+    //about the loaded files changes (see invalidateLookups). The frame list asks for every visible row
+    //several times per repaint so this saves walking every file and message list over and over.
+    if (lookupCacheGeneration != lookupGeneration)
+    {
+        lookupCache.clear();
+        lookupCacheGeneration = lookupGeneration;
+    }
+    uint64_t key = static_cast<uint64_t>(frame.frameId()) | (static_cast<uint64_t>(static_cast<uint32_t>(frame.bus)) << 29);
+    QHash<uint64_t, DBC_MESSAGE*>::const_iterator it = lookupCache.constFind(key);
+    if (it != lookupCache.constEnd()) return it.value();
+
+    DBC_MESSAGE *found = nullptr;
     for(int i = 0; i < loadedFiles.count(); i++)
     {
         if (loadedFiles[i].getAssocBus() == -1 || frame.bus == loadedFiles[i].getAssocBus())
         {
             DBC_MESSAGE* msg = loadedFiles[i].messageHandler->findMsgByID(frame.frameId());
-            if (msg != nullptr) return msg;
+            if (msg != nullptr)
+            {
+                found = msg;
+                break;
+            }
         }
     }
-    return nullptr;
+    lookupCache.insert(key, found);
+    return found;
+}
+
+/*
+ * Bumps the lookup generation so findMessage() forgets everything it has cached. Static because the
+ * message and file classes need to call it too and they don't know the handler (and the handler may
+ * still be under construction when the saved DBC files are loaded).
+ */
+void DBCHandler::invalidateLookups()
+{
+    lookupGeneration++;
 }
 
 
@@ -1840,6 +1883,7 @@ DBCFile* DBCHandler::getFileByName(QString name)
 
 DBCHandler::DBCHandler()
 {
+    lookupCacheGeneration = lookupGeneration;
     // Load previously saved DBC file settings
     QSettings settings;
     int filecount = settings.value("DBC/FileCount", 0).toInt();
@@ -2,6 +2,7 @@
 #define DBCHANDLER_H
 
 #include <QObject>
+#include <QHash>
 #include "dbc_classes.h"
 #include "can_structs.h"
 
@@ -124,9 +125,15 @@ public:
     int createBlankFile();
     DBCFile* loadJSONFile(QString);
     static DBCHandler *getReference();
+    //call after changing anything that affects which message a frame resolves to
+    static void invalidateLookups();
+    static uint32_t getLookupGeneration() { return lookupGeneration; }
 
 private:
     QList<DBCFile> loadedFiles;
+    QHash<uint64_t, DBC_MESSAGE*> lookupCache; //(bus, id) -> message, nullptr entries mean no match
+    uint32_t lookupCacheGeneration;
+    static uint32_t lookupGeneration;
 
     DBCHandler();
     static DBCHandler *instance;
@@ -6,6 +6,7 @@
 #include <QComboBox>
 #include "dbchandler.h"
 #include "dbcmaineditor.h"
+#include "canframeview.h"
 
 namespace Ui {
 class DBCLoadSaveWindow;
@@ -16,7 +17,7 @@ class DBCLoadSaveWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit DBCLoadSaveWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit DBCLoadSaveWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~DBCLoadSaveWindow();
 
 private slots:
@@ -39,7 +40,7 @@ private:
     Ui::DBCLoadSaveWindow *ui;
     DBCHandler *dbcHandler;
     DBCFile *currentlyEditingFile;
-    const QVector<CANFrame> *referenceFrames;
+    const CANFrameView *referenceFrames;
     DBCMainEditor *editorWindow;
     bool inhibitCellProcessing;
 
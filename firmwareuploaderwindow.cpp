@@ -11,7 +11,7 @@
 //for firmware updates and wouldn't need this specific code. But, it might be able to be turned into a UDS firmware uploader or downloader.
 //Note that this screen is specifically hidden by default because of it's oddball status. You have to re-enable it in mainwindow.cpp to see it.
 
-FirmwareUploaderWindow::FirmwareUploaderWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FirmwareUploaderWindow::FirmwareUploaderWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FirmwareUploaderWindow)
 {
@@ -75,10 +75,16 @@ void FirmwareUploaderWindow::updatedFrames(int numFrames)
     }
 }
 
+//everything that matched our filters since the connection was last drained
+void FirmwareUploaderWindow::gotTargettedFrames(const CANFrameBatch &frames)
+{
+    foreach (const CANFrame &frame, frames) gotTargettedFrame(frame);
+}
+
 void FirmwareUploaderWindow::gotTargettedFrame(CANFrame frame)
 {
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(frame.payload().constData());
-    int dataLen = frame.payload().count();
+    const unsigned char *data = frame.payloadData();
+    int dataLen = frame.payloadLength();
 
     qDebug() << "FUW: Got targetted frame with id " << frame.frameId();
     if (frame.frameId() == (uint32_t)(baseAddress + 0x10) && (dataLen == 8) ) {
@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QTimer>
 #include "can_structs.h"
+#include "canframeview.h"
 #include "connections/canconmanager.h"
 #include "utility.h"
 
@@ -16,7 +17,7 @@ class FirmwareUploaderWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FirmwareUploaderWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FirmwareUploaderWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~FirmwareUploaderWindow();
 
 signals:
@@ -24,6 +25,7 @@ signals:
 
 public slots:
     void gotTargettedFrame(CANFrame frame);
+    void gotTargettedFrames(const CANFrameBatch &frames);
 
 private slots:
     void handleLoadFile();
@@ -46,7 +48,7 @@ private:
     int bus;
     uint32_t token;
     QByteArray firmwareData;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QTimer *timer;
 };
 
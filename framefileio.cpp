@@ -1,23 +1,178 @@
 #include "framefileio.h"
 
 #include <QMessageBox>
+#include <QBuffer>
 #include <QProgressDialog>
 #include <QDateTime>
+#include <QFileInfo>
 #include <QRegularExpression>
 #include <QtEndian>
+#include <QScopedPointer>
 #include <QSettings>
 #include <iostream>
+#include <algorithm>
+#include <string.h>
 
 #include "utility.h"
 #include "blfhandler.h"
+#include "connections/canconmanager.h"
+#include "framestream.h"
+#include "textlogparser.h"
+#include "utils/tracer.h"
 
 QFile FrameFileIO::continuousFile;
 
+namespace {
+
+//base of the text format writers. Lines are put together in a buffer that goes out every 256KB
+class TextFrameWriter : public FrameWriter
+{
+public:
+    TextFrameWriter() : mStarted(false), mHasFirst(false), mHeaderSize(0) {}
+
+    bool open(const QString &filename)
+    {
+        mFile.setFileName(filename);
+        return mFile.open(QIODevice::WriteOnly | QIODevice::Text);
+    }
+
+    bool write(const CANFrame *frames, int count) override
+    {
+        if (!mFile.isOpen()) return false;
+        for (int i = 0; i < count; i++)
+        {
+            if (!mStarted) start(&frames[i]);
+            appendFrame(mBuffer, frames[i]);
+            if (mBuffer.size() > 256 * 1024 && !flush()) return false;
+        }
+        return true;
+    }
+
+    bool finish() override
+    {
+        if (!mFile.isOpen()) return false;
+        if (!mStarted) start(nullptr);
+        bool ok = flush() && rewriteHeader();
+        mFile.close();
+        return ok;
+    }
+
+protected:
+    //the header goes out just before the first frame as some formats put its time in there. first is null for no frames
+    virtual void appendHeader(QByteArray &out, const CANFrame *first) { Q_UNUSED(out); Q_UNUSED(first); }
+    virtual void appendFrame(QByteArray &out, const CANFrame &frame) = 0;
+
+    //true for formats whose header has totals (frame count, stop time) only known once all frames are written.
+    //appendHeader() is called again by finish() and what it gives goes over the first header, so it must come out
+    //just as long
+    virtual bool headerHasTotals() const { return false; }
+
+    //same as QString::number(value, 16).toUpper().rightJustified(digits, '0')
+    static void appendHex(QByteArray &out, uint64_t value, int digits)
+    {
+        static const char hexDigits[] = "0123456789ABCDEF";
+        char text[16];
+        int len = 0;
+        do
+        {
+            text[len++] = hexDigits[value & 0xF];
+            value >>= 4;
+        } while (value);
+        for (int i = len; i < digits; i++) out.append('0');
+        while (len) out.append(text[--len]);
+    }
+
+    //microseconds as seconds with the given number of decimals, rounded like QString::number(us / 1000000.0, 'f', decimals)
+    static void appendSeconds(QByteArray &out, int64_t us, int decimals)
+    {
+        if (us < 0)
+        {
+            out.append('-');
+            us = -us;
+        }
+        int64_t scale = 1;
+        for (int i = decimals; i < 6; i++) scale *= 10;
+        uint64_t units = static_cast<uint64_t>(us + scale / 2) / static_cast<uint64_t>(scale);
+        uint64_t perSecond = 1000000 / static_cast<uint64_t>(scale);
+        out.append(QByteArray::number(static_cast<qulonglong>(units / perSecond)));
+        if (decimals <= 0) return;
+        out.append('.');
+        out.append(QByteArray::number(static_cast<qulonglong>(units % perSecond)).rightJustified(decimals, '0'));
+    }
+
+private:
+    void start(const CANFrame *first)
+    {
+        mStarted = true;
+        mHasFirst = (first != nullptr);
+        if (first) mFirst = *first;
+        appendHeader(mBuffer, first);
+        mHeaderSize = mBuffer.size();
+    }
+
+    bool flush()
+    {
+        bool ok = mFile.write(mBuffer) == mBuffer.size();
+        mBuffer.resize(0);
+        return ok;
+    }
+
+    bool rewriteHeader()
+    {
+        if (!headerHasTotals()) return true;
+        QByteArray header;
+        appendHeader(header, mHasFirst ? &mFirst : nullptr);
+        return header.size() == mHeaderSize && mFile.seek(0) && mFile.write(header) == header.size();
+    }
+
+    QFile mFile;
+    QByteArray mBuffer;
+    bool mStarted;
+    CANFrame mFirst;
+    bool mHasFirst;
+    int mHeaderSize;
+};
+
+//[pos, pos + len) of a line, cut short where the line ends and without the white space around it. How the fixed
+//width formats get at their columns, same as QByteArray::mid(pos, len).trimmed()
+void lineColumn(const char *&begin, const char *&end, int pos, int len)
+{
+    begin += qMin(static_cast<qint64>(pos), static_cast<qint64>(end - begin));
+    if (end - begin > len) end = begin + len;
+    TextTokens::trim(begin, end);
+}
+
+//a token without the quotes and white space around it
+void unquote(const char *&begin, const char *&end)
+{
+    while (begin < end && (*begin == '"' || *begin == ' ' || *begin == '\t')) begin++;
+    while (end > begin && (end[-1] == '"' || end[-1] == ' ' || end[-1] == '\t')) end--;
+}
+
+//same as Utility::ParseStringToNum(): hex with a 0x or x in front, binary with 0b or b, decimal otherwise
+uint64_t parseNumber(const char *begin, const char *end)
+{
+    uint64_t value = 0;
+    if (end - begin > 1 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X' || begin[1] == 'b' || begin[1] == 'B')) begin++;
+    if (begin < end && (*begin == 'x' || *begin == 'X'))
+    {
+        TextTokens::parseHex(begin + 1, end, value);
+    }
+    else if (begin < end && (*begin == 'b' || *begin == 'B'))
+    {
+        for (const char *c = begin + 1; c < end; c++) value = (value << 1) | (*c == '1' ? 1 : 0);
+    }
+    else TextTokens::parseUInt(begin, end, value);
+    return value;
+}
+
+}
+
 FrameFileIO::FrameFileIO()
 {
 }
 
-bool FrameFileIO::saveFrameFile(QString &fileName, const QVector<CANFrame>* frameCache)
+bool FrameFileIO::saveFrameFile(QString &fileName, const CANFrameView * frameCache)
 {
     QString filename;
     QFileDialog dialog(qApp->activeWindow());
@@ -38,6 +193,7 @@ bool FrameFileIO::saveFrameFile(QString &fileName, const QVector<CANFrame>* fram
     filters.append(QString(tr("Cabana Log (*.csv *.CSV)")));
     filters.append(QString(tr("CANalyzer Ascii Log (*.asc *.ASC)")));
     filters.append(QString(tr("CARBUS Analyzer (*.trc *.TRC)")));
+    filters.append(QString(tr("CANOpenAnalyzer Capture (*.cancap)")));
 
     dialog.setDirectory(settings.value("FileIO/LoadSaveDirectory", dialog.directory().path()).toString());
     dialog.setFileMode(QFileDialog::AnyFile);
@@ -58,6 +214,7 @@ bool FrameFileIO::saveFrameFile(QString &fileName, const QVector<CANFrame>* fram
         progress.show();
 
         qApp->processEvents();
+        TRACE_SCOPE("file save");
 
         if (dialog.selectedNameFilter() == filters[0])
         {
@@ -128,6 +285,11 @@ bool FrameFileIO::saveFrameFile(QString &fileName, const QVector<CANFrame>* fram
             if (!filename.contains('.')) filename += ".trc";
             result = saveCARBUSAnalzyer(filename, frameCache);
         }
+        if (dialog.selectedNameFilter() == filters[13])
+        {
+            if (!filename.contains('.')) filename += ".cancap";
+            result = saveCaptureFile(filename, frameCache);
+        }
 
         progress.cancel();
 
@@ -143,328 +305,234 @@ bool FrameFileIO::saveFrameFile(QString &fileName, const QVector<CANFrame>* fram
     return false;
 }
 
-bool FrameFileIO::loadFrameFile(QString &fileName, QVector<CANFrame>* frameCache)
-{
-    QString filename;
-    QFileDialog dialog;
-    QSettings settings;
-    bool result = false;
-
-    QStringList filters;
-    filters.append(QString(tr("Autodetect File Type (*.*)")));
-    filters.append(QString(tr("GVRET Logs (*.csv *.CSV)")));
-    filters.append(QString(tr("CRTD Logs (*.crt *.crtd *.CRT *.CRTD)")));
-    filters.append(QString(tr("BusMaster Log (*.log *.LOG)")));
-    filters.append(QString(tr("Microchip Log (*.can *.CAN *.log *.LOG)")));
-    filters.append(QString(tr("Vector trace files (*.trace *.TRACE)")));
-    filters.append(QString(tr("IXXAT MiniLog (*.csv *.CSV)")));
-    filters.append(QString(tr("CAN-DO Log (*.avc *.can *.evc *.qcc *.AVC *.CAN *.EVC *.QCC)")));
-    filters.append(QString(tr("Vehicle Spy (*.csv *.CSV)")));
-    filters.append(QString(tr("Candump/Kayak (*.log *.LOG)")));
-    filters.append(QString(tr("CANDump Lawicel (*.txt *.TXT *.LOG *.log)")));
-    filters.append(QString(tr("PCAN Viewer (*.trc *.TRC)")));
-    filters.append(QString(tr("Kvaser Log Decimal (*.txt *.TXT)")));
-    filters.append(QString(tr("Kvaser Log Hex (*.txt *.TXT)")));
-    filters.append(QString(tr("CANalyzer Ascii Log (*.asc *.ASC)")));
-    filters.append(QString(tr("CANalyzer Binary Log Files (*.blf *.BLF)")));
-    filters.append(QString(tr("CARBUS Analyzer Trace Files (*.trc *.TRC)")));
-    filters.append(QString(tr("CANHacker Trace Files (*.trc *.TRC)")));
-    filters.append(QString(tr("Generic ID/Data CSV (*.csv *.CSV)")));
-    filters.append(QString(tr("Cabana Log (*.csv *.CSV)")));
-    filters.append(QString(tr("CANOpen Magic (*.csv *.CSV)")));
-
-    dialog.setDirectory(settings.value("FileIO/LoadSaveDirectory", dialog.directory().path()).toString());
-    dialog.setFileMode(QFileDialog::ExistingFile);
-    dialog.setNameFilters(filters);
-    dialog.setViewMode(QFileDialog::Detail);
-
-    if (dialog.exec() == QDialog::Accepted)
-    {
-        filename = dialog.selectedFiles()[0];
-        QString selectedNameFilter = dialog.selectedNameFilter();
+namespace {
 
-        QProgressDialog progress(qApp->activeWindow());
-        progress.setWindowModality(Qt::WindowModal);
-        progress.setLabelText("Loading file...");
-        progress.setCancelButton(nullptr);
-        progress.setRange(0,0);
-        progress.setMinimumDuration(0);
-        progress.show();
-
-        qApp->processEvents();
-
-        if (selectedNameFilter == filters[0]) result = autoDetectLoadFile(filename, frameCache);
-        if (selectedNameFilter == filters[1]) result = loadNativeCSVFile(filename, frameCache);
-        if (selectedNameFilter == filters[2]) result = loadCRTDFile(filename, frameCache);
-        if (selectedNameFilter == filters[3]) result = loadLogFile(filename, frameCache);
-        if (selectedNameFilter == filters[4]) result = loadMicrochipFile(filename, frameCache);
-        if (selectedNameFilter == filters[5]) result = loadTraceFile(filename, frameCache);
-        if (selectedNameFilter == filters[6]) result = loadIXXATFile(filename, frameCache);
-        if (selectedNameFilter == filters[7]) result = loadCANDOFile(filename, frameCache);
-        if (selectedNameFilter == filters[8]) result = loadVehicleSpyFile(filename, frameCache);
-        if (selectedNameFilter == filters[9]) result = loadCanDumpFile(filename, frameCache);
-        if (selectedNameFilter == filters[10]) result = loadLawicelFile(filename, frameCache);
-        if (selectedNameFilter == filters[11]) result = loadPCANFile(filename, frameCache);
-        if (selectedNameFilter == filters[12]) result = loadKvaserFile(filename, frameCache, false);
-        if (selectedNameFilter == filters[13]) result = loadKvaserFile(filename, frameCache, true);
-        if (selectedNameFilter == filters[14]) result = loadCanalyzerASC(filename, frameCache);
-        if (selectedNameFilter == filters[15]) result = loadCanalyzerBLF(filename, frameCache);
-        if (selectedNameFilter == filters[16]) result = loadCARBUSAnalyzerFile(filename, frameCache);
-        if (selectedNameFilter == filters[17]) result = loadCANHackerFile(filename, frameCache);
-        if (selectedNameFilter == filters[18]) result = loadGenericCSVFile(filename, frameCache);
-        if (selectedNameFilter == filters[19]) result = loadCabanaFile(filename, frameCache);
-        if (selectedNameFilter == filters[20]) result = loadCANOpenFile(filename, frameCache);
-
-        progress.cancel();
+//the Kvaser loader needs to be told which flavour it is looking at, the load dialog has an entry for each
+bool loadKvaserDecimalFile(QString filename, QVector<CANFrame>* frames)
+{
+    return FrameFileIO::loadKvaserFile(filename, frames, false);
+}
 
-        if (result)
-        {
-            QStringList fileList = filename.split('/');
-            fileName = fileList[fileList.length() - 1];
-            settings.setValue("FileIO/LoadSaveDirectory", dialog.directory().path());
-            return true;
-        }
-        else
-        {
-            if (dialog.selectedNameFilter() != filters[0])
-            {
-                QMessageBox msgBox;
-                msgBox.setText("File load completed with errors.\r\nPerhaps you selected the wrong file type?");
-                msgBox.exec();
-            }
-            return false;
-        }
-    }
-    return false;
+bool loadKvaserHexFile(QString filename, QVector<CANFrame>* frames)
+{
+    return FrameFileIO::loadKvaserFile(filename, frames, true);
 }
 
+//how much a format check proves. A signature can't turn up by accident, a header line names the format, a line
+//shape match only says the first lines look like frames of that format, and several formats share a shape
+enum DetectConfidence
+{
+    DETECT_SHAPE = 1,
+    DETECT_HEADER,
+    DETECT_SIGNATURE
+};
 
-//Try every format by first using the "is" functions which try to detect whether a given file is a good match to that
-//file format or not. Those functions are much less tolerant than the load functions and so should help to discriminate
-//whether a file could be loaded or not by a given loader. The loader return is still used in case the guess was wrong.
-bool FrameFileIO::autoDetectLoadFile(QString filename, QVector<CANFrame>* frames)
+struct DetectFormat
 {
-    qDebug() << "Attempting Canalyzer BLF";
-    if (isCanalyzerBLF(filename))
+    const char *name;
+    bool (*probe)(const QByteArray &prefix);
+    FrameFileIO::LoadFunction loader;
+    DetectConfidence confidence;
+};
+
+//formats that match equally well are tried in the order of this list
+const DetectFormat detectFormats[] =
+{
+    {"capture file", FrameFileIO::isCaptureFile, FrameFileIO::loadCaptureFile, DETECT_SIGNATURE},
+    {"Canalyzer BLF", FrameFileIO::isCanalyzerBLF, FrameFileIO::loadCanalyzerBLF, DETECT_SIGNATURE},
+    {"native CSV", FrameFileIO::isNativeCSVFile, FrameFileIO::loadNativeCSVFile, DETECT_HEADER},
+    {"Canalyzer ASC", FrameFileIO::isCanalyzerASC, FrameFileIO::loadCanalyzerASC, DETECT_SHAPE},
+    {"CRTD", FrameFileIO::isCRTDFile, FrameFileIO::loadCRTDFile, DETECT_SHAPE},
+    {"trace", FrameFileIO::isTraceFile, FrameFileIO::loadTraceFile, DETECT_SHAPE},
+    {"vehicle spy", FrameFileIO::isVehicleSpyFile, FrameFileIO::loadVehicleSpyFile, DETECT_HEADER},
+    {"candump", FrameFileIO::isCanDumpFile, FrameFileIO::loadCanDumpFile, DETECT_SHAPE},
+    {"lawicel", FrameFileIO::isLawicelFile, FrameFileIO::loadLawicelFile, DETECT_SHAPE},
+    {"'CARBUS Analyzer'", FrameFileIO::isCARBUSAnalyzerFile, FrameFileIO::loadCARBUSAnalyzerFile, DETECT_HEADER},
+    {"CANHacker", FrameFileIO::isCANHackerFile, FrameFileIO::loadCANHackerFile, DETECT_SHAPE},
+    {"Cabana", FrameFileIO::isCabanaFile, FrameFileIO::loadCabanaFile, DETECT_SHAPE},
+    {"CANOpen Magic", FrameFileIO::isCANOpenFile, FrameFileIO::loadCANOpenFile, DETECT_HEADER},
+    {"Busmaster Log", FrameFileIO::isLogFile, FrameFileIO::loadLogFile, DETECT_SHAPE},
+    {"PCAN", FrameFileIO::isPCANFile, FrameFileIO::loadPCANFile, DETECT_SHAPE},
+    {"IXXAT", FrameFileIO::isIXXATFile, FrameFileIO::loadIXXATFile, DETECT_SHAPE},
+    {"microchip", FrameFileIO::isMicrochipFile, FrameFileIO::loadMicrochipFile, DETECT_SHAPE},
+    {"CANDO", FrameFileIO::isCANDOFile, FrameFileIO::loadCANDOFile, DETECT_SHAPE},
+    {"Kvaser HEX", FrameFileIO::isKvaserFile, loadKvaserHexFile, DETECT_SHAPE},
+    {"Kvaser Decimal", FrameFileIO::isKvaserFile, loadKvaserDecimalFile, DETECT_SHAPE},
+    {"generic CSV", FrameFileIO::isGenericCSVFile, FrameFileIO::loadGenericCSVFile, DETECT_SHAPE}
+};
+
+//every format whose check passes on the start of the file, most certain first
+QVector<const DetectFormat *> detectFileFormats(const QByteArray &prefix)
+{
+    QVector<const DetectFormat *> matches;
+    for (const DetectFormat &format : detectFormats)
     {
-        if (loadCanalyzerBLF(filename, frames))
-        {
-            qDebug() << "Loaded as Canalyzer BLF successfully!";
-            return true;
-        }
+        if (format.probe(prefix)) matches.append(&format);
     }
-
-    qDebug() << "Attempting native CSV";
-    if (isNativeCSVFile(filename))
+    std::stable_sort(matches.begin(), matches.end(), [](const DetectFormat *a, const DetectFormat *b)
     {
-        if (loadNativeCSVFile(filename, frames))
-        {
-            qDebug() << "Loaded as native CSV successfully!";
-            return true;
-        }
-    }
+        return a->confidence > b->confidence;
+    });
+    return matches;
+}
 
-    qDebug() << "Attempting canalyzer ASC";
-    if (isCanalyzerASC(filename))
+//tries the formats in turn until one loads
+bool loadDetectedFile(const QString &filename, const QVector<const DetectFormat *> &formats, QVector<CANFrame> *frames)
+{
+    int start = frames->count();
+    foreach (const DetectFormat *format, formats)
     {
-        if (loadCanalyzerASC(filename, frames))
+        qDebug() << "Attempting" << format->name;
+        frames->resize(start); //nothing left over from a format that didn't work out
+        if (format->loader(filename, frames))
         {
-            qDebug() << "Loaded as Canalyzer ASC successfully!";
+            qDebug() << "Loaded as" << format->name << "successfully!";
             return true;
         }
     }
+    qDebug() << "Nothing worked... sorry...";
+    return false;
+}
 
-    qDebug() << "Attempting CRTD";
-    if (isCRTDFile(filename))
-    {
-        if (loadCRTDFile(filename, frames))
-        {
-            qDebug() << "Loaded as CRTD successfully!";
-            return true;
-        }
-    }
+}
 
+bool FrameFileIO::selectLoadFile(QString &filename, LoadFunction &loader)
+{
+    QFileDialog dialog;
+    QSettings settings;
 
-    qDebug() << "Attempting trace file";
-    if (isTraceFile(filename))
-    {
-        if (loadTraceFile(filename, frames))
-        {
-            qDebug() << "Loaded as trace successfully!";
-            return true;
-        }
-    }
+    struct Format
+    {
+        QString filter;
+        LoadFunction loader;
+    };
+    const Format formats[] =
+    {
+        {tr("Autodetect File Type (*.*)"), nullptr},
+        {tr("GVRET Logs (*.csv *.CSV)"), loadNativeCSVFile},
+        {tr("CRTD Logs (*.crt *.crtd *.CRT *.CRTD)"), loadCRTDFile},
+        {tr("BusMaster Log (*.log *.LOG)"), loadLogFile},
+        {tr("Microchip Log (*.can *.CAN *.log *.LOG)"), loadMicrochipFile},
+        {tr("Vector trace files (*.trace *.TRACE)"), loadTraceFile},
+        {tr("IXXAT MiniLog (*.csv *.CSV)"), loadIXXATFile},
+        {tr("CAN-DO Log (*.avc *.can *.evc *.qcc *.AVC *.CAN *.EVC *.QCC)"), loadCANDOFile},
+        {tr("Vehicle Spy (*.csv *.CSV)"), loadVehicleSpyFile},
+        {tr("Candump/Kayak (*.log *.LOG)"), loadCanDumpFile},
+        {tr("CANDump Lawicel (*.txt *.TXT *.LOG *.log)"), loadLawicelFile},
+        {tr("PCAN Viewer (*.trc *.TRC)"), loadPCANFile},
+        {tr("Kvaser Log Decimal (*.txt *.TXT)"), loadKvaserDecimalFile},
+        {tr("Kvaser Log Hex (*.txt *.TXT)"), loadKvaserHexFile},
+        {tr("CANalyzer Ascii Log (*.asc *.ASC)"), loadCanalyzerASC},
+        {tr("CANalyzer Binary Log Files (*.blf *.BLF)"), loadCanalyzerBLF},
+        {tr("CARBUS Analyzer Trace Files (*.trc *.TRC)"), loadCARBUSAnalyzerFile},
+        {tr("CANHacker Trace Files (*.trc *.TRC)"), loadCANHackerFile},
+        {tr("Generic ID/Data CSV (*.csv *.CSV)"), loadGenericCSVFile},
+        {tr("Cabana Log (*.csv *.CSV)"), loadCabanaFile},
+        {tr("CANOpen Magic (*.csv *.CSV)"), loadCANOpenFile},
+        {tr("CANOpenAnalyzer Capture (*.cancap)"), loadCaptureFile}
+    };
 
-    qDebug() << "Attempting vehicle spy";
-    if (isVehicleSpyFile(filename))
-    {
-        if (loadVehicleSpyFile(filename, frames))
-        {
-            qDebug() << "Loaded as vehicle spy successfully!";
-            return true;
-        }
-    }
+    QStringList filters;
+    for (const Format &format : formats) filters.append(format.filter);
 
-    qDebug() << "Attempting candump";
-    if (isCanDumpFile(filename))
-    {
-        if (loadCanDumpFile(filename, frames))
-        {
-            qDebug() << "Loaded as candump successfully!";
-            return true;
-        }
-    }
+    dialog.setDirectory(settings.value("FileIO/LoadSaveDirectory", dialog.directory().path()).toString());
+    dialog.setFileMode(QFileDialog::ExistingFile);
+    dialog.setNameFilters(filters);
+    dialog.setViewMode(QFileDialog::Detail);
 
-    qDebug() << "Attempting lawicel";
-    if (isLawicelFile(filename))
-    {
-        if (loadLawicelFile(filename, frames))
-        {
-            qDebug() << "Loaded as lawicel successfully!";
-            return true;
-        }
-    }
+    if (dialog.exec() != QDialog::Accepted) return false;
 
-    qDebug() << "Attempting 'CARBUS Analyzer'";
-    if (isCARBUSAnalyzerFile(filename))
-    {
-        if (loadCARBUSAnalyzerFile(filename, frames))
-        {
-            qDebug() << "Loaded as 'CARBUS Analyzer' successfully!";
-            return true;
-        }
-    }
+    filename = dialog.selectedFiles()[0];
+    loader = formats[qMax(0, filters.indexOf(dialog.selectedNameFilter()))].loader;
+    settings.setValue("FileIO/LoadSaveDirectory", dialog.directory().path());
+    return true;
+}
 
-    qDebug() << "Attempting canhacker";
-    if (isCANHackerFile(filename))
-    {
-        if (loadCANHackerFile(filename, frames))
-        {
-            qDebug() << "Loaded as CANHacker successfully!";
-            return true;
-        }
-    }
+bool FrameFileIO::loadFrameFile(QString &fileName, QVector<CANFrame>* frameCache)
+{
+    QString filename;
+    LoadFunction loader;
+    bool result = false;
 
-    qDebug() << "Attempting cabana";
-    if (isCabanaFile(filename))
-    {
-        if (loadCabanaFile(filename, frames))
-        {
-            qDebug() << "Loaded as Cabana successfully!";
-            return true;
-        }
-    }
+    if (!selectLoadFile(filename, loader)) return false;
 
-    qDebug() << "Attempting canopen";
-    if (isCANOpenFile(filename))
-    {
-        if (loadCANOpenFile(filename, frames))
-        {
-            qDebug() << "Loaded as CANOpen Magic successfully!";
-            return true;
-        }
-    }
+    QProgressDialog progress(qApp->activeWindow());
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setLabelText("Loading file...");
+    progress.setCancelButton(nullptr);
+    progress.setRange(0,0);
+    progress.setMinimumDuration(0);
+    progress.show();
 
-    qDebug() << "Attempting busmaster log";
-    if (isLogFile(filename))
+    qApp->processEvents();
     {
-        if (loadLogFile(filename, frames))
-        {
-            qDebug() << "Loaded as Busmaster Log successfully!";
-            return true;
-        }
+        TRACE_SCOPE("file load");
+        if (loader) result = loader(filename, frameCache);
+        else result = autoDetectLoadFile(filename, frameCache);
     }
 
-    qDebug() << "Attempting pcan";
-    if (isPCANFile(filename))
-    {
-        if (loadPCANFile(filename, frames))
-        {
-            qDebug() << "Loaded as PCAN successfully!";
-            return true;
-        }
-    }
+    progress.cancel();
 
-    qDebug() << "Attempting ixxat";
-    if (isIXXATFile(filename))
+    if (result)
     {
-        if (loadIXXATFile(filename, frames))
-        {
-            qDebug() << "Loaded as IXXAT successfully!";
-            return true;
-        }
+        QStringList fileList = filename.split('/');
+        fileName = fileList[fileList.length() - 1];
+        return true;
     }
 
-    qDebug() << "Attempting microchip";
-    if (isMicrochipFile(filename))
-    {
-        if (loadMicrochipFile(filename, frames))
-        {
-            qDebug() << "Loaded as microchip successfully!";
-            return true;
-        }
-    }
+    QMessageBox msgBox;
+    if (loader) msgBox.setText("File load completed with errors.\r\nPerhaps you selected the wrong file type?");
+    else msgBox.setText("Could not autodetect the file type.\rPlease try to manually select the file format.");
+    msgBox.exec();
+    return false;
+}
 
-    qDebug() << "Attempting CANDo";
-    if (isCANDOFile(filename))
-    {
-        if (loadCANDOFile(filename, frames))
-        {
-            qDebug() << "Loaded as CANDO successfully!";
-            return true;
-        }
-    }
 
-    qDebug() << "Attempting kvaser";
-    if (isKvaserFile(filename))
-    {
-        if (loadKvaserFile(filename, frames,true))
-        {
-            qDebug() << "Loaded as Kvaser HEX successfully!";
-            return true;
-        }
-        if (loadKvaserFile(filename, frames,false))
-        {
-            qDebug() << "Loaded as KVaser Decimal successfully!";
-            return true;
-        }
-    }
+//The start of the file is read once and every format check is run on it. The "is" functions are much less
+//tolerant than the load functions and so should help to discriminate whether a file could be loaded or not by a
+//given loader. The formats that match are tried from the most certain match down, the loader return is still
+//used in case the guess was wrong.
+bool FrameFileIO::autoDetectLoadFile(QString filename, QVector<CANFrame>* frames)
+{
+    QByteArray prefix;
+    if (!readFilePrefix(filename, prefix)) return false;
+    return loadDetectedFile(filename, detectFileFormats(prefix), frames);
+}
 
-    qDebug() << "Attempting generic CSV";
-    if (isGenericCSVFile(filename))
+//no check should see a line cut in half, so unless the whole file fits the prefix ends with the last complete line
+bool FrameFileIO::readFilePrefix(QString filename, QByteArray &prefix)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    prefix = file.read(DETECT_BYTES);
+    if (!file.atEnd())
     {
-        if (loadGenericCSVFile(filename, frames))
-        {
-            qDebug() << "Loaded as generic CSV successfully!";
-            return true;
-        }
+        int eol = prefix.lastIndexOf('\n');
+        if (eol >= 0) prefix.truncate(eol + 1);
     }
+    return true;
+}
 
-    QMessageBox msgBox;
-    msgBox.setText("Could not autodetect the file type.\rPlease try to manually select the file format.");
-    msgBox.exec();
-    qDebug() << "Nothing worked... sorry...";
-    return false;
+bool FrameFileIO::isCaptureFile(const QByteArray &prefix)
+{
+    return CaptureFile::isCaptureFile(prefix);
 }
 
 
-bool FrameFileIO::isVehicleSpyFile(QString filename)
+bool FrameFileIO::isVehicleSpyFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     bool foundProbableHeader = false;
     bool isMatch = false;
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try {
         for (int i = 0; i < 10; i++)
         {
-            if (!inFile->atEnd())
+            if (!inFile.atEnd())
             {
-                line = inFile->readLine().simplified().toUpper();
+                line = inFile.readLine().simplified().toUpper();
                 if (line.startsWith("LINE") && line.contains("TIME") && line.contains("B1"))
                 {
                     foundProbableHeader = true;
@@ -473,10 +541,10 @@ bool FrameFileIO::isVehicleSpyFile(QString filename)
         }
         if (foundProbableHeader)
         {
-            if (!inFile->atEnd())
+            if (!inFile.atEnd())
             {
-                line = inFile->readLine().simplified().toUpper();
-                inFile->close();
+                line = inFile.readLine().simplified().toUpper();
+                inFile.close();
                 QList<QByteArray> tokens = line.split(',');
                 if (tokens.length() > 20)
                 {
@@ -489,7 +557,7 @@ bool FrameFileIO::isVehicleSpyFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
+    inFile.close();
     return isMatch;
 }
 
@@ -497,101 +565,94 @@ bool FrameFileIO::isVehicleSpyFile(QString filename)
 //2,2550.368293675,0.003818174999651092,67371008,F,F,HS CAN $119,HS CAN,,119,F,F,00,00,00,00,00,00,0D,8B,,,
 //Line,Abs Time(Sec),Rel Time (Sec),Status,Er,Tx,Description,Network,Node,Arb ID,Remote,Xtd,B1,B2,B3,B4,B5,B6,B7,B8,Value,Trigger,Signals
 // 0       1             2             3   4  5   6             7     8     9     10     11 12 13 14 15 16 17 18 19  20     21      22
-bool FrameFileIO::loadVehicleSpyFile(QString filename, QVector<CANFrame> *frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    bool pastHeader = false;
-    bool foundErrors = false;
+namespace {
 
-    QDateTime now = QDateTime::currentDateTime();
-    QDateTime tempTime;
+//the frames follow the second header line that starts with "Line". Times are seconds into the log, they are put
+//after the time the file is loaded
+class VehicleSpyGrammar : public TextLogGrammar
+{
+public:
+    VehicleSpyGrammar() : now(QDateTime::currentDateTime().toMSecsSinceEpoch()) {}
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        qint64 pos = 0;
+        int headerLines = 0;
+        while (pos < size && headerLines < 2)
+        {
+            qint64 len = lineLength(data + pos, size - pos);
+            TextTokens tokens;
+            tokens.splitWhitespace(data + pos, data + pos + len);
+            if (tokens.count() > 0 && tokens.startsWith(0, "LINE")) headerLines++;
+            pos += len;
+        }
+        return pos;
     }
 
-    while (!inFile->atEnd() && !pastHeader)
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
     {
-        line = inFile->readLine().simplified().toUpper();
-        if (line.startsWith("LINE")) lineCounter++;
-        if (lineCounter == 2) pastHeader = true;
-    }
+        TextTokens tokens;
+        tokens.split(begin, end, ',');
+        if (tokens.count() <= 20) return LINE_ERROR;
 
-    if (inFile->atEnd()) foundErrors = true;
+        uint64_t value;
+        tokens.toSecondsUs(1, value);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, (now + static_cast<qint64>(value / 1000)) * 1000));
+        frame.isReceived = (tokens.first(5) != 'T' && tokens.first(5) != 't');
+        tokens.toHex(9, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(tokens.first(11) == 'T' || tokens.first(11) == 't');
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-        line = inFile->readLine().simplified().toUpper();
-
-        QList<QByteArray> tokens = line.split(',');
-        if (tokens.length() > 20)
-        {
-            thisFrame.bus = 0;
-            thisFrame.setFrameType(QCanBusFrame::DataFrame);
-            tempTime = now;
-            tempTime = tempTime.addMSecs(static_cast<int64_t>(tokens[1].toDouble() * 1000.0));
-            thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<uint64_t>(tempTime.toMSecsSinceEpoch() * 1000)));
-            if (tokens[5].startsWith("T")) thisFrame.isReceived = false;
-                else thisFrame.isReceived = true;
-            thisFrame.setFrameId(static_cast<uint32_t>(tokens[9].toInt(nullptr, 16)));
-            if (tokens[11].startsWith("T")) thisFrame.setExtendedFrameFormat(true);
-                else thisFrame.setExtendedFrameFormat(false);
-            QByteArray bytes;
-            for (int i = 0; i < 8; i++)
-            {
-                if (tokens[12 + i].length() > 0)
-                {
-                    bytes.append(static_cast<char>(tokens[12 + i].toInt(nullptr, 16)));
-                }
-                else break;
-            }
-            thisFrame.setPayload(bytes);
-            frames->append(thisFrame);
+        unsigned char bytes[8];
+        int len = 0;
+        while (len < 8 && tokens.length(12 + len) > 0)
+        {
+            tokens.toHex(12 + len, value);
+            bytes[len++] = static_cast<unsigned char>(value);
         }
-        else foundErrors = true;
+        frame.setPayload(bytes, len);
+        return LINE_FRAME;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+    //a file that ends with the header is broken
+    bool requiresFrames() const override { return true; }
+
+private:
+    qint64 now; //ms since the epoch
+};
+
+}
+
+bool FrameFileIO::loadVehicleSpyFile(QString filename, QVector<CANFrame> *frames)
+{
+    TextLogReader reader(new VehicleSpyGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::saveVehicleSpyFile(QString filename, const QVector<CANFrame> *frames)
+bool FrameFileIO::saveVehicleSpyFile(QString filename, const CANFrameView *frames)
 {
     Q_UNUSED(filename);
     Q_UNUSED(frames);
     return true;
 }
 
-bool FrameFileIO::isCRTDFile(QString filename)
+bool FrameFileIO::isCRTDFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = false;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        line = inFile->readLine().toUpper(); //read out the header first and discard it.
+        line = inFile.readLine().toUpper(); //read out the header first and discard it.
 
-        while (!inFile->atEnd() && lineCounter < 100) {
+        while (!inFile.atEnd() && lineCounter < 100) {
             lineCounter++;
-            line = inFile->readLine().simplified();
+            line = inFile.readLine().simplified();
             if (line.length() > 2)
             {
                 QList<QByteArray> tokens = line.split(' ');
@@ -618,8 +679,7 @@ bool FrameFileIO::isCRTDFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -650,111 +710,90 @@ tokens:
 2 = ID
 3-x = The data bytes
 */
-bool FrameFileIO::loadCRTDFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    bool foundErrors = false;
+namespace {
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+//CRTD: "<time> [bus]R11|R29|T11|T29 <id> <data bytes>". Other record types (comments, events) are skipped
+class CRTDGrammar : public TextLogGrammar
+{
+public:
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        return lineLength(data, size);
     }
 
-    line = inFile->readLine().toUpper(); //read out the header first and discard it.
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.splitWhitespace(begin, end);
+        if (tokens.count() < 3)
+        {
+            if (tokens.count() == 0 || tokens.end(tokens.count() - 1) - tokens.begin(0) <= 2) return LINE_SKIP;
+            return LINE_ERROR;
+        }
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
+        //a decimal point means seconds. Without one the time is already in microseconds
+        uint64_t value;
+        if (memchr(tokens.begin(0), '.', static_cast<size_t>(tokens.length(0)))) tokens.toSecondsUs(0, value);
+        else tokens.toUInt(0, value);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value)));
+
+        const char *type = tokens.begin(1);
+        frame.bus = 0;
+        if (*type >= '1' && *type <= '9') //leading digit is the bus number
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            frame.bus = *type - '1';
+            type++;
         }
-        line = inFile->readLine().simplified();
-        if (line.length() > 2)
+        if (type == tokens.end(1) || (*type != 'R' && *type != 'T')) return LINE_SKIP;
+
+        int typeLen = static_cast<int>(tokens.end(1) - type);
+        frame.isReceived = (*type != 'T');
+        tokens.toHex(2, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        if (typeLen == 3 && type[1] == '2' && type[2] == '9') frame.setExtendedFrameFormat(true);
+        else frame.setExtendedFrameFormat(false);
+
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        int len = qMin(tokens.count() - 3, CANFRAME_MAX_PAYLOAD);
+        for (int d = 0; d < len; d++)
         {
-            QList<QByteArray> tokens = line.split(' ');
-            int multiplier;
-            if (tokens.length() > 2)
-            {
-                int idxOfDecimal = tokens[0].indexOf('.');
-                if (idxOfDecimal > -1) {
-                    //int decimalPlaces = tokens[0].length() - tokens[0].indexOf('.') - 1;
-                    //the result of the above is the # of digits after the decimal.
-                    //This program deals in microsecond so turn the value into microseconds
-                    multiplier = 1000000; //turn the decimal into full microseconds
-                }
-                else
-                {
-                    multiplier = 1; //special case. Assume no decimal means microseconds
-                }
-                //qDebug() << "decimal places " << decimalPlaces;
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<int64_t>((tokens[0].toDouble() * multiplier))));
-                thisFrame.bus = 0;
-                char firstChar = tokens[1].left(1)[0];
-                if (firstChar >= '1' && firstChar <= '9')
-                {
-                    thisFrame.bus = tokens[1].left(1)[0] - '1';
-                    tokens[1].remove(0,1); // Remove leading digit (bus number)
-                    firstChar = tokens[1].left(1)[0];
-                }
-                if (firstChar == 'R' || firstChar == 'T')
-                {
-                    thisFrame.setFrameId(static_cast<uint32_t>(tokens[2].toInt(nullptr, 16)));
-                    if (tokens[1] == "R29" || tokens[1] == "T29") thisFrame.setExtendedFrameFormat(true);
-                        else thisFrame.setExtendedFrameFormat(false);
-                    if (firstChar == 'T') thisFrame.isReceived = false;
-                        else thisFrame.isReceived = true;
-                    QByteArray bytes(tokens.length() - 3, 0);
-                    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                    for (int d = 0; d < bytes.length(); d++)
-                    {
-                        if (tokens[d + 3] != "")
-                        {
-                            bytes[d] = static_cast<char>(tokens[d + 3].toInt(nullptr, 16));
-                        }
-                        else bytes[d] = 0;
-                    }
-                    thisFrame.setPayload(bytes);
-                    frames->append(thisFrame);
-                }
-            }
-            else foundErrors = true;
+            tokens.toHex(d + 3, value);
+            bytes[d] = static_cast<unsigned char>(value);
         }
+        frame.setPayload(bytes, len);
+        return LINE_FRAME;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+};
+
+}
+
+bool FrameFileIO::loadCRTDFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new CRTDGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isCARBUSAnalyzerFile(QString filename)
+bool FrameFileIO::isCARBUSAnalyzerFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
 
     bool isMatch = false;
 
     // not Text mode because file contains `\r` new lines
-    if (!inFile->open(QIODevice::ReadOnly))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly)) return false;
     try
     {
         //read header
-        line = inFile->readLine().toUpper();
+        line = inFile.readLine().toUpper();
         if (line.startsWith("@ TEXT @")) return true;
     } catch (...)
     {
         isMatch = false;
     }
 
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -765,107 +804,89 @@ bool FrameFileIO::isCARBUSAnalyzerFile(QString filename)
 //14,687	1	0004	4E0	8	24 00 00 00 00 00 00 00	00000000	$
 // timestamp: sec,ms - for version 2
 //            sec,us - for version 3
-bool FrameFileIO::loadCARBUSAnalyzerFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    if (!inFile->open(QIODevice::ReadOnly))
-    {
-        delete inFile;
-        return false;
-    }
-
-    CANFrame thisFrame;
-    QString line;
-    int lineCounter = 0;
-    bool foundErrors = false;
-
-    // readLine() works only with "\n" and "\r\n"
-    QString localReadAll = inFile->readAll().replace("\r", "\r\n");
+namespace {
 
-    QTextStream txt(&localReadAll);
+//lines end with a bare '\r'. The version in the header line says whether the fraction of the time is ms or us
+class CARBUSAnalyzerGrammar : public TextLogGrammar
+{
+public:
+    CARBUSAnalyzerGrammar() : version(3) {} //current default
 
-    line = txt.readLine().toUpper(); //read out the header
+    char lineEnd() const override { return '\r'; }
 
-    int version = 3; // current default
-    QRegularExpression re("@ TEXT @ (?<version>\\d) @.*");
-    QRegularExpressionMatch match = re.match(line);
-    if (match.hasMatch()) {
-        version = match.captured("version").toInt();
+    qint64 headerLength(const char *data, qint64 size) override
+    {
+        qint64 len = lineLength(data, size, '\r');
+        TextTokens tokens;
+        tokens.splitWhitespace(data, data + len);
+        uint64_t value;
+        if (tokens.count() > 4 && tokens.equals(0, "@") && tokens.equals(1, "TEXT") && tokens.equals(2, "@")
+                && tokens.length(3) == 1 && tokens.toUInt(3, value))
+        {
+            version = static_cast<int>(value);
+        }
+        return len;
     }
 
-    while (!txt.atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.splitWhitespace(begin, end);
+        if (tokens.count() == 0 || tokens.end(tokens.count() - 1) - tokens.begin(0) <= 2) return LINE_SKIP;
+        if (tokens.count() <= 3) return LINE_ERROR;
+
+        //"14,687" is the time with the comma taken out
+        uint64_t timeStamp = 0;
+        for (const char *c = tokens.begin(0); c < tokens.end(0); c++)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            if (*c >= '0' && *c <= '9') timeStamp = timeStamp * 10 + static_cast<uint64_t>(*c - '0');
         }
-        line = txt.readLine().simplified();
-        if (line.length() > 2)
-        {
-            QList<QString> tokens = line.split(QRegExp("\\s+"));
-            if (tokens.length() > 3)
-            {
-                QString time = tokens[0].replace(",", "");
-                int64_t timeStamp = time.toInt();
-                if (version == 2) {
-                    timeStamp *= 1000; // ms -> us
-                }
+        if (version == 2) timeStamp *= 1000; // ms -> us
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(timeStamp)));
 
-                thisFrame.isReceived = true;
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<int64_t>(timeStamp)));
-                thisFrame.bus = tokens[1].toInt();
-                thisFrame.setFrameId(static_cast<uint32_t>(tokens[3].toInt(nullptr, 16)));
-                thisFrame.setExtendedFrameFormat(thisFrame.frameId() > 0x7FF);
-                int numBytes = tokens[4].toInt(nullptr, 16);
-                QByteArray bytes(numBytes , 0);
-                for (int d = 0; d < numBytes; d++)
-                {
-                    if (tokens[d + 5] != "")
-                    {
-                        bytes[d] = static_cast<unsigned char>(tokens[d + 5].toInt(nullptr, 16));
-                    }
-                    else bytes[d] = 0;
-                }
-                thisFrame.setPayload(bytes);
-                frames->append(thisFrame);
-            }
-            else
-            {
-                foundErrors = true;
-            }
+        uint64_t value;
+        tokens.toInt(1, frame.bus);
+        tokens.toHex(3, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
+
+        LineResult result = LINE_FRAME;
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        tokens.toHex(4, value);
+        int numBytes = static_cast<int>(qMin(value, static_cast<uint64_t>(CANFRAME_MAX_PAYLOAD)));
+        for (int d = 0; d < numBytes; d++)
+        {
+            value = 0;
+            if (d + 5 < tokens.count()) tokens.toHex(d + 5, value);
+            else result = LINE_DAMAGED;
+            bytes[d] = static_cast<unsigned char>(value);
         }
+        frame.setPayload(bytes, numBytes);
+        return result;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+private:
+    int version;
+};
+
 }
 
-bool FrameFileIO::saveCARBUSAnalzyer(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadCARBUSAnalyzerFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        delete outFile;
-        return false;
-    }
-    QTextStream outTextStream(outFile);
+    TextLogReader reader(new CARBUSAnalyzerGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-    int lineCounter = 0;
+namespace {
 
-    qint64 minTime = frames->at(0).timeStamp().microSeconds();
-    qint64 maxTime = minTime;
-    for (int c = 0; c < frames->count(); c++)
-    {
-        if (frames->at(c).timeStamp().microSeconds() < minTime) minTime = frames->at(c).timeStamp().microSeconds();
-        if (frames->at(c).timeStamp().microSeconds() > maxTime) maxTime = frames->at(c).timeStamp().microSeconds();
-    }
-    qint64 totalTime = maxTime - minTime;
-    // looks like a bug in CARBUS format for 3 version. time is in ms, while packets in us.
-    totalTime /= 1000;
-    QTime someTime(0,0,0);
-    someTime = someTime.addMSecs(totalTime);
+//version 3 of the format, times in seconds and microseconds. Lines end with a bare '\r'
+class CARBUSAnalyzerWriter : public TextFrameWriter
+{
+public:
+    CARBUSAnalyzerWriter() : count(0), minTime(0), maxTime(0) {}
+
+protected:
+    bool headerHasTotals() const override { return true; }
 
     // header:
     // @see #loadCARBUSAnalyzer()
@@ -873,93 +894,87 @@ bool FrameFileIO::saveCARBUSAnalzyer(QString filename, const QVector<CANFrame>*
     // 15688 = max time - start time  in ms
     //
     // "@ TEXT @ 3 @ 64 @ 0 @ 14012 @ 15688 @ 00:00:15.688 @"
-    // saving in version format 3 with microseconds in packets time
-    outTextStream << "@ TEXT @ 3 @ 64 @ 0 @ " << frames->count() <<  " @ " << totalTime
-                  <<" @ " << someTime.toString("hh:mm:ss.zzz") <<" @\r";
-
-    const unsigned char *data;
-    for (int c = 0; c < frames->count(); c++)
-    {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-        auto frame = frames->at(c);
-
-        uint64_t timeStamp = frame.timeStamp().microSeconds();
-        QString canId = QString::number(frame.frameId(), 16).toUpper().rightJustified(3, '0').toUtf8();
-        QString canDlc = QString::number(frame.payload().length()).toUtf8();
+    // The totals are padded with spaces as the header goes out again at the same length once they are known
+    void appendHeader(QByteArray &out, const CANFrame *first) override
+    {
+        Q_UNUSED(first);
+        // looks like a bug in CARBUS format for 3 version. time is in ms, while packets in us.
+        int64_t totalTime = (maxTime - minTime) / 1000;
+        QTime someTime(0,0,0);
+        someTime = someTime.addMSecs(static_cast<int>(totalTime));
+        out.append("@ TEXT @ 3 @ 64 @ 0 @ ");
+        out.append(QByteArray::number(static_cast<qulonglong>(count)).rightJustified(10, ' '));
+        out.append(" @ ");
+        out.append(QByteArray::number(static_cast<qlonglong>(totalTime)).rightJustified(10, ' '));
+        out.append(" @ ");
+        out.append(someTime.toString("hh:mm:ss.zzz").toUtf8());
+        out.append(" @\r");
+    }
+
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
+    {
+        int64_t time = static_cast<int64_t>(frame.timestamp);
+        if (count == 0 || time < minTime) minTime = time;
+        if (count == 0 || time > maxTime) maxTime = time;
+        count++;
+
+        out.append(QByteArray::number(static_cast<qulonglong>(frame.timestamp / 1000000)));
+        out.append(',');
+        out.append(QByteArray::number(static_cast<qulonglong>(frame.timestamp % 1000000)).rightJustified(6, '0'));
+        out.append('\t');
+        out.append(QByteArray::number(frame.bus)); // bus channel
+        out.append("\t0004\t"); // it's CAN frame
+        appendHex(out, frame.frameId(), 3);
+        out.append('\t');
+        out.append(QByteArray::number(frame.payloadLength()));
+        out.append('\t');
+
+        QByteArray canData;
+        QByteArray ascii;
+        for (int d = 0; d < frame.payloadLength(); d++)
+        {
+            unsigned char octet = frame.payloadData()[d];
+            if (d) canData.append(' ');
+            appendHex(canData, octet, 2);
+            ascii.append((octet >= 32 && octet < 126) ? static_cast<char>(octet) : ' ');
+        }
+        out.append(canData.leftJustified(23, ' '));
+        out.append("\t00000000\t");
+        out.append(ascii.leftJustified(8, ' '));
+        out.append("\t\r");
+    }
+
+private:
+    uint64_t count;
+    int64_t minTime;
+    int64_t maxTime;
+};
 
-        QString ascii = "";
-        QString finalCanData;
-
-        data = reinterpret_cast<const unsigned char *>(frame.payload().constData());
-        for (int d = 0; d < frame.payload().length(); d++)
-        {
-            auto octet = data[d];
-            finalCanData.append(QString::number(octet, 16).toUpper().rightJustified(2, '0').toUtf8());
-            finalCanData.append(" ");
-
-            QString strCode = QString::number(octet, 16);
-            bool conv;
-            uint symbolCode = strCode.toInt(&conv, 16);
-
-            if ((symbolCode >= 32 && symbolCode < 126)) {
-                QChar localQChar = QChar(symbolCode);
-                if (localQChar.toLatin1() != 0) {
-                   ascii += QString::fromLocal8Bit(QByteArray::fromHex(strCode.toLatin1()));
-              }
-            } else {
-                ascii += " ";
-            }
-        }
-        finalCanData = finalCanData.trimmed().leftJustified(23, ' ');
-        ascii = ascii.leftJustified(8, ' ');
-        auto seconds = QString::number(timeStamp / 1000000);
-        auto uSeconds = QString::number(timeStamp % 1000000);
-        QString localArg = "";
-        localArg.append(seconds).append(",").append(uSeconds).append("\t")
-                .append(QString::number(frame.bus)).append("\t") // bus channel
-                .append("0004").append("\t") // it's CAN frame
-                .append(canId).append("\t")
-                .append(canDlc).append("\t")
-                .append(finalCanData).append("\t")
-                .append("00000000").append("\t")
-                .append(ascii).append("\t")
-                .append("\r");
-
-        qDebug() << localArg;
-        outTextStream << localArg;
-    }
-
-    outFile->close();
-    delete outFile;
+}
 
-    return true;
+bool FrameFileIO::saveCARBUSAnalzyer(QString filename, const CANFrameView* frames)
+{
+    CARBUSAnalyzerWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
-bool FrameFileIO::isCANHackerFile(QString filename)
+bool FrameFileIO::isCANHackerFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = false;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        line = inFile->readLine().toUpper(); //read out the header first and discard it.
+        line = inFile.readLine().toUpper(); //read out the header first and discard it.
         if (line.contains("CANHACKER")) return true;
 
-        while (!inFile->atEnd()) {
+        while (!inFile.atEnd()) {
             lineCounter++;
-            line = inFile->readLine().simplified();
+            line = inFile.readLine().simplified();
             if (line.length() > 2)
             {
                 QList<QByteArray> tokens = line.split(' ');
@@ -983,113 +998,90 @@ bool FrameFileIO::isCANHackerFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
 // CANHacker trace format
 // Time   ID     DLC Data                    Comment
 // 00.000 00004000 8 36 47 19 43 01 00 00 80 
-bool FrameFileIO::loadCANHackerFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    bool foundErrors = false;
+namespace {
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+//"<time> <id> <len> <data bytes>" after a header line. Time is seconds, or microseconds if there's no decimal point
+class CANHackerGrammar : public TextLogGrammar
+{
+public:
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        return lineLength(data, size);
     }
 
-    line = inFile->readLine().toUpper(); //read out the header first and discard it.
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.splitWhitespace(begin, end);
+        if (tokens.count() == 0 || tokens.end(tokens.count() - 1) - tokens.begin(0) <= 2) return LINE_SKIP;
+        if (tokens.count() <= 3) return LINE_ERROR;
+
+        uint64_t value;
+        if (memchr(tokens.begin(0), '.', static_cast<size_t>(tokens.length(0)))) tokens.toSecondsUs(0, value);
+        else tokens.toUInt(0, value);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value)));
+        tokens.toHex(1, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-        line = inFile->readLine().simplified();
-        if (line.length() > 2)
+        LineResult result = LINE_FRAME;
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        tokens.toHex(2, value);
+        int numBytes = static_cast<int>(qMin(value, static_cast<uint64_t>(CANFRAME_MAX_PAYLOAD)));
+        for (int d = 0; d < numBytes; d++)
         {
-            QList<QByteArray> tokens = line.split(' ');
-            int multiplier;
-            if (tokens.length() > 3)
-            {
-                int idxOfDecimal = tokens[0].indexOf('.');
-                if (idxOfDecimal > -1) {
-                    //int decimalPlaces = tokens[0].length() - tokens[0].indexOf('.') - 1;
-                    //the result of the above is the # of digits after the decimal.
-                    //This program deals in microsecond so turn the value into microseconds
-                    multiplier = 1000000; //turn the decimal into full microseconds
-                }
-                else
-                {
-                    multiplier = 1; //special case. Assume no decimal means microseconds
-                }
-                //qDebug() << "decimal places " << decimalPlaces;
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<uint64_t>(tokens[0].toDouble() * multiplier)));
-                thisFrame.setFrameId( static_cast<uint32_t>(tokens[1].toInt(nullptr, 16)) );
-                thisFrame.setExtendedFrameFormat((thisFrame.frameId() > 0x7FF));
-                thisFrame.isReceived = true;
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                thisFrame.bus = 0;
-                int numBytes = tokens[2].toInt(nullptr, 16);
-                QByteArray bytes( numBytes, 0);
-                for (int d = 0; d < numBytes; d++)
-                {
-                    if (tokens[d + 3] != "")
-                    {
-                        bytes[d] = static_cast<char>(tokens[d + 3].toInt(nullptr, 16));
-                    }
-                    else bytes[d] = 0;
-                }
-                thisFrame.setPayload(bytes);
-                frames->append(thisFrame);
-            }
-            else foundErrors = true;
+            value = 0;
+            if (d + 3 < tokens.count()) tokens.toHex(d + 3, value);
+            else result = LINE_DAMAGED;
+            bytes[d] = static_cast<unsigned char>(value);
         }
+        frame.setPayload(bytes, numBytes);
+        return result;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+};
+
+}
+
+bool FrameFileIO::loadCANHackerFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new CANHackerGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isCANOpenFile(QString filename)
+bool FrameFileIO::isCANOpenFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = false;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        line = inFile->readLine().toUpper();
+        line = inFile.readLine().toUpper();
         if (!line.contains("CANOPEN MAGIC")) return false;
-        line = inFile->readLine();
-        line = inFile->readLine();
-        line = inFile->readLine();
-        line = inFile->readLine();
+        line = inFile.readLine();
+        line = inFile.readLine();
+        line = inFile.readLine();
+        line = inFile.readLine();
 
-        while (!inFile->atEnd()) {
+        while (!inFile.atEnd()) {
             lineCounter++;
             if (lineCounter > 10)
             {
                 break;
             }
 
-            line = inFile->readLine().replace('\"', ' ').simplified();
+            line = inFile.readLine().replace('\"', ' ').simplified();
             if (line.length() > 2)
             {
                 QList<QByteArray> tokens = line.split(',');
@@ -1109,160 +1101,129 @@ bool FrameFileIO::isCANOpenFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
 //"Message Number","Time (ms)","Time","Excel Time","Count","ID","Flags","Message Type","Node","Details","Process Data","Data (Hex)","Data (Text)","Data (Decimal)","Length","Raw Message"
 //"0","0.000","8:09:42:48.7953090'",43447.7100146116,"","0x2E1","","Default: PDO","","Default: TPDO 2 of Node 0x61 (97)","","10 21 04 00 00 00 00 00 ",". ! . . . . . . ","U:0 S:0","8","10 21 04 00 00 00 00 00"
-bool FrameFileIO::loadCANOpenFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    bool foundErrors = false;
-
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        qDebug() << "Could not open the file!";
-        return false;
-    }
+namespace {
 
-    line = inFile->readLine(); //read out the header first and discard it.
-    line = inFile->readLine();
-    line = inFile->readLine();
-    line = inFile->readLine();
-    line = inFile->readLine();
-
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
+//every field is quoted and there are five header lines. Time is in ms, the ID is hex with 0x or decimal
+class CANOpenGrammar : public TextLogGrammar
+{
+public:
+    qint64 headerLength(const char *data, qint64 size) override
+    {
+        qint64 pos = 0;
+        for (int line = 0; line < 5 && pos < size; line++) pos += lineLength(data + pos, size - pos);
+        return pos;
+    }
+
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.split(begin, end, ',');
+        if (tokens.count() == 0 || tokens.end(tokens.count() - 1) - tokens.begin(0) <= 2) return LINE_SKIP;
+        if (tokens.count() <= 11) return LINE_ERROR;
+
+        uint64_t value;
+        const char *b = tokens.begin(1);
+        const char *e = tokens.end(1);
+        unquote(b, e);
+        TextTokens::parseSecondsUs(b, e, value);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value / 1000)));
+        b = tokens.begin(5);
+        e = tokens.end(5);
+        unquote(b, e);
+        frame.setFrameId(static_cast<uint32_t>(parseNumber(b, e)));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
+
+        b = tokens.begin(11);
+        e = tokens.end(11);
+        unquote(b, e);
+        TextTokens dataTok;
+        dataTok.splitWhitespace(b, e);
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        int numBytes = qMin(dataTok.count(), CANFRAME_MAX_PAYLOAD);
+        for (int d = 0; d < numBytes; d++)
+        {
+            dataTok.toHex(d, value);
+            bytes[d] = static_cast<unsigned char>(value);
+        }
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
+    }
+};
 
-        line = inFile->readLine().replace('\"', ' ').simplified();
-        if (line.length() > 2)
-        {
-            QList<QByteArray> tokens = line.split(',');
-            if (tokens.length() > 11)
-            {
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<uint64_t>(tokens[1].simplified().toDouble() * 1000.0)));
-                thisFrame.setFrameId(static_cast<uint32_t>(Utility::ParseStringToNum(tokens[5].simplified())));
-                thisFrame.setExtendedFrameFormat( (thisFrame.frameId() > 0x7FF) );
-                thisFrame.isReceived = true;
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                thisFrame.bus = 0;
-                QList<QByteArray> dataTok = tokens[11].simplified().split(' ');
-                QByteArray bytes(dataTok.length(), 0);
-                for (int d = 0; d < dataTok.length(); d++)
-                {
-                    if (dataTok[d] != "")
-                    {
-                        bytes[d] = static_cast<char>(dataTok[d].simplified().toInt(nullptr, 16));
-                    }
-                    else bytes[d] = 0;
-                }
-                thisFrame.setPayload(bytes);
-                frames->append(thisFrame);
-            }
-            else foundErrors = true;
-        }
-    }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
 }
 
-bool FrameFileIO::saveCRTDFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadCANOpenFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    int lineCounter = 0;
+    TextLogReader reader(new CANOpenGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
+namespace {
 
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
+class CRTDWriter : public TextFrameWriter
+{
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
     {
-        delete outFile;
-        return false;
+        appendSeconds(out, first ? static_cast<int64_t>(first->timestamp) : 0, 6);
+        out.append(FrameFileIO::tr(" CXX GVRET-PC Reverse Engineering Tool Output V").toUtf8());
+        out.append(QByteArray::number(VERSION));
+        out.append('\n');
     }
 
-    //write in float format with 6 digits after the decimal point
-    outFile->write(QString::number(frames->at(0).timeStamp().microSeconds() / 1000000.0, 'f', 6).toUtf8() + tr(" CXX GVRET-PC Reverse Engineering Tool Output V").toUtf8() + QString::number(VERSION).toUtf8());
-    outFile->write("\n");
-
-    for (int c = 0; c < frames->count(); c++)
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-        outFile->write(QString::number(frame->timeStamp().microSeconds() / 1000000.0, 'f', 6).toUtf8());
-        outFile->putChar(' ');
-
-        outFile->write(QString::number(frame->bus + 1).toUtf8());
-        if (frame->isReceived) outFile->putChar('R');
-        else outFile->putChar('T');
-
-        if (frame->hasExtendedFrameFormat())
-        {
-            outFile->write("29 ");
-        }
-        else outFile->write("11 ");
-        outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8());
-        outFile->putChar(' ');
-
-        for (int temp = 0; temp < dataLen; temp++)
+        appendSeconds(out, static_cast<int64_t>(frame.timestamp), 6);
+        out.append(' ');
+        out.append(QByteArray::number(frame.bus + 1));
+        out.append(frame.isReceived ? 'R' : 'T');
+        out.append(frame.hasExtendedFrameFormat() ? "29 " : "11 ");
+        appendHex(out, frame.frameId(), 8);
+        out.append(' ');
+        for (int temp = 0; temp < frame.payloadLength(); temp++)
         {
-            outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            outFile->putChar(' ');
+            appendHex(out, frame.payloadData()[temp], 2);
+            out.append(' ');
         }
-
-        outFile->write("\n");
+        out.append('\n');
     }
-    outFile->close();
-    delete outFile;
+};
 
-    return true;
+}
+
+bool FrameFileIO::saveCRTDFile(QString filename, const CANFrameView* frames)
+{
+    CRTDWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
 
-bool FrameFileIO::isPCANFile(QString filename)
+bool FrameFileIO::isPCANFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     int fileVersion = 1;
     bool isMatch = false;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        while (!inFile->atEnd()) {
+        while (!inFile.atEnd()) {
             lineCounter++;
             if (lineCounter > 10)
             {
                 break;
             }
-            line = inFile->readLine();
+            line = inFile.readLine();
             if (line.startsWith(";$FILEVERSION=2.0")) fileVersion = 2;
             if (line.startsWith(';')) continue;
             if (line.length() > 41)
@@ -1300,8 +1261,7 @@ bool FrameFileIO::isPCANFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -1329,133 +1289,108 @@ bool FrameFileIO::isPCANFile(QString filename)
   It seems as if Version 2 files might be able to store other protocols like ISO-TP or J1939
 */
 
-bool FrameFileIO::loadPCANFile(QString filename, QVector<CANFrame>* frames)
+namespace {
+
+class PCANGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    int fileVersion = 1;
-    bool foundErrors = false;
+public:
+    PCANGrammar() : fileVersion(1) {}
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+    //the ';' comment lines at the start, one of them may say the file is version 2.0
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        static const char versionTag[] = ";$FILEVERSION=2.0";
+        qint64 pos = 0;
+        while (pos < size && data[pos] == ';')
+        {
+            qint64 len = lineLength(data + pos, size - pos);
+            if (len >= static_cast<qint64>(sizeof(versionTag) - 1) && memcmp(data + pos, versionTag, sizeof(versionTag) - 1) == 0) fileVersion = 2;
+            pos += len;
+        }
+        return pos;
     }
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        if (end - begin < 41 || *begin == ';') return LINE_SKIP;
+
+        //where the columns are in the two versions
+        const bool v2 = (fileVersion == 2);
+        const int idPos = v2 ? 25 : 28;
+        const int dataPos = v2 ? 40 : 41;
+
+        uint64_t value;
+        const char *b = begin;
+        const char *e = end;
+        lineColumn(b, e, idPos, 8);
+        TextTokens::parseHex(b, e, value);
+        if (value >= 0x1FFFFFFF) return LINE_SKIP;
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(begin[idPos] != ' ');
+
+        b = begin;
+        e = end;
+        lineColumn(b, e, v2 ? 8 : 10, v2 ? 13 : 8);
+        TextTokens::parseSecondsUs(b, e, value); //in ms
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value / 1000)));
+
+        b = begin;
+        e = end;
+        lineColumn(b, e, v2 ? 37 : 38, v2 ? 2 : 1);
+        TextTokens::parseUInt(b, e, value);
+        int numBytes = static_cast<int>(qMin(value, static_cast<uint64_t>(CANFRAME_MAX_PAYLOAD)));
+
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        memset(bytes, 0, sizeof(bytes));
+        if (end - begin > dataPos && begin[dataPos] == 'R')
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
         }
-        line = inFile->readLine();
-        if (line.startsWith(";$FILEVERSION=2.0")) fileVersion = 2;
-        if (line.startsWith(';')) continue;
-        if (line.length() > 41)
+        else
         {
-            if (fileVersion == 1)
-            {
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, (uint64_t)(line.mid(10, 8).simplified().toDouble() * 1000.0)));
-                thisFrame.setFrameId(line.mid(28, 8).simplified().toUInt(nullptr, 16));
-                if (thisFrame.frameId() < 0x1FFFFFFF)
-                {
-                    int numBytes = line.mid(38,1).toInt();
-                    QByteArray bytes(numBytes, 0);
-                    thisFrame.isReceived = true;
-                    thisFrame.bus = 0;
-                    if (line.at(28) == ' ') {
-                        thisFrame.setExtendedFrameFormat(false);
-                    } else {
-                        thisFrame.setExtendedFrameFormat(true);
-                    }
-
-                    if (line.at(41) == 'R') {
-                        thisFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                    } else {
-                        QList<QByteArray> tokens = line.mid(41, numBytes * 3).split(' ');
-                        thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                        for (int d = 0; d < numBytes; d++)
-                        {
-                            if (tokens[d] != "")
-                            {
-                                bytes[d] = static_cast<char>(tokens[d].toInt(nullptr, 16));
-                            }
-                            else bytes[d] = 0;
-                        }
-                    }
-                    thisFrame.setPayload(bytes);
-                    frames->append(thisFrame);
-                }
-            }
-            else if (fileVersion == 2)
+            b = begin;
+            e = end;
+            lineColumn(b, e, dataPos, numBytes * 3);
+            TextTokens tokens;
+            tokens.splitWhitespace(b, e);
+            for (int d = 0; d < numBytes && d < tokens.count(); d++)
             {
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<uint64_t>(line.mid(8, 13).simplified().toDouble() * 1000.0)));
-                thisFrame.setFrameId(line.mid(25, 8).simplified().toUInt(nullptr, 16));
-                if (thisFrame.frameId() < 0x1FFFFFFF)
-                {
-                    int numBytes = line.mid(37,2).trimmed().toInt();
-                    QByteArray bytes(numBytes, 0);
-                    qDebug() << thisFrame.payload().length();
-                    thisFrame.isReceived = true;
-                    thisFrame.bus = 0;
-                    if (line.at(25) == ' ') {
-                        thisFrame.setExtendedFrameFormat(false);
-                    } else {
-                        thisFrame.setExtendedFrameFormat(true);
-                    }
-                    if (line.at(40) == 'R') {
-                        thisFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                    } else {
-                        QList<QByteArray> tokens = line.mid(40, thisFrame.payload().length() * 3).split(' ');
-                        thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                        for (int d = 0; d < numBytes; d++)
-                        {
-                            if (tokens[d] != "")
-                            {
-                                bytes[d] = static_cast<char>(tokens[d].toInt(nullptr, 16));
-                            }
-                            else bytes[d] = 0;
-                        }
-                    }
-                    thisFrame.setPayload(bytes);
-                    frames->append(thisFrame);
-                }
+                tokens.toHex(d, value);
+                bytes[d] = static_cast<unsigned char>(value);
             }
         }
-        //else foundErrors = true;
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+private:
+    int fileVersion;
+};
+
+}
+
+bool FrameFileIO::loadPCANFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new PCANGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isCanalyzerASC(QString filename)
+bool FrameFileIO::isCanalyzerASC(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = false;
     bool inHeader = true;
     QList<QByteArray> tokens;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        while (!inFile->atEnd() && lineCounter < 10) {
+        while (!inFile.atEnd() && lineCounter < 10) {
             lineCounter++;
-            if (lineCounter > 10)
-            {
-                qApp->processEvents();
-                lineCounter = 0;
-            }
-            line = inFile->readLine();
+            line = inFile.readLine();
             if (inHeader)
             {
                 if (line.startsWith("//") ||  lineCounter > 4)
@@ -1485,8 +1420,7 @@ bool FrameFileIO::isCanalyzerASC(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -1497,239 +1431,191 @@ bool FrameFileIO::isCanalyzerASC(QString filename)
 //47.971842 2 248 Rx d 8 FF FF FF FF FF FF FF FF
 //Which is then easy to parse by splitting on the spaces
 //Time   bus id dir ? len databytes
-bool FrameFileIO::loadCanalyzerASC(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    bool foundErrors = false;
-    bool inHeader = true;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-    QList<QByteArray> tokens;
+namespace {
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+//CANalyzer ASC: "<seconds> <bus> <id>[x] Rx|Tx d|r <len> <data bytes>". Anything else in the log is skipped
+class CanalyzerASCGrammar : public TextLogGrammar
+{
+public:
+    //the header ends with the first // line, or after the fifth line if there isn't one
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        qint64 pos = 0;
+        for (int line = 1; line <= 5 && pos < size; line++)
+        {
+            bool comment = (size - pos >= 2 && data[pos] == '/' && data[pos + 1] == '/');
+            pos += lineLength(data + pos, size - pos);
+            if (comment) break;
+        }
+        return pos;
     }
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.splitWhitespace(begin, end);
+        if (tokens.count() <= 5) return LINE_SKIP;
+
+        uint64_t value;
+        if (!tokens.toSecondsUs(0, value)) return LINE_SKIP;
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value)));
+
+        const char *idEnd = tokens.end(2);
+        bool extended = (idEnd > tokens.begin(2) && idEnd[-1] == 'x');
+        if (extended) idEnd--;
+        if (!TextTokens::parseHex(tokens.begin(2), idEnd, value)) return LINE_SKIP;
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(extended);
+
+        int payloadLen;
+        tokens.toInt(5, payloadLen);
+        if (payloadLen > 8 || payloadLen < 0)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            qDebug() << "Payload length out of range. Original line: " << QByteArray(begin, static_cast<int>(end - begin));
+            return LINE_ERROR;
         }
-        line = inFile->readLine();
-        if (inHeader)
+        frame.isReceived = tokens.contains(3, "RX");
+        tokens.toInt(1, frame.bus);
+        if (tokens.equals(4, "r")) frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+
+        LineResult result = LINE_FRAME;
+        unsigned char bytes[8];
+        for (int d = 0; d < payloadLen; d++)
         {
-            if (line.startsWith("//") ||  lineCounter > 4)
+            if (6 + d < tokens.count())
             {
-                inHeader = false;
-                continue;
+                tokens.toHex(6 + d, value);
+                bytes[d] = static_cast<unsigned char>(value);
             }
-        }
-        if (inHeader) continue;
-        if (line.length() > 2)
-        {            
-            tokens = line.simplified().split(' ');
-            if (tokens.length() > 5)
+            else //expected byte wasn't there to read. Set it zero and flag the error
             {
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<uint64_t>(tokens[0].toDouble() * 1000000.0)));
-                if (tokens[2].endsWith('x'))
-                {
-                    QByteArray copied_id = tokens[2];
-                    copied_id.chop(1);
-                    thisFrame.setFrameId(copied_id.toUInt(nullptr, 16));
-                    thisFrame.setExtendedFrameFormat(true);
-                }
-                else
-                {
-                    thisFrame.setFrameId(tokens[2].toUInt(nullptr, 16));
-                    thisFrame.setExtendedFrameFormat(false);
-                }
-
-                int payloadLen = tokens[5].toInt();
-                QByteArray bytes(payloadLen, 0);
-
-                if (payloadLen > 8)
-                {
-                    qDebug() << "Payload length too long. Original line: " << line;
-                    return false;
-                }
-                if (payloadLen < 0)
-                {
-                    qDebug() << "Payload length negative! Original line: " << line;
-                    return false;
-                }
-                thisFrame.isReceived = tokens[3].toUpper().contains("RX");
-                thisFrame.bus = tokens[1].toInt();
-                if (tokens[4] == "r") thisFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                for (int d = 6; d < (6 + payloadLen); d++)
-                {
-                    if (tokens.count() > d)
-                    {
-                        bytes[d - 6] = static_cast<char>(tokens[d].toInt(nullptr, 16));
-                    }
-                    else //expected byte wasn't there to read. Set it zero and set error flag
-                    {
-                        bytes[d - 6] = 0;
-                        foundErrors = true;
-                        qDebug() << "D:" << d << " Count:" << tokens.count();
-                        qDebug() << "Expected byte missing! Original line: " << line;
-                    }
-                }
-                thisFrame.setPayload(bytes);
+                bytes[d] = 0;
+                result = LINE_DAMAGED;
             }
-            frames->append(thisFrame);
         }
-        //else foundErrors = true;
+        frame.setPayload(bytes, payloadLen);
+        return result;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+};
+
 }
 
-bool FrameFileIO::saveCanalyzerASC(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadCanalyzerASC(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    int lineCounter = 0;
-    int64_t offsetTime = frames->at(0).timeStamp().microSeconds();
-
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
-
-    for (int c = 0; c < frames->count(); c++)
-    {
-        if (frames->at(c).timeStamp().microSeconds() < offsetTime) offsetTime = frames->at(c).timeStamp().microSeconds();
-    }
-
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        delete outFile;
-        return false;
-    }
+    TextLogReader reader(new CanalyzerASCGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-    QDateTime now;
-    now = QDateTime::currentDateTime();
-    if (offsetTime > 10000000000) //chances are the input file had times as system time so load it
-    {
-        now.setMSecsSinceEpoch(offsetTime / 1000); //offsetTime was in microseconds
-    }
-    outFile->write("date " + now.toString("ddd MMM dd h:mm:ss.zzz a yyyy").toUtf8());
+namespace {
 
-    outFile->write("\nbase hex  timestamps absolute\n");
-    outFile->write("no internal event logging\n");
-    outFile->write("// version 11.0.0\n");
+//timestamps are relative to offsetTime, the earliest frame. When that isn't known up front the first frame is used
+class CanalyzerASCWriter : public TextFrameWriter
+{
+public:
+    explicit CanalyzerASCWriter(int64_t offsetTime = -1) : offsetTime(offsetTime) {}
 
-    for (int c = 0; c < frames->count(); c++)
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
+        if (offsetTime < 0) offsetTime = first ? static_cast<int64_t>(first->timestamp) : 0;
+        QDateTime now = QDateTime::currentDateTime();
+        if (offsetTime > 10000000000) //chances are the input file had times as system time so load it
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            now.setMSecsSinceEpoch(offsetTime / 1000); //offsetTime was in microseconds
         }
+        out.append("date " + now.toString("ddd MMM dd h:mm:ss.zzz a yyyy").toUtf8());
+        out.append("\nbase hex  timestamps absolute\n");
+        out.append("no internal event logging\n");
+        out.append("// version 11.0.0\n");
+    }
 
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-        uint64_t timeStamp = (frame->timeStamp().microSeconds() - offsetTime) / 1000000ull;
-        int tsLen = QString::number(timeStamp).length();
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
+    {
+        int64_t time = static_cast<int64_t>(frame.timestamp) - offsetTime;
+        int tsLen = QByteArray::number(static_cast<qulonglong>(qAbs(time) / 1000000)).length();
         int precision = 6;
         //vector seems to keep 10 bytes at the start of the line for the timestamp. It should never exceed this
         //and there should never be a precision over 6 digits after the decimal
         if (tsLen > 3) precision = 9 - tsLen;
-        outFile->write(QString::number((frame->timeStamp().microSeconds() - offsetTime) / 1000000.0, 'f', precision).rightJustified(10, ' ').toUtf8());
-        outFile->putChar(' ');
-        outFile->write(QString::number(frame->bus + 1).toUtf8());
-        outFile->write("  ");
-        if (frames->at(c).hasExtendedFrameFormat())
+        QByteArray timeText;
+        appendSeconds(timeText, time, precision);
+        out.append(timeText.rightJustified(10, ' '));
+        out.append(' ');
+        out.append(QByteArray::number(frame.bus + 1));
+        out.append("  ");
+        if (frame.hasExtendedFrameFormat())
         {
-            outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8());
-            outFile->write("x");
+            appendHex(out, frame.frameId(), 8);
+            out.append("x");
         }
         else
         {
-            outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(3, '0').toUtf8());
-            outFile->write("      ");
+            appendHex(out, frame.frameId(), 3);
+            out.append("      ");
         }
-        outFile->write("   ");
-
-        if (frames->at(c).isReceived) outFile->write("Rx ");
-        else outFile->write("Tx ");
-
-        if (frames->at(c).frameType() == QCanBusFrame::RemoteRequestFrame) outFile->write("r ");
-        else outFile->write("d ");
-
-        outFile->write(QString::number(dataLen).toUtf8());
-        outFile->write("  ");
-
-        for (int temp = 0; temp < dataLen; temp++)
+        out.append("   ");
+        out.append(frame.isReceived ? "Rx " : "Tx ");
+        out.append(frame.frameType() == QCanBusFrame::RemoteRequestFrame ? "r " : "d ");
+        out.append(QByteArray::number(frame.payloadLength()));
+        out.append("  ");
+        for (int temp = 0; temp < frame.payloadLength(); temp++)
         {
-            outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            outFile->write("  ");
+            appendHex(out, frame.payloadData()[temp], 2);
+            out.append("  ");
         }
-
-        outFile->write("\n");
+        out.append('\n');
     }
-    outFile->close();
-    delete outFile;
 
-    return true;
+private:
+    int64_t offsetTime;
+};
+
 }
 
-bool FrameFileIO::isCanalyzerBLF(QString filename)
+bool FrameFileIO::saveCanalyzerASC(QString filename, const CANFrameView* frames)
 {
-    BLF_FILE_HEADER header;
-
-    QFile *inFile = new QFile(filename);
-    bool isMatch = false;
-
-    if (!inFile->open(QIODevice::ReadOnly))
+    int64_t offsetTime = frames->isEmpty() ? 0 : frames->at(0).timeStamp().microSeconds();
+    for (int c = 0; c < frames->count(); c++)
     {
-        delete inFile;
-        return false;
+        if (frames->at(c).timeStamp().microSeconds() < offsetTime) offsetTime = frames->at(c).timeStamp().microSeconds();
     }
-    inFile->read(reinterpret_cast<char *>(&header), sizeof(header));
-    if (qFromLittleEndian(header.sig) == 0x47474F4C)
+
+    CanalyzerASCWriter writer(offsetTime);
+    return writer.open(filename) && writeFrames(&writer, frames);
+}
+
+bool FrameFileIO::isCanalyzerBLF(const QByteArray &prefix)
+{
+    BLF_FILE_HEADER header;
+    if (prefix.size() < static_cast<int>(sizeof(header))) return false;
+    memcpy(&header, prefix.constData(), sizeof(header));
+    if (qFromLittleEndian(header.sig) == 0x47474F4C) //"LOGG"
     {
         qDebug() << "Proper BLF file header token";
-        isMatch = true;
+        return true;
     }
-    else isMatch = false;
-
-    inFile->close();
-    delete inFile;
-
-    return isMatch;
+    return false;
 }
 
 //this one is pretty complicated and handled by it's own class
 bool FrameFileIO::loadCanalyzerBLF(QString filename, QVector<CANFrame> *frames)
 {
-    BLFHandler blf;
-    return blf.loadBLF(filename, frames);
+    BLFReader reader;
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isNativeCSVFile(QString filename)
+bool FrameFileIO::isNativeCSVFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int fileVersion = 1;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        line = inFile->readLine().toUpper(); //read out the header first and discard it.
+        line = inFile.readLine().toUpper(); //read out the header first and discard it.
         if (line.length() < 23) isMatch = false;
         else if (line.at(23) == 'D') fileVersion = 2; //Dir is found starting at position 23 if this is a V2 file
 
@@ -1737,8 +1623,8 @@ bool FrameFileIO::isNativeCSVFile(QString filename)
         if (!line.contains("EXTENDED")) isMatch = false;
         if (!line.contains("D1")) isMatch = false;
 
-        if (!inFile->atEnd()) {
-            line = inFile->readLine().simplified();
+        if (!inFile.atEnd()) {
+            line = inFile.readLine().simplified();
             if (line.length() > 2)
             {
                 QList<QByteArray> tokens = line.split(',');
@@ -1761,8 +1647,7 @@ bool FrameFileIO::isNativeCSVFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
 
     return isMatch;
 }
@@ -1770,160 +1655,129 @@ bool FrameFileIO::isNativeCSVFile(QString filename)
 //The "native" file format for this program
 //Time Stamp,ID,Extended,Dir,Bus,LEN,D1,D2,D3,D4,D5,D6,D7,D8
 //39747828,000005EB,false,Rx,0,8,E8,45,85,4B,4A,28,36,69,
-bool FrameFileIO::loadNativeCSVFile(QString filename, QVector<CANFrame>* frames)
+namespace {
+
+//GVRET native CSV: Time Stamp,ID,Extended,[Dir,]Bus,LEN,D1..D8. Version 2 files have the Dir column
+class NativeCSVGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int fileVersion = 1;
-    uint64_t timeStamp = Utility::GetTimeMS();
-    int lineCounter = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
+public:
+    static const uint64_t NO_TIMESTAMP = ~static_cast<uint64_t>(0);
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+    NativeCSVGrammar() : fileVersion(1), timeStamp(Utility::GetTimeMS()) {}
+
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        qint64 len = lineLength(data, size);
+        //Dir is found starting at position 23 if this is a V2 file
+        if (len > 23 && (data[23] == 'D' || data[23] == 'd')) fileVersion = 2;
+        return len;
     }
 
-    line = inFile->readLine().toUpper(); //read out the header first and discard it.
-    if (line.at(23) == 'D') fileVersion = 2; //Dir is found starting at position 23 if this is a V2 file
-
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.split(begin, end, ',');
+        if (tokens.count() < 5)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            if (tokens.count() == 0 || tokens.end(tokens.count() - 1) - tokens.begin(0) <= 2) return LINE_SKIP;
+            return LINE_ERROR;
         }
 
-        line = inFile->readLine().simplified();
-        if (line.length() > 2)
+        //a timestamp that short isn't real. Those frames get made up ones 5us apart, see finishFrames
+        uint64_t value;
+        if (tokens.length(0) > 3)
         {
-            QList<QByteArray> tokens = line.split(',');
-            if (tokens.length() >= 5)
-            {
-                if (tokens[0].length() > 3)
-                {
-                    thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, tokens[0].toULongLong()));
-                }
-                else
-                {
-                    timeStamp += 5;
-                    thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp));
-                }
-
-                thisFrame.setFrameId(tokens[1].toUInt(nullptr, 16));
-                if (tokens[2].toUpper().contains("TRUE")) thisFrame.setExtendedFrameFormat(true);
-                    else thisFrame.setExtendedFrameFormat(false);
-
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
-
-                if (fileVersion == 1)
-                {
-                    thisFrame.isReceived = true;
-                    thisFrame.bus = tokens[3].toInt();
-                    int lng = tokens[4].toInt();
-                    if (lng > 8) lng = 8;
-                    if (lng < 0) lng = 0;
-                    if (lng + 5 > tokens.length()) lng = tokens.length() - 5;
-                    QByteArray bytes(lng, 0);
-                    for (int c = 0; c < 8; c++) bytes[c] = 0;
-                    for (int d = 0; d < lng; d++)
-                        bytes[d] = static_cast<char>(tokens[5 + d].toInt(nullptr, 16));
-                    thisFrame.setPayload(bytes);
-                }
-                else if (fileVersion == 2)
-                {
-                    if (tokens[3].at(0) == 'R') thisFrame.isReceived = true;
-                    else thisFrame.isReceived = false;
-                    thisFrame.bus = tokens[4].toInt();                    
-                    int lng = tokens[5].toInt();
-                    if (lng > 8) lng = 8;
-                    if (lng < 0) lng = 0;
-                    if (lng + 6 > tokens.length()) lng = tokens.length() - 6;
-                    QByteArray bytes(lng, 0);
-                    for (int c = 0; c < 8; c++) bytes[c] = 0;
-                    for (int d = 0; d < lng; d++)
-                        bytes[d] = static_cast<char>(tokens[6 + d].toInt(nullptr, 16));
-                    thisFrame.setPayload(bytes);
-                }
-
-                frames->append(thisFrame);
-            }
-            else foundErrors = true;
+            tokens.toUInt(0, value);
+            frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value)));
         }
-    }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
-}
+        else frame.timestamp = NO_TIMESTAMP;
 
-bool FrameFileIO::saveNativeCSVFile(QString filename, const QVector<CANFrame>* frames)
-{
-    QFile *outFile = new QFile(filename);
-    int lineCounter = 0;
+        tokens.toHex(1, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(tokens.contains(2, "TRUE"));
 
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
+        int firstData = 5;
+        if (fileVersion == 2)
+        {
+            frame.isReceived = (tokens.first(3) == 'R');
+            firstData = 6;
+        }
+        tokens.toInt(firstData - 2, frame.bus);
 
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        delete outFile;
-        return false;
+        int lng;
+        tokens.toInt(firstData - 1, lng);
+        if (lng > 8) lng = 8;
+        if (lng < 0) lng = 0;
+        if (lng + firstData > tokens.count()) lng = tokens.count() - firstData;
+        if (lng < 0) lng = 0;
+        unsigned char bytes[8];
+        for (int d = 0; d < lng; d++)
+        {
+            tokens.toHex(firstData + d, value);
+            bytes[d] = static_cast<unsigned char>(value);
+        }
+        frame.setPayload(bytes, lng);
+        return LINE_FRAME;
     }
 
-    outFile->write("Time Stamp,ID,Extended,Dir,Bus,LEN,D1,D2,D3,D4,D5,D6,D7,D8");
-    outFile->write("\n");
-
-    for (int c = 0; c < frames->count(); c++)
+    void finishFrames(CANFrame *frames, int count) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
+        for (int i = 0; i < count; i++)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            if (frames[i].timestamp != NO_TIMESTAMP) continue;
+            timeStamp += 5;
+            frames[i].setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(timeStamp)));
         }
+    }
 
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
+private:
+    int fileVersion;
+    uint64_t timeStamp;
+};
 
-        outFile->write(QString::number(frame->timeStamp().microSeconds()).toUtf8());
-        outFile->putChar(44);
+}
 
-        outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8());
-        outFile->putChar(44);
+bool FrameFileIO::loadNativeCSVFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new NativeCSVGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-        if (frame->hasExtendedFrameFormat()) outFile->write("true,");
-        else outFile->write("false,");
+namespace {
 
-        if (frame->isReceived) outFile->write("Rx,");
-        else outFile->write("Tx,");
+class NativeCSVWriter : public FrameWriter
+{
+public:
+    bool open(const QString &filename)
+    {
+        file.setFileName(filename);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+        FrameFileIO::writeNativeCSVHeader(&file);
+        return true;
+    }
 
-        outFile->write(QString::number(frame->bus).toUtf8());
-        outFile->putChar(44);
+    bool write(const CANFrame *frames, int count) override
+    {
+        return file.isOpen() && FrameFileIO::writeNativeCSVFrames(&file, frames, count);
+    }
 
-        outFile->write(QString::number(dataLen).toUtf8());
-        outFile->putChar(44);
+    bool finish() override
+    {
+        if (!file.isOpen()) return false;
+        file.close();
+        return file.error() == QFileDevice::NoError;
+    }
 
-        for (int temp = 0; temp < 8; temp++)
-        {
-            if (temp < dataLen)
-                outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            else
-                outFile->write("00");
-            outFile->putChar(44);
-        }
+private:
+    QFile file;
+};
 
-        outFile->write("\n");
+}
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
+bool FrameFileIO::saveNativeCSVFile(QString filename, const CANFrameView* frames)
+{
+    NativeCSVWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
 bool FrameFileIO::openContinuousNative()
@@ -1950,8 +1804,7 @@ bool FrameFileIO::openContinuousNative()
         {
             return false;
         }
-        continuousFile.write("Time Stamp,ID,Extended,Dir,Bus,LEN,D1,D2,D3,D4,D5,D6,D7,D8");
-        continuousFile.write("\n");
+        writeNativeCSVHeader(&continuousFile);
         settings.setValue("FileIO/LoadSaveDirectory", dialog.directory().path());
         return true;
     }
@@ -1968,50 +1821,129 @@ bool FrameFileIO::closeContinuousNative()
     return false;
 }
 
-bool FrameFileIO::writeContinuousNative(const QVector<CANFrame>* frames, int beginningFrame)
+bool FrameFileIO::writeContinuousNative(const CANFrameView* frames, int beginningFrame)
 {
-
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
-
     if (!continuousFile.isOpen()) return false;
-    qDebug() << "Bgn: " << beginningFrame << "  Count: " << frames->count();
-    for (int c = beginningFrame; c < frames->count(); c++)
+    int num = frames->count();
+    for (int c = beginningFrame; c < num; c++)
     {
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
+        if (!writeNativeCSVFrames(&continuousFile, &frames->at(c), 1)) return false;
+    }
+    return true;
+}
+
+//the buses of every connection as they are set up right now, stored with a capture so it is known where it came from
+QVector<CaptureFile::BusInfo> FrameFileIO::captureBuses()
+{
+    QVector<CaptureFile::BusInfo> buses;
+    CANConManager *manager = CANConManager::getInstance();
+    foreach (CANConnection *conn, manager->getConnections())
+    {
+        int busBase = manager->getBusBase(conn);
+        for (int i = 0; i < conn->getNumBuses(); i++)
+        {
+            CANBus bus;
+            CaptureFile::BusInfo info;
+            info.bus = busBase + i;
+            info.driver = conn->getDriver();
+            info.port = conn->getPort();
+            info.speed = 0;
+            info.listenOnly = false;
+            if (conn->getBusSettings(i, bus))
+            {
+                info.speed = bus.getSpeed();
+                info.listenOnly = bus.isListenOnly();
+            }
+            buses.append(info);
+        }
+    }
+    return buses;
+}
 
-        continuousFile.write(QString::number(frame->timeStamp().microSeconds()).toUtf8());
-        continuousFile.putChar(44);
+//Copies a capture file into memory like any other log. Big ones are better shown straight from disk, see selectCaptureFile()
+bool FrameFileIO::loadCaptureFile(QString filename, QVector<CANFrame>* frames)
+{
+    CaptureFileReader reader;
+    return reader.open(filename) && readFrames(&reader, frames);
+}
+
+bool FrameFileIO::saveCaptureFile(QString filename, const CANFrameView* frames)
+{
+    return CaptureFile::save(filename, frames, captureBuses());
+}
 
-        continuousFile.write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8());
-        continuousFile.putChar(44);
+//asks for a capture file to map in place of loading it. Returns false if the user backed out
+bool FrameFileIO::selectCaptureFile(QString &filename)
+{
+    QFileDialog dialog(qApp->activeWindow());
+    QSettings settings;
 
-        if (frame->hasExtendedFrameFormat()) continuousFile.write("true,");
-        else continuousFile.write("false,");
+    QStringList filters;
+    filters.append(QString(tr("CANOpenAnalyzer Capture (*.cancap)")));
 
-        if (frame->isReceived) continuousFile.write("Rx,");
-        else continuousFile.write("Tx,");
+    dialog.setDirectory(settings.value("FileIO/LoadSaveDirectory", dialog.directory().path()).toString());
+    dialog.setFileMode(QFileDialog::ExistingFile);
+    dialog.setNameFilters(filters);
+    dialog.setViewMode(QFileDialog::Detail);
 
-        continuousFile.write(QString::number(frame->bus).toUtf8());
-        continuousFile.putChar(44);
+    if (dialog.exec() == QDialog::Accepted)
+    {
+        filename = dialog.selectedFiles()[0];
+        settings.setValue("FileIO/LoadSaveDirectory", dialog.directory().path());
+        return true;
+    }
+    return false;
+}
 
-        continuousFile.write(QString::number(dataLen).toUtf8());
-        continuousFile.putChar(44);
+void FrameFileIO::writeNativeCSVHeader(QIODevice *out)
+{
+    out->write("Time Stamp,ID,Extended,Dir,Bus,LEN,D1,D2,D3,D4,D5,D6,D7,D8");
+    out->write("\n");
+}
 
+/*
+ * Native CSV lines for a plain array of frames, same format as saveNativeCSVFile. There is no GUI involved
+ * (no dialogs, no processEvents) so this can be used from a worker thread. The lines are put together in a
+ * buffer and written out in one go.
+ */
+bool FrameFileIO::writeNativeCSVFrames(QIODevice *out, const CANFrame *frames, int count)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    QByteArray buffer;
+    buffer.reserve(qMin(count, 4096) * 72);
+
+    for (int c = 0; c < count; c++)
+    {
+        const CANFrame &frame = frames[c];
+        const unsigned char *data = frame.payloadData();
+        int dataLen = frame.payloadLength();
+
+        buffer.append(QByteArray::number(static_cast<qlonglong>(frame.timeStamp().microSeconds())));
+        buffer.append(',');
+        buffer.append(QByteArray::number(frame.frameId(), 16).toUpper().rightJustified(8, '0'));
+        buffer.append(',');
+        buffer.append(frame.hasExtendedFrameFormat() ? "true," : "false,");
+        buffer.append(frame.isReceived ? "Rx," : "Tx,");
+        buffer.append(QByteArray::number(frame.bus));
+        buffer.append(',');
+        buffer.append(QByteArray::number(dataLen));
+        buffer.append(',');
         for (int temp = 0; temp < 8; temp++)
         {
-            if (temp < dataLen)
-                continuousFile.write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            else
-                continuousFile.write("00");
-            continuousFile.putChar(44);
+            unsigned char byte = (temp < dataLen) ? data[temp] : 0;
+            buffer.append(hexDigits[byte >> 4]);
+            buffer.append(hexDigits[byte & 0xF]);
+            buffer.append(',');
         }
+        buffer.append('\n');
 
-        continuousFile.write("\n");
+        if (buffer.size() > 256 * 1024)
+        {
+            if (out->write(buffer) != buffer.size()) return false;
+            buffer.clear();
+        }
     }
+    if (!buffer.isEmpty() && out->write(buffer) != buffer.size()) return false;
     return true;
 }
 
@@ -2025,23 +1957,20 @@ bool FrameFileIO::flushContinuousNative()
 }
 
 
-bool FrameFileIO::isGenericCSVFile(QString filename)
+bool FrameFileIO::isGenericCSVFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        line = inFile->readLine(); //read out the header first and discard it.
+        line = inFile.readLine(); //read out the header first and discard it.
 
-        if (!inFile->atEnd()) {
-            line = inFile->readLine();
+        if (!inFile.atEnd()) {
+            line = inFile.readLine();
             if (line.length() > 2)
             {
                 QList<QByteArray> tokens = line.split(',');
@@ -2069,135 +1998,123 @@ bool FrameFileIO::isGenericCSVFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
-bool FrameFileIO::loadGenericCSVFile(QString filename, QVector<CANFrame>* frames)
+namespace {
+
+//"<hex id>,<data bytes>" after a header line. There are no times in the file, frames get made up ones 5ms apart
+class GenericCSVGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    uint64_t timeStamp = Utility::GetTimeMS();
-    int lineCounter = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
+public:
+    GenericCSVGrammar() : timeStamp(Utility::GetTimeMS()) {}
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+    qint64 headerLength(const char *data, qint64 size) override
     {
-        delete inFile;
-        return false;
+        return lineLength(data, size);
     }
 
-    line = inFile->readLine(); //read out the header first and discard it.
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        if (end - begin < 2) return LINE_ERROR;
+        TextTokens tokens;
+        tokens.split(begin, end, ',');
+        if (tokens.count() < 2) return LINE_ERROR;
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
+        uint64_t value;
+        tokens.toHex(0, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
+
+        TextTokens dataTok;
+        dataTok.splitWhitespace(tokens.begin(1), tokens.end(1));
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        int numBytes = qMin(dataTok.count(), CANFRAME_MAX_PAYLOAD);
+        for (int d = 0; d < numBytes; d++)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            dataTok.toHex(d, value);
+            bytes[d] = static_cast<unsigned char>(value);
         }
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
+    }
 
-        line = inFile->readLine();
-        if (line.length() > 2)
+    void finishFrames(CANFrame *frames, int count) override
+    {
+        for (int i = 0; i < count; i++)
         {
-            QList<QByteArray> tokens = line.split(',');
-
             timeStamp += 5000;
-            thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp));
-            thisFrame.setFrameId(tokens[0].toUInt(nullptr, 16));
-            if (thisFrame.frameId() > 0x7FF) thisFrame.setExtendedFrameFormat(true);
-            else thisFrame.setExtendedFrameFormat(false);
-            thisFrame.bus = 0;
-            thisFrame.setFrameType(QCanBusFrame::DataFrame);
-            QList<QByteArray> dataTok = tokens[1].split(' ');
-            QByteArray bytes(dataTok.length(), 0);
-            for (int d = 0; d < dataTok.length(); d++) bytes[d] = static_cast<char>(dataTok[d].toInt(nullptr, 16));
-            thisFrame.setPayload(bytes);
-            frames->append(thisFrame);
+            frames[i].setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(timeStamp)));
         }
-        else foundErrors = true;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+private:
+    uint64_t timeStamp;
+};
+
 }
 
-//4f5,ff 34 23 45 24 e4
-bool FrameFileIO::saveGenericCSVFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadGenericCSVFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    int lineCounter = 0;
+    TextLogReader reader(new GenericCSVGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
+namespace {
 
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
+//4f5,ff 34 23 45 24 e4
+class GenericCSVWriter : public TextFrameWriter
+{
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
     {
-        delete outFile;
-        return false;
+        Q_UNUSED(first);
+        out.append("ID,Data Bytes\n");
     }
 
-    outFile->write("ID,Data Bytes");
-    outFile->write("\n");
-
-    for (int c = 0; c < frames->count(); c++)
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-        outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8());
-        outFile->putChar(44);
-
-        for (int temp = 0; temp < dataLen; temp++)
+        appendHex(out, frame.frameId(), 8);
+        out.append(',');
+        for (int temp = 0; temp < frame.payloadLength(); temp++)
         {
-            outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            outFile->putChar(' ');
+            appendHex(out, frame.payloadData()[temp], 2);
+            out.append(' ');
         }
+        out.append('\n');
+    }
+};
 
-        outFile->write("\n");
+}
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
+bool FrameFileIO::saveGenericCSVFile(QString filename, const CANFrameView* frames)
+{
+    GenericCSVWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
-bool FrameFileIO::isLogFile(QString filename)
+bool FrameFileIO::isLogFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        line = inFile->readLine().toUpper();
+        line = inFile.readLine().toUpper();
         if (!line.contains("BUSMASTER")) isMatch = false;
 
-        while (!inFile->atEnd() && line.startsWith("***")) {
-            line = inFile->readLine().toUpper();
+        while (!inFile.atEnd() && line.startsWith("***")) {
+            line = inFile.readLine().toUpper();
         }
 
-        if (!inFile->atEnd())
+        if (!inFile.atEnd())
         {
-            line = inFile->readLine().toUpper();
+            line = inFile.readLine().toUpper();
             if (line.length() > 1)
             {
                 QList<QByteArray> tokens = line.split(' ');
@@ -2221,8 +2138,7 @@ bool FrameFileIO::isLogFile(QString filename)
         isMatch = false;
     }
 
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -2258,180 +2174,156 @@ Sample chunk of a busmaster log:
 11:49:12:9680 Rx 1 0x40B s 8 00 00 00 00 00 10 60 00
 11:49:12:9690 Rx 1 0x045 s 8 40 00 00 00 00 00 00 00
 */
-bool FrameFileIO::loadLogFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    uint64_t timeStamp = Utility::GetTimeMS();
-    int lineCounter = 0;
-    bool foundErrors = false;
-
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
-
-    line = inFile->readLine(); //read out the header first and discard it.
+namespace {
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-
-        line = inFile->readLine().toUpper();
-        if (line.startsWith("***")) continue;
-        if (line.length() > 1)
-        {
-            QList<QByteArray> tokens = line.split(' ');
-            if (tokens.length() >= 6)
+class BusmasterLogGrammar : public TextLogGrammar
+{
+public:
+    qint64 headerLength(const char *data, qint64 size) override
+    {
+        return lineLength(data, size);
+    }
+
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        if (end - begin < 1 || (end - begin >= 3 && memcmp(begin, "***", 3) == 0)) return LINE_SKIP;
+        TextTokens tokens;
+        tokens.splitWhitespace(begin, end);
+        if (tokens.count() < 6) return LINE_ERROR;
+
+        //hours:minutes:seconds:tenths of ms
+        TextTokens timeToks;
+        timeToks.split(tokens.begin(0), tokens.end(0), ':');
+        uint64_t timePart[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 4 && i < timeToks.count(); i++) timeToks.toUInt(i, timePart[i]);
+        uint64_t timeStamp = (timePart[0] * (1000ul * 1000ul * 60ul * 60ul)) + (timePart[1] * (1000ul * 1000ul * 60ul))
+                + (timePart[2] * (1000ul * 1000ul)) + (timePart[3] * 100ul);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(timeStamp)));
+        frame.isReceived = (tokens.first(1) == 'R' || tokens.first(1) == 'r');
+
+        uint64_t value;
+        if (tokens.length(3) > 2) TextTokens::parseHex(tokens.begin(3) + 2, tokens.end(3), value); //after the 0x
+        else value = 0;
+        frame.setFrameId(static_cast<uint32_t>(value));
+        if (tokens.equals(4, "S")) {
+            frame.setExtendedFrameFormat(false);
+        } else if (tokens.equals(4, "X")) {
+            frame.setExtendedFrameFormat(true);
+        } else if (tokens.equals(4, "SR")) {
+            frame.setExtendedFrameFormat(false);
+            frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        } else { // XR
+            frame.setExtendedFrameFormat(true);
+            frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        }
+        tokens.toInt(2, frame.bus);
+
+        int lng;
+        tokens.toInt(5, lng);
+        if (lng > 8) lng = 8;
+        if (lng < 0) lng = 0;
+        LineResult result = LINE_FRAME;
+        unsigned char bytes[8];
+        memset(bytes, 0, sizeof(bytes));
+        if (frame.frameType() != QCanBusFrame::RemoteRequestFrame)
+        {
+            for (int d = 0; d < lng; d++)
             {
-                QList<QByteArray> timeToks = tokens[0].split(':');
-                timeStamp = (timeToks[0].toUInt() * (1000ul * 1000ul * 60ul * 60ul)) + (timeToks[1].toUInt() * (1000ul * 1000ul * 60ul))
-                      + (timeToks[2].toUInt() * (1000ul * 1000ul)) + (timeToks[3].toUInt() * 100ul);
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp));
-                if (tokens[1].at(0) == 'R') thisFrame.isReceived = true;
-                    else thisFrame.isReceived = false;
-                thisFrame.setFrameId(tokens[3].right(tokens[3].length() - 2).toUInt(nullptr, 16));
-                if (tokens[4] == "S") {
-                    thisFrame.setExtendedFrameFormat(false);
-                    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                } else if (tokens[4] == "X") {
-                    thisFrame.setExtendedFrameFormat(true);
-                    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                } else if (tokens[4] == "SR") {
-                    thisFrame.setExtendedFrameFormat(false);
-                    thisFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                } else { // XR
-                    thisFrame.setExtendedFrameFormat(true);
-                    thisFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                }
-                thisFrame.bus = tokens[2].toInt();
-
-                int lng = tokens[5].toInt();
-                if (lng > 8) lng = 8;
-                if (lng < 0) lng = 0;
-                QByteArray bytes(lng, 0);
-                if (thisFrame.frameType() != QCanBusFrame::RemoteRequestFrame) {
-                    for (int d = 0; d < lng; d++)
-                        bytes[d] = static_cast<char>(tokens[d + 6].toInt(nullptr, 16));
+                if (d + 6 < tokens.count())
+                {
+                    tokens.toHex(d + 6, value);
+                    bytes[d] = static_cast<unsigned char>(value);
                 }
-                thisFrame.setPayload(bytes);
-                frames->append(thisFrame);
+                else result = LINE_DAMAGED;
             }
-            else foundErrors = true;
         }
+        frame.setPayload(bytes, lng);
+        return result;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+};
+
 }
 
-bool FrameFileIO::saveLogFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadLogFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    QDateTime timestamp, tempStamp;
-    int lineCounter = 0;
-
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
-
-    //timestamp = QDateTime::currentDateTime();
-
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        delete outFile;
-        return false;
-    }
-
-    outFile->write("***BUSMASTER Ver 3.2.0***\n");
-    outFile->write("***PROTOCOL CAN***\n");
-    outFile->write("***NOTE: PLEASE DO NOT EDIT THIS DOCUMENT***\n");
-    outFile->write("***[START LOGGING SESSION]***\n");
-    outFile->write("***START DATE AND TIME ");
-    outFile->write(timestamp.toString("d:M:yyyy h:m:s:z").toUtf8());
-    outFile->write("***\n");
-    outFile->write("***HEX***\n");
-    outFile->write("***SYSTEM MODE***\n");
-    outFile->write("***START CHANNEL BAUD RATE***\n");
-    outFile->write("***CHANNEL 1 - Kvaser - Kvaser Leaf Light HS #0 (Channel 0), Serial Number- 0, Firmware- 0x00000037 0x00020000 - 500000 bps***\n");
-    outFile->write("***END CHANNEL BAUD RATE***\n");
-    outFile->write("***START DATABASE FILES***\n");
-    outFile->write("***END OF DATABASE FILES***\n");
-    outFile->write("***<Time><Tx/Rx><Channel><CAN ID><Type><DLC><DataBytes>***\n");
-
-    for (int c = 0; c < frames->count(); c++)
-    {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
+    TextLogReader reader(new BusmasterLogGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
+namespace {
 
-        tempStamp = QDateTime::fromMSecsSinceEpoch(frame->timeStamp().microSeconds() / 1000);
-        outFile->write(tempStamp.toString("hh:mm:ss:zzz").toUtf8());
-        if (frame->isReceived) outFile->write(" Rx ");
-        else outFile->write(" Tx ");
+class BusmasterLogWriter : public TextFrameWriter
+{
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
+    {
+        Q_UNUSED(first);
+        out.append("***BUSMASTER Ver 3.2.0***\n");
+        out.append("***PROTOCOL CAN***\n");
+        out.append("***NOTE: PLEASE DO NOT EDIT THIS DOCUMENT***\n");
+        out.append("***[START LOGGING SESSION]***\n");
+        out.append("***START DATE AND TIME ***\n");
+        out.append("***HEX***\n");
+        out.append("***SYSTEM MODE***\n");
+        out.append("***START CHANNEL BAUD RATE***\n");
+        out.append("***CHANNEL 1 - Kvaser - Kvaser Leaf Light HS #0 (Channel 0), Serial Number- 0, Firmware- 0x00000037 0x00020000 - 500000 bps***\n");
+        out.append("***END CHANNEL BAUD RATE***\n");
+        out.append("***START DATABASE FILES***\n");
+        out.append("***END OF DATABASE FILES***\n");
+        out.append("***<Time><Tx/Rx><Channel><CAN ID><Type><DLC><DataBytes>***\n");
+    }
+
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
+    {
+        bool remote = (frame.frameType() == QCanBusFrame::RemoteRequestFrame);
+        QDateTime tempStamp = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(frame.timestamp / 1000));
+        out.append(tempStamp.toString("hh:mm:ss:zzz").toUtf8());
+        out.append(frame.isReceived ? " Rx " : " Tx ");
         // busmaster channel start at 1
-        outFile->write(QString::number(frame->bus + 1).toUtf8() + " ");
-        outFile->write("0x");
-        if (frame->hasExtendedFrameFormat() && frame->frameId() > 0x7FF) {
-            outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8());
-        } else {
-            outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(3, '0').toUtf8());
-        }
-        if (frame->hasExtendedFrameFormat()) outFile->write(" x");
-            else outFile->write(" s");
-        if (frame->frameType() == QCanBusFrame::RemoteRequestFrame) outFile->write("r ");
-            else outFile->write(" ");
-        outFile->write(QString::number(dataLen).toUtf8() + " ");
-
-        if (frame->frameType() != QCanBusFrame::RemoteRequestFrame) {
-            for (int temp = 0; temp < dataLen; temp++)
+        out.append(QByteArray::number(frame.bus + 1));
+        out.append(" 0x");
+        appendHex(out, frame.frameId(), (frame.hasExtendedFrameFormat() && frame.frameId() > 0x7FF) ? 8 : 3);
+        out.append(frame.hasExtendedFrameFormat() ? " x" : " s");
+        out.append(remote ? "r " : " ");
+        out.append(QByteArray::number(frame.payloadLength()));
+        out.append(' ');
+        if (!remote)
+        {
+            for (int temp = 0; temp < frame.payloadLength(); temp++)
             {
-                outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-                outFile->putChar(' ');
+                appendHex(out, frame.payloadData()[temp], 2);
+                out.append(' ');
             }
         }
+        out.append('\n');
+    }
+};
 
-        outFile->write("\n");
+}
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
+bool FrameFileIO::saveLogFile(QString filename, const CANFrameView* frames)
+{
+    BusmasterLogWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
-bool FrameFileIO::isIXXATFile(QString filename)
+bool FrameFileIO::isIXXATFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        line = inFile->readLine().toUpper();
+        line = inFile.readLine().toUpper();
         if (!line.contains("IXXAT")) isMatch = false;
 
         for (int i = 0; i < 6; i++)
         {
-            if (!inFile->atEnd()) line = inFile->readLine().toUpper();
+            if (!inFile.atEnd()) line = inFile.readLine().toUpper();
             else isMatch = false;
         }
 
@@ -2442,166 +2334,149 @@ bool FrameFileIO::isIXXATFile(QString filename)
         isMatch = false;
     }
 
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
-//"00:01:03.03","223","Std","","00 00 00 00 49 00 00 01 "
-bool FrameFileIO::loadIXXATFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    uint64_t timeStamp = Utility::GetTimeMS();
-    int lineCounter = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
-
-    for (int i = 0; i < 7; i++) line = inFile->readLine(); //read out the header first and discard it.
-
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
+namespace {
 
-        line = inFile->readLine().toUpper();
-        if (line.length() > 1)
-        {
-            QList<QByteArray> tokens = line.split(',');
-            if (line.length() >= 5)
-            {
-                QString timePortion = Utility::unQuote(tokens[0]);
-                QStringList timeToks = timePortion.split(':');
-                if (timeToks.length() >= 3)
-                {
-                    timeStamp = (timeToks[0].toUInt() * (1000ul * 1000ul * 60ul * 60ul)) + (timeToks[1].toUInt() * (1000ul * 1000ul * 60ul))
-                      + static_cast<uint64_t>(timeToks[2].toDouble() * (1000.0 * 1000.0));
-                }
-                else
-                {
-                    timeStamp = 0;
-                    foundErrors = true;
-                    return false;
-                }
-                thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp));
-                thisFrame.setFrameId(Utility::unQuote(tokens[1]).toUInt(nullptr, 16));
-                QString tempStr = Utility::unQuote(tokens[2]).toUpper();
-                if (tempStr.length() > 0)
-                {
-                    if (tempStr.at(0) == 'S') thisFrame.setExtendedFrameFormat(false);
-                        else thisFrame.setExtendedFrameFormat(true);
-                }
-                else
-                {
-                    thisFrame.setExtendedFrameFormat(false);
-                    foundErrors = true;
-                    return false;
-                }
+//"00:01:03.03","223","Std","","00 00 00 00 49 00 00 01 " after seven header lines
+class IXXATGrammar : public TextLogGrammar
+{
+public:
+    qint64 headerLength(const char *data, qint64 size) override
+    {
+        qint64 pos = 0;
+        for (int line = 0; line < 7 && pos < size; line++) pos += lineLength(data + pos, size - pos);
+        return pos;
+    }
+
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        if (end - begin < 1) return LINE_SKIP;
+        TextTokens tokens;
+        tokens.split(begin, end, ',');
+        if (tokens.count() < 5) return LINE_ERROR;
+
+        //hours:minutes:seconds with a fraction
+        const char *b = tokens.begin(0);
+        const char *e = tokens.end(0);
+        unquote(b, e);
+        TextTokens timeToks;
+        timeToks.split(b, e, ':');
+        if (timeToks.count() < 3) return LINE_ERROR;
+        uint64_t hours, minutes, us;
+        timeToks.toUInt(0, hours);
+        timeToks.toUInt(1, minutes);
+        timeToks.toSecondsUs(2, us);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>((hours * (1000ul * 1000ul * 60ul * 60ul)) + (minutes * (1000ul * 1000ul * 60ul)) + us)));
+
+        uint64_t value;
+        b = tokens.begin(1);
+        e = tokens.end(1);
+        unquote(b, e);
+        TextTokens::parseHex(b, e, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        b = tokens.begin(2);
+        e = tokens.end(2);
+        unquote(b, e);
+        if (b == e) return LINE_ERROR;
+        frame.setExtendedFrameFormat(*b != 'S' && *b != 's');
+
+        b = tokens.begin(4);
+        e = tokens.end(4);
+        unquote(b, e);
+        TextTokens dataToks;
+        dataToks.splitWhitespace(b, e);
+        if (dataToks.count() > 8) return LINE_ERROR;
+        unsigned char bytes[8];
+        for (int d = 0; d < dataToks.count(); d++)
+        {
+            dataToks.toHex(d, value);
+            bytes[d] = static_cast<unsigned char>(value);
+        }
+        frame.setPayload(bytes, dataToks.count());
+        return LINE_FRAME;
+    }
+};
 
-                thisFrame.isReceived = true;
-                thisFrame.bus = 0;
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
-
-                QStringList dataToks = Utility::unQuote(tokens[4]).simplified().split(' ');
-                int numBytes = dataToks.length();
-                QByteArray bytes(numBytes, 0);
-                if (numBytes > 8) return false;
-                for (int d = 0; d < numBytes; d++) bytes[d] = static_cast<char>(dataToks[d].toInt(nullptr, 16));
-                thisFrame.setPayload(bytes);
-                frames->append(thisFrame);
-            }
-            else return false;
-        }
-    }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
 }
 
-bool FrameFileIO::saveIXXATFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadIXXATFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    QDateTime timestamp, tempStamp;
-    int lineCounter = 0;
+    TextLogReader reader(new IXXATGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
+namespace {
+
+class IXXATWriter : public TextFrameWriter
+{
+public:
+    IXXATWriter() : startTime(QDateTime::currentDateTime()), firstTime(0), lastTime(0), haveFrames(false) {}
 
-    timestamp = QDateTime::currentDateTime();
+protected:
+    bool headerHasTotals() const override { return true; }
 
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
+    //the stop time is only known at the end. It is padded to the longest it can be so the header can go out again
+    void appendHeader(QByteArray &out, const CANFrame *first) override
     {
-        delete outFile;
-        return false;
+        Q_UNUSED(first);
+        QDateTime stopTime = startTime.addMSecs(static_cast<qint64>(lastTime - firstTime) / 1000);
+        out.append("ASCII Trace CANOpenAnalyzer" + QByteArray::number(VERSION) + "\n");
+        out.append("Date: " + startTime.toString("d:M:yyyy").toUtf8() + "\n");
+        out.append("Start time: " + startTime.toString("h:m:s").toUtf8() + "\n");
+        out.append("Stop time: " + stopTime.toString("h:m:s").toUtf8().leftJustified(8, ' ') + "\n");
+        out.append("Overruns: 0\n");
+        out.append("Baudrate: 500 kbit/s\n"); //could be a lie... this code has no way to know the baud rate (at the moment)
+        out.append("\"Time\",\"Identifier (hex)\",\"Format\",\"Flags\",\"Data (hex)\"\n");
     }
 
-    outFile->write("ASCII Trace CANOpenAnalyzer" + QString::number(VERSION).toUtf8() + "\n");
-    outFile->write("Date: " + timestamp.toString("d:M:yyyy").toUtf8() + "\n");
-    outFile->write("Start time: " + timestamp.toString("h:m:s").toUtf8() + "\n");
-    timestamp = timestamp.addMSecs((frames->last().timeStamp().microSeconds() - frames->first().timeStamp().microSeconds()) / 1000);
-    outFile->write("Stop time: " + timestamp.toString("h:m:s").toUtf8() + "\n");
-    outFile->write("Overruns: 0\n");
-    outFile->write("Baudrate: 500 kbit/s\n"); //could be a lie... this code has no way to know the baud rate (at the moment)
-    outFile->write("\"Time\",\"Identifier (hex)\",\"Format\",\"Flags\",\"Data (hex)\"\n");
-
-    for (int c = 0; c < frames->count(); c++)
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-        tempStamp = QDateTime::fromMSecsSinceEpoch(frame->timeStamp().microSeconds() / 1000);
-        outFile->write("\"" + tempStamp.toString("h:m:s.").toUtf8() + tempStamp.toString("z").rightJustified(3, '0').toUtf8() + "\"");
+        if (!haveFrames) firstTime = frame.timestamp;
+        haveFrames = true;
+        lastTime = frame.timestamp;
 
-        outFile->write(",\"" + QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8() + "\"");
-        if (frame->hasExtendedFrameFormat()) outFile->write(",\"Ext\"");
-            else outFile->write(",\"Std\"");
-        outFile->write(",\"\",\"");
-
-        for (int temp = 0; temp < dataLen; temp++)
+        QDateTime tempStamp = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(frame.timestamp / 1000));
+        out.append("\"" + tempStamp.toString("h:m:s.").toUtf8() + tempStamp.toString("z").rightJustified(3, '0').toUtf8() + "\"");
+        out.append(",\"");
+        appendHex(out, frame.frameId(), 8);
+        out.append('"');
+        out.append(frame.hasExtendedFrameFormat() ? ",\"Ext\"" : ",\"Std\"");
+        out.append(",\"\",\"");
+        for (int temp = 0; temp < frame.payloadLength(); temp++)
         {
-            outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            outFile->putChar(' ');
+            appendHex(out, frame.payloadData()[temp], 2);
+            out.append(' ');
         }
+        out.append("\"\n");
+    }
 
-        outFile->write("\"\n");
+private:
+    QDateTime startTime;
+    uint64_t firstTime;
+    uint64_t lastTime;
+    bool haveFrames;
+};
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
 }
 
-bool FrameFileIO::isCANDOFile(QString filename)
+bool FrameFileIO::saveIXXATFile(QString filename, const CANFrameView* frames)
 {
-    QFile *inFile = new QFile(filename);
+    IXXATWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
+}
+
+bool FrameFileIO::isCANDOFile(const QByteArray &prefix)
+{
+    QBuffer inFile;
+    inFile.setData(prefix);
     int lineCounter = 0;
     QByteArray data;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly)) return false;
 
     //this file format is in static 12 byte blocks.
     //Bytes 0 - 1 are a time stamp
@@ -2609,11 +2484,11 @@ bool FrameFileIO::isCANDOFile(QString filename)
     //Bytes 4 - 11 are the data bytes (padded with FF for bytes not used)
     try
     {
-        while (!inFile->atEnd() && lineCounter < 200)
+        while (!inFile.atEnd() && lineCounter < 200)
         {
             lineCounter++;
 
-            data = inFile->read(12);
+            data = inFile.read(12);
 
             int ID = ((data[3] & 0x0F) * 256 + data[2]);
             int len = data[3] >> 4;
@@ -2633,49 +2508,58 @@ bool FrameFileIO::isCANDOFile(QString filename)
         isMatch = false;
     }
 
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
-bool FrameFileIO::loadCANDOFile(QString filename, QVector<CANFrame>* frames)
+namespace {
+
+//this file format is in static 12 byte blocks.
+//Bytes 0 - 1 are a time stamp
+//Bytes 2 - 3 are the data length (top 4 bits) then ID (bottom 11 bits)
+//Bytes 4 - 11 are the data bytes (padded with FF for bytes not used)
+//A block with FFFF for length and ID only sets the time
+const int CANDO_BLOCK = 12;
+
+class CANDOFileReader : public FrameReader
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    int lineCounter = 0;
-    QByteArray data;
-    int timeOffset = 0;
-    int64_t lastTimeStamp = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
+public:
+    CANDOFileReader() : timeOffset(0), lastTimeStamp(0), ok(false) {}
 
-    if (!inFile->open(QIODevice::ReadOnly))
+    bool open(const QString &filename)
     {
-        delete inFile;
-        return false;
+        file.setFileName(filename);
+        ok = file.open(QIODevice::ReadOnly);
+        return ok;
     }
 
-    //this file format is in static 12 byte blocks.
-    //Bytes 0 - 1 are a time stamp
-    //Bytes 2 - 3 are the data length (top 4 bits) then ID (bottom 11 bits)
-    //Bytes 4 - 11 are the data bytes (padded with FF for bytes not used)
-
-    while (!inFile->atEnd())
+    int read(CANFrame *frames, int max) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
+        unsigned char data[CANDO_BLOCK * 256];
+        int done = 0;
+        while (done < max)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            qint64 want = CANDO_BLOCK * qMin(max - done, 256);
+            qint64 got = file.read(reinterpret_cast<char *>(data), want);
+            if (got < 0) ok = false;
+            if (got % CANDO_BLOCK) ok = false; //the file ends part way into a block
+            for (const unsigned char *uData = data; uData + CANDO_BLOCK <= data + got; uData += CANDO_BLOCK)
+            {
+                if (readBlock(uData, frames[done])) done++;
+            }
+            if (got < want) break;
         }
+        return done;
+    }
 
-        data = inFile->read(12);
-        const unsigned char *uData = reinterpret_cast<const unsigned char *>(data.constData());
+    bool isOk() const override { return ok; }
+    qint64 position() const override { return file.isOpen() ? file.pos() : 0; }
+    qint64 size() const override { return file.size(); }
 
-        thisFrame.bus = 0;
-        thisFrame.isReceived = true;
-        thisFrame.setExtendedFrameFormat(false); //format is incapable of extended frames
-        thisFrame.setFrameType(QCanBusFrame::DataFrame);
+private:
+    bool readBlock(const unsigned char *uData, CANFrame &frame)
+    {
+        //the time wraps every minute
         qint64 tempStamp;
         tempStamp = 1000000ul * (uData[0] >> 2);
         tempStamp += (((uData[0] & 3) << 8) + uData[1]) * 1000;
@@ -2683,109 +2567,126 @@ bool FrameFileIO::loadCANDOFile(QString filename, QVector<CANFrame>* frames)
         if (tempStamp < lastTimeStamp)
         {
             timeOffset += 60000000ul;
+            tempStamp += 60000000ul;
         }
         lastTimeStamp = tempStamp;
-        thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, tempStamp));
-        thisFrame.setFrameId(((uData[3] & 0x0F) * 256 + uData[2]) & 0x7FF);
-        int numBytes = uData[3] >> 4;
-        QByteArray bytes(numBytes, 0);
+        if (uData[2] == 0xFF && uData[3] == 0xFF) return false;
 
-        if (numBytes <= 8 && thisFrame.frameId() <= 0x7FF)
+        int numBytes = uData[3] >> 4;
+        if (numBytes > 8)
         {
-            for (int d = 0; d < numBytes; d++) bytes[d] = data[4 + d];
-            thisFrame.setPayload(bytes);
-            frames->append(thisFrame);
+            ok = false;
+            return false;
         }
-        else foundErrors = true;
+        frame = CANFrame();
+        frame.setExtendedFrameFormat(false); //format is incapable of extended frames
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, tempStamp));
+        frame.setFrameId(((uData[3] & 0x0F) * 256 + uData[2]) & 0x7FF);
+        frame.setPayload(uData + 4, numBytes);
+        return true;
     }
 
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+    QFile file;
+    qint64 timeOffset;
+    qint64 lastTimeStamp;
+    bool ok;
+};
+
 }
 
-bool FrameFileIO::saveCANDOFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadCANDOFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    int lineCounter = 0;
-    QByteArray data;
-    CANFrame thisFrame;
-    int id;
-    qint64 ms;
+    CANDOFileReader reader;
+    return reader.open(filename) && readFrames(&reader, frames);
+}
+
+namespace {
 
-    const unsigned char *inData;
-    int inDataLen;
-    const CANFrame *frame;
+//extended frames can't be stored and are left out
+class CANDOWriter : public FrameWriter
+{
+public:
+    CANDOWriter() : started(false) {}
 
-    if (!outFile->open(QIODevice::WriteOnly))
+    bool open(const QString &filename)
     {
-        delete outFile;
-        return false;
+        file.setFileName(filename);
+        return file.open(QIODevice::WriteOnly);
     }
 
-    data.reserve(13);
-
-    //The initial frame in official files sets the global time but I don't care so it is set all zeros here.
-    thisFrame = frames->at(0);
-    ms = (thisFrame.timeStamp().microSeconds() / 1000);
-    data[0] = (((ms / 1000) % 60) << 2) + ((ms % 1000) >> 8);
-    data[1] = (char)(ms & 0xFF);
-    data[2] = (char)0xFF;
-    data[3] = (char)0xFF;
-    for (int l = 0; l < 8; l++) data[4 + l] = 0;
-    outFile->write(data);
-
-    for (int c = 0; c < frames->count(); c++)
+    bool write(const CANFrame *frames, int count) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
+        if (!file.isOpen()) return false;
+        QByteArray data;
+        data.reserve((count + 1) * CANDO_BLOCK);
+        for (int c = 0; c < count; c++)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            const CANFrame &frame = frames[c];
+            //The initial frame in official files sets the global time but I don't care so it is set all zeros here.
+            if (!started)
+            {
+                started = true;
+                appendBlock(data, frame.timestamp, 0xFFF, 0xF, nullptr);
+            }
+            if (!frame.hasExtendedFrameFormat())
+            {
+                appendBlock(data, frame.timestamp, static_cast<int>(frame.frameId() & 0x7FF), qMin(frame.payloadLength(), 8), frame.payloadData());
+            }
         }
+        return file.write(data) == data.size();
+    }
 
-        frame = &frames->at(c);
-        inData = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        inDataLen = frame->payload().count();
-
-        for (int j = 0; j < 8; j++) data[4 + j] = (char)0xFF;
+    bool finish() override
+    {
+        if (!file.isOpen()) return false;
+        file.close();
+        return file.error() == QFileDevice::NoError;
+    }
 
-        if (!frame->hasExtendedFrameFormat())
+private:
+    //bytes is null for the time block, which has FFFF for length and ID and zeros for data
+    static void appendBlock(QByteArray &data, uint64_t timestamp, int id, int len, const unsigned char *bytes)
+    {
+        qint64 ms = static_cast<qint64>(timestamp / 1000);
+        data.append(static_cast<char>((((ms / 1000) % 60) << 2) + ((ms % 1000) >> 8)));
+        data.append(static_cast<char>((ms % 1000) & 0xFF));
+        data.append(static_cast<char>(id & 0xFF));
+        data.append(static_cast<char>((id >> 8) + (len << 4)));
+        for (int d = 0; d < 8; d++)
         {
-            ms = (frame->timeStamp().microSeconds() / 1000);
-            id = frame->frameId() & 0x7FF;
-            data[0] = (((ms / 1000) % 60) << 2) + ((ms % 1000) >> 8);
-            data[1] = (char)(ms & 0xFF);
-            data[2] = (char)(id & 0xFF);
-            data[3] = (char)((id >> 8) + (inDataLen << 4));
-            for (int d = 0; d < inDataLen; d++) data[4 + d] = (char)inData[d];
-            outFile->write(data);
+            if (!bytes) data.append('\0');
+            else data.append(d < len ? static_cast<char>(bytes[d]) : static_cast<char>(0xFF));
         }
     }
-    outFile->close();
-    delete outFile;
-    return true;
+
+    QFile file;
+    bool started;
+};
+
+}
+
+bool FrameFileIO::saveCANDOFile(QString filename, const CANFrameView* frames)
+{
+    CANDOWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
-bool FrameFileIO::isMicrochipFile(QString filename)
+bool FrameFileIO::isMicrochipFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     bool inComment = false;
     int lineCounter = 0;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        while (!inFile->atEnd() && lineCounter < 100) {
+        while (!inFile.atEnd() && lineCounter < 100) {
             lineCounter++;
 
-            line = inFile->readLine();
+            line = inFile.readLine();
             if (line.length() > 2)
             {
                 if (line.startsWith("//"))
@@ -2815,11 +2716,12 @@ bool FrameFileIO::isMicrochipFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
+namespace {
+
 //log file from microchip tool
 /*
 tokens:
@@ -2829,74 +2731,64 @@ tokens:
 3 = Data byte length
 4-x = The data bytes
 */
-bool FrameFileIO::loadMicrochipFile(QString filename, QVector<CANFrame>* frames)
+//the header is the blocks between pairs of "//" lines at the top of the file
+class MicrochipGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    bool inComment = false;
-    long long timeStamp;
-    int lineCounter = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
-
-    //line = inFile->readLine(); //read out the header first and discard it.
-
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-
-        line = inFile->readLine();
-        if (line.length() > 2)
-        {
-            if (line.startsWith("//"))
+public:
+    qint64 headerLength(const char *data, qint64 size) override
+    {
+        qint64 pos = 0;
+        bool inComment = false;
+        while (pos < size)
+        {
+            qint64 len = lineLength(data + pos, size - pos);
+            const char *b = data + pos;
+            const char *e = b + len;
+            while (e > b && (e[-1] == '\n' || e[-1] == '\r')) e--;
+            if (e - b >= 2)
             {
-                inComment = !inComment;
-            }
-            else
-            {
-                if (!inComment)
-                {
-                    QList<QByteArray> tokens = line.split(';');
-                    if (tokens.length() >= 4)
-                    {
-                        timeStamp = tokens[0].toInt() * 1000;
-                        thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp));
-                        if (tokens[1].at(0) == 'R') thisFrame.isReceived = true;
-                            else thisFrame.isReceived = false;
-                        thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                        thisFrame.setFrameId(static_cast<quint32>( Utility::ParseStringToNum(tokens[2])) );
-                        if (thisFrame.frameId() <= 0x7FF) thisFrame.setExtendedFrameFormat(false);
-                            else thisFrame.setExtendedFrameFormat(true);
-                        thisFrame.bus = 0;
-                        int numBytes = tokens[3].toInt();
-                        QByteArray bytes(numBytes, 0);
-                        if (thisFrame.payload().length() > 8) thisFrame.payload().resize(8);
-                        if (thisFrame.payload().length() + 4 > tokens.length()) thisFrame.payload().resize( tokens.length() - 4 );
-                        for (int d = 0; d < numBytes; d++) bytes[d] = static_cast<char>( Utility::ParseStringToNum(tokens[4 + d]) );
-                        thisFrame.setPayload(bytes);
-                        frames->append(thisFrame);
-                    }
-                    else foundErrors = true;
-                }
+                if (b[0] == '/' && b[1] == '/') inComment = !inComment;
+                else if (!inComment) break;
             }
+            pos += len;
         }
+        return pos;
+    }
+
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        if (end - begin < 2 || (begin[0] == '/' && begin[1] == '/')) return LINE_SKIP;
+        TextTokens tokens;
+        tokens.split(begin, end, ';');
+        if (tokens.count() < 4) return LINE_ERROR;
+
+        int value;
+        tokens.toInt(0, value);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value) * 1000));
+        frame.isReceived = (tokens.first(1) == 'R');
+        frame.setFrameId(static_cast<uint32_t>(parseNumber(tokens.begin(2), tokens.end(2))));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
+
+        int numBytes;
+        tokens.toInt(3, numBytes);
+        numBytes = qBound(0, numBytes, qMin(8, tokens.count() - 4));
+        unsigned char bytes[8];
+        for (int d = 0; d < numBytes; d++) bytes[d] = static_cast<unsigned char>(parseNumber(tokens.begin(4 + d), tokens.end(4 + d)));
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+};
+
+}
+
+bool FrameFileIO::loadMicrochipFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new MicrochipGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
+namespace {
+
 /*
 1247;RX;0xC2;8;0x5C;0x87;0x00;0x00;0x01;0x00;0x00;0x1C
 1218;RX;0x236;1;0x00;0x00;0x00;0x00;0x00;0x00;0x00;0xF0
@@ -2908,85 +2800,65 @@ tokens:
 3 = data length
 4-x = data bytes in hex with 0x prefix
 */
-bool FrameFileIO::saveMicrochipFile(QString filename, const QVector<CANFrame>* frames)
+class MicrochipWriter : public TextFrameWriter
 {
-    QFile *outFile = new QFile(filename);
-    QDateTime timestamp, tempStamp;
-    int lineCounter = 0;
-
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
-
-    timestamp = QDateTime::currentDateTime();
-
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
     {
-        delete outFile;
-        return false;
+        Q_UNUSED(first);
+        out.append("//---------------------------------\n");
+        out.append("Microchip Technology Inc.\n");
+        out.append("CAN BUS Analyzer\n");
+        out.append("CANOpenAnalyzer Exporter\n");
+        out.append("Logging Started: ");
+        out.append(QDateTime::currentDateTime().toString("d/M/yyyy h:m:s").toUtf8());
+        out.append("\n");
+        out.append("//---------------------------------\n");
     }
 
-    outFile->write("//---------------------------------\n");
-    outFile->write("Microchip Technology Inc.\n");
-    outFile->write("CAN BUS Analyzer\n");
-    outFile->write("CANOpenAnalyzer Exporter\n");
-    outFile->write("Logging Started: ");
-    outFile->write(timestamp.toString("d/M/yyyy h:m:s").toUtf8());
-    outFile->write("\n");
-    outFile->write("//---------------------------------\n");
-
-    for (int c = 0; c < frames->count(); c++)
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-        outFile->write(QString::number((frame->timeStamp().microSeconds() / 1000)).toUtf8());
-        if (frame->isReceived) outFile->write(";RX;");
-        else outFile->write(";TX;");
-        outFile->write("0x" + QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8() + ";");
-        outFile->write(QString::number(dataLen).toUtf8() + ";");
-
-        for (int temp = 0; temp < dataLen; temp++)
+        out.append(QByteArray::number(static_cast<qlonglong>(frame.timestamp / 1000)));
+        out.append(frame.isReceived ? ";RX;" : ";TX;");
+        out.append("0x");
+        appendHex(out, frame.frameId(), 8);
+        out.append(';');
+        out.append(QByteArray::number(frame.payloadLength()));
+        out.append(';');
+        for (int temp = 0; temp < frame.payloadLength(); temp++)
         {
-            outFile->write("0x" + QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            outFile->putChar(';');
+            out.append("0x");
+            appendHex(out, frame.payloadData()[temp], 2);
+            out.append(';');
         }
+        out.append('\n');
+    }
+};
 
-        outFile->write("\n");
+}
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
+bool FrameFileIO::saveMicrochipFile(QString filename, const CANFrameView* frames)
+{
+    MicrochipWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
-bool FrameFileIO::isTraceFile(QString filename)
+bool FrameFileIO::isTraceFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        while (!inFile->atEnd() && lineCounter < 100) {
+        while (!inFile.atEnd() && lineCounter < 100) {
             lineCounter++;
 
-            line = inFile->readLine();
+            line = inFile.readLine();
             line = line.trimmed();
             if (line.length() > 2)
             {
@@ -3019,8 +2891,7 @@ bool FrameFileIO::isTraceFile(QString filename)
         isMatch = false;
     }
 
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -3053,237 +2924,182 @@ and irrelevant. The second field is a funky timestamp, then message id, etc as
 shown in the file comments. The bytes seem to be space delimited and in hex
 */
 
-bool FrameFileIO::loadTraceFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    long long timeStamp = 0;
-    int lineCounter = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+namespace {
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
+class TraceGrammar : public TextLogGrammar
+{
+public:
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens::trim(begin, end);
+        if (end - begin <= 2 || *begin == ';') return LINE_SKIP; //a comment. Ignore it.
+        TextTokens tokens;
+        tokens.split(begin, end, '\t');
+        if (tokens.count() <= 3) return LINE_ERROR;
+
+        TextTokens timestampToks;
+        timestampToks.split(tokens.begin(1), tokens.end(1), ':');
+        if (timestampToks.count() < 4) return LINE_ERROR;
+        uint64_t hours, minutes, seconds, tenths;
+        timestampToks.toUInt(0, hours);
+        timestampToks.toUInt(1, minutes);
+        timestampToks.toUInt(2, seconds);
+        timestampToks.toUInt(3, tenths);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(hours * 1000000l * 60 * 60 + minutes * 1000000l * 60
+                                                                          + seconds * 1000000l + tenths * 100)));
+
+        uint64_t value;
+        tokens.toHex(2, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
+        int numBytes;
+        tokens.toInt(3, numBytes);
+        numBytes = qBound(0, numBytes, 8);
+
+        TextTokens dataToks;
+        if (tokens.count() > 4) dataToks.splitWhitespace(tokens.begin(4), tokens.end(4));
+        if (dataToks.count() < numBytes) return LINE_DAMAGED;
+        unsigned char bytes[8];
+        for (int d = 0; d < numBytes; d++)
+        {
+            dataToks.toHex(d, value);
+            bytes[d] = static_cast<unsigned char>(value);
+        }
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
+    }
+};
 
-        line = inFile->readLine();
-        line = line.trimmed();
-        if (line.length() > 2)
-        {
-            if (line.startsWith(";"))
-            {
-                // a comment. Ignore it.
-            }
-            else
-            {
-                QList<QByteArray> tokens = line.split('\t');
-                if (tokens.length() > 3)
-                {
-                    QList<QByteArray> timestampToks = tokens[1].split(':');
-
-                    timeStamp = timestampToks[0].toInt() * 1000000l * 60 * 60;
-                    timeStamp += timestampToks[1].toInt() * 1000000l * 60;
-                    timeStamp += timestampToks[2].toInt() * 1000000l;
-                    timeStamp += timestampToks[3].toInt() * 100;
-
-                    thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<uint32_t>(timeStamp)));
-
-                    thisFrame.setFrameId(static_cast<uint32_t>(tokens[2].toLong(nullptr, 16)));
-                    if (thisFrame.frameId() <= 0x7FF) thisFrame.setExtendedFrameFormat(false);
-                        else thisFrame.setExtendedFrameFormat(true);
-                    thisFrame.bus = 0;
-                    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                    int numBytes = tokens[3].toInt();
-                    if (numBytes > 8) numBytes = 8;
-                    QByteArray bytes(numBytes, 0);
-                    QList<QByteArray> dataToks = tokens[4].split(' ');
-                    //if (numBytes > dataToks.length()) thisFrame.payload().resize(dataToks.length());
-                    for (int d = 0; d < numBytes; d++) bytes[d] = static_cast<char>(dataToks[d].toInt(nullptr, 16));
-                    thisFrame.setPayload(bytes);
-                    frames->append(thisFrame);
-                }
-                else foundErrors = true;
-            }
-        }
-    }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
 }
 
-bool FrameFileIO::saveTraceFile(QString filename, const QVector<CANFrame> * frames)
+bool FrameFileIO::loadTraceFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    QDateTime timestamp;
-    int lineCounter = 0;
-    int64_t tempTime;
-    int tempTimePiece;
-
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
-
-    timestamp = QDateTime::currentDateTime();
-
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        delete outFile;
-        return false;
-    }
-
-    outFile->write(";  CANOpenAnalyzer CAN Logger trace file\n");
-    outFile->write(";  Device Serial Number : 0000 \n");
-    outFile->write(";  Start Time : ");
-    outFile->write(timestamp.toString("ddd, MMM dd, yyyy :: h:m:s\n").toUtf8());
-    outFile->write(";\n");
-    outFile->write(";  Column description :\n");
-    outFile->write(";  ~~~~~~~~~~~~~~~~~~~~~\n");
-    outFile->write(";\n");
-    outFile->write(";   + Message Number\n");
-    outFile->write(";   |\n");
-    outFile->write(";   |     	     + Time Stamp (ms)\n");
-    outFile->write(";   |     	     |\n");
-    outFile->write(";   |     	     |      	    + Message ID (hex)\n");
-    outFile->write(";   |     	     |      	    |\n");
-    outFile->write(";   |     	     |      	    |   	+ Data Length Code\n");
-    outFile->write(";   |     	     |      	    |   	|\n");
-    outFile->write(";   |     	     |      	    |   	|	 + Data Bytes (hex)\n");
-    outFile->write(";   |     	     |      	    |   	|	 |\n");
-    outFile->write(";---+-----	-----+------	----+---	+	-+ -- -- -- -- -- -- --\n");
+    TextLogReader reader(new TraceGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
+namespace {
 
-    for (int c = 0; c < frames->count(); c++)
+class TraceWriter : public TextFrameWriter
+{
+public:
+    TraceWriter() : lineCounter(0) {}
+
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
+    {
+        Q_UNUSED(first);
+        out.append(";  CANOpenAnalyzer CAN Logger trace file\n");
+        out.append(";  Device Serial Number : 0000 \n");
+        out.append(";  Start Time : ");
+        out.append(QDateTime::currentDateTime().toString("ddd, MMM dd, yyyy :: h:m:s\n").toUtf8());
+        out.append(";\n");
+        out.append(";  Column description :\n");
+        out.append(";  ~~~~~~~~~~~~~~~~~~~~~\n");
+        out.append(";\n");
+        out.append(";   + Message Number\n");
+        out.append(";   |\n");
+        out.append(";   |     	     + Time Stamp (ms)\n");
+        out.append(";   |     	     |\n");
+        out.append(";   |     	     |      	    + Message ID (hex)\n");
+        out.append(";   |     	     |      	    |\n");
+        out.append(";   |     	     |      	    |   	+ Data Length Code\n");
+        out.append(";   |     	     |      	    |   	|\n");
+        out.append(";   |     	     |      	    |   	|	 + Data Bytes (hex)\n");
+        out.append(";   |     	     |      	    |   	|	 |\n");
+        out.append(";---+-----	-----+------	----+---	+	-+ -- -- -- -- -- -- --\n");
+    }
+
+    //    1	00:00:00:0021	0000000E	8	1F D3 3F FF 08 FF E0 CB
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
         lineCounter++;
-        if ((lineCounter % 100) == 0)
-        {
-            qApp->processEvents();
-            //lineCounter = 0;
-        }
+        out.append(QByteArray::number(lineCounter).rightJustified(10, ' '));
+        out.append('\t');
 
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-         //1F D3 3F FF 08 FF E0 CB
-        outFile->write(QString::number(lineCounter).rightJustified(10, ' ').toUtf8());
-        outFile->write("\t");
-
-        tempTime = frame->timeStamp().microSeconds();
-        tempTimePiece = static_cast<int>(tempTime / 1000000l / 60 / 60);
+        int64_t tempTime = static_cast<int64_t>(frame.timestamp);
+        int tempTimePiece = static_cast<int>(tempTime / 1000000l / 60 / 60);
         tempTime -= tempTimePiece * 1000000l * 60 * 60;
-        outFile->write(QString::number(tempTimePiece).rightJustified(2, '0').toUtf8());
-        outFile->write(":");
+        out.append(QByteArray::number(tempTimePiece).rightJustified(2, '0'));
+        out.append(':');
 
         tempTimePiece = static_cast<int>(tempTime / 1000000l / 60);
         tempTime -= tempTimePiece * 1000000l * 60;
-        outFile->write(QString::number(tempTimePiece).rightJustified(2, '0').toUtf8());
-        outFile->write(":");
+        out.append(QByteArray::number(tempTimePiece).rightJustified(2, '0'));
+        out.append(':');
 
         tempTimePiece = static_cast<int>(tempTime / 1000000l);
         tempTime -= tempTimePiece * 1000000l;
-        outFile->write(QString::number(tempTimePiece).rightJustified(2, '0').toUtf8());
-        outFile->write(":");
+        out.append(QByteArray::number(tempTimePiece).rightJustified(2, '0'));
+        out.append(':');
 
         tempTimePiece = static_cast<int>(tempTime / 100);
-        outFile->write(QString::number(tempTimePiece).rightJustified(4, '0').toUtf8());
-        outFile->write("\t");
-
-        outFile->write(QString::number(frame->frameId(), 16).toUpper().rightJustified(8, '0').toUtf8() + "\t");
-
-        outFile->write(QString::number(dataLen).toUtf8() + "\t");
+        out.append(QByteArray::number(tempTimePiece).rightJustified(4, '0'));
+        out.append('\t');
 
-        for (int temp = 0; temp < dataLen; temp++)
+        appendHex(out, frame.frameId(), 8);
+        out.append('\t');
+        out.append(QByteArray::number(frame.payloadLength()));
+        out.append('\t');
+        for (int temp = 0; temp < frame.payloadLength(); temp++)
         {
-            outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            outFile->putChar(' ');
+            appendHex(out, frame.payloadData()[temp], 2);
+            out.append(' ');
         }
+        out.append('\n');
+    }
 
-        outFile->write("\n");
+private:
+    int lineCounter;
+};
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
 }
 
-bool FrameFileIO::saveCanDumpFile(QString filename, const QVector<CANFrame> * frames)
+bool FrameFileIO::saveTraceFile(QString filename, const CANFrameView* frames)
 {
-    QFile *outFile = new QFile(filename);
-    QDateTime timestamp;
-    int lineCounter = 0;
-    double tempTime;
-
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
-
-    timestamp = QDateTime::currentDateTime();
+    TraceWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
+}
 
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        delete outFile;
-        return false;
-    }
+namespace {
 
-    for (int c = 0; c < frames->count(); c++)
+class CanDumpWriter : public TextFrameWriter
+{
+protected:
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
-        lineCounter++;
-        if ((lineCounter % 100) == 0)
+        QByteArray time;
+        appendSeconds(time, static_cast<int64_t>(frame.timestamp), 6);
+        out.append('(');
+        out.append(time.rightJustified(17, '0'));
+        out.append(") vcan0 ");
+        appendHex(out, frame.frameId(), frame.hasExtendedFrameFormat() ? 8 : 3);
+        out.append('#');
+        if (frame.frameType() == QCanBusFrame::RemoteRequestFrame)
         {
-            qApp->processEvents();
-        }
-
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
-
-        outFile->write("(");
-
-        tempTime = frame->timeStamp().microSeconds() / 1000000.0;
-        outFile->write(QString::number(tempTime,'f', 6).rightJustified(17, '0').toUtf8());
-        outFile->write(") vcan0 ");
-
-        if (frame->hasExtendedFrameFormat()) {
-            outFile->write(QString::number(frame->frameId(), 16).rightJustified(8,'0').toUpper().toUtf8());
-        } else {
-            outFile->write(QString::number(frame->frameId(), 16).rightJustified(3,'0').toUpper().toUtf8());
+            out.append('R');
+            out.append(QByteArray::number(frame.payloadLength()));
         }
-
-        outFile->write("#");
-
-        if (frame->frameType() == QCanBusFrame::RemoteRequestFrame) {
-            outFile->write("R");
-            outFile->write(QString::number(dataLen).toUtf8());
-        } else {
-            for (int temp = 0; temp < dataLen; temp++)
-            {
-                outFile->write(QString::number(data[temp], 16).rightJustified(2,'0').toUpper().toUtf8());
-            }
+        else
+        {
+            for (int temp = 0; temp < frame.payloadLength(); temp++) appendHex(out, frame.payloadData()[temp], 2);
         }
+        out.append('\n');
+    }
+};
 
-        outFile->write("\n");
+}
 
-    }
-    outFile->close();
-    delete outFile;
-    return true;
+bool FrameFileIO::saveCanDumpFile(QString filename, const CANFrameView* frames)
+{
+    CanDumpWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
 }
 
-bool FrameFileIO::isCanDumpFile(QString filename)
+bool FrameFileIO::isCanDumpFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     QList<QByteArray> tokens;
     QRegExp timeExp("^\\((\\S+)\\)$");
@@ -3294,18 +3110,14 @@ bool FrameFileIO::isCanDumpFile(QString filename)
     bool isMatch = true;
     bool ret;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        while (!inFile->atEnd() && lineCounter < 100) {
+        while (!inFile.atEnd() && lineCounter < 100) {
             lineCounter++;
 
-            line = inFile->readLine().toUpper();
+            line = inFile.readLine().toUpper();
             if (line.length() > 1)
             {
                 /* tokenize */
@@ -3397,8 +3209,7 @@ bool FrameFileIO::isCanDumpFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
@@ -3407,134 +3218,100 @@ bool FrameFileIO::isCanDumpFile(QString filename)
                        or
    (1551774790.942758) can1 7A8 [8] F4 DC D1 83 0E 02 00 00
 */
-bool FrameFileIO::loadCanDumpFile(QString filename, QVector<CANFrame>* frames)
-{
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    QList<QByteArray> tokens;
-    QRegExp timeExp("^\\((\\S+)\\)$");
-    QRegExp IdValExp("^(\\S+)#(\\S+)$");
-    QRegExp valExp("(\\S{2})");
-    int lineCounter = 0;
-    int pos = 0;
-    bool ret;
-
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+namespace {
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
+//candump -l / Kayak: "(<seconds>) canX <id>#<data>" or the expanded "(<seconds>) canX <id> [len] <data bytes>"
+class CanDumpGrammar : public TextLogGrammar
+{
+public:
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens tokens;
+        tokens.splitWhitespace(begin, end);
+        if (tokens.count() < 3) return LINE_SKIP;
+
+        /* timestamp */
+        if (tokens.length(0) < 3 || tokens.first(0) != '(' || tokens.end(0)[-1] != ')') return LINE_SKIP;
+        uint64_t value;
+        if (!TextTokens::parseSecondsUs(tokens.begin(0) + 1, tokens.end(0) - 1, value)) return LINE_SKIP;
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value)));
+
+        frame.isReceived = true;
+        frame.bus = 0;
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        int numBytes = 0;
+
+        if (memchr(begin, '[', static_cast<size_t>(end - begin))) //the expanded format
+        {
+            //(1551774790.942758) can1 7A8 [8] F4 DC D1 83 0E 02 00 00
+            //     0               1     2   3  4 5  6  7  8  9  10 11
+            tokens.toHex(2, value);
+            frame.setFrameId(static_cast<uint32_t>(value));
+            frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
+            numBytes = (tokens.count() > 3 && tokens.length(3) > 1) ? tokens.begin(3)[1] - '0' : 0;
+            numBytes = qBound(0, numBytes, 8);
+            for (int c = 0; c < numBytes; c++)
+            {
+                value = 0;
+                if ((4 + c) < tokens.count()) tokens.toHex(4 + c, value);
+                bytes[c] = static_cast<unsigned char>(value);
+            }
         }
-
-        line = inFile->readLine().toUpper();
-        if (line.length() > 1)
+        else //the concise format
         {
-            /* tokenize */
-            tokens.clear();
-            tokens = line.simplified().split(' ');
-            if(tokens.count()<3) continue;
+            /* ID & value */
+            const char *hash = static_cast<const char *>(memchr(tokens.begin(2), '#', static_cast<size_t>(tokens.length(2))));
+            if (!hash || hash == tokens.begin(2)) return LINE_SKIP; //nothing after the # is a frame without data
 
-            /* timestamp */
-            ret = timeExp.exactMatch(tokens[0]);
-            if(!ret) continue;
+            TextTokens::parseHex(tokens.begin(2), hash, value);
+            frame.setFrameId(static_cast<uint32_t>(value));
+            frame.setExtendedFrameFormat(hash - tokens.begin(2) > 3);
 
-            thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, (uint64_t)(timeExp.cap(1).toDouble(&ret) * (double)1000000.0)));
-            if(!ret) continue;
-
-            if (line.contains('[')) //the expanded format (second one from the above list)
+            const char *val = hash + 1;
+            const char *valEnd = tokens.end(2);
+            if ((*val == 'R' || *val == 'r') && val + 1 < valEnd && val[1] >= '0' && val[1] <= '9')
             {
-                //(1551774790.942758) can1 7A8 [8] F4 DC D1 83 0E 02 00 00
-                //     0               1     2   3  4 5  6  7  8  9  10 11
-                thisFrame.setFrameId(tokens[2].toLong(nullptr, 16));
-                if (thisFrame.frameId() > 0x7FF) thisFrame.setExtendedFrameFormat(true);
-                else thisFrame.setExtendedFrameFormat(false);
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                int numBytes = tokens[3].at(1) - '0';
-                QByteArray bytes(numBytes, 0);
-                for (int c = 0; c < numBytes; c++)
-                {
-                    if ((4 + c) < tokens.size()) bytes[c] = static_cast<char>(tokens[4 + c].toInt(nullptr, 16));
-                }
-                thisFrame.setPayload(bytes);
+                frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
             }
-            else  //the more concise format (first one from list above)
+            else
             {
-                /* ID & value */
-                //qDebug() << tokens[2];
-                ret = IdValExp.exactMatch(tokens[2]);
-                if(!ret)
+                /* val byte per byte */
+                for (; val + 1 < valEnd && numBytes < CANFRAME_MAX_PAYLOAD; val += 2)
                 {
-                    qDebug() << "ID regex didn't match!";
-                    continue;
-                }
-
-                /* ID */
-                thisFrame.setFrameId(static_cast<uint32_t>(IdValExp.cap(1).toInt(&ret, 16)));
-                if (IdValExp.cap(1).length() > 3) {
-                    thisFrame.setExtendedFrameFormat(true);
-                } else {
-                    thisFrame.setExtendedFrameFormat(false);
-                }
-
-                QString val= IdValExp.cap(2);
-
-                pos = 0;
-                QByteArray bytes;
-                if (val.startsWith("R") && val.at(1).isDigit()) {
-                    thisFrame.payload().resize( val.at(1).toLatin1() - '0' );
-                    thisFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
-                } else {
-                    thisFrame.setFrameType(QCanBusFrame::DataFrame);
-                    /* val byte per byte */
-                    while ((pos = valExp.indexIn(val, pos)) != -1)
-                    {
-                        bytes.append((char)valExp.cap(1).toInt(&ret, 16));
-                        if(!ret) continue;
-
-                        pos += valExp.matchedLength();
-                    }
+                    TextTokens::parseHex(val, val + 2, value);
+                    bytes[numBytes++] = static_cast<unsigned char>(value);
                 }
-                thisFrame.setPayload(bytes);
             }
-
-            /*NB: should we make sure len <= 8? */
-            thisFrame.isReceived = true;
-            thisFrame.bus = 0;
-       }
-       frames->append(thisFrame);
+        }
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
     }
-    inFile->close();
-    delete inFile;
-    return true;
+};
+
+}
+
+bool FrameFileIO::loadCanDumpFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new CanDumpGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isLawicelFile(QString filename)
+bool FrameFileIO::isLawicelFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = false;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
 
     try
     {
-        while (!inFile->atEnd() && lineCounter < 100) {
+        while (!inFile.atEnd() && lineCounter < 100) {
             lineCounter++;
 
-            line = inFile->readLine().toUpper();
+            line = inFile.readLine().toUpper();
             if (line.length() > 4 && !line.startsWith("S"))
             {
                 int ID = line.mid(0, 3).toInt(nullptr, 16);
@@ -3551,88 +3328,87 @@ bool FrameFileIO::isLawicelFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
+namespace {
+
 /*Example line:
 1D5210000000000E0D7
 The first three digits are the ID, all bytes are then two hex digits after that. So, the length is determined by line length
 Skip all lines that start with an S
 */
-bool FrameFileIO::loadLawicelFile(QString filename, QVector<CANFrame>* frames)
+class LawicelGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    bool foundErrors = false;
-    quint64 timeStamp = 0;
+public:
+    LawicelGrammar() : timeStamp(0) {}
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
     {
-        delete inFile;
-        return false;
+        TextTokens::trim(begin, end);
+        if (end - begin <= 4 || *begin == 'S') return LINE_SKIP;
+
+        uint64_t value;
+        TextTokens::parseHex(begin, begin + 3, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(false);
+        begin += 3;
+        int numBytes = qMin(static_cast<int>((end - begin) / 2), CANFRAME_MAX_PAYLOAD);
+        unsigned char bytes[CANFRAME_MAX_PAYLOAD];
+        for (int d = 0; d < numBytes; d++)
+        {
+            TextTokens::parseHex(begin + d * 2, begin + d * 2 + 2, value);
+            bytes[d] = static_cast<unsigned char>(value);
+        }
+        frame.setPayload(bytes, numBytes);
+        return LINE_FRAME;
     }
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-        line = inFile->readLine().simplified();
-        if (line.length() > 4 && !line.startsWith("S"))
-        {
-            thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, timeStamp += 100));
-            thisFrame.setFrameId( line.mid(0, 3).toInt(nullptr, 16) );
-            thisFrame.setExtendedFrameFormat(false);
-            thisFrame.isReceived = true;
-            thisFrame.setFrameType(QCanBusFrame::DataFrame);
-            thisFrame.bus = 0;
-            line.remove(0, 3);
-            int numBytes = line.length() / 2;
-            QByteArray bytes(numBytes, 0);
-            for (int d = 0; d < numBytes; d++)
-            {
-                bytes[d] = static_cast<char>(line.mid(d * 2, 2).toInt(nullptr, 16));
-            }
-            thisFrame.setPayload(bytes);
-            frames->append(thisFrame);
+    //there are no timestamps, the frames are put 100us apart
+    void finishFrames(CANFrame *frames, int count) override
+    {
+        for (int i = 0; i < count; i++)
+        {
+            timeStamp += 100;
+            frames[i].setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(timeStamp)));
         }
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+private:
+    uint64_t timeStamp;
+};
+
+}
+
+bool FrameFileIO::loadLawicelFile(QString filename, QVector<CANFrame>* frames)
+{
+    TextLogReader reader(new LawicelGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isKvaserFile(QString filename)
+bool FrameFileIO::isKvaserFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        line = inFile->readLine().simplified().toUpper();
+        line = inFile.readLine().simplified().toUpper();
         if (!line.contains("CHN")) isMatch = false;
         if (!line.contains("FLG")) isMatch = false;
         if (!line.contains("D0")) isMatch = false;
 
-        if (inFile->atEnd()) isMatch = false;
+        if (inFile.atEnd()) isMatch = false;
 
-        while (!inFile->atEnd() && lineCounter < 10) {
+        while (!inFile.atEnd() && lineCounter < 10) {
             lineCounter++;
 
-            line = inFile->readLine().toUpper();
+            line = inFile.readLine().toUpper();
 
             if (line.length() > 70) {
                 //Chn Identifier Flg   DLC  D0...1...2...3...4...5...6..D7       Time     Dir
@@ -3647,95 +3423,95 @@ bool FrameFileIO::isKvaserFile(QString filename)
     {
         isMatch = false;
     }
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
+namespace {
+
 //Chn Identifier Flg   DLC  D0...1...2...3...4...5...6..D7       Time     Dir
 // 0    000000AD         8  FF  FF  00  00  00  00  00  00     154.266550 R
-bool FrameFileIO::loadKvaserFile(QString filename, QVector<CANFrame> *frames, bool useHex)
+//the ID and data bytes are in decimal or hex, the file doesn't say which
+class KvaserGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    int lineCounter = 0;
-    int base = 10;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
+public:
+    explicit KvaserGrammar(bool useHex) : useHex(useHex) {}
 
-    if (useHex) base = 16;
+    qint64 headerLength(const char *data, qint64 size) override { return lineLength(data, size); }
+    bool requiresFrames() const override { return true; }
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
     {
-        delete inFile;
-        return false;
-    }
+        if (end - begin < 70) return LINE_SKIP;
 
-    //ignore header
-    line = inFile->readLine().simplified().toUpper();
+        uint64_t value;
+        const char *b = begin;
+        const char *e = end;
+        lineColumn(b, e, 0, 3);
+        TextTokens::parseUInt(b, e, value);
+        frame.bus = static_cast<int>(value);
+        frame.setFrameId(static_cast<uint32_t>(column(begin, end, 4, 10)));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7FF);
 
-    if (inFile->atEnd()) foundErrors = true;
+        b = begin;
+        e = end;
+        lineColumn(b, e, 21, 3);
+        TextTokens::parseUInt(b, e, value);
+        int numBytes = qMin(static_cast<int>(value), 8);
+        unsigned char bytes[8];
+        for (int i = 0; i < numBytes; i++) bytes[i] = static_cast<unsigned char>(column(begin, end, 25 + i * 4, 3));
+        frame.setPayload(bytes, numBytes);
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
-        line = inFile->readLine().toUpper();
-
-        qDebug() << line.length();
-
-        if (line.length() > 70) {
-            //Chn Identifier Flg   DLC  D0...1...2...3...4...5...6..D7       Time     Dir
-            // 0    000000AD         8  FF  FF  00  00  00  00  00  00     154.266550 R
-            thisFrame.bus = line.mid(0,3).simplified().toInt();
-            thisFrame.setFrameId(line.mid(4,10).simplified().toInt(nullptr, base));
-            if (thisFrame.frameId() > 0x7FF) thisFrame.setExtendedFrameFormat(true);
-                else thisFrame.setExtendedFrameFormat(false);
-            thisFrame.setFrameType(QCanBusFrame::DataFrame);
-            int numBytes = line.mid(21, 3).simplified().toInt();
-            QByteArray bytes(numBytes, 0);
-            for (int i = 0; i < numBytes; i++) {
-                bytes[i] = line.mid(25 + i * 4, 3).simplified().toInt(nullptr, base);
-            }
-            thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, line.mid(57, 14).simplified().toDouble() * 1000000));
-            if (line.mid(72, 1).toUpper() == "R") thisFrame.isReceived = true;
-                else thisFrame.isReceived = false;
-            thisFrame.setPayload(bytes);
-            frames->append(thisFrame);
-        }
-        //else foundErrors = true;
+        b = begin;
+        e = end;
+        lineColumn(b, e, 57, 14);
+        TextTokens::parseSecondsUs(b, e, value);
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(value)));
+        frame.isReceived = (end - begin > 72 && (begin[72] == 'R' || begin[72] == 'r'));
+        return LINE_FRAME;
+    }
+
+private:
+    //a number column in the base of the file
+    uint64_t column(const char *begin, const char *end, int pos, int len) const
+    {
+        uint64_t value = 0;
+        lineColumn(begin, end, pos, len);
+        if (useHex) TextTokens::parseHex(begin, end, value);
+        else TextTokens::parseUInt(begin, end, value);
+        return value;
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+    bool useHex;
+};
+
+}
+
+bool FrameFileIO::loadKvaserFile(QString filename, QVector<CANFrame> *frames, bool useHex)
+{
+    TextLogReader reader(new KvaserGrammar(useHex));
+    return reader.open(filename) && readFrames(&reader, frames);
 }
 
-bool FrameFileIO::isCabanaFile(QString filename)
+bool FrameFileIO::isCabanaFile(const QByteArray &prefix)
 {
-    QFile *inFile = new QFile(filename);
+    QBuffer inFile;
+    inFile.setData(prefix);
     QByteArray line;
     int lineCounter = 0;
     bool isMatch = true;
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
     try
     {
-        line = inFile->readLine().toUpper(); //read out the header first and discard it.
+        line = inFile.readLine().toUpper(); //read out the header first and discard it.
         if (!line.contains("TIME")) isMatch = false;
         if (!line.contains("ADDR")) isMatch = false;
 
-        while (!inFile->atEnd() || lineCounter < 100) {
+        while (!inFile.atEnd() || lineCounter < 100) {
             lineCounter++;
 
-            line = inFile->readLine().simplified();
+            line = inFile.readLine().simplified();
             if (line.length() > 2)
             {
                 QList<QByteArray> tokens = line.split(',');
@@ -3753,11 +3529,12 @@ bool FrameFileIO::isCabanaFile(QString filename)
         isMatch = false;
     }
 
-    inFile->close();
-    delete inFile;
+    inFile.close();
     return isMatch;
 }
 
+namespace {
+
 //Cabana uses a CSV file with four columns
 //time,addr,bus,data
 //time is in seconds, with quite a bit of resolution after the decimal point. Does not start at 0, probably time-since-boot?
@@ -3765,153 +3542,259 @@ bool FrameFileIO::isCabanaFile(QString filename)
 //bus is which CAN bus this was captured on
 //data is the data in hex
 //There also may or may not be some blank lines in between the csv column headers and the beginning of data.
-bool FrameFileIO::loadCabanaFile(QString filename, QVector<CANFrame>* frames)
+class CabanaGrammar : public TextLogGrammar
 {
-    QFile *inFile = new QFile(filename);
-    CANFrame thisFrame;
-    QByteArray line;
-    bool timeStampBaseSet = false;
-    uint64_t timeStampBase = 0;
-    uint64_t lastTimeStamp = 0;
-    int lineCounter = 0;
-    bool foundErrors = false;
-    thisFrame.setFrameType(QCanBusFrame::DataFrame);
+public:
+    static const uint64_t NO_TIMESTAMP = ~static_cast<uint64_t>(0);
 
-    if (!inFile->open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        delete inFile;
-        return false;
-    }
+    CabanaGrammar() : timeStampBaseSet(false), timeStampBase(0), lastTimeStamp(0) {}
 
-    line = inFile->readLine().toUpper(); //read out the header first and discard it.
+    qint64 headerLength(const char *data, qint64 size) override { return lineLength(data, size); }
 
-    while (!inFile->atEnd()) {
-        lineCounter++;
-        if (lineCounter > 100)
-        {
-            qApp->processEvents();
-            lineCounter = 0;
-        }
+    LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const override
+    {
+        TextTokens::trim(begin, end);
+        if (end - begin <= 2) return LINE_SKIP;
+        TextTokens tokens;
+        tokens.split(begin, end, ',');
+        if (tokens.count() < 3) return LINE_ERROR;
 
-        line = inFile->readLine().simplified();
-        if (line.length() > 2)
+        //times are made relative to the first one in finishFrames. Frames without one come 1us after the last
+        uint64_t value;
+        if (tokens.length(0) > 1)
         {
-            QList<QByteArray> tokens = line.split(',');
-            if (tokens.length() >= 3)
-            {
-                if (tokens[0].length() > 1)
-                {
-                    double temp = tokens[0].toDouble();
-                    temp = temp * 1000000;
-
-                    if(!timeStampBaseSet)
-                    {
-                        timeStampBase = (uint64_t)(temp);
-                        timeStampBaseSet = true;
-                    }
-
-                    if(timeStampBaseSet) {
-                        thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, ((uint64_t)(temp) - timeStampBase)));
-                        lastTimeStamp = thisFrame.timeStamp().microSeconds();
-                    } else {
-                        thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, (lastTimeStamp + 1)));
-                        lastTimeStamp = thisFrame.timeStamp().microSeconds();
-                    }
-
-                }
-                else
-                {
-                    thisFrame.setTimeStamp(QCanBusFrame::TimeStamp(0, (lastTimeStamp + 1)));
-                    lastTimeStamp = thisFrame.timeStamp().microSeconds();
-                }
+            tokens.toSecondsUs(0, value);
+            frame.timestamp = value;
+        }
+        else frame.timestamp = NO_TIMESTAMP;
 
-                thisFrame.setFrameId(tokens[1].toInt());
-                if (thisFrame.frameId() > 0x7ff) thisFrame.setExtendedFrameFormat(true);
-                    else thisFrame.setExtendedFrameFormat(false);
+        tokens.toUInt(1, value);
+        frame.setFrameId(static_cast<uint32_t>(value));
+        frame.setExtendedFrameFormat(frame.frameId() > 0x7ff);
+        tokens.toInt(2, frame.bus);
 
-                thisFrame.setFrameType(QCanBusFrame::DataFrame);
+        uint64_t tempData = 0;
+        if (tokens.count() > 3) tokens.toHex(3, tempData);
+        unsigned char bytes[8];
+        for (int i = 0; i < 8; i++) bytes[i] = static_cast<unsigned char>((tempData >> (56 - i * 8)) & 0xFF);
+        frame.setPayload(bytes, 8);
+        return LINE_FRAME;
+    }
 
-                thisFrame.isReceived = true;
-                thisFrame.bus = tokens[2].toInt();
-                QByteArray bytes(8,0);
+    void finishFrames(CANFrame *frames, int count) override
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (frames[i].timestamp != NO_TIMESTAMP)
+            {
+                if (!timeStampBaseSet)
                 {
-                    unsigned long long int tempData = tokens[3].toULongLong(nullptr, 16);
-                    bytes[0] = ((tempData >> 56) & 0xFF);
-                    bytes[1] = ((tempData >> 48) & 0xFF);
-                    bytes[2] = ((tempData >> 40) & 0xFF);
-                    bytes[3] = ((tempData >> 32) & 0xFF);
-                    bytes[4] = ((tempData >> 24) & 0xFF);
-                    bytes[5] = ((tempData >> 16) & 0xFF);
-                    bytes[6] = ((tempData >> 8) & 0xFF);
-                    bytes[7] = (tempData & 0xFF);
+                    timeStampBase = frames[i].timestamp;
+                    timeStampBaseSet = true;
                 }
-                thisFrame.setPayload(bytes);
-                frames->append(thisFrame);
+                lastTimeStamp = frames[i].timestamp - timeStampBase;
             }
-            else foundErrors = true;
+            else lastTimeStamp++;
+            frames[i].setTimeStamp(QCanBusFrame::TimeStamp(0, static_cast<qint64>(lastTimeStamp)));
         }
     }
-    inFile->close();
-    delete inFile;
-    return !foundErrors;
+
+private:
+    bool timeStampBaseSet;
+    uint64_t timeStampBase;
+    uint64_t lastTimeStamp;
+};
+
 }
 
-bool FrameFileIO::saveCabanaFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::loadCabanaFile(QString filename, QVector<CANFrame>* frames)
 {
-    QFile *outFile = new QFile(filename);
-    int lineCounter = 0;
+    TextLogReader reader(new CabanaGrammar);
+    return reader.open(filename) && readFrames(&reader, frames);
+}
 
-    const unsigned char *data;
-    int dataLen;
-    const CANFrame *frame;
+namespace {
 
-    if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
+class CabanaWriter : public TextFrameWriter
+{
+protected:
+    void appendHeader(QByteArray &out, const CANFrame *first) override
     {
-        delete outFile;
-        return false;
+        Q_UNUSED(first);
+        out.append("time,addr,bus,data\n");
     }
-    
-    outFile->write("time,addr,bus,data");
-    outFile->write("\n");
 
-    for (int c = 0; c < frames->count(); c++)
+    void appendFrame(QByteArray &out, const CANFrame &frame) override
     {
-        lineCounter++;
-        if (lineCounter > 100)
+        appendSeconds(out, static_cast<int64_t>(frame.timestamp), 6);
+        out.append(".0,");
+        out.append(QByteArray::number(frame.frameId()));
+        out.append(',');
+        out.append(QByteArray::number(frame.bus));
+        out.append(',');
+        for (int temp = 0; temp < 8; temp++)
         {
-            qApp->processEvents();
-            lineCounter = 0;
+            if (temp < frame.payloadLength()) appendHex(out, frame.payloadData()[temp], 2);
+            else out.append("00");
         }
+        out.append('\n');
+    }
+};
+
+}
 
-        frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
+bool FrameFileIO::saveCabanaFile(QString filename, const CANFrameView* frames)
+{
+    CabanaWriter writer;
+    return writer.open(filename) && writeFrames(&writer, frames);
+}
 
-        double tempTimeStamp = frame->timeStamp().microSeconds();
-        tempTimeStamp /= 1000000;
+namespace {
 
-        outFile->write(QString::number(tempTimeStamp, 'f').toUtf8());
-        outFile->write(".0");
-        outFile->putChar(44);
+//opens the stream on filename, or gets rid of it if that doesn't work out
+template <typename T> T *openedOrNull(T *stream, const QString &filename)
+{
+    if (stream->open(filename)) return stream;
+    delete stream;
+    return nullptr;
+}
 
-        outFile->write(QString::number(frame->frameId(), 10).toUpper().toUtf8());
-        outFile->putChar(44);
+}
 
-        outFile->write(QString::number(frame->bus).toUtf8());
-        outFile->putChar(44);
+//Every format gets a reader of its own so files of any size can be gone through. loader is the format the user
+//picked, null to autodetect
+FrameReader *FrameFileIO::openReader(QString filename, LoadFunction loader)
+{
+    if (!loader)
+    {
+        //the best match gets streamed. Unlike autoDetectLoadFile() the other candidates aren't tried when it fails
+        //as that would mean going through the file once per format
+        QByteArray prefix;
+        if (!readFilePrefix(filename, prefix)) return nullptr;
+        QVector<const DetectFormat *> formats = detectFileFormats(prefix);
+        if (formats.isEmpty()) return nullptr;
+        loader = formats[0]->loader;
+    }
+
+    if (loader == loadCaptureFile) return openedOrNull(new CaptureFileReader, filename);
+    if (loader == loadCANDOFile) return openedOrNull(new CANDOFileReader, filename);
+    if (loader == loadCanalyzerBLF) return openedOrNull(new BLFReader, filename);
+
+    TextLogGrammar *grammar = nullptr;
+    if (loader == loadNativeCSVFile) grammar = new NativeCSVGrammar;
+    else if (loader == loadCanalyzerASC) grammar = new CanalyzerASCGrammar;
+    else if (loader == loadCRTDFile) grammar = new CRTDGrammar;
+    else if (loader == loadCanDumpFile) grammar = new CanDumpGrammar;
+    else if (loader == loadGenericCSVFile) grammar = new GenericCSVGrammar;
+    else if (loader == loadLogFile) grammar = new BusmasterLogGrammar;
+    else if (loader == loadMicrochipFile) grammar = new MicrochipGrammar;
+    else if (loader == loadTraceFile) grammar = new TraceGrammar;
+    else if (loader == loadIXXATFile) grammar = new IXXATGrammar;
+    else if (loader == loadVehicleSpyFile) grammar = new VehicleSpyGrammar;
+    else if (loader == loadLawicelFile) grammar = new LawicelGrammar;
+    else if (loader == loadPCANFile) grammar = new PCANGrammar;
+    else if (loader == loadKvaserDecimalFile) grammar = new KvaserGrammar(false);
+    else if (loader == loadKvaserHexFile) grammar = new KvaserGrammar(true);
+    else if (loader == loadCARBUSAnalyzerFile) grammar = new CARBUSAnalyzerGrammar;
+    else if (loader == loadCANHackerFile) grammar = new CANHackerGrammar;
+    else if (loader == loadCabanaFile) grammar = new CabanaGrammar;
+    else if (loader == loadCANOpenFile) grammar = new CANOpenGrammar;
+    if (grammar) return openedOrNull(new TextLogReader(grammar), filename);
+
+    //a load function from somewhere else, read from memory
+    QVector<CANFrame> frames;
+    bool result = loader(filename, &frames);
+    if (!result && frames.isEmpty()) return nullptr;
+    return new VectorFrameReader(frames, result);
+}
 
-        for (int temp = 0; temp < 8; temp++)
+//saver is one of the save functions, the format to write. Null picks it by the extension: csv = GVRET,
+//crt/crtd = CRTD, log = candump, asc = CANalyzer, trc = CARBUS, trace = Vector trace, avc/evc/qcc = CAN-DO,
+//cancap = capture
+FrameWriter *FrameFileIO::openWriter(QString filename, SaveFunction saver)
+{
+    if (!saver)
+    {
+        QString suffix = QFileInfo(filename).suffix().toLower();
+        if (suffix == "cancap") saver = saveCaptureFile;
+        else if (suffix == "csv") saver = saveNativeCSVFile;
+        else if (suffix == "crt" || suffix == "crtd") saver = saveCRTDFile;
+        else if (suffix == "log") saver = saveCanDumpFile;
+        else if (suffix == "asc") saver = saveCanalyzerASC;
+        else if (suffix == "trc") saver = saveCARBUSAnalzyer;
+        else if (suffix == "trace") saver = saveTraceFile;
+        else if (suffix == "avc" || suffix == "evc" || suffix == "qcc") saver = saveCANDOFile;
+        else return nullptr;
+    }
+
+    if (saver == saveCaptureFile) return openedOrNull(new CaptureFileWriter, filename);
+    if (saver == saveNativeCSVFile) return openedOrNull(new NativeCSVWriter, filename);
+    if (saver == saveCANDOFile) return openedOrNull(new CANDOWriter, filename);
+
+    TextFrameWriter *writer = nullptr;
+    if (saver == saveCRTDFile) writer = new CRTDWriter;
+    else if (saver == saveCanDumpFile) writer = new CanDumpWriter;
+    else if (saver == saveCanalyzerASC) writer = new CanalyzerASCWriter;
+    else if (saver == saveCARBUSAnalzyer) writer = new CARBUSAnalyzerWriter;
+    else if (saver == saveGenericCSVFile) writer = new GenericCSVWriter;
+    else if (saver == saveLogFile) writer = new BusmasterLogWriter;
+    else if (saver == saveMicrochipFile) writer = new MicrochipWriter;
+    else if (saver == saveTraceFile) writer = new TraceWriter;
+    else if (saver == saveIXXATFile) writer = new IXXATWriter;
+    else if (saver == saveCabanaFile) writer = new CabanaWriter;
+    if (writer) return openedOrNull(writer, filename);
+    return nullptr; //Vehicle Spy and anything else without a writer
+}
+
+//appends everything the reader has to frames
+bool FrameFileIO::readFrames(FrameReader *reader, QVector<CANFrame> *frames)
+{
+    const int batch = 65536;
+    for (;;)
+    {
+        int start = frames->count();
+        frames->resize(start + batch);
+        int num = reader->read(frames->data() + start, batch);
+        frames->resize(start + num);
+        if (num == 0) break;
+    }
+    return reader->isOk();
+}
+
+//all of frames to the writer, a block at a time, and completes the file
+bool FrameFileIO::writeFrames(FrameWriter *writer, const CANFrameView *frames)
+{
+    const int blockFrames = 4096;
+    QVector<CANFrame> block;
+    block.reserve(blockFrames);
+    int num = frames->count();
+    for (int i = 0; i < num; i++)
+    {
+        block.append(frames->at(i));
+        if (block.count() == blockFrames || i == num - 1)
         {
-            if (temp < dataLen)
-                outFile->write(QString::number(data[temp], 16).toUpper().rightJustified(2, '0').toUtf8());
-            else
-                outFile->write("00");
+            if (!writer->write(block.constData(), block.count())) return false;
+            block.resize(0);
         }
+    }
+    return writer->finish();
+}
 
-        outFile->write("\n");
+//one batch of frames in memory at a time, whatever the size of the file
+bool FrameFileIO::convertFrameFile(QString inFilename, QString outFilename, SaveFunction saver)
+{
+    TRACE_SCOPE("file convert");
+    QScopedPointer<FrameReader> reader(openReader(inFilename));
+    if (reader.isNull()) return false;
+    QScopedPointer<FrameWriter> writer(openWriter(outFilename, saver));
+    if (writer.isNull()) return false;
 
+    QVector<CANFrame> batch(4096);
+    for (;;)
+    {
+        int num = reader->read(batch.data(), batch.count());
+        if (num == 0) break;
+        if (!writer->write(batch.constData(), num)) return false;
     }
-    outFile->close();
-    delete outFile;
-    return true;
+    return writer->finish() && reader->isOk();
 }
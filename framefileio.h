@@ -13,6 +13,9 @@
 #include <QStringList>
 #include <QFileDialog>
 #include "can_structs.h"
+#include "canframeview.h"
+#include "capturefile.h"
+#include "framestream.h"
 #include "utility.h"
 
 class FrameFileIO: public QObject
@@ -27,9 +30,16 @@ public:
     //The QVector is used as either the target for loading or the source for saving.
     //These routines call the below loading/saving functions so no need to use them directly if you don't want.
     static bool loadFrameFile(QString &, QVector<CANFrame>*);
-    static bool saveFrameFile(QString &, const QVector<CANFrame>*);
+    static bool saveFrameFile(QString &, const CANFrameView *);
 
-    //These do the actual loading and saving and can be used directly if you'd prefer
+    //one of the load functions below. Null stands for autodetect
+    typedef bool (*LoadFunction)(QString, QVector<CANFrame>*);
+    //just the dialog part of loadFrameFile. filename gets the full path, loader the format that was picked.
+    //False if the user backed out
+    static bool selectLoadFile(QString &filename, LoadFunction &loader);
+
+    //These do the actual loading and saving and can be used directly if you'd prefer. The load functions don't
+    //touch the GUI so they can run on a worker thread
     static bool autoDetectLoadFile(QString, QVector<CANFrame>*);
     static bool loadCRTDFile(QString, QVector<CANFrame>*);
     static bool loadNativeCSVFile(QString, QVector<CANFrame>*);
@@ -46,53 +56,78 @@ public:
     static bool loadKvaserFile(QString, QVector<CANFrame>*, bool);
     static bool loadCanalyzerASC(QString, QVector<CANFrame>*);
     static bool loadCanalyzerBLF(QString, QVector<CANFrame>*);
+    static bool loadCaptureFile(QString, QVector<CANFrame>*);
+    static bool selectCaptureFile(QString &);
     static bool loadCARBUSAnalyzerFile(QString filename, QVector<CANFrame>* frames);
     static bool loadCANHackerFile(QString filename, QVector<CANFrame>* frames);
     static bool loadCabanaFile(QString filename, QVector<CANFrame>* frames);
     static bool loadCANOpenFile(QString filename, QVector<CANFrame>* frames);
 
     //functions that pre-scan a file to try to figure out if they could read it. Used to automatically determine
-    //file type and load it.
-    static bool isCRTDFile(QString);
-    static bool isNativeCSVFile(QString);
-    static bool isGenericCSVFile(QString);
-    static bool isLogFile(QString);
-    static bool isMicrochipFile(QString);
-    static bool isTraceFile(QString);
-    static bool isIXXATFile(QString);
-    static bool isCANDOFile(QString);
-    static bool isVehicleSpyFile(QString);
-    static bool isCanDumpFile(QString);
-    static bool isLawicelFile(QString);
-    static bool isPCANFile(QString);
-    static bool isKvaserFile(QString);
-    static bool isCanalyzerASC(QString);
-    static bool isCanalyzerBLF(QString);
-    static bool isCARBUSAnalyzerFile(QString filename);
-    static bool isCANHackerFile(QString filename);
-    static bool isCabanaFile(QString filename);
-    static bool isCANOpenFile(QString filename);
+    //file type and load it. They all look at the same start of the file, read once with readFilePrefix()
+    static const int DETECT_BYTES = 64 * 1024;
+    static bool readFilePrefix(QString filename, QByteArray &prefix);
+    static bool isCaptureFile(const QByteArray &prefix);
+    static bool isCRTDFile(const QByteArray &prefix);
+    static bool isNativeCSVFile(const QByteArray &prefix);
+    static bool isGenericCSVFile(const QByteArray &prefix);
+    static bool isLogFile(const QByteArray &prefix);
+    static bool isMicrochipFile(const QByteArray &prefix);
+    static bool isTraceFile(const QByteArray &prefix);
+    static bool isIXXATFile(const QByteArray &prefix);
+    static bool isCANDOFile(const QByteArray &prefix);
+    static bool isVehicleSpyFile(const QByteArray &prefix);
+    static bool isCanDumpFile(const QByteArray &prefix);
+    static bool isLawicelFile(const QByteArray &prefix);
+    static bool isPCANFile(const QByteArray &prefix);
+    static bool isKvaserFile(const QByteArray &prefix);
+    static bool isCanalyzerASC(const QByteArray &prefix);
+    static bool isCanalyzerBLF(const QByteArray &prefix);
+    static bool isCARBUSAnalyzerFile(const QByteArray &prefix);
+    static bool isCANHackerFile(const QByteArray &prefix);
+    static bool isCabanaFile(const QByteArray &prefix);
+    static bool isCANOpenFile(const QByteArray &prefix);
 
-    static bool saveCRTDFile(QString, const QVector<CANFrame>*);
-    static bool saveNativeCSVFile(QString, const QVector<CANFrame>*);
-    static bool saveGenericCSVFile(QString, const QVector<CANFrame>*);
-    static bool saveLogFile(QString, const QVector<CANFrame>*);
-    static bool saveMicrochipFile(QString, const QVector<CANFrame>*);
-    static bool saveTraceFile(QString, const QVector<CANFrame>*);
-    static bool saveIXXATFile(QString, const QVector<CANFrame>*);
-    static bool saveCANDOFile(QString, const QVector<CANFrame>*);
-    static bool saveVehicleSpyFile(QString, const QVector<CANFrame>*);
-    static bool saveCanDumpFile(QString filename, const QVector<CANFrame> * frames);
-    static bool saveCabanaFile(QString filename, const QVector<CANFrame>* frames);
-    static bool saveCanalyzerASC(QString filename, const QVector<CANFrame>* frames);
-    static bool saveCARBUSAnalzyer(QString filename, const QVector<CANFrame>* frames);
+    static bool saveCRTDFile(QString, const CANFrameView *);
+    static bool saveNativeCSVFile(QString, const CANFrameView *);
+    static bool saveGenericCSVFile(QString, const CANFrameView *);
+    static bool saveLogFile(QString, const CANFrameView *);
+    static bool saveMicrochipFile(QString, const CANFrameView *);
+    static bool saveTraceFile(QString, const CANFrameView *);
+    static bool saveIXXATFile(QString, const CANFrameView *);
+    static bool saveCANDOFile(QString, const CANFrameView *);
+    static bool saveVehicleSpyFile(QString, const CANFrameView *);
+    static bool saveCanDumpFile(QString filename, const CANFrameView * frames);
+    static bool saveCabanaFile(QString filename, const CANFrameView * frames);
+    static bool saveCanalyzerASC(QString filename, const CANFrameView * frames);
+    static bool saveCARBUSAnalzyer(QString filename, const CANFrameView * frames);
+    static bool saveCaptureFile(QString filename, const CANFrameView * frames);
+    //one of the save functions above
+    typedef bool (*SaveFunction)(QString, const CANFrameView *);
 
     static bool openContinuousNative();
     static bool closeContinuousNative();
-    static bool writeContinuousNative(const QVector<CANFrame>*, int);
+    static bool writeContinuousNative(const CANFrameView *, int);
     static bool flushContinuousNative();
 
+    //Streaming access to frame files, a batch of frames at a time, so files of any size can be gone through. Every
+    //format that can be loaded has a reader and every one that can be saved a writer (all but Vehicle Spy). The
+    //caller owns what these return, null on failure
+    static FrameReader *openReader(QString filename, LoadFunction loader = nullptr);
+    static FrameWriter *openWriter(QString filename, SaveFunction saver = nullptr);
+    static bool readFrames(FrameReader *reader, QVector<CANFrame> *frames);
+    static bool writeFrames(FrameWriter *writer, const CANFrameView *frames);
+    //any file openReader() can autodetect to saver's format (or the one picked by the extension, see openWriter())
+    //without holding the whole file in memory
+    static bool convertFrameFile(QString inFilename, QString outFilename, SaveFunction saver = nullptr);
+
+    //native CSV without any GUI, safe to call from worker threads
+    static void writeNativeCSVHeader(QIODevice *);
+    static bool writeNativeCSVFrames(QIODevice *, const CANFrame *, int);
+
 private:
+    static QVector<CaptureFile::BusInfo> captureBuses();
+
     static QFile continuousFile;
 };
 
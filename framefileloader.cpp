@@ -0,0 +1,86 @@
+#include "framefileloader.h"
+
+#include <QScopedPointer>
+#include <QtConcurrent>
+#include "framestream.h"
+#include "utils/tracer.h"
+
+FrameFileLoader::FrameFileLoader(QObject *parent) : QObject(parent), mFree(MAX_PENDING), mRunning(false)
+{
+    mPool.setMaxThreadCount(1);
+    mCancel.storeRelease(0);
+}
+
+FrameFileLoader::~FrameFileLoader()
+{
+    cancel();
+    mPool.waitForDone();
+}
+
+bool FrameFileLoader::load(const QString &filename, FrameFileIO::LoadFunction loader)
+{
+    if (mRunning) return false;
+    mRunning = true;
+    mCancel.storeRelease(0);
+    QtConcurrent::run(&mPool, [this, filename, loader]()
+    {
+        run(filename, loader);
+    });
+    return true;
+}
+
+void FrameFileLoader::cancel()
+{
+    mCancel.storeRelease(1);
+}
+
+//false if the load was cancelled while waiting
+bool FrameFileLoader::waitForReceiver()
+{
+    while (!mFree.tryAcquire(1, 100))
+    {
+        if (mCancel.loadAcquire()) return false;
+    }
+    return true;
+}
+
+void FrameFileLoader::run(const QString &filename, FrameFileIO::LoadFunction loader)
+{
+    TRACE_SCOPE("file load");
+    QScopedPointer<FrameReader> reader(FrameFileIO::openReader(filename, loader));
+    bool ok = !reader.isNull();
+    if (ok)
+    {
+        //the dialog has a real bar while the first batch is still being read
+        qint64 total = reader->size();
+        QMetaObject::invokeMethod(this, [this, total]() { emit progress(0, total); }, Qt::QueuedConnection);
+    }
+
+    while (ok && !mCancel.loadAcquire())
+    {
+        QVector<CANFrame> frames(BATCH_FRAMES);
+        int num = reader->read(frames.data(), frames.count());
+        if (num == 0) break;
+        frames.resize(num);
+        if (!waitForReceiver()) break;
+
+        CANFrameBatch batch(frames);
+        qint64 done = reader->position();
+        qint64 total = reader->size();
+        QMetaObject::invokeMethod(this, [this, batch, done, total]()
+        {
+            emit framesLoaded(batch);
+            emit progress(done, total);
+            mFree.release();
+        }, Qt::QueuedConnection);
+    }
+    if (ok) ok = reader->isOk();
+
+    //queued behind the last batch so the receiver has everything by the time it hears the load is over
+    bool cancelled = mCancel.loadAcquire();
+    QMetaObject::invokeMethod(this, [this, ok, cancelled]()
+    {
+        mRunning = false;
+        emit finished(ok, cancelled);
+    }, Qt::QueuedConnection);
+}
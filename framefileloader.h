@@ -0,0 +1,56 @@
+#ifndef FRAMEFILELOADER_H
+#define FRAMEFILELOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QAtomicInteger>
+#include "canframebatch.h"
+#include "framefileio.h"
+
+/*
+ * Loads a frame file on a thread of its own so the GUI keeps running however long the file takes. The frames
+ * come back batch by batch through framesLoaded() on the thread the loader lives in, so they can be shown while
+ * the rest of the file is still being read. The reading thread stays at most MAX_PENDING batches ahead of the
+ * receiver and waits for it to catch up otherwise, so a file that parses faster than it can be displayed does
+ * not end up queued in memory twice. Every format FrameFileIO knows is read a batch at a time (see
+ * FrameFileIO::openReader), so progress() follows the file from the first batch and cancel() stops it promptly.
+ */
+class FrameFileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int BATCH_FRAMES = 65536;
+    static const int MAX_PENDING = 4;
+
+    explicit FrameFileLoader(QObject *parent = nullptr);
+    ~FrameFileLoader(); //cancels a running load and waits for its thread
+
+    //loader is the format the user picked, null to autodetect. False if a load is already running
+    bool load(const QString &filename, FrameFileIO::LoadFunction loader);
+    //stops after the batch being read. finished() still follows
+    void cancel();
+    bool isRunning() const { return mRunning; }
+
+signals:
+    void framesLoaded(const CANFrameBatch &frames);
+    //how far through the file the load is, in bytes. Sent once the file is open and after every batch
+    void progress(qint64 done, qint64 total);
+    //ok is false if the file couldn't be opened or some of it didn't parse. Comes after the last framesLoaded()
+    void finished(bool ok, bool cancelled);
+
+private:
+    Q_DISABLE_COPY(FrameFileLoader)
+
+    void run(const QString &filename, FrameFileIO::LoadFunction loader); //on the pool
+    bool waitForReceiver();
+
+    QThreadPool mPool;
+    QSemaphore mFree; //batches the reading thread may still send before the receiver has taken the earlier ones
+    QAtomicInteger<int> mCancel;
+    bool mRunning; //GUI thread only
+};
+
+#endif // FRAMEFILELOADER_H
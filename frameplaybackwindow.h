@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QListWidget>
 #include "can_structs.h"
+#include "canframeview.h"
 #include "framefileio.h"
 #include "frameplaybackobject.h"
 
@@ -16,7 +17,7 @@ class FramePlaybackWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FramePlaybackWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FramePlaybackWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~FramePlaybackWindow();
 
 private slots:
@@ -49,7 +50,7 @@ private:
     Ui::FramePlaybackWindow *ui;
     QList<int> foundID;
     QList<CANFrame> frameCache;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QList<SequenceItem> seqItems;
     SequenceItem *currentSeqItem;
     int currentSeqNum;
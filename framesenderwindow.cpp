@@ -15,7 +15,7 @@
  * Also, rows default to enabled which is odd because the button state does not reflect that.
 */
 
-FrameSenderWindow::FrameSenderWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FrameSenderWindow::FrameSenderWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FrameSenderWindow)
 {
@@ -127,6 +127,16 @@ void FrameSenderWindow::buildFrameCache()
 {
     CANFrame thisFrame;
     frameCache.clear();
+    const CANFrameIDIndex *idIndex = modelFrames->idIndex();
+    if (idIndex) //only the most recent frame of each ID is wanted so there's no need to look at the rest
+    {
+        foreach (uint32_t id, idIndex->ids())
+        {
+            int row = idIndex->lastRowForID(id);
+            if (row > -1) frameCache.insert(static_cast<int>(id), modelFrames->at(row));
+        }
+        return;
+    }
     for (int i = 0; i < modelFrames->count(); i++)
     {
         thisFrame = modelFrames->at(i);
@@ -181,8 +191,6 @@ void FrameSenderWindow::processIncomingFrame(CANFrame *frame)
         for (int trig = 0; trig < sendingData[sd].triggers.count(); trig++)
         {
             Trigger *thisTrigger = &sendingData[sd].triggers[trig];
-            qDebug() << "Trigger ID: " << thisTrigger->ID;
-            qDebug() << "Frame ID: " << frame->frameId();
             if (thisTrigger->ID > 0 && (uint32_t)thisTrigger->ID == frame->frameId())
             {
                 if (thisTrigger->bus == frame->bus || thisTrigger->bus == -1)
@@ -794,8 +802,8 @@ void FrameSenderWindow::updateGridRow(int idx)
     int gridLine = idx;
     QString dataString;
     QTableWidgetItem *item = ui->tableSender->item(gridLine, 9);
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(temp->payload().constData());
-    int dataLen = temp->payload().length();
+    const unsigned char *data = temp->payloadData();
+    int dataLen = temp->payloadLength();
 
     if (item == nullptr) item = new QTableWidgetItem();
     item->setText(QString::number(temp->count));
@@ -6,6 +6,7 @@
 #include <QElapsedTimer>
 #include <QTime>
 #include "can_structs.h"
+#include "canframeview.h"
 #include "can_trigger_structs.h"
 
 namespace Ui {
@@ -17,7 +18,7 @@ class FrameSenderWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FrameSenderWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FrameSenderWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~FrameSenderWindow();
 
 private slots:
@@ -34,7 +35,7 @@ private:
     Ui::FrameSenderWindow *ui;
     QList<FrameSendData> sendingData;
     QHash<int, CANFrame> frameCache; //hash with frame ID as the key and the most recent frame as the value
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QTimer *intervalTimer;
     QElapsedTimer elapsedTimer;
     bool inhibitChanged = false;
@@ -0,0 +1,63 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <QVector>
+#include "can_structs.h"
+
+/*
+ * Frame files a batch at a time. A reader hands out the frames of a file in file order and a writer takes
+ * them in the order they should end up in the file, so a file can be converted or filtered while only ever
+ * holding one batch of frames no matter how big it is. See FrameFileIO::openReader() / openWriter().
+ */
+class FrameReader
+{
+public:
+    virtual ~FrameReader() {}
+
+    //copies up to max frames to frames and returns how many. 0 once the whole file has been read
+    virtual int read(CANFrame *frames, int max) = 0;
+
+    //false if the file couldn't be read or part of it didn't parse. Only final once read() has returned 0
+    virtual bool isOk() const = 0;
+
+    //how far through the file the reader is, for progress display. In bytes, or frames for readers working from memory
+    virtual qint64 position() const = 0;
+    virtual qint64 size() const = 0;
+};
+
+class FrameWriter
+{
+public:
+    virtual ~FrameWriter() {}
+
+    virtual bool write(const CANFrame *frames, int count) = 0;
+
+    //completes the file (trailers, index, header fields only known at the end). Nothing can be written after
+    virtual bool finish() = 0;
+};
+
+//frames that are already in memory. For the formats that can only be loaded as a whole
+class VectorFrameReader : public FrameReader
+{
+public:
+    VectorFrameReader(const QVector<CANFrame> &frames, bool ok) : mFrames(frames), mPos(0), mOk(ok) {}
+
+    int read(CANFrame *frames, int max) override
+    {
+        int num = qMin(max, mFrames.count() - mPos);
+        for (int i = 0; i < num; i++) frames[i] = mFrames[mPos + i];
+        mPos += num;
+        return num;
+    }
+
+    bool isOk() const override { return mOk; }
+    qint64 position() const override { return mPos; }
+    qint64 size() const override { return mFrames.count(); }
+
+private:
+    QVector<CANFrame> mFrames;
+    int mPos;
+    bool mOk;
+};
+
+#endif // FRAMESTREAM_H
@@ -23,6 +23,10 @@ MainSettingsDialog::MainSettingsDialog(QWidget *parent) :
     ui->comboSendingBus->addItem(tr("Both"));
     ui->comboSendingBus->addItem(tr("From File"));
 
+    //same order as CANConManager::DrainPolicy
+    ui->comboDrainPolicy->addItem(tr("Lowest latency"));
+    ui->comboDrainPolicy->addItem(tr("Highest throughput"));
+
     //update the GUI with all the settings we have stored giving things
     //defaults if nothing was stored (if this is the first time)
     ui->cbDisplayHex->setChecked(settings.value("Main/UseHex", true).toBool());
@@ -74,6 +78,11 @@ MainSettingsDialog::MainSettingsDialog(QWidget *parent) :
     ui->cbUseFiltered->setChecked(settings.value("Main/UseFiltered", false).toBool());
     ui->cbUseOpenGL->setChecked(settings.value("Main/UseOpenGL", false).toBool());
     ui->cbFilterLabeling->setChecked(settings.value("Main/FilterLabeling", false).toBool());
+    ui->comboDrainPolicy->setCurrentIndex(settings.value("Main/DrainPolicy", 0).toInt());
+    ui->spinRefreshInterval->setValue(settings.value("Main/RefreshInterval", 250).toInt());
+    ui->spinCaptureLimit->setValue(settings.value("Main/CaptureLimitMB", 0).toInt());
+    ui->cbArchiveEvicted->setChecked(settings.value("Main/ArchiveEvicted", false).toBool());
+    ui->lineArchiveDirectory->setText(settings.value("Main/ArchiveDirectory", "").toString());
 
     //just for simplicity they all call the same function and that function updates all settings at once
     connect(ui->cbDisplayHex, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
@@ -98,6 +107,11 @@ MainSettingsDialog::MainSettingsDialog(QWidget *parent) :
     connect(ui->lineRemotePassword, SIGNAL(editingFinished()), this, SLOT(updateSettings()));
     connect(ui->cbLoadConnections, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
     connect(ui->cbFilterLabeling, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
+    connect(ui->comboDrainPolicy, SIGNAL(currentIndexChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->spinRefreshInterval, SIGNAL(valueChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->spinCaptureLimit, SIGNAL(valueChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->cbArchiveEvicted, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
+    connect(ui->lineArchiveDirectory, SIGNAL(editingFinished()), this, SLOT(updateSettings()));
     installEventFilter(this);
 }
 
@@ -159,6 +173,11 @@ void MainSettingsDialog::updateSettings()
     QByteArray encPass = crypto.encryptToByteArray(ui->lineRemotePassword->text());
     settings.setValue("Remote/Pass", encPass);
     settings.setValue("Main/FilterLabeling", ui->cbFilterLabeling->isChecked());
+    settings.setValue("Main/DrainPolicy", ui->comboDrainPolicy->currentIndex());
+    settings.setValue("Main/RefreshInterval", ui->spinRefreshInterval->value());
+    settings.setValue("Main/CaptureLimitMB", ui->spinCaptureLimit->value());
+    settings.setValue("Main/ArchiveEvicted", ui->cbArchiveEvicted->isChecked());
+    settings.setValue("Main/ArchiveDirectory", ui->lineArchiveDirectory->text());
 
     settings.sync();
     emit updatedSettings();
@@ -3,12 +3,14 @@
 #include "can_structs.h"
 #include <QDateTime>
 #include <QFileDialog>
+#include <QDir>
 #include <QtSerialPort/QSerialPortInfo>
 #include "connections/canconmanager.h"
 #include "connections/connectionwindow.h"
 #include "helpwindow.h"
 #include "utility.h"
 #include "filterutility.h"
+#include "utils/tracer.h"
 
 /*
 Some notes on things I'd like to put into the program but haven't put on github (yet)
@@ -94,9 +96,20 @@ MainWindow::MainWindow(QWidget *parent) :
     framesPerSec = 0;
     continuousLogging = false;
     continuousLogFlushCounter = 0;
+    fileLoader = new FrameFileLoader(this);
+    loadProgress = nullptr;
+    loadingFormat = nullptr;
+    loadingFrames = 0;
+    holdLiveFrames = false;
 
     connect(ui->actionSetup, SIGNAL(triggered(bool)), SLOT(showConnectionSettingsWindow()));
     connect(ui->actionOpen_Log_File, &QAction::triggered, this, &MainWindow::handleLoadFile);
+    connect(fileLoader, &FrameFileLoader::framesLoaded, this, &MainWindow::gotLoadedFrames);
+    connect(fileLoader, &FrameFileLoader::progress, this, &MainWindow::updateLoadProgress);
+    connect(fileLoader, &FrameFileLoader::finished, this, &MainWindow::loadFinished);
+    connect(ui->actionOpen_Capture_File, &QAction::triggered, this, &MainWindow::handleOpenCaptureFile);
+    connect(ui->actionExport_Trace, &QAction::triggered, this, &MainWindow::handleExportTrace);
+    connect(ui->actionConvert_Log_File, &QAction::triggered, this, &MainWindow::handleConvertFile);
     connect(ui->actionGraph_Dta, &QAction::triggered, this, &MainWindow::showGraphingWindow);
     connect(ui->actionFrame_Data_Analysis, &QAction::triggered, this, &MainWindow::showFrameDataAnalysis);
     connect(ui->btnClearFrames, &QAbstractButton::clicked, this, &MainWindow::clearFrames);
@@ -140,7 +153,7 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->btnExpandAll, &QAbstractButton::clicked, this, &MainWindow::expandAllRows);
     connect(ui->btnCollapseAll, &QAbstractButton::clicked, this, &MainWindow::collapseAllRows);
 
-    connect(CANConManager::getInstance(), &CANConManager::framesReceived, model, &CANFrameModel::addFrames);
+    connect(CANConManager::getInstance(), &CANConManager::framesReceived, this, &MainWindow::gotLiveFrames);
 
     lbStatusConnected.setText(tr("Connected to 0 buses"));
     lbHelp.setText(tr("Press F1 on any screen for help"));
@@ -164,8 +177,7 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->listFilters->horizontalScrollBar()->setEnabled(false);
 
     connect(&updateTimer, &QTimer::timeout, this, &MainWindow::tickGUIUpdate);
-    updateTimer.setInterval(250);
-    updateTimer.start();
+    updateTimer.start(); //interval was set from Main/RefreshInterval by readSettings()
 
     elapsedTime = new QTime;
     elapsedTime->start();
@@ -361,6 +373,18 @@ void MainWindow::readUpdateableSettings()
     model->setSysTimeMode(useSystemClock);
     useFiltered = settings.value("Main/UseFiltered", false).toBool();
     model->setTimeFormat(settings.value("Main/TimeFormat", "MMM-dd HH:mm:ss.zzz").toString());
+    CANConManager::getInstance()->setDrainPolicy((CANConManager::DrainPolicy)settings.value("Main/DrainPolicy", 0).toInt());
+    //how often the frame list is told about new frames. Each tick is a row insert, not a reset, so this is cheap
+    updateTimer.setInterval(qBound(50, settings.value("Main/RefreshInterval", 250).toInt(), 2000));
+    //oldest frames get dropped (and optionally archived) once the capture goes over this many MB
+    model->setCaptureLimit(settings.value("Main/CaptureLimitMB", 0).toInt());
+    QString archiveDir;
+    if (settings.value("Main/ArchiveEvicted", false).toBool())
+    {
+        archiveDir = settings.value("Main/ArchiveDirectory", "").toString();
+        if (archiveDir.isEmpty()) archiveDir = settings.value("FileIO/LoadSaveDirectory", QDir::homePath()).toString();
+    }
+    model->setArchiveDirectory(archiveDir);
 
     if (settings.value("Main/FilterLabeling", false).toBool())
         ui->listFilters->setMaximumWidth(250);
@@ -562,6 +586,7 @@ void MainWindow::filterClearAll()
 
 void MainWindow::tickGUIUpdate()
 {
+    TRACE_SCOPE("GUI update");
     rxFrames = model->sendBulkRefresh();
     //if(rxFrames>0)
     //{
@@ -573,9 +598,17 @@ void MainWindow::tickGUIUpdate()
         else
             framesPerSec = 0;
 
-        ui->lbNumFrames->setText(QString::number(model->rowCount()));
+        quint64 evicted = model->getEvictedFrameCount();
+        if (evicted > 0)
+        {
+            ui->lbNumFrames->setText(QString::number(model->rowCount()) + tr(" (%1 evicted)").arg(evicted));
+            ui->lbNumFrames->setToolTip(tr("%1 MB of frames in memory, %2 evicted frames archived to disk")
+                                        .arg(model->getCaptureBytes() / (1024 * 1024)).arg(model->getArchivedFrameCount()));
+        }
+        else ui->lbNumFrames->setText(QString::number(model->rowCount()));
         if (rxFrames > 0 && /*allowCapture && */ ui->cbAutoScroll->isChecked()) ui->canFramesView->scrollToBottom();
         ui->lbFPS->setText(QString::number(framesPerSec));
+        updateCaptureStats();
         if (rxFrames > 0)
         {
             bDirty = true;
@@ -586,7 +619,7 @@ void MainWindow::tickGUIUpdate()
 
         if (continuousLogging)
         {
-            const QVector<CANFrame> *modelFrames = model->getListReference();
+            const CANFrameView *modelFrames = model->getListReference();
             FrameFileIO::writeContinuousNative(modelFrames, modelFrames->count() - rxFrames);
 
             continuousLogFlushCounter++;
@@ -644,6 +677,8 @@ void MainWindow::clearFrames()
     ui->canFramesView->scrollToTop();
     model->clearFrames();
     CANConManager::getInstance()->resetTimeBasis();
+    CANConManager::getInstance()->resetStats();
+    Tracer::clear();
     ui->lbNumFrames->setText(QString::number(model->rowCount()));
     bDirty = false;
     loadedFileName = "";
@@ -651,46 +686,273 @@ void MainWindow::clearFrames()
     emit framesUpdated(-1);
 }
 
+//Whether the connections are keeping up: frames dropped because a queue filled up, how full the fullest
+//queue ever got and how long frames wait to reach the list. The per connection numbers go in the tooltip.
+void MainWindow::updateCaptureStats()
+{
+    CANConManager *manager = CANConManager::getInstance();
+    CANConStatsSnapshot total = manager->getTotalStats();
+    int peakPercent = 0;
+    QString details;
+    foreach (const CANConStatsSnapshot &stats, manager->getConnectionStats())
+    {
+        if (stats.queueSize > 0) peakPercent = qMax(peakPercent, stats.peakQueueDepth * 100 / stats.queueSize);
+        details += tr("%1: %2 received, %3 queued, %4 dropped, peak queue %5 of %6, latency p50 < %7 us, p99 < %8 us\n")
+                   .arg(stats.name).arg(stats.received).arg(stats.queued).arg(stats.dropped)
+                   .arg(stats.peakQueueDepth).arg(stats.queueSize)
+                   .arg(stats.latencyPercentileUs(0.5)).arg(stats.latencyPercentileUs(0.99));
+    }
+
+    QString text = tr("%1 dropped, peak queue %2%").arg(total.dropped).arg(peakPercent);
+    qint64 p99 = total.latencyPercentileUs(0.99);
+    if (p99 >= 0) text += tr(", p99 < %1 ms").arg(p99 / 1000.0, 0, 'f', 1);
+    ui->lbCaptureStats->setText(text);
+    ui->lbCaptureStats->setToolTip(details.trimmed());
+}
+
 void MainWindow::normalizeTiming()
 {
     model->normalizeTiming();
     emit framesUpdated(-2); //claim an all new set of frames because every frame was updated.
 }
 
+//the file is read on a worker thread. Its frames go into the model batch by batch as they are parsed and are
+//shown by the regular GUI updates, so a big file fills the view progressively instead of freezing the window
 void MainWindow::handleLoadFile()
 {
+    if (fileLoader->isRunning()) return;
+
     QString filename;
-    QVector<CANFrame> tempFrames;
+    FrameFileIO::LoadFunction loader;
+    if (!FrameFileIO::selectLoadFile(filename, loader)) return;
 
-    QMessageBox::StandardButton confirmDialog;
+    loadingFileName = filename;
+    loadingFormat = loader;
+    loadingFrames = 0;
+    holdLiveFrames = true;
+
+    loadProgress = new QProgressDialog(this);
+    loadProgress->setWindowModality(Qt::NonModal);
+    loadProgress->setWindowTitle(tr("Loading File"));
+    loadProgress->setLabelText(tr("Loading %1...").arg(QFileInfo(filename).fileName()));
+    loadProgress->setAutoReset(false);
+    loadProgress->setAutoClose(false);
+    loadProgress->setRange(0, 0); //busy until the reader knows how far it got
+    loadProgress->setMinimumDuration(0);
+    connect(loadProgress, &QProgressDialog::canceled, fileLoader, &FrameFileLoader::cancel);
+    loadProgress->show();
+
+    loadTimer.start();
+    fileLoader->load(filename, loader);
+}
+
+void MainWindow::gotLoadedFrames(const CANFrameBatch &frames)
+{
+    if (loadingFrames == 0)
+    {
+        //the frames already there stay until the file actually has something to replace them with
+        ui->canFramesView->scrollToTop();
+        model->clearFrames();
+        emit framesUpdated(-1);
+    }
+    loadingFrames += static_cast<quint64>(frames.count());
+    model->insertFrames(frames.constData(), frames.count());
+    emit framesLoaded(frames);
+}
 
-    bool loadResult = FrameFileIO::loadFrameFile(filename, &tempFrames);
+//live frames go into the model, except while a file is loading. The file's frames would end up mixed in with
+//them and a failed load would take them down with it, so they are held until the load is over (including any
+//question about it, the message boxes keep the events coming)
+void MainWindow::gotLiveFrames(const CANConnection *conn, const CANFrameBatch &frames)
+{
+    if (holdLiveFrames)
+    {
+        heldLiveFrames.append(frames);
+        return;
+    }
+    model->addFrames(conn, frames);
+}
+
+void MainWindow::addHeldLiveFrames()
+{
+    //not timed, the connection they came from may be gone by now
+    holdLiveFrames = false;
+    foreach (const CANFrameBatch &frames, heldLiveFrames) model->addFrames(nullptr, frames);
+    heldLiveFrames.clear();
+}
+
+void MainWindow::updateLoadProgress(qint64 done, qint64 total)
+{
+    if (!loadProgress || total <= 0) return;
+
+    loadProgress->setRange(0, 1000);
+    loadProgress->setValue(static_cast<int>(qBound(Q_INT64_C(0), done * 1000 / total, Q_INT64_C(1000))));
+
+    QString text = tr("Loading %1...\n%2 frames").arg(QFileInfo(loadingFileName).fileName()).arg(loadingFrames);
+    double seconds = loadTimer.elapsed() / 1000.0;
+    if (seconds > 0.5 && done > 0)
+    {
+        text += tr(", %1 frames/s").arg(qRound64(loadingFrames / seconds));
+        if (done < total) text += tr(", about %1 s left").arg(qRound64(seconds * (total - done) / done));
+    }
+    loadProgress->setLabelText(text);
+}
+
+void MainWindow::loadFinished(bool ok, bool cancelled)
+{
+    if (loadProgress)
+    {
+        loadProgress->hide();
+        loadProgress->deleteLater();
+        loadProgress = nullptr;
+    }
 
-    if (!loadResult)
+    if (!ok && !cancelled)
     {
-        if (tempFrames.count() > 0) //only ask if at least one frame was decoded.
+        QMessageBox msgBox;
+        if (loadingFormat) msgBox.setText(tr("File load completed with errors.\r\nPerhaps you selected the wrong file type?"));
+        else if (loadingFrames == 0) msgBox.setText(tr("Could not autodetect the file type.\rPlease try to manually select the file format."));
+        if (!msgBox.text().isEmpty()) msgBox.exec();
+
+        bool salvage = false;
+        if (loadingFrames > 0) //only ask if at least one frame was decoded.
         {
-            confirmDialog = QMessageBox::question(this, "Error Loading", "Do you want to salvage what could be loaded?",
-                                      QMessageBox::Yes|QMessageBox::No);
-            if (confirmDialog == QMessageBox::Yes) {
-                loadResult = true;
+            salvage = (QMessageBox::question(this, "Error Loading", "Do you want to salvage what could be loaded?",
+                                             QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes);
+        }
+        if (!salvage)
+        {
+            if (loadingFrames > 0)
+            {
+                model->clearFrames();
+                emit framesUpdated(-1);
             }
+            addHeldLiveFrames();
+            return;
         }
     }
 
-    if (loadResult)
+    //a cancelled load keeps whatever was loaded up to then. If that was nothing, nothing changed
+    if (cancelled && loadingFrames == 0)
     {
-        ui->canFramesView->scrollToTop();
-        model->clearFrames();
-        model->insertFrames(tempFrames);
-        loadedFileName = filename;
-        model->recalcOverwrite();
-        ui->lbNumFrames->setText(QString::number(model->rowCount()));
-        if (ui->cbAutoScroll->isChecked()) ui->canFramesView->scrollToBottom();
+        addHeldLiveFrames();
+        return;
+    }
+    if (loadingFrames == 0) model->clearFrames(); //an empty file still replaces what was there
 
-        updateFileStatus();
-        emit framesUpdated(-1);
+    loadedFileName = QFileInfo(loadingFileName).fileName();
+    model->recalcOverwrite();
+    addHeldLiveFrames();
+    ui->lbNumFrames->setText(QString::number(model->rowCount()));
+    if (ui->cbAutoScroll->isChecked()) ui->canFramesView->scrollToBottom();
+
+    updateFileStatus();
+    emit framesUpdated(-1);
+}
+
+//.cancap captures are shown straight from disk rather than loaded so they can be bigger than memory
+void MainWindow::handleOpenCaptureFile()
+{
+    QString filename;
+    if (!FrameFileIO::selectCaptureFile(filename)) return;
+
+    ui->canFramesView->scrollToTop();
+    if (!model->openCaptureFile(filename))
+    {
+        QMessageBox msgBox;
+        msgBox.setText(tr("Could not open %1.\r\nIt is not a capture file or it was written by a different version.").arg(filename));
+        msgBox.exec();
+        return;
     }
+    QStringList fileList = filename.split('/');
+    loadedFileName = fileList[fileList.length() - 1];
+    ui->lbNumFrames->setText(QString::number(model->rowCount()));
+    if (ui->cbAutoScroll->isChecked()) ui->canFramesView->scrollToBottom();
+
+    updateFileStatus();
+    emit framesUpdated(-1);
+}
+
+//timings recorded by TRACE_SCOPE, for chrome://tracing or ui.perfetto.dev
+void MainWindow::handleExportTrace()
+{
+    QMessageBox msgBox;
+    if (!Tracer::isCompiledIn())
+    {
+        msgBox.setText(tr("This build does not record performance traces.\r\nRebuild with qmake CONFIG+=tracing to enable them."));
+        msgBox.exec();
+        return;
+    }
+
+    QSettings settings;
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export Performance Trace"),
+                                                    settings.value("FileIO/LoadSaveDirectory", QDir::homePath()).toString(),
+                                                    tr("Chrome Trace (*.json)"));
+    if (filename.isEmpty()) return;
+    if (!filename.contains('.')) filename += ".json";
+
+    quint64 events = Tracer::recordedEvents();
+    if (!Tracer::exportChromeTrace(filename))
+    {
+        msgBox.setText(tr("Could not write %1").arg(filename));
+        msgBox.exec();
+        return;
+    }
+    QString text = tr("Exported %1 events.").arg(events);
+    if (Tracer::droppedEvents() > 0) text += tr("\r\n%1 events were dropped because the trace buffers were full.").arg(Tracer::droppedEvents());
+    msgBox.setText(text);
+    msgBox.exec();
+}
+
+//file to file, a batch of frames at a time. Nothing is loaded into the frame list
+void MainWindow::handleConvertFile()
+{
+    QSettings settings;
+    QString directory = settings.value("FileIO/LoadSaveDirectory", QDir::homePath()).toString();
+    QString inFilename = QFileDialog::getOpenFileName(this, tr("Convert Log File"), directory, tr("Any Log File (*.*)"));
+    if (inFilename.isEmpty()) return;
+
+    struct Format
+    {
+        QString filter;
+        const char *suffix;
+        FrameFileIO::SaveFunction saver;
+    };
+    const Format formats[] =
+    {
+        {tr("GVRET Logs (*.csv)"), ".csv", FrameFileIO::saveNativeCSVFile},
+        {tr("CRTD Logs (*.crtd)"), ".crtd", FrameFileIO::saveCRTDFile},
+        {tr("Generic ID/Data CSV (*.csv)"), ".csv", FrameFileIO::saveGenericCSVFile},
+        {tr("BusMaster Log (*.log)"), ".log", FrameFileIO::saveLogFile},
+        {tr("Microchip Log (*.log)"), ".log", FrameFileIO::saveMicrochipFile},
+        {tr("Vector Trace Files (*.trace)"), ".trace", FrameFileIO::saveTraceFile},
+        {tr("IXXAT MiniLog (*.csv)"), ".csv", FrameFileIO::saveIXXATFile},
+        {tr("CAN-DO Log (*.can)"), ".can", FrameFileIO::saveCANDOFile},
+        {tr("Candump/Kayak (*.log)"), ".log", FrameFileIO::saveCanDumpFile},
+        {tr("Cabana Log (*.csv)"), ".csv", FrameFileIO::saveCabanaFile},
+        {tr("CANalyzer Ascii Log (*.asc)"), ".asc", FrameFileIO::saveCanalyzerASC},
+        {tr("CARBUS Analyzer (*.trc)"), ".trc", FrameFileIO::saveCARBUSAnalzyer},
+        {tr("CANOpenAnalyzer Capture (*.cancap)"), ".cancap", FrameFileIO::saveCaptureFile}
+    };
+
+    QStringList filters;
+    for (const Format &format : formats) filters.append(format.filter);
+    QString selectedFilter;
+    QString outFilename = QFileDialog::getSaveFileName(this, tr("Convert To"), QFileInfo(inFilename).path(),
+                                                       filters.join(";;"), &selectedFilter);
+    if (outFilename.isEmpty()) return;
+    const Format &format = formats[qMax(0, filters.indexOf(selectedFilter))];
+    if (QFileInfo(outFilename).suffix().isEmpty()) outFilename += format.suffix;
+    settings.setValue("FileIO/LoadSaveDirectory", QFileInfo(inFilename).path());
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool result = FrameFileIO::convertFrameFile(inFilename, outFilename, format.saver);
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox msgBox;
+    if (result) msgBox.setText(tr("Converted %1 to %2").arg(inFilename, outFilename));
+    else msgBox.setText(tr("Could not convert %1.\r\nThe file could not be read in full or %2 could not be written.").arg(inFilename, outFilename));
+    msgBox.exec();
 }
 
 void MainWindow::handleSaveFile()
@@ -806,7 +1068,7 @@ void MainWindow::handleSaveDecoded()
 void MainWindow::saveDecodedTextFile(QString filename)
 {
     QFile *outFile = new QFile(filename);
-    const QVector<CANFrame> *frames = model->getFilteredListReference();
+    const CANFrameView *frames = model->getFilteredListReference();
 
     const unsigned char *data;
     int dataLen;
@@ -822,8 +1084,8 @@ Data Bytes: 88 10 00 13 BB 00 06 00
     for (int c = 0; c < frames->count(); c++)
     {
         frame = &frames->at(c);
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
-        dataLen = frame->payload().count();
+        data = frame->payloadData();
+        dataLen = frame->payloadLength();
 
         QString builderString;
         builderString += tr("Time: ") + QString::number((frame->timeStamp().microSeconds() / 1000000.0), 'f', 6);
@@ -5,9 +5,12 @@
 #include <QMainWindow>
 #include <QSerialPort>
 #include <QSerialPortInfo>
+#include <QProgressDialog>
+#include <QElapsedTimer>
 #include "canframemodel.h"
 #include "can_structs.h"
 #include "framefileio.h"
+#include "framefileloader.h"
 #include "dbc/dbchandler.h"
 #include "bus_protocols/isotp_handler.h"
 
@@ -56,6 +59,14 @@ public:
 
 private slots:
     void handleLoadFile();
+    void addHeldLiveFrames();
+    void gotLoadedFrames(const CANFrameBatch &frames);
+    void gotLiveFrames(const CANConnection *conn, const CANFrameBatch &frames);
+    void updateLoadProgress(qint64 done, qint64 total);
+    void loadFinished(bool ok, bool cancelled);
+    void handleOpenCaptureFile();
+    void handleExportTrace();
+    void handleConvertFile();
     void handleSaveFile();
     void handleSaveFilteredFile();
     void handleSaveFilters();
@@ -128,6 +139,7 @@ signals:
     //-1 = frames cleared, -2 = a new file has been loaded (so all frames are different), otherwise # of new frames
     void framesUpdated(int numFrames); //something has updated the frame list (send at gui update frequency)
     void frameUpdateRapid(int numFrames);
+    void framesLoaded(const CANFrameBatch &frames); //frames of a file being loaded, batch by batch as it is read
     void settingsUpdated();
     void sendCenterTimeID(uint32_t ID, double timestamp);
 
@@ -154,6 +166,16 @@ private:
     bool continuousLogging;
     int continuousLogFlushCounter;
 
+    //file being loaded in the background
+    FrameFileLoader *fileLoader;
+    QProgressDialog *loadProgress;
+    QElapsedTimer loadTimer;
+    QString loadingFileName;
+    FrameFileIO::LoadFunction loadingFormat;
+    quint64 loadingFrames;
+    bool holdLiveFrames; //from the start of a load until whatever finished() brings up has been dealt with
+    QVector<CANFrameBatch> heldLiveFrames; //captured while the file loads, added behind it once the load is over
+
     //References to other windows we can display
     GraphingWindow *graphingWindow;
     FrameInfoWindow *frameInfoWindow;
@@ -191,6 +213,7 @@ private:
     void saveDecodedTextFile(QString);
     void addFrameToDisplay(CANFrame &, bool);
     void updateFileStatus();
+    void updateCaptureStats();
     void closeEvent(QCloseEvent *event);
     void killEmAll();
     void killWindow(QDialog *win);
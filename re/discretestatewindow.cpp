@@ -3,7 +3,7 @@
 #include "mainwindow.h"
 #include "helpwindow.h"
 
-DiscreteStateWindow::DiscreteStateWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+DiscreteStateWindow::DiscreteStateWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::DiscreteStateWindow)
 {
@@ -8,7 +8,7 @@ const QColor FlowViewWindow::graphColors[8] = {Qt::blue, Qt::green, Qt::black, Q
                                                Qt::gray, Qt::yellow, Qt::cyan, Qt::darkMagenta}; //4 5 6 7
 
 
-FlowViewWindow::FlowViewWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FlowViewWindow::FlowViewWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FlowViewWindow)
 {
@@ -436,8 +436,8 @@ void FlowViewWindow::updatedFrames(int numFrames)
         for (int i = modelFrames->count() - numFrames; i < modelFrames->count(); i++)
         {
             thisFrame = &modelFrames->at(i);
-            data = reinterpret_cast<const unsigned char *>(thisFrame->payload().constData());
-            dataLen = thisFrame->payload().length();
+            data = thisFrame->payloadData();
+            dataLen = thisFrame->payloadLength();
 
             if (!foundID.contains(thisFrame->frameId()))
             {
@@ -519,7 +519,7 @@ void FlowViewWindow::createGraph(int byteNum)
     for (int j = 0; j < numEntries; j++)
     {
         frame = &frameCache[j];
-        data = reinterpret_cast<const unsigned char *>(frame->payload().constData());
+        data = frame->payloadData();
 
         tempVal = data[byteNum];
 
@@ -609,7 +609,7 @@ void FlowViewWindow::changeID(QString newID)
 
     updateGraphLocation();
 
-    memcpy(currBytes, frameCache.at(currentPosition).payload().constData(), 8);
+    memcpy(currBytes, frameCache.at(currentPosition).payloadData(), 8);
     memcpy(refBytes, currBytes, 8);
 
     updateDataView();
@@ -645,7 +645,7 @@ void FlowViewWindow::btnStopClick()
     currentPosition = 0;
 
 
-    memcpy(currBytes, frameCache.at(currentPosition).payload().constData(), 8);
+    memcpy(currBytes, frameCache.at(currentPosition).payloadData(), 8);
     memcpy(refBytes, currBytes, 8);
 
     updateFrameLabel();
@@ -782,7 +782,7 @@ void FlowViewWindow::updatePosition(bool forward)
         playbackTimer->stop();
     }
 
-    memcpy(currBytes, frameCache.at(currentPosition).payload().constData(), 8);
+    memcpy(currBytes, frameCache.at(currentPosition).payloadData(), 8);
 
     if (ui->cbSync->checkState() == Qt::Checked) emit sendCenterTimeID(frameCache[currentPosition].frameId(), frameCache[currentPosition].timeStamp().microSeconds() / 1000000.0);
 }
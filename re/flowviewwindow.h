@@ -4,6 +4,7 @@
 #include <QDialog>
 #include "qcustomplot.h"
 #include "can_structs.h"
+#include "canframeview.h"
 
 namespace Ui {
 class FlowViewWindow;
@@ -14,7 +15,7 @@ class FlowViewWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FlowViewWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FlowViewWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~FlowViewWindow();
     void showEvent(QShowEvent*);
 
@@ -46,7 +47,7 @@ private:
     Ui::FlowViewWindow *ui;
     QList<quint32> foundID;
     QList<CANFrame> frameCache;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     unsigned char refBytes[8];
     unsigned char currBytes[8];
     int triggerValues[8];
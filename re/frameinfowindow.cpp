@@ -12,7 +12,7 @@ QPen FrameInfoWindow::bytePens[8];
 
 const int numIntervalHistBars = 20;
 
-FrameInfoWindow::FrameInfoWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FrameInfoWindow::FrameInfoWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FrameInfoWindow)
 {
@@ -284,14 +284,24 @@ void FrameInfoWindow::updateDetailsWindow(QString newID)
     {
 
         frameCache.clear();
-        for (int i = 0; i < modelFrames->count(); i++)
+        const CANFrameIDIndex *idIndex = modelFrames->idIndex();
+        if (idIndex)
         {
-            CANFrame thisFrame = modelFrames->at(i);
-            if (thisFrame.frameId() == static_cast<uint32_t>(targettedID)) frameCache.append(thisFrame);
+            QVector<uint32_t> rows = idIndex->rowsForID(static_cast<uint32_t>(targettedID));
+            frameCache.reserve(rows.count());
+            for (int i = 0; i < rows.count(); i++) frameCache.append(modelFrames->at(static_cast<int>(rows[i])));
+        }
+        else
+        {
+            for (int i = 0; i < modelFrames->count(); i++)
+            {
+                CANFrame thisFrame = modelFrames->at(i);
+                if (thisFrame.frameId() == static_cast<uint32_t>(targettedID)) frameCache.append(thisFrame);
+            }
         }
 
-        const unsigned char *data = reinterpret_cast<const unsigned char *>(frameCache.at(0).payload().constData());
-        int dataLen = frameCache.at(0).payload().length();
+        const unsigned char *data = frameCache.at(0).payloadData();
+        int dataLen = frameCache.at(0).payloadLength();
 
         ui->treeDetails->clear();
 
@@ -379,8 +389,8 @@ void FrameInfoWindow::updateDetailsWindow(QString newID)
         }
         for (int j = 0; j < 64; j++) bitfieldHistogram[j] = 0;
 
-        data = reinterpret_cast<const unsigned char *>(frameCache.at(0).payload().constData());
-        dataLen = frameCache.at(0).payload().length();
+        data = frameCache.at(0).payloadData();
+        dataLen = frameCache.at(0).payloadLength();
 
         for (int c = 0; c < dataLen; c++)
         {
@@ -395,8 +405,8 @@ void FrameInfoWindow::updateDetailsWindow(QString newID)
         //then find all data points
         for (int j = 0; j < frameCache.count(); j++)
         {
-            data = reinterpret_cast<const unsigned char *>(frameCache.at(j).payload().constData());
-            dataLen = frameCache.at(j).payload().length();
+            data = frameCache.at(j).payloadData();
+            dataLen = frameCache.at(j).payloadLength();
 
             byteGraphX.append(j);
             for (int bytcnt = 0; bytcnt < dataLen; bytcnt++)
@@ -613,7 +623,20 @@ void FrameInfoWindow::updateDetailsWindow(QString newID)
 void FrameInfoWindow::refreshIDList()
 {
     int id;
-    for (int i = 0; i < modelFrames->count(); i++)
+    const CANFrameIDIndex *idIndex = modelFrames->idIndex();
+    if (idIndex)
+    {
+        foreach (uint32_t indexedID, idIndex->ids())
+        {
+            id = static_cast<int>(indexedID);
+            if (!foundID.contains(id))
+            {
+                foundID.append(id);
+                FilterUtility::createFilterItem(id, ui->listFrameID);
+            }
+        }
+    }
+    else for (int i = 0; i < modelFrames->count(); i++)
     {
         CANFrame thisFrame = modelFrames->at(i);
         id = (int)thisFrame.frameId();
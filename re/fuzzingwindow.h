@@ -5,6 +5,7 @@
 #include <QListWidget>
 #include <QTimer>
 #include "can_structs.h"
+#include "canframeview.h"
 
 namespace Ui {
 class FuzzingWindow;
@@ -25,7 +26,7 @@ class FuzzingWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FuzzingWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FuzzingWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~FuzzingWindow();
 
 signals:
@@ -45,7 +46,7 @@ private slots:
 
 private:
     Ui::FuzzingWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QTimer *fuzzTimer;
     QList<int> foundIDs;
     QList<int> selectedIDs;
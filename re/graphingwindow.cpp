@@ -5,7 +5,7 @@
 #include "helpwindow.h"
 #include <QDebug>
 
-GraphingWindow::GraphingWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+GraphingWindow::GraphingWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::GraphingWindow)
 {
@@ -1110,10 +1110,23 @@ void GraphingWindow::createGraph(GraphParams &params, bool createGraphParam)
     qDebug() << "Mask: " << params.mask;
 
     frameCache.clear();
-    for (int i = 0; i < modelFrames->count(); i++)
+    const CANFrameIDIndex *idIndex = modelFrames->idIndex();
+    if (idIndex) //go straight to the frames for this ID
     {
-        CANFrame thisFrame = modelFrames->at(i);
-        if (thisFrame.frameId() == params.ID && thisFrame.frameType() == QCanBusFrame::DataFrame) frameCache.append(thisFrame);
+        QVector<uint32_t> rows = idIndex->rowsForID(params.ID);
+        for (int i = 0; i < rows.count(); i++)
+        {
+            const CANFrame &thisFrame = modelFrames->at(static_cast<int>(rows[i]));
+            if (thisFrame.frameType() == QCanBusFrame::DataFrame) frameCache.append(thisFrame);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < modelFrames->count(); i++)
+        {
+            CANFrame thisFrame = modelFrames->at(i);
+            if (thisFrame.frameId() == params.ID && thisFrame.frameType() == QCanBusFrame::DataFrame) frameCache.append(thisFrame);
+        }
     }
 
     //to fix weirdness where a graph that has no data won't be able to be edited, selected, or deleted properly
@@ -3,6 +3,7 @@
 
 #include "qcustomplot.h"
 #include "can_structs.h"
+#include "canframeview.h"
 #include "dbc/dbchandler.h"
 
 #include <QDialog>
@@ -37,7 +38,7 @@ class GraphingWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit GraphingWindow(const QVector<CANFrame> *, QWidget *parent = 0);
+    explicit GraphingWindow(const CANFrameView *, QWidget *parent = 0);
     ~GraphingWindow();
     void showEvent(QShowEvent*);
 
@@ -77,7 +78,7 @@ private:
     Ui::GraphingWindow *ui;
     DBCHandler *dbcHandler;
     QList<CANFrame> frameCache;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QList<GraphParams> graphParams;
     QPen selectedPen;
     QCPSelectionDecorator *selDecorator;
@@ -4,7 +4,7 @@
 #include "helpwindow.h"
 #include "filterutility.h"
 
-ISOTP_InterpreterWindow::ISOTP_InterpreterWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+ISOTP_InterpreterWindow::ISOTP_InterpreterWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::ISOTP_InterpreterWindow)
 {
@@ -210,8 +210,8 @@ void ISOTP_InterpreterWindow::showDetailView()
 
     msg = &messages[rowNum];
 
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(msg->payload().constData());
-    int dataLen = msg->payload().length();
+    const unsigned char *data = msg->payloadData();
+    int dataLen = msg->payloadLength();
 
     if (msg->reportedLength != dataLen)
     {
@@ -252,8 +252,8 @@ void ISOTP_InterpreterWindow::newISOMessage(ISOTP_MESSAGE msg)
     int rowNum;
     QString tempString;
 
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(msg.payload().constData());
-    int dataLen = msg.payload().length();
+    const unsigned char *data = msg.payloadData();
+    int dataLen = msg.payloadLength();
 
     if ((msg.reportedLength != dataLen) && !ui->cbShowIncomplete->isChecked()) return;
 
@@ -278,7 +278,7 @@ void ISOTP_InterpreterWindow::newISOMessage(ISOTP_MESSAGE msg)
     ui->tableIsoFrames->setItem(rowNum, 2, new QTableWidgetItem(QString::number(msg.bus)));
     if (msg.isReceived) ui->tableIsoFrames->setItem(rowNum, 3, new QTableWidgetItem("Rx"));
     else ui->tableIsoFrames->setItem(rowNum, 3, new QTableWidgetItem("Tx"));
-    ui->tableIsoFrames->setItem(rowNum, 4, new QTableWidgetItem(QString::number(msg.payload().length())));
+    ui->tableIsoFrames->setItem(rowNum, 4, new QTableWidgetItem(QString::number(msg.payloadLength())));
 
     for (int i = 0; i < dataLen; i++)
     {
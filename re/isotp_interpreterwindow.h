@@ -3,6 +3,7 @@
 
 #include <QDialog>
 #include "bus_protocols/isotp_handler.h"
+#include "canframeview.h"
 
 class ISOTP_MESSAGE;
 class ISOTP_HANDLER;
@@ -16,7 +17,7 @@ class ISOTP_InterpreterWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit ISOTP_InterpreterWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit ISOTP_InterpreterWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~ISOTP_InterpreterWindow();
     void showEvent(QShowEvent*);
 
@@ -38,7 +39,7 @@ private:
     ISOTP_HANDLER *decoder;
     UDS_HANDLER *udsDecoder;
 
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QVector<ISOTP_MESSAGE> messages;
     QHash<int, bool> idFilters;
 
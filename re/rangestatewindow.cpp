@@ -5,7 +5,7 @@
 #include "helpwindow.h"
 #include "filterutility.h"
 
-RangeStateWindow::RangeStateWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+RangeStateWindow::RangeStateWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::RangeStateWindow)
 {
@@ -242,7 +242,7 @@ void RangeStateWindow::signalsFactory()
     int granularity = ui->spinGranularity->value();
     int sigType = ui->cbSignalMode->currentIndex() + 1;
     int signedType = ui->cbSignedMode->currentIndex() + 1;
-    int maxBits = frameCache.at(0).payload().length() * 8;
+    int maxBits = frameCache.at(0).payloadLength() * 8;
     int sens = ui->slideSensitivity->value();
 
     for (int sigSize = maxSig; sigSize >= minSig; sigSize -= granularity)
@@ -6,8 +6,8 @@
 SnifferItem::SnifferItem(const CANFrame& pFrame, quint32 seq):
     mID(pFrame.frameId())
 {
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(pFrame.payload().constData());
-    int dataLen = pFrame.payload().length();
+    const unsigned char *data = pFrame.payloadData();
+    int dataLen = pFrame.payloadLength();
 
     for (int i = 0; i < dataLen; i++) {
         mNotch[i] = 0;
@@ -117,8 +117,8 @@ void SnifferItem::update(const CANFrame& pFrame, quint32 timeSeq, bool mute)
     mLastTime = mCurrentTime;
     mCurrSeqVal = timeSeq;
 
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(pFrame.payload().constData());
-    int dataLen = pFrame.payload().length();
+    const unsigned char *data = pFrame.payloadData();
+    int dataLen = pFrame.payloadLength();
 
     /* copy new value */
     for (int i = 0; i < dataLen; i++)
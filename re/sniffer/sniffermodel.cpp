@@ -321,7 +321,7 @@ void SnifferModel::filter(fltType pType, int pId)
 /**********         slots       ****************/
 /***********************************************/
 
-void SnifferModel::update(CANConnection*, QVector<CANFrame>& pFrames)
+void SnifferModel::update(CANConnection*, const CANFrameBatch& pFrames)
 {
     foreach(const CANFrame& frame, pFrames)
     {
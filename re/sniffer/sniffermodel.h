@@ -7,6 +7,7 @@
 #include <QTimer>
 
 #include "can_structs.h"
+#include "canframebatch.h"
 #include "connections/canconnection.h"
 #include "snifferitem.h"
 
@@ -49,7 +50,7 @@ public:
 
 
 public slots:
-    void update(CANConnection*, QVector<CANFrame>&);
+    void update(CANConnection*, const CANFrameBatch&);
     void notch();
     void unNotch();
 
@@ -5,6 +5,7 @@
 #include "ui_snifferwindow.h"
 #include "helpwindow.h"
 #include "connections/canconmanager.h"
+#include "mainwindow.h"
 #include "SnifferDelegate.h"
 
 SnifferWindow::SnifferWindow(QWidget *parent) :
@@ -116,6 +117,11 @@ void SnifferWindow::showEvent(QShowEvent* event)
 {
     QDialog::showEvent(event);
     connect(CANConManager::getInstance(), &CANConManager::framesReceived, &mModel, &SnifferModel::update);
+    /* frames of a file being loaded are sniffed as they arrive too */
+    connect(MainWindow::getReference(), &MainWindow::framesLoaded, this, [this](const CANFrameBatch &frames)
+    {
+        mModel.update(nullptr, frames);
+    });
     mTimer.start();
     readSettings();
     installEventFilter(this);
@@ -130,6 +136,7 @@ void SnifferWindow::closeEvent(QCloseEvent *event)
     mTimer.stop();
     /* disconnect reception of frames */
     disconnect(CANConManager::getInstance(), 0, this, 0);
+    disconnect(MainWindow::getReference(), 0, this, 0);
     writeSettings();
     /* clear model */
     mModel.clear();
@@ -6,7 +6,7 @@
 #include "utility.h"
 #include "helpwindow.h"
 
-UDSScanWindow::UDSScanWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+UDSScanWindow::UDSScanWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::UDSScanWindow)
 {
@@ -354,8 +354,8 @@ void UDSScanWindow::gotUDSReply(UDS_MESSAGE msg)
     int offset = ui->spinReplyOffset->value();
     UDS_MESSAGE sentFrame;
     bool gotReply = false;
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(msg.payload().constData());
-    int dataLen = msg.payload().length();
+    const unsigned char *data = msg.payloadData();
+    int dataLen = msg.payloadLength();
 
     int numSending = sendingFrames.length();
     if (numSending == 0) return;
@@ -250,20 +250,26 @@ void CANScriptHelper::sendFrame(QJSValue bus, QJSValue id, QJSValue length, QJSV
     CANConManager::getInstance()->sendFrame(frame);
 }
 
+void CANScriptHelper::gotTargettedFrames(const CANFrameBatch &frames)
+{
+    if (!gotFrameFunction.isCallable()) return;
+    foreach (const CANFrame &frame, frames) gotTargettedFrame(frame);
+}
+
 void CANScriptHelper::gotTargettedFrame(const CANFrame &frame)
 {
     if (!gotFrameFunction.isCallable()) return; //nothing to do if we can't even call the function
     //qDebug() << "Got frame in script interface";
 
-    const unsigned char *data = reinterpret_cast<const unsigned char *>(frame.payload().constData());
-    int dataLen = frame.payload().length();
+    const unsigned char *data = frame.payloadData();
+    int dataLen = frame.payloadLength();
 
     for (int i = 0; i < filters.length(); i++)
     {
         if (filters[i].checkFilter(frame.frameId(), frame.bus))
         {
             QJSValueList args;
-            args << frame.bus << frame.frameId() << frame.payload().length();
+            args << frame.bus << frame.frameId() << frame.payloadLength();
             QJSValue dataBytes = scriptEngine->newArray(dataLen);
 
             for (int j = 0; j < dataLen; j++) dataBytes.setProperty(j, QJSValue(data[j]));
@@ -311,7 +317,7 @@ void ISOTPScriptHelper::sendISOTP(QJSValue bus, QJSValue id, QJSValue length, QJ
     msg.setFrameId(id.toUInt());
     dataArray.resize(length.toInt());
 
-    int dataLen = msg.payload().length();
+    int dataLen = msg.payloadLength();
 
     if (!dataBytes.isArray()) qDebug() << "data isn't an array";
 
@@ -341,10 +347,10 @@ void ISOTPScriptHelper::newISOMessage(ISOTP_MESSAGE msg)
     //qDebug() << "Got frame in script interface";
 
     QJSValueList args;
-    args << msg.bus << msg.frameId() << msg.payload().length();
-    QJSValue dataBytes = scriptEngine->newArray(static_cast<uint>(msg.payload().length()));
+    args << msg.bus << msg.frameId() << msg.payloadLength();
+    QJSValue dataBytes = scriptEngine->newArray(static_cast<uint>(msg.payloadLength()));
 
-    for (int j = 0; j < msg.payload().length(); j++) dataBytes.setProperty(static_cast<quint32>(j), QJSValue((unsigned char)msg.payload()[j]));
+    for (int j = 0; j < msg.payloadLength(); j++) dataBytes.setProperty(static_cast<quint32>(j), QJSValue((unsigned char)msg.payload()[j]));
     args.append(dataBytes);
     gotFrameFunction.call(args);
 }
@@ -391,7 +397,7 @@ void UDSScriptHelper::sendUDS(QJSValue bus, QJSValue id, QJSValue service, QJSVa
 
     if (!data.isArray()) qDebug() << "data isn't an array";
 
-    for (int i = 0; i < msg.payload().length(); i++)
+    for (int i = 0; i < msg.payloadLength(); i++)
     {
         dataArray[i] = (static_cast<uint8_t>(data.property(static_cast<quint32>(i)).toInt()));
     }
@@ -414,15 +420,15 @@ void UDSScriptHelper::setRxCallback(QJSValue cb)
 void UDSScriptHelper::newUDSMessage(UDS_MESSAGE msg)
 {
     //qDebug() << "udsScriptHelper got a UDS message";
-    qDebug() << "UDS script helper. Msg data len: " << msg.payload().length();
+    qDebug() << "UDS script helper. Msg data len: " << msg.payloadLength();
     if (!gotFrameFunction.isCallable()) return; //nothing to do if we can't even call the function
     qDebug() << "Got frame in script interface";
 
     QJSValueList args;
-    args << msg.bus << msg.frameId() << msg.service << msg.subFunc << msg.payload().length();
-    QJSValue dataBytes = scriptEngine->newArray(static_cast<unsigned int>(msg.payload().length()));
+    args << msg.bus << msg.frameId() << msg.service << msg.subFunc << msg.payloadLength();
+    QJSValue dataBytes = scriptEngine->newArray(static_cast<unsigned int>(msg.payloadLength()));
 
-    for (int j = 0; j < msg.payload().length(); j++) dataBytes.setProperty(static_cast<quint32>(j), QJSValue((unsigned char)msg.payload()[j]));
+    for (int j = 0; j < msg.payloadLength(); j++) dataBytes.setProperty(static_cast<quint32>(j), QJSValue((unsigned char)msg.payload()[j]));
     args.append(dataBytes);
     gotFrameFunction.call(args);
 }
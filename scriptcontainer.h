@@ -2,6 +2,7 @@
 #define SCRIPTCONTAINER_H
 
 #include "can_structs.h"
+#include "canframebatch.h"
 #include "canfilter.h"
 #include "bus_protocols/isotp_handler.h"
 #include "bus_protocols/isotp_message.h"
@@ -28,6 +29,7 @@ public slots:
 
 private slots:
     void gotTargettedFrame(const CANFrame &frame);
+    void gotTargettedFrames(const CANFrameBatch &frames);
 
 private:
     QList<CANFilter> filters;
@@ -8,7 +8,7 @@
 #include "connections/canconmanager.h"
 #include "helpwindow.h"
 
-ScriptingWindow::ScriptingWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+ScriptingWindow::ScriptingWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::ScriptingWindow)
 {
@@ -57,7 +57,7 @@ ScriptingWindow::~ScriptingWindow()
 }
 
 
-void ScriptingWindow::newFrames(const CANConnection* pConn, const QVector<CANFrame>& pFrames)
+void ScriptingWindow::newFrames(const CANConnection* pConn, const CANFrameBatch& pFrames)
 {
     /*FIXME: name of the probe and bus should be checked */
     Q_UNUSED(pConn);
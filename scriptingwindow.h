@@ -3,6 +3,8 @@
 
 #include "scriptcontainer.h"
 #include "can_structs.h"
+#include "canframeview.h"
+#include "canframebatch.h"
 #include "connections/canconnection.h"
 #include "jsedit.h"
 
@@ -20,7 +22,7 @@ class ScriptingWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit ScriptingWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit ScriptingWindow(const CANFrameView *frames, QWidget *parent = 0);
     void showEvent(QShowEvent*);
     ~ScriptingWindow();
 
@@ -40,7 +42,7 @@ private slots:
     void revertScript();
     void recompileScript();
     void changeCurrentScript();
-    void newFrames(const CANConnection*, const QVector<CANFrame>&);
+    void newFrames(const CANConnection*, const CANFrameBatch&);
     void clickedLogClear();
     void valuesTimerElapsed();
     void updatedValue(int row, int col);
@@ -55,7 +57,7 @@ private:
     JSEdit *editor;
     QList<ScriptContainer *> scripts;
     ScriptContainer *currentScript;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
     QElapsedTimer elapsedTime;
     QTimer valuesTimer;
 };
@@ -4,7 +4,7 @@
 #include "mainwindow.h"
 #include <QDebug>
 
-SignalViewerWindow::SignalViewerWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+SignalViewerWindow::SignalViewerWindow(const CANFrameView *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::SignalViewerWindow)
 {
@@ -3,6 +3,7 @@
 
 #include <QDialog>
 #include "dbc/dbchandler.h"
+#include "canframeview.h"
 
 namespace Ui {
 class SignalViewerWindow;
@@ -13,7 +14,7 @@ class SignalViewerWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit SignalViewerWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit SignalViewerWindow(const CANFrameView *frames, QWidget *parent = 0);
     ~SignalViewerWindow();
 
 private slots:
@@ -28,7 +29,7 @@ private:
     DBCHandler *dbcHandler;
 
     QList<DBC_SIGNAL *> signalList;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameView *modelFrames;
 
     void processFrame(CANFrame &frame);
 };
@@ -11,6 +11,7 @@ SOURCES += \
     tst_cancon.cpp \
     ../connections/canconfactory.cpp \
     ../connections/canconnection.cpp \
+    ../connections/cantimebase.cpp \
     ../connections/gvretserial.cpp \
     ../connections/socketcan.cpp \
     ../canbus.cpp
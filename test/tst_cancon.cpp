@@ -322,8 +322,48 @@ void TestCanCon::write()
 }
 
 
+/* one matched frame on an otherwise quiet bus, THROUGHPUT_FIRST settings so it never raises a drain itself */
+void TestCanCon::targettedFrameWithoutTraffic()
+{
+    qRegisterMetaType<CANFrameBatch>("CANFrameBatch");
+
+    TestFeedConnection conn;
+    TestTargetReceiver receiver;
+    conn.setDrainTrigger(conn.getQueue().size() / 4, 50000);
+    QVERIFY(conn.addTargettedFrame(0, 0x7E8, 0x7FF, &receiver));
+
+    QSignalSpy spy(&conn, SIGNAL(framesAvailable()));
+
+    CANFrame frame;
+    frame.bus = 0;
+    frame.setFrameId(0x7E8);
+    conn.receive(frame);
+    QCOMPARE(spy.count(), 0);
+
+    /* what the manager's backstop does, with no further frames arriving */
+    conn.clearDrainRequest();
+    conn.deliverTargettedFrames();
+
+    QTRY_COMPARE(receiver.mFrames, 1);
+}
+
+
 /*********************************************************/
 
+TestFeedConnection::TestFeedConnection():
+    CANConnection("feed", "test", CANCon::GVRET_SERIAL, 1, 1000, false) {}
+
+void TestFeedConnection::receive(const CANFrame& pFrame)
+{
+    CANFrame* frame_p = getQueue().get();
+    if(!frame_p)
+        return;
+    *frame_p = pFrame;
+    checkTargettedFrame(*frame_p);
+    getQueue().queue();
+    framesQueued();
+}
+
 bool TestCanCon::pCreate(CANConnection*& pConn_p)
 {
     pConn_p = CanConFactory::create(mType, mPortName);
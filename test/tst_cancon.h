@@ -4,6 +4,31 @@
 #include <QObject>
 #include "canconconst.h"
 #include "canconnection.h"
+#include "canframebatch.h"
+
+/* a connection without a device, frames are fed to it by the test */
+class TestFeedConnection: public CANConnection
+{
+public:
+    TestFeedConnection();
+    void receive(const CANFrame& pFrame);
+protected:
+    void piStarted() {}
+    void piStop() {}
+    void piSetBusSettings(int, CANBus) {}
+    bool piGetBusSettings(int, CANBus&) { return false; }
+    void piSuspend(bool) {}
+    bool piSendFrame(const CANFrame&) { return true; }
+};
+
+class TestTargetReceiver: public QObject
+{
+    Q_OBJECT
+public:
+    int mFrames = 0;
+public slots:
+    void gotTargettedFrames(const CANFrameBatch& pFrames) { mFrames += pFrames.count(); }
+};
 
 class TestCanCon: public QObject
 {
@@ -23,6 +48,7 @@ private slots:
     void filter();
     void filter_data();
     void write();
+    void targettedFrameWithoutTraffic();
 
 private:
     bool pCreate(CANConnection*& pConn_p);
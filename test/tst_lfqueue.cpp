@@ -3,6 +3,7 @@
 #include <QtConcurrent/qtconcurrentrun.h>
 
 #include "utils/lfqueue.h"
+#include "can_structs.h"
 #include "tst_lfqueue.h"
 
 
@@ -16,6 +17,7 @@ void TestLFQueue::setSize_data()
     QTest::newRow("0")      <<  0       << true;
     QTest::newRow("10")     << 10       << true;
     QTest::newRow("2000")   << 20000    << true;
+    QTest::newRow("3")      <<  3       << true;
 
 }
 
@@ -27,6 +29,12 @@ void TestLFQueue::setSize()
 
     LFQueue<void*> queue;
     QCOMPARE(queue.setSize(size), result);
+
+    /* capacity is rounded up to a power of two */
+    if(result && size>0) {
+        QVERIFY(queue.size() >= size);
+        QCOMPARE(queue.size() & (queue.size()-1), 0);
+    }
 }
 
 
@@ -83,3 +91,149 @@ void TestLFQueue::exchange()
 
     thread.waitForFinished();
 }
+
+
+void bulkReaderThread(LFQueue<int>* pQueue_p, int pSize, int pBatch) {
+    int expected = 0;
+    int count;
+    int* val_p;
+
+    while(expected < pSize) {
+        if(! (val_p = pQueue_p->peekBulk(pBatch, count)) )
+            continue;
+
+        QVERIFY(count > 0);
+        QVERIFY(count <= pBatch);
+        for(int i=0 ; i<count ; i++)
+            QCOMPARE(val_p[i], expected++);
+
+        pQueue_p->consume(count);
+    }
+}
+
+
+void TestLFQueue::bulkExchange_data()
+{
+    QTest::addColumn<int>("queueSize");
+    QTest::addColumn<int>("batch");
+
+    QTest::newRow("batch1")     << 16   << 1;
+    QTest::newRow("batch5")     << 16   << 5;   /* doesn't divide the ring so runs wrap around the end */
+    QTest::newRow("batchFull")  << 16   << 16;
+    QTest::newRow("batchOver")  << 8    << 100; /* asks for more than the ring can hold */
+}
+
+
+void TestLFQueue::bulkExchange()
+{
+    const int total = 100000;
+    LFQueue<int> queue;
+    QFETCH(int, queueSize);
+    QFETCH(int, batch);
+
+    QCOMPARE(queue.setSize(queueSize), true);
+
+    QFuture<void> thread = QtConcurrent::run(bulkReaderThread, &queue, total, batch);
+
+    int next = 0;
+    int count;
+    int* val_p;
+    while(next < total) {
+        if(! (val_p = queue.reserve(qMin(batch, total-next), count)) )
+            continue;
+
+        QVERIFY(count > 0);
+        for(int i=0 ; i<count ; i++)
+            val_p[i] = next++;
+
+        queue.commit(count);
+    }
+
+    thread.waitForFinished();
+}
+
+
+/* drains pTotal frames, either one at a time or in runs, like CANConManager does */
+void frameDrainThread(LFQueue<CANFrame>* pQueue_p, int pTotal, bool pBulk) {
+    int received = 0;
+    int count;
+    CANFrame* frame_p;
+    uint64_t sum = 0;
+
+    while(received < pTotal) {
+        if(pBulk) {
+            if(! (frame_p = pQueue_p->peekBulk(pQueue_p->size(), count)) )
+                continue;
+            for(int i=0 ; i<count ; i++)
+                sum += frame_p[i].timestamp;
+            pQueue_p->consume(count);
+            received += count;
+        }
+        else {
+            if(! (frame_p = pQueue_p->peek()) )
+                continue;
+            sum += frame_p->timestamp;
+            pQueue_p->dequeue();
+            received++;
+        }
+    }
+
+    QVERIFY(sum == static_cast<uint64_t>(pTotal) * (pTotal-1) / 2);
+}
+
+
+void TestLFQueue::throughput_data()
+{
+    QTest::addColumn<bool>("bulk");
+
+    /* both rows run the current queue, one through get()/queue() and peek()/dequeue(), one through the runs */
+    QTest::newRow("perFrameApi")    << false;
+    QTest::newRow("bulkApi")        << true;
+}
+
+
+/*
+ * Benchmark, only timed when asked for (-iterations, -callgrind etc). A normal run goes through it once with a
+ * small count. Whether frames arrive complete and in order is checked by bulkExchange.
+ */
+void TestLFQueue::throughput()
+{
+    const int total = 100000;
+    const int batch = 64;
+    LFQueue<CANFrame> queue;
+    QFETCH(bool, bulk);
+
+    QCOMPARE(queue.setSize(4000), true);
+
+    CANFrame frame;
+    frame.setFrameId(0x123);
+    frame.setPayload(QByteArray(8, 0x55));
+
+    QBENCHMARK {
+        QFuture<void> thread = QtConcurrent::run(frameDrainThread, &queue, total, bulk);
+
+        int sent = 0;
+        int count;
+        CANFrame* frame_p;
+        while(sent < total) {
+            if(bulk) {
+                if(! (frame_p = queue.reserve(qMin(batch, total-sent), count)) )
+                    continue;
+                for(int i=0 ; i<count ; i++) {
+                    frame_p[i] = frame;
+                    frame_p[i].timestamp = static_cast<uint64_t>(sent++);
+                }
+                queue.commit(count);
+            }
+            else {
+                if(! (frame_p = queue.get()) )
+                    continue;
+                *frame_p = frame;
+                frame_p->timestamp = static_cast<uint64_t>(sent++);
+                queue.queue();
+            }
+        }
+
+        thread.waitForFinished();
+    }
+}
@@ -13,6 +13,10 @@ private slots:
     void setSize();
     void exchange_data();
     void exchange();
+    void bulkExchange_data();
+    void bulkExchange();
+    void throughput_data();
+    void throughput();
 };
 
 #endif // TST_LFQUEUE_H
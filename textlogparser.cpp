@@ -0,0 +1,325 @@
+#include "textlogparser.h"
+
+#include <QThread>
+#include <QtConcurrent>
+#include <string.h>
+#include "utils/tracer.h"
+
+namespace {
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+inline char upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+}
+
+void TextTokens::splitWhitespace(const char *begin, const char *end)
+{
+    mCount = 0;
+    const char *c = begin;
+    while (mCount < MAX_TOKENS)
+    {
+        while (c < end && isSpace(*c)) c++;
+        if (c == end) break;
+        mBegin[mCount] = c;
+        while (c < end && !isSpace(*c)) c++;
+        mEnd[mCount++] = c;
+    }
+}
+
+void TextTokens::split(const char *begin, const char *end, char sep)
+{
+    mCount = 0;
+    trim(begin, end);
+    if (begin == end) return;
+
+    const char *c = begin;
+    while (mCount < MAX_TOKENS)
+    {
+        const char *tokenEnd = static_cast<const char *>(memchr(c, sep, static_cast<size_t>(end - c)));
+        if (!tokenEnd) tokenEnd = end;
+        const char *b = c;
+        const char *e = tokenEnd;
+        while (b < e && isSpace(*b)) b++;
+        while (e > b && isSpace(e[-1])) e--;
+        mBegin[mCount] = b;
+        mEnd[mCount++] = e;
+        if (tokenEnd == end) break;
+        c = tokenEnd + 1;
+    }
+}
+
+bool TextTokens::equals(int idx, const char *text) const
+{
+    const char *c = mBegin[idx];
+    for (; *text; text++, c++)
+    {
+        if (c == mEnd[idx] || upper(*c) != upper(*text)) return false;
+    }
+    return c == mEnd[idx];
+}
+
+bool TextTokens::contains(int idx, const char *text) const
+{
+    int len = static_cast<int>(strlen(text));
+    for (const char *start = mBegin[idx]; mEnd[idx] - start >= len; start++)
+    {
+        int i = 0;
+        while (i < len && upper(start[i]) == upper(text[i])) i++;
+        if (i == len) return true;
+    }
+    return false;
+}
+
+bool TextTokens::startsWith(int idx, const char *text) const
+{
+    const char *c = mBegin[idx];
+    for (; *text; text++, c++)
+    {
+        if (c == mEnd[idx] || upper(*c) != upper(*text)) return false;
+    }
+    return true;
+}
+
+void TextTokens::trim(const char *&begin, const char *&end)
+{
+    while (begin < end && isSpace(*begin)) begin++;
+    while (end > begin && isSpace(end[-1])) end--;
+}
+
+bool TextTokens::toInt(int idx, int &value) const
+{
+    const char *b = mBegin[idx];
+    bool negative = (b < mEnd[idx] && *b == '-');
+    if (negative || (b < mEnd[idx] && *b == '+')) b++;
+    uint64_t v;
+    bool ok = parseUInt(b, mEnd[idx], v) && v <= 0x7FFFFFFF;
+    value = ok ? (negative ? -static_cast<int>(v) : static_cast<int>(v)) : 0;
+    return ok;
+}
+
+bool TextTokens::parseHex(const char *begin, const char *end, uint64_t &value)
+{
+    value = 0;
+    if (begin == end || end - begin > 16) return false;
+    uint64_t v = 0;
+    for (const char *c = begin; c < end; c++)
+    {
+        int digit;
+        if (*c >= '0' && *c <= '9') digit = *c - '0';
+        else if (*c >= 'A' && *c <= 'F') digit = *c - 'A' + 10;
+        else if (*c >= 'a' && *c <= 'f') digit = *c - 'a' + 10;
+        else return false;
+        v = (v << 4) | static_cast<uint64_t>(digit);
+    }
+    value = v;
+    return true;
+}
+
+bool TextTokens::parseUInt(const char *begin, const char *end, uint64_t &value)
+{
+    value = 0;
+    if (begin == end || end - begin > 19) return false;
+    uint64_t v = 0;
+    for (const char *c = begin; c < end; c++)
+    {
+        if (*c < '0' || *c > '9') return false;
+        v = v * 10 + static_cast<uint64_t>(*c - '0');
+    }
+    value = v;
+    return true;
+}
+
+bool TextTokens::parseSecondsUs(const char *begin, const char *end, uint64_t &value)
+{
+    value = 0;
+    const char *dot = static_cast<const char *>(memchr(begin, '.', static_cast<size_t>(end - begin)));
+    if (!dot) dot = end;
+
+    uint64_t seconds = 0;
+    if (dot > begin && !parseUInt(begin, dot, seconds)) return false;
+    if (dot == begin && (dot == end || dot + 1 == end)) return false; //no digits at all
+
+    uint64_t us = 0;
+    int places = 0;
+    for (const char *c = dot + 1; c < end; c++)
+    {
+        if (*c < '0' || *c > '9') return false;
+        if (places < 6)
+        {
+            us = us * 10 + static_cast<uint64_t>(*c - '0');
+            places++;
+        }
+    }
+    for (; places < 6; places++) us *= 10;
+    value = seconds * 1000000 + us;
+    return true;
+}
+
+qint64 TextLogGrammar::lineLength(const char *data, qint64 size, char eol)
+{
+    const char *found = static_cast<const char *>(memchr(data, eol, static_cast<size_t>(size)));
+    return found ? (found - data + 1) : size;
+}
+
+void TextLogReader::parseChunk(Chunk &chunk)
+{
+    TRACE_SCOPE("text parse");
+    chunk.errors = false;
+    chunk.frames.resize(0);
+    chunk.frames.reserve(static_cast<int>((chunk.end - chunk.begin) / 40)); //a short frame line is about that long
+
+    const CANFrame blank;
+    const char *line = chunk.begin;
+    while (line < chunk.end)
+    {
+        const char *eol = static_cast<const char *>(memchr(line, chunk.eol, static_cast<size_t>(chunk.end - line)));
+        if (!eol) eol = chunk.end;
+        const char *next = (eol < chunk.end) ? eol + 1 : eol;
+        if (eol > line && eol[-1] == '\r') eol--;
+
+        CANFrame frame = blank;
+        switch (chunk.grammar->parseLine(line, eol, frame))
+        {
+        case TextLogGrammar::LINE_FRAME:
+            chunk.frames.append(frame);
+            break;
+        case TextLogGrammar::LINE_DAMAGED:
+            chunk.frames.append(frame);
+            chunk.errors = true;
+            break;
+        case TextLogGrammar::LINE_ERROR:
+            chunk.errors = true;
+            break;
+        default:
+            break;
+        }
+        line = next;
+    }
+}
+
+TextLogReader::TextLogReader(TextLogGrammar *grammar)
+    : mGrammar(grammar), mChunkCount(0), mChunk(0), mFramePos(0), mHeaderDone(false), mAtEnd(true), mOk(false),
+      mFrames(0), mPosition(0), mSize(0)
+{
+}
+
+bool TextLogReader::open(const QString &filename)
+{
+    mFile.setFileName(filename);
+    mOk = mFile.open(QIODevice::ReadOnly);
+    mAtEnd = !mOk;
+    mSize = mOk ? mFile.size() : 0;
+    return mOk;
+}
+
+int TextLogReader::read(CANFrame *frames, int max)
+{
+    int done = 0;
+    while (done < max)
+    {
+        if (mChunk >= mChunkCount)
+        {
+            if (!fill()) break;
+            continue;
+        }
+        const QVector<CANFrame> &parsed = mChunks[mChunk].frames;
+        int num = qMin(max - done, parsed.count() - mFramePos);
+        if (num > 0) memcpy(frames + done, parsed.constData() + mFramePos, static_cast<size_t>(num) * sizeof(CANFrame));
+        done += num;
+        mFramePos += num;
+        if (mFramePos >= parsed.count())
+        {
+            mChunk++;
+            mFramePos = 0;
+        }
+    }
+    return done;
+}
+
+//reads and parses the next window. False once there is nothing left
+bool TextLogReader::fill()
+{
+    mChunk = 0;
+    mChunkCount = 0;
+    mFramePos = 0;
+    if (mAtEnd && mText.isEmpty())
+    {
+        if (mFrames == 0 && mGrammar->requiresFrames()) mOk = false;
+        return false;
+    }
+
+    const qint64 window = static_cast<qint64>(CHUNK_BYTES) * qMax(1, QThread::idealThreadCount());
+    int carried = mText.size();
+    if (!mAtEnd)
+    {
+        TRACE_SCOPE("text read");
+        mText.resize(carried + static_cast<int>(window));
+        qint64 got = mFile.read(mText.data() + carried, window);
+        if (got < 0)
+        {
+            mOk = false;
+            got = 0;
+        }
+        mText.resize(carried + static_cast<int>(got));
+        if (got == 0 || mFile.atEnd()) mAtEnd = true;
+    }
+
+    const char *data = mText.constData();
+    const char *end = data + mText.size();
+    const char *begin = data;
+    const char eol = mGrammar->lineEnd();
+    if (!mHeaderDone)
+    {
+        mHeaderDone = true;
+        begin += qBound(Q_INT64_C(0), mGrammar->headerLength(data, mText.size()), static_cast<qint64>(mText.size()));
+    }
+
+    //the last line may not be all there yet, it waits for the next window unless this is the end of the file
+    const char *complete = end;
+    if (!mAtEnd)
+    {
+        while (complete > begin && complete[-1] != eol) complete--;
+        if (complete == begin) complete = end; //a window without a line ending. Nothing to be done but cut it
+    }
+
+    //chunks end just after a line ending so every line is parsed by exactly one chunk
+    for (const char *pos = begin; pos < complete; mChunkCount++)
+    {
+        if (mChunkCount == mChunks.count()) mChunks.append(Chunk());
+        Chunk &chunk = mChunks[mChunkCount];
+        chunk.begin = pos;
+        if (complete - pos <= CHUNK_BYTES) chunk.end = complete;
+        else
+        {
+            const char *cut = pos + CHUNK_BYTES;
+            const char *lineEnd = static_cast<const char *>(memchr(cut, eol, static_cast<size_t>(complete - cut)));
+            chunk.end = lineEnd ? lineEnd + 1 : complete;
+        }
+        chunk.grammar = mGrammar.data();
+        chunk.eol = eol;
+        pos = chunk.end;
+    }
+
+    if (mChunkCount == 1) parseChunk(mChunks[0]);
+    else if (mChunkCount > 1) QtConcurrent::blockingMap(mChunks.begin(), mChunks.begin() + mChunkCount, parseChunk);
+    for (int i = 0; i < mChunkCount; i++)
+    {
+        if (mChunks[i].errors) mOk = false;
+        mGrammar->finishFrames(mChunks[i].frames.data(), mChunks[i].frames.count());
+        mFrames += mChunks[i].frames.count();
+    }
+
+    //frames are parsed, the carried over part of a line moves to the front for the next window
+    int used = static_cast<int>(complete - data);
+    memmove(mText.data(), mText.constData() + used, static_cast<size_t>(mText.size() - used));
+    mText.resize(mText.size() - used);
+    mPosition = mAtEnd ? mSize : mFile.pos() - mText.size();
+    return true;
+}
@@ -0,0 +1,152 @@
+#ifndef TEXTLOGPARSER_H
+#define TEXTLOGPARSER_H
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+#include "can_structs.h"
+#include "framestream.h"
+
+/*
+ * Reader for the line oriented text log formats (GVRET CSV, candump, CANalyzer ASC, CRTD and so on).
+ *
+ * The file is read a window of a few MB per thread at a time. Each window is cut into chunks at line boundaries,
+ * every chunk is parsed on a thread of the global pool and the frames of the chunks are handed out in file order,
+ * so the result is exactly what a single pass over the file would have produced. Only one window of text and
+ * its frames are ever held, whatever the size of the file.
+ *
+ * What a line means is up to a TextLogGrammar. A grammar gets each line as a pair of pointers into the window
+ * and splits it with TextTokens, which only records where each token starts and ends. Numbers are parsed
+ * straight from those ranges. Nothing on the per line path allocates.
+ */
+
+//the tokens of one line. Each token is a [begin, end) range of the line, nothing is copied
+class TextTokens
+{
+public:
+    static const int MAX_TOKENS = 80; //64 data bytes and the fields around them. Anything after is dropped
+
+    TextTokens() : mCount(0) {}
+
+    //splits at runs of white space, same as QByteArray::simplified().split(' ')
+    void splitWhitespace(const char *begin, const char *end);
+    //splits at every sep and trims the white space around each token, same as simplified().split(sep)
+    void split(const char *begin, const char *end, char sep);
+
+    int count() const { return mCount; }
+    const char *begin(int idx) const { return mBegin[idx]; }
+    const char *end(int idx) const { return mEnd[idx]; }
+    int length(int idx) const { return static_cast<int>(mEnd[idx] - mBegin[idx]); }
+    char first(int idx) const { return (mBegin[idx] < mEnd[idx]) ? *mBegin[idx] : 0; }
+
+    //exact compare, ASCII case insensitive
+    bool equals(int idx, const char *text) const;
+    bool contains(int idx, const char *text) const;
+    bool startsWith(int idx, const char *text) const;
+
+    //these return false if the token isn't a number in its entirety. value is left at 0 then
+    bool toHex(int idx, uint64_t &value) const { return parseHex(mBegin[idx], mEnd[idx], value); }
+    bool toUInt(int idx, uint64_t &value) const { return parseUInt(mBegin[idx], mEnd[idx], value); }
+    bool toInt(int idx, int &value) const;
+    bool toSecondsUs(int idx, uint64_t &value) const { return parseSecondsUs(mBegin[idx], mEnd[idx], value); }
+
+    //moves begin and end past the white space around [begin, end)
+    static void trim(const char *&begin, const char *&end);
+
+    //hex and decimal digits only, no prefix or sign
+    static bool parseHex(const char *begin, const char *end, uint64_t &value);
+    static bool parseUInt(const char *begin, const char *end, uint64_t &value);
+    //seconds with an optional fraction ("12.345678") to microseconds. Digits past the sixth decimal are ignored
+    static bool parseSecondsUs(const char *begin, const char *end, uint64_t &value);
+
+private:
+    int mCount;
+    const char *mBegin[MAX_TOKENS];
+    const char *mEnd[MAX_TOKENS];
+};
+
+/*
+ * One text log format. parseLine() is called from several threads at once so it must not change the grammar.
+ * Anything the header says about the rest of the file is worked out in headerLength(), which runs once before
+ * the lines are parsed. State that has to carry from one line to the next belongs in finishFrames().
+ */
+class TextLogGrammar
+{
+public:
+    enum LineResult
+    {
+        LINE_FRAME,     //frame was filled in
+        LINE_DAMAGED,   //frame was filled in as far as the line went. It is kept but the load reports errors
+        LINE_SKIP,      //nothing in this line (comment, event, blank)
+        LINE_ERROR      //looked like a frame but didn't parse. The load reports errors
+    };
+
+    virtual ~TextLogGrammar() {}
+
+    //how many bytes at the start of the file are header and not frames
+    virtual qint64 headerLength(const char *data, qint64 size) { Q_UNUSED(data); Q_UNUSED(size); return 0; }
+
+    //line is without its line ending. frame comes in default constructed
+    virtual LineResult parseLine(const char *begin, const char *end, CANFrame &frame) const = 0;
+
+    //called with the frames of every chunk, in file order and from the reading thread only
+    virtual void finishFrames(CANFrame *frames, int count) { Q_UNUSED(frames); Q_UNUSED(count); }
+
+    //what ends a line. A '\r' just before a '\n' is dropped, so '\n' covers both Unix and DOS files
+    virtual char lineEnd() const { return '\n'; }
+
+    //true for formats where a file without a single frame is broken rather than empty. The load reports errors then
+    virtual bool requiresFrames() const { return false; }
+
+    //length of the first line including its line ending
+    static qint64 lineLength(const char *data, qint64 size, char eol = '\n');
+};
+
+class TextLogReader : public FrameReader
+{
+public:
+    static const int CHUNK_BYTES = 2 * 1024 * 1024;
+
+    explicit TextLogReader(TextLogGrammar *grammar); //takes ownership of the grammar
+
+    bool open(const QString &filename);
+
+    int read(CANFrame *frames, int max) override;
+    bool isOk() const override { return mOk; }
+    qint64 position() const override { return mPosition; }
+    qint64 size() const override { return mSize; }
+
+private:
+    Q_DISABLE_COPY(TextLogReader)
+
+    struct Chunk
+    {
+        const char *begin;
+        const char *end;
+        const TextLogGrammar *grammar;
+        char eol;
+        QVector<CANFrame> frames;
+        bool errors;
+    };
+
+    static void parseChunk(Chunk &chunk);
+    bool fill();
+
+    QScopedPointer<TextLogGrammar> mGrammar;
+    QFile mFile;
+    QByteArray mText;           //the window. Starts at a line, may end with the start of a line the next one finishes
+    QVector<Chunk> mChunks;     //of the window, parsed
+    int mChunkCount;
+    int mChunk;                 //next frame to hand out is mChunks[mChunk].frames[mFramePos]
+    int mFramePos;
+    bool mHeaderDone;
+    bool mAtEnd;
+    bool mOk;
+    qint64 mFrames;             //handed out so far, see TextLogGrammar::requiresFrames()
+    qint64 mPosition;
+    qint64 mSize;
+};
+
+#endif // TEXTLOGPARSER_H
@@ -3,21 +3,34 @@
 
 #include <QObject>
 #include <QDebug>
+#include <QAtomicInteger>
 
 
-/* macros */
-#define IS_EMPTY()  (  mWIdx.load()             == mRIdx.load() )
-#define IS_FULL()   ( (mWIdx.load()+1)%mSize    == mRIdx.load() )
+/* size of a cache line on everything we run on. Used to keep the reader and writer indices apart */
+#define LFQUEUE_CACHE_LINE  64
 
 
+/*
+ * Single producer / single consumer lock free ring.
+ *
+ * The capacity is always a power of two so the position in the array is just (index & mask). The read and
+ * write indices run freely (they are only masked when used) which means the whole array is usable and
+ * "full" is simply wIdx - rIdx == size. Each side keeps the indices it writes on its own cache line along
+ * with a private copy of the other side's index so the common case doesn't touch the other thread's line.
+ *
+ * Besides the one at a time get()/queue() and peek()/dequeue() there is a bulk API: reserve() hands out
+ * up to N contiguous free slots which are published with a single commit(), and peekBulk() hands out up
+ * to N contiguous filled slots which are released with a single consume().
+ */
 template<class T>
 class LFQueue
 {
 public:
-    LFQueue() : mSize(0), mArray(nullptr){}
+    LFQueue() : mSize(0), mMask(0), mArray(nullptr), mCachedWIdx(0), mCachedRIdx(0) {}
 
     ~LFQueue() {setSize(0);}
 
+    /* size is rounded up to the next power of two */
     bool setSize(int size) {
         if(size<0)
             return false;
@@ -26,66 +39,157 @@ public:
             delete[] mArray;
             mArray = nullptr;
         }
+        mSize = 0;
+        mMask = 0;
+        flush();
 
         if(size>0) {
-            mArray = new T[size];
-            if(mArray)
-                mSize = size;
+            quint32 pow2 = 1;
+            while(pow2 < static_cast<quint32>(size))
+                pow2 <<= 1;
+
+            mArray = new T[pow2];
+            if(mArray) {
+                mSize = pow2;
+                mMask = pow2 - 1;
+            }
             return ( mArray != nullptr );
         }
 
         return true;
     }
 
+    int size() const { return static_cast<int>(mSize); }
+
+    /* number of filled slots. Only a snapshot when the other side is running */
+    int count() const { return static_cast<int>(mWIdx.loadAcquire() - mRIdx.loadAcquire()); }
+
     void flush() {
         mRIdx.store(0);
         mWIdx.store(0);
+        mCachedWIdx = 0;
+        mCachedRIdx = 0;
     }
 
+    /* producer side */
+
     T* get() {
-        if(IS_FULL())
+        int n;
+        return reserve(1, n);
+    }
+
+
+    void queue() {
+        commit(1);
+    }
+
+
+    /*
+     * Reserve up to pWanted contiguous slots. pCount is set to how many were actually handed out, which
+     * can be fewer than asked for if the queue is nearly full or the free space wraps around the end of
+     * the array. Returns nullptr (and pCount 0) if there is no room at all.
+     */
+    T* reserve(int pWanted, int& pCount) {
+        quint32 wIdx = mWIdx.load();
+        quint32 space = mSize - (wIdx - mCachedRIdx);
+
+        if(space < static_cast<quint32>(pWanted)) {
+            /* only look at the reader's index when our copy says we're short */
+            mCachedRIdx = mRIdx.loadAcquire();
+            space = mSize - (wIdx - mCachedRIdx);
+        }
+
+        quint32 pos = wIdx & mMask;
+        quint32 contiguous = mSize - pos;
+        quint32 num = qMin(qMin(space, contiguous), static_cast<quint32>(pWanted));
+
+        pCount = static_cast<int>(num);
+        if(num == 0)
             return nullptr;
 
-        return &(mArray[mWIdx.loadAcquire()]); /* prevent memory reordering (belt and braces) */
+        return &(mArray[pos]);
     }
 
 
-    void queue() {
+    /* publish pCount slots previously handed out by reserve() */
+    void commit(int pCount) {
+        quint32 wIdx = mWIdx.load();
+
         #ifdef QT_DEBUG
-        if(IS_FULL())
+        if( (wIdx - mRIdx.load()) + static_cast<quint32>(pCount) > mSize )
             qCritical() << "BUG: queueing in full queue";
         #endif
 
-        int wIdx = mWIdx.load();
-        mWIdx.storeRelease((wIdx+1)%mSize);
+        mWIdx.storeRelease(wIdx + static_cast<quint32>(pCount));
     }
 
 
+    /* consumer side */
+
     T* peek() {
-        if(IS_EMPTY())
+        int n;
+        return peekBulk(1, n);
+    }
+
+
+    void dequeue() {
+        consume(1);
+    }
+
+
+    /*
+     * Peek at up to pWanted contiguous filled slots. pCount is set to how many are available; the rest
+     * (if any) are returned by the next call once the ones before them are consumed.
+     */
+    T* peekBulk(int pWanted, int& pCount) {
+        quint32 rIdx = mRIdx.load();
+        quint32 avail = mCachedWIdx - rIdx;
+
+        if(avail < static_cast<quint32>(pWanted)) {
+            mCachedWIdx = mWIdx.loadAcquire();
+            avail = mCachedWIdx - rIdx;
+        }
+
+        quint32 pos = rIdx & mMask;
+        quint32 contiguous = mSize - pos;
+        quint32 num = qMin(qMin(avail, contiguous), static_cast<quint32>(pWanted));
+
+        pCount = static_cast<int>(num);
+        if(num == 0)
             return nullptr;
 
-        return &(mArray[mRIdx.loadAcquire()]); /* prevent memory reordering (belt and braces) */
+        return &(mArray[pos]);
     }
 
 
-    void dequeue() {
+    /* release pCount slots previously handed out by peekBulk() */
+    void consume(int pCount) {
+        quint32 rIdx = mRIdx.load();
+
         #ifdef QT_DEBUG
-        if(IS_EMPTY())
+        if( static_cast<quint32>(pCount) > mWIdx.load() - rIdx )
             qCritical() << "BUG: dequeueing an empty queue";
         #endif
 
-        int rIdx = mRIdx.load();
-        mRIdx.storeRelease((rIdx+1)%mSize);
+        mRIdx.storeRelease(rIdx + static_cast<quint32>(pCount));
     }
 
 
 private:
-    int mSize;
-    T*  mArray;
-
-    QAtomicInt mRIdx;
-    QAtomicInt mWIdx;
+    quint32 mSize;
+    quint32 mMask;
+    T*      mArray;
+
+    /* consumer's line */
+    char                    mPad0[LFQUEUE_CACHE_LINE];
+    QAtomicInteger<quint32> mRIdx;
+    quint32                 mCachedWIdx;
+
+    /* producer's line */
+    char                    mPad1[LFQUEUE_CACHE_LINE - sizeof(QAtomicInteger<quint32>) - sizeof(quint32)];
+    QAtomicInteger<quint32> mWIdx;
+    quint32                 mCachedRIdx;
+    char                    mPad2[LFQUEUE_CACHE_LINE - sizeof(QAtomicInteger<quint32>) - sizeof(quint32)];
 };
 
 #endif // LFQUEUE_H
@@ -0,0 +1,214 @@
+#include "tracer.h"
+
+#ifdef CANOA_TRACING
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <string.h>
+#include "connections/cantimebase.h"
+
+namespace {
+
+//events of one thread. Only the owning thread writes, the GUI thread may read below count as long as epoch is
+//the current one. The owner only rewinds when it finds a newer epoch, which only clear() on the GUI thread makes
+struct ThreadBuffer
+{
+    static const int BLOCK_BITS = 14;
+    static const int BLOCK_SIZE = 1 << BLOCK_BITS;
+    static const int BLOCK_MASK = BLOCK_SIZE - 1;
+    static const int MAX_BLOCKS = Tracer::MAX_EVENTS / BLOCK_SIZE;
+
+    Tracer::Event *blocks[MAX_BLOCKS];
+    QAtomicInt count;
+    QAtomicInteger<quint64> dropped;
+    QAtomicInt epoch; //clear() the events below count were recorded after
+    int tid;
+    QByteArray threadName;
+
+    ThreadBuffer() : count(0), dropped(0), epoch(0), tid(0)
+    {
+        memset(blocks, 0, sizeof(blocks));
+    }
+};
+
+//buffers are never freed. A thread that has finished may still have events that want exporting
+QMutex registryLock;
+QList<ThreadBuffer *> registry;
+QAtomicInt currentEpoch(0);
+thread_local ThreadBuffer *localBuffer = nullptr;
+
+ThreadBuffer *registerThread()
+{
+    ThreadBuffer *buffer = new ThreadBuffer;
+    QThread *thread = QThread::currentThread();
+    QMutexLocker lock(&registryLock);
+    registry.append(buffer);
+    buffer->tid = registry.count();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+        buffer->threadName = "GUI";
+    else if (!thread->objectName().isEmpty())
+        buffer->threadName = thread->objectName().toUtf8();
+    else
+        buffer->threadName = "Thread " + QByteArray::number(buffer->tid);
+    return buffer;
+}
+
+QList<ThreadBuffer *> buffers()
+{
+    QMutexLocker lock(&registryLock);
+    return registry;
+}
+
+//buffers that have recorded since the last clear(). The others are left alone, their owner may be rewinding them
+QList<ThreadBuffer *> currentBuffers()
+{
+    int epoch = currentEpoch.load();
+    QList<ThreadBuffer *> out;
+    foreach (ThreadBuffer *buffer, buffers())
+    {
+        if (buffer->epoch.loadAcquire() == epoch) out.append(buffer);
+    }
+    return out;
+}
+
+void appendEscaped(QByteArray &out, const char *text)
+{
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\') out.append('\\');
+        out.append(*c);
+    }
+}
+
+//ns -> the fractional microseconds the trace format wants
+void appendMicros(QByteArray &out, qint64 ns)
+{
+    out.append(QByteArray::number(ns / 1000));
+    out.append('.');
+    int frac = static_cast<int>(ns % 1000);
+    out.append(static_cast<char>('0' + frac / 100));
+    out.append(static_cast<char>('0' + (frac / 10) % 10));
+    out.append(static_cast<char>('0' + frac % 10));
+}
+
+}
+
+bool Tracer::isCompiledIn()
+{
+    return true;
+}
+
+qint64 Tracer::now()
+{
+    return CANTimebase::nowNs();
+}
+
+void Tracer::record(const char *name, qint64 start, qint64 end)
+{
+    ThreadBuffer *buffer = localBuffer;
+    if (!buffer) buffer = localBuffer = registerThread();
+
+    int epoch = currentEpoch.loadAcquire();
+    if (buffer->epoch.load() != epoch)
+    {
+        //cleared since this thread last recorded. Keeps the blocks, they get written over
+        buffer->count.store(0);
+        buffer->dropped.store(0);
+        buffer->epoch.storeRelease(epoch); //readers that see the new epoch see the rewound count
+    }
+
+    int num = buffer->count.load();
+    if (num >= MAX_EVENTS)
+    {
+        buffer->dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+    int block = num >> ThreadBuffer::BLOCK_BITS;
+    if (!buffer->blocks[block]) buffer->blocks[block] = new Event[ThreadBuffer::BLOCK_SIZE];
+    Event &event = buffer->blocks[block][num & ThreadBuffer::BLOCK_MASK];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    buffer->count.storeRelease(num + 1); //publishes the event and the block it went into
+}
+
+void Tracer::clear()
+{
+    currentEpoch.fetchAndAddOrdered(1);
+}
+
+quint64 Tracer::recordedEvents()
+{
+    quint64 total = 0;
+    foreach (ThreadBuffer *buffer, currentBuffers()) total += static_cast<quint64>(buffer->count.loadAcquire());
+    return total;
+}
+
+quint64 Tracer::droppedEvents()
+{
+    quint64 total = 0;
+    foreach (ThreadBuffer *buffer, currentBuffers()) total += buffer->dropped.load();
+    return total;
+}
+
+bool Tracer::exportChromeTrace(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray out;
+    out.reserve(1 << 20);
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    foreach (ThreadBuffer *buffer, buffers())
+    {
+        if (!first) out.append(",\n");
+        first = false;
+        out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        out.append(QByteArray::number(buffer->tid));
+        out.append(",\"args\":{\"name\":\"");
+        appendEscaped(out, buffer->threadName.constData());
+        out.append("\"}}");
+
+        //threads that haven't recorded since the last clear() are still named, just without events
+        int num = buffer->epoch.loadAcquire() == currentEpoch.load() ? buffer->count.loadAcquire() : 0;
+        for (int i = 0; i < num; i++)
+        {
+            const Event &event = buffer->blocks[i >> ThreadBuffer::BLOCK_BITS][i & ThreadBuffer::BLOCK_MASK];
+            out.append(",\n{\"name\":\"");
+            appendEscaped(out, event.name);
+            out.append("\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            out.append(QByteArray::number(buffer->tid));
+            out.append(",\"ts\":");
+            appendMicros(out, event.start);
+            out.append(",\"dur\":");
+            appendMicros(out, event.duration);
+            out.append('}');
+            if (out.size() > (1 << 20) - 256)
+            {
+                if (file.write(out) != out.size()) return false;
+                out.resize(0);
+            }
+        }
+    }
+    out.append("\n]}\n");
+    return file.write(out) == out.size();
+}
+
+#else
+
+bool Tracer::isCompiledIn() { return false; }
+qint64 Tracer::now() { return 0; }
+void Tracer::record(const char *, qint64, qint64) {}
+void Tracer::clear() {}
+quint64 Tracer::recordedEvents() { return 0; }
+quint64 Tracer::droppedEvents() { return 0; }
+bool Tracer::exportChromeTrace(const QString &) { return false; }
+
+#endif
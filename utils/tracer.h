@@ -0,0 +1,73 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <stdint.h>
+
+/*
+ * Scoped timers for the stages a frame goes through (driver read, queue drain, model insert, refilter, GUI
+ * refresh, DBC decode, file I/O) that can be dumped as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+ * to see where the time goes under a heavy bus load.
+ *
+ * Tracing only exists in builds made with "qmake CONFIG+=tracing" (which defines CANOA_TRACING). In every other
+ * build TRACE_SCOPE expands to nothing at all so the instrumented code costs exactly what it did before.
+ *
+ * TRACE_SCOPE("name") at the top of a block records one event covering the time until the block is left.
+ * Each thread records into a buffer of its own so recording never takes a lock or shares a cache line with
+ * another thread. The buffer grows a block at a time and publishes its count with a release store so
+ * exportChromeTrace() can read it from the GUI thread while the owner keeps on recording. Once a thread has
+ * recorded MAX_EVENTS events every further event of that thread is dropped and counted, see droppedEvents().
+ * clear() only starts a new epoch, each thread rewinds its own buffer to the start the next time it records, so
+ * a trace can be taken again and again without running out of room. clear(), recordedEvents(), droppedEvents()
+ * and exportChromeTrace() all have to be called from the same (GUI) thread.
+ * The name is not copied so it has to be a string literal.
+ */
+class Tracer
+{
+public:
+    static const int MAX_EVENTS = 1 << 20; //per thread, 24MB worth of events
+
+    struct Event
+    {
+        const char *name;
+        qint64 start;    //ns on the now() clock, which is CANTimebase::nowNs() so traces line up with frame latencies
+        qint64 duration; //ns
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name) : mName(name), mStart(now()) {}
+        ~Scope() { record(mName, mStart, now()); }
+    private:
+        Q_DISABLE_COPY(Scope)
+        const char *mName;
+        qint64 mStart;
+    };
+
+    //true if this build was made with tracing, otherwise everything below does nothing
+    static bool isCompiledIn();
+
+    static qint64 now();
+    static void record(const char *name, qint64 start, qint64 end);
+
+    //start over. Events recorded so far are left out of the next export and their room is reused
+    static void clear();
+
+    //events recorded since the last clear() and events dropped because a thread's buffer was full
+    static quint64 recordedEvents();
+    static quint64 droppedEvents();
+
+    //writes everything recorded since the last clear() in the Chrome trace event format
+    static bool exportChromeTrace(const QString &filename);
+};
+
+#ifdef CANOA_TRACING
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) Tracer::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#endif
+
+#endif // TRACER_H